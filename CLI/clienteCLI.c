@@ -2,9 +2,17 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
 #include "../src/utils/headers/coap_api.h"
+#include "../src/utils/headers/coap_client.h"
+#include "../src/utils/headers/histogram.h"
+#include "../src/utils/headers/shm_table.h"
+#include "../src/utils/headers/change_feed.h"
 
 #define INPUT_SIZE 512
+#define BATCH_DEFAULT_INFLIGHT 32
 
 void print_help(void) {
     printf("\n=== CoAP CLI Client Interactivo ===\n");
@@ -15,6 +23,15 @@ void print_help(void) {
     printf("  delete <host> <port> <path> <con|non>\n");
     printf("  help - Mostrar esta ayuda\n");
     printf("  quit/exit - Salir del programa\n\n");
+
+    printf("Modo batch (mismos comandos, uno por línea, desde archivo o stdin):\n");
+    printf("  clienteCLI --batch <archivo|-> [--inflight N] [--timeout ms] [--retries N]\n\n");
+
+    printf("Lectura local de la tabla compartida del servidor (--shm-table):\n");
+    printf("  clienteCLI --shm <nombre> [--key <path>]\n\n");
+
+    printf("Suscripción al change feed del servidor (--feed-socket):\n");
+    printf("  clienteCLI --feed <socket> [--from <seq> --epoch <época>]\n\n");
     
     printf("Ejemplos:\n");
     printf("  get 127.0.0.1 5683 /sensors/temp con\n");
@@ -48,7 +65,7 @@ int validate_port(const char *port_str) {
     return 1;
 }
 
-int main(void) {
+static int run_interactive(void) {
     char line[INPUT_SIZE];
 
     printf("=== CoAP CLI Client Interactivo ===\n");
@@ -128,3 +145,301 @@ int main(void) {
     printf(" Saliendo...\n");
     return 0;
 }
+
+// ---------------------------------------------------------------------------
+// Modo batch: comandos leídos de un archivo o stdin, hasta N en vuelo
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    uint64_t sent;
+    uint64_t ok;
+    uint64_t timeouts;
+    uint64_t non_unanswered;    // NON sin respuesta (el servidor no responde NON)
+    uint64_t resets;
+    uint64_t send_errors;
+    uint64_t invalid_lines;
+    uint64_t by_code[256];
+    Histogram latency_us;
+} BatchStats;
+
+typedef struct {
+    BatchStats *stats;
+    long line_no;
+    int confirmable;
+} BatchRequest;
+
+static void on_batch_response(const CoapClientResult *result, void *user) {
+    BatchRequest *req = (BatchRequest *)user;
+    BatchStats *st = req->stats;
+    switch (result->status) {
+        case COAP_CLIENT_OK: {
+            uint8_t code = result->response->code;
+            st->by_code[code]++;
+            hist_record(&st->latency_us, result->latency_us);
+            if ((code >> 5) == 2) {
+                st->ok++;
+            } else {
+                printf(" [línea %ld] respuesta %d.%02d: %.*s\n", req->line_no, code >> 5, code & 0x1F,
+                       result->response->payload_len, result->response->payload);
+            }
+            break;
+        }
+        case COAP_CLIENT_TIMEOUT:
+            if (req->confirmable) {
+                st->timeouts++;
+                printf(" [línea %ld] timeout tras %d retransmisiones\n", req->line_no, result->retransmissions);
+            } else {
+                st->non_unanswered++;
+            }
+            break;
+        case COAP_CLIENT_RESET:
+            st->resets++;
+            printf(" [línea %ld] RST del servidor\n", req->line_no);
+            break;
+        default:
+            st->send_errors++;
+            printf(" [línea %ld] error de envío\n", req->line_no);
+            break;
+    }
+    free(req);
+}
+
+static uint64_t monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+static void print_batch_summary(const BatchStats *st, uint64_t elapsed_us) {
+    double secs = elapsed_us / 1e6;
+    uint64_t completed = st->sent;
+    printf("\n=== Resumen batch ===\n");
+    printf("Requests: %llu en %.3f s (%.0f req/s)\n", (unsigned long long)completed, secs,
+           secs > 0 ? completed / secs : 0.0);
+    printf("OK (2.xx): %llu  Timeouts: %llu  RST: %llu  Errores de envío: %llu  NON sin respuesta: %llu\n",
+           (unsigned long long)st->ok, (unsigned long long)st->timeouts, (unsigned long long)st->resets,
+           (unsigned long long)st->send_errors, (unsigned long long)st->non_unanswered);
+    if (st->invalid_lines > 0) {
+        printf("Líneas inválidas (ignoradas): %llu\n", (unsigned long long)st->invalid_lines);
+    }
+    printf("Códigos de respuesta:");
+    for (int code = 0; code < 256; code++) {
+        if (st->by_code[code]) {
+            printf(" %d.%02d=%llu", code >> 5, code & 0x1F, (unsigned long long)st->by_code[code]);
+        }
+    }
+    printf("\n");
+    if (hist_count(&st->latency_us) > 0) {
+        printf("Latencia (us): p50=%llu p90=%llu p99=%llu p99.9=%llu max=%llu\n",
+               (unsigned long long)hist_percentile(&st->latency_us, 50.0),
+               (unsigned long long)hist_percentile(&st->latency_us, 90.0),
+               (unsigned long long)hist_percentile(&st->latency_us, 99.0),
+               (unsigned long long)hist_percentile(&st->latency_us, 99.9),
+               (unsigned long long)hist_max(&st->latency_us));
+    }
+}
+
+static int run_batch(const char *source, int inflight, int timeout_ms, int retries) {
+    FILE *in = strcmp(source, "-") == 0 ? stdin : fopen(source, "r");
+    if (!in) {
+        perror(source);
+        return 1;
+    }
+
+    CoapTxParams params;
+    coap_tx_params_default(&params);
+    params.nstart = inflight;   // todo el pipeline puede ir al mismo servidor
+    if (timeout_ms > 0) params.ack_timeout_ms = timeout_ms;
+    if (retries >= 0) params.max_retransmit = retries;
+    CoapClient *client = coap_client_create(&params);
+    if (!client) {
+        fprintf(stderr, "No se pudo crear el cliente CoAP\n");
+        if (in != stdin) fclose(in);
+        return 1;
+    }
+    coap_client_set_response_timeout(client, params.ack_timeout_ms);
+
+    static BatchStats stats;
+    memset(&stats, 0, sizeof(stats));
+    hist_init(&stats.latency_us);
+
+    char line[INPUT_SIZE];
+    long line_no = 0;
+    uint64_t start = monotonic_us();
+    while (fgets(line, sizeof(line), in)) {
+        line_no++;
+        line[strcspn(line, "\r\n")] = 0;
+        char *cmd = line;
+        while (*cmd == ' ' || *cmd == '\t') cmd++;
+        if (*cmd == '\0' || *cmd == '#') continue;
+
+        char *method = strtok(cmd, " ");
+        char *host = strtok(NULL, " ");
+        char *port_str = strtok(NULL, " ");
+        char *path = strtok(NULL, " ");
+        char *mode = strtok(NULL, " ");
+        char *payload = strtok(NULL, "");
+
+        struct sockaddr_in server;
+        memset(&server, 0, sizeof(server));
+        server.sin_family = AF_INET;
+        if (!method || !host || !port_str || !path || !mode ||
+            !validate_method(method) || !validate_port(port_str) || !validate_mode(mode) ||
+            inet_pton(AF_INET, host, &server.sin_addr) != 1) {
+            printf(" [línea %ld] comando inválido, ignorado\n", line_no);
+            stats.invalid_lines++;
+            continue;
+        }
+        server.sin_port = htons(atoi(port_str));
+
+        // Respetar la ventana: procesar respuestas hasta que haya lugar
+        while (coap_client_pending(client) >= (size_t)inflight) coap_client_poll(client, -1);
+
+        BatchRequest *req = malloc(sizeof(BatchRequest));
+        if (!req) break;
+        req->stats = &stats;
+        req->line_no = line_no;
+        req->confirmable = strcmp(mode, "con") == 0 || strcmp(mode, "CON") == 0;
+        if (coap_client_request(client, &server, (uint8_t)coap_parse_method(method), path,
+                                req->confirmable, payload, on_batch_response, req) != 0) {
+            printf(" [línea %ld] error al enviar\n", line_no);
+            stats.send_errors++;
+            free(req);
+            continue;   // no salió: no cuenta como enviado
+        }
+        stats.sent++;
+        coap_client_poll(client, 0);
+    }
+    coap_client_run(client);
+    uint64_t elapsed = monotonic_us() - start;
+
+    print_batch_summary(&stats, elapsed);
+    coap_client_destroy(client);
+    if (in != stdin) fclose(in);
+    return (stats.timeouts || stats.resets || stats.send_errors) ? 2 : 0;
+}
+
+static void batch_usage(const char *prog) {
+    fprintf(stderr, "Uso: %s --batch <archivo|-> [--inflight N] [--timeout ms] [--retries N]\n", prog);
+    fprintf(stderr, "     %s --shm <nombre> [--key <path>]\n", prog);
+    fprintf(stderr, "     %s --feed <socket> [--from <seq> --epoch <época>]\n", prog);
+}
+
+typedef struct {
+    uint64_t seq;
+    uint64_t epoch;
+} FeedPosition;
+
+static int print_change(const FeedChange *c, void *ctx) {
+    FeedPosition *last = (FeedPosition *)ctx;
+    last->seq = c->seq;
+    last->epoch = c->epoch;
+    printf("%llu\t%s\t%.*s\tv%u\t%.*s\n", (unsigned long long)c->seq,
+           c->op == FEED_OP_DELETE ? "del" : "set", (int)c->key_len, c->key, c->version,
+           (int)c->value_len, c->value);
+    fflush(stdout);
+    return 0;
+}
+
+// Imprime los cambios del store a medida que llegan: seq, op, clave, versión,
+// valor. Para reanudar: --from <último + 1> --epoch <la que se informa al salir>.
+static int run_feed(const char *path, uint64_t from, uint64_t epoch) {
+    int fd = change_feed_subscribe(path, from, epoch);
+    if (fd < 0) {
+        fprintf(stderr, "No se pudo conectar al change feed %s\n", path);
+        return 1;
+    }
+    FeedPosition last = {0, epoch};
+    uint64_t oldest = 0;
+    int rc = change_feed_consume(fd, print_change, &last, &oldest);
+    close(fd);
+    if (rc == FEED_FRAME_GAP) {
+        fprintf(stderr, "Atrasado: el cambio más viejo disponible es %llu (último recibido %llu)\n",
+                (unsigned long long)oldest, (unsigned long long)last.seq);
+        return 2;
+    }
+    if (rc == FEED_FRAME_RESET) {
+        fprintf(stderr, "El servidor se reinició: la secuencia %llu de la época %llu ya no existe "
+                "(resincronizar y suscribirse desde 0)\n",
+                (unsigned long long)from, (unsigned long long)epoch);
+        return 2;
+    }
+    fprintf(stderr, "El servidor cerró el feed (último cambio %llu, época %llu)\n",
+            (unsigned long long)last.seq, (unsigned long long)last.epoch);
+    return 0;
+}
+
+static int print_shm_value(const ShmValue *v, void *ctx) {
+    size_t *live = (size_t *)ctx;
+    if (v->flags & SHM_SLOT_DELETED) return 0;
+    (*live)++;
+    if (v->flags & SHM_SLOT_TOO_LARGE) printf("%s\t(valor grande: usar GET)\n", v->key);
+    else printf("%s\t%s\n", v->key, v->value);
+    return 0;
+}
+
+// Lee la tabla de últimos valores sin pasar por CoAP: una clave o todas
+static int run_shm(const char *name, const char *key) {
+    ShmTable *t = shm_table_open(name);
+    if (!t) {
+        fprintf(stderr, "No se pudo abrir la tabla compartida %s\n", name);
+        return 1;
+    }
+    int rc = 0;
+    if (key) {
+        char value[SHM_VALUE_MAX + 1];
+        uint64_t version = 0;
+        int n = shm_table_get(t, key, value, sizeof(value), &version);
+        if (n >= 0) {
+            printf("%s (versión %llu)\n", value, (unsigned long long)version);
+        } else {
+            fprintf(stderr, "%s: %s\n", key, n == SHM_TOO_LARGE ? "valor grande, usar GET" : "no existe");
+            rc = 2;
+        }
+    } else {
+        size_t live = 0;
+        uint64_t start = monotonic_us();
+        size_t visited = shm_table_scan(t, print_shm_value, &live);
+        fprintf(stderr, "%zu valores (%zu slots) en %.2f ms\n", live, visited,
+                (double)(monotonic_us() - start) / 1000.0);
+    }
+    shm_table_close(t, 0);
+    return rc;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1) {
+        const char *source = NULL, *shm = NULL, *key = NULL, *feed = NULL;
+        unsigned long long from = 0, epoch = 0;
+        int inflight = BATCH_DEFAULT_INFLIGHT, timeout_ms = 0, retries = -1;
+        for (int i = 1; i < argc; i++) {
+            if (i + 1 >= argc) {
+                batch_usage(argv[0]);
+                return 1;
+            }
+            if (strcmp(argv[i], "--batch") == 0) source = argv[++i];
+            else if (strcmp(argv[i], "--inflight") == 0) inflight = atoi(argv[++i]);
+            else if (strcmp(argv[i], "--timeout") == 0) timeout_ms = atoi(argv[++i]);
+            else if (strcmp(argv[i], "--retries") == 0) retries = atoi(argv[++i]);
+            else if (strcmp(argv[i], "--shm") == 0) shm = argv[++i];
+            else if (strcmp(argv[i], "--key") == 0) key = argv[++i];
+            else if (strcmp(argv[i], "--feed") == 0) feed = argv[++i];
+            else if (strcmp(argv[i], "--from") == 0) from = strtoull(argv[++i], NULL, 10);
+            else if (strcmp(argv[i], "--epoch") == 0) epoch = strtoull(argv[++i], NULL, 10);
+            else {
+                batch_usage(argv[0]);
+                return 1;
+            }
+        }
+        if (shm) return run_shm(shm, key);
+        if (feed) return run_feed(feed, (uint64_t)from, (uint64_t)epoch);
+        if (!source) {
+            batch_usage(argv[0]);
+            return 1;
+        }
+        if (inflight < 1) inflight = 1;
+        return run_batch(source, inflight, timeout_ms, retries);
+    }
+
+    return run_interactive();
+}
@@ -0,0 +1,577 @@
+// Generador de carga open-loop para el servidor CoAP.
+//
+// Cada thread tiene su propio loop epoll y un puñado de sockets UDP que
+// multiplexan miles de dispositivos virtuales. Los envíos siguen un calendario
+// fijo (tasa objetivo) sin esperar respuestas, y la latencia se mide desde el
+// instante en que el request *debía* salir: así un servidor lento no frena al
+// generador ni esconde su cola (corrección de coordinated omission).
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+
+#include "message.h"
+#include "histogram.h"
+#include "workload.h"
+
+#define LG_TOKEN_LEN     8
+#define LG_MAX_SOCKETS   64
+#define LG_MAX_RETRIES   4
+#define LG_PACKET_SIZE   512
+#define LG_RECV_BATCH    64
+
+typedef struct {
+    const char *host;
+    int port;
+    const char *path;
+    double rate;            // requests/s totales
+    int duration_s;
+    long devices;           // dispositivos virtuales
+    int threads;
+    int sockets;            // sockets por thread
+    int confirmable;        // modo por defecto si el perfil no fija la mezcla
+    const char *profile_spec;
+    int timeout_ms;         // ACK_TIMEOUT inicial
+    int max_retries;
+    uint32_t window;        // requests en vuelo por thread (potencia de 2)
+} LoadgenConfig;
+
+// Un slot por request en vuelo, indexado por seq & mask
+typedef struct {
+    uint64_t seq;
+    uint64_t intended_ns;   // instante programado (para la latencia corregida)
+    uint64_t sent_ns;       // último envío real
+    uint8_t retries;
+    uint8_t pending;
+    uint16_t len;
+    uint8_t packet[LG_PACKET_SIZE];
+} Slot;
+
+// Cola FIFO de seqs por nivel de retransmisión: todos los elementos de un
+// nivel tienen el mismo timeout, así que sus deadlines quedan ordenados.
+typedef struct {
+    uint64_t *seqs;
+    uint64_t *deadlines;
+    uint32_t head, tail, mask;
+} TimeoutQueue;
+
+typedef struct {
+    int id;
+    const LoadgenConfig *cfg;
+    struct sockaddr_in server;
+    int epfd;
+    int socks[LG_MAX_SOCKETS];
+    Slot *slots;
+    uint32_t mask;
+    TimeoutQueue queues[LG_MAX_RETRIES + 1];
+
+    uint64_t rng;
+    uint64_t outstanding;   // CON sin resolver
+    uint64_t sent, sent_non, responses, lost, retransmits, errors, late_responses, send_failures;
+    uint64_t by_method[5];
+    Histogram corrected;
+    Histogram uncorrected;
+} Worker;
+
+static WorkloadProfile profile;
+// Un request que no se pudo codificar corta la corrida en todos los threads
+static atomic_int run_aborted;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Delta o largo de opción (RFC 7252 3.1), como en message.c: 0-12 van en
+// el nibble, 13 = un byte extra (+13), 14 = dos bytes extra (+269)
+static uint8_t option_nibble(size_t v, uint8_t *ext, size_t *ext_len)
+{
+    if (v < 13) return (uint8_t)v;
+    if (v < 269) {
+        ext[(*ext_len)++] = (uint8_t)(v - 13);
+        return 13;
+    }
+    ext[(*ext_len)++] = (uint8_t)((v - 269) >> 8);
+    ext[(*ext_len)++] = (uint8_t)(v - 269);
+    return 14;
+}
+
+static int put_option(uint8_t *p, size_t size, size_t *off, int delta, const void *value, size_t len)
+{
+    uint8_t ext[4];
+    size_t ext_len = 0;
+    uint8_t d = option_nibble((size_t)delta, ext, &ext_len);
+    uint8_t l = option_nibble(len, ext, &ext_len);
+    if (len > 65535 + 269 || *off + 1 + ext_len + len > size) return -1;
+    p[(*off)++] = (uint8_t)((d << 4) | l);
+    memcpy(p + *off, ext, ext_len);
+    *off += ext_len;
+    memcpy(p + *off, value, len);
+    *off += len;
+    return 0;
+}
+
+// Codifica un request directamente en el buffer del slot (sin mallocs).
+// -1 si la URI o el payload no entran: un request recortado mediría otra
+// cosa, así que la corrida se aborta.
+static int encode_request(uint8_t *p, size_t size, const WorkloadOp *op, uint16_t mid, uint64_t token,
+                          const char *path, const char *payload, int payload_len)
+{
+    size_t off = 0;
+    if (size < 4 + LG_TOKEN_LEN) return -1;
+    p[off++] = (uint8_t)((1 << 6) | ((op->confirmable ? 0 : 1) << 4) | LG_TOKEN_LEN);
+    p[off++] = op->method;
+    p[off++] = (uint8_t)(mid >> 8);
+    p[off++] = (uint8_t)mid;
+    for (int i = 0; i < LG_TOKEN_LEN; i++) p[off++] = (uint8_t)(token >> (56 - 8 * i));
+
+    int last_number = 0;
+    const char *s = path;
+    while (*s == '/') s++;
+    while (*s) {
+        const char *start = s;
+        while (*s && *s != '/') s++;
+        size_t len = (size_t)(s - start);
+        if (len) {
+            if (put_option(p, size, &off, 11 - last_number, start, len) != 0) return -1;
+            last_number = 11;
+        }
+        while (*s == '/') s++;
+    }
+    if (payload && payload_len > 0) {
+        const uint8_t json = 50;  // application/json
+        if (put_option(p, size, &off, 12 - last_number, &json, 1) != 0) return -1;
+        if (off + 1 + (size_t)payload_len > size) return -1;
+        p[off++] = 0xFF;
+        memcpy(p + off, payload, (size_t)payload_len);
+        off += (size_t)payload_len;
+    }
+    return (int)off;
+}
+
+static int queue_init(TimeoutQueue *q, uint32_t capacity)
+{
+    q->seqs = calloc(capacity, sizeof(uint64_t));
+    q->deadlines = calloc(capacity, sizeof(uint64_t));
+    q->head = q->tail = 0;
+    q->mask = capacity - 1;
+    return (q->seqs && q->deadlines) ? 0 : -1;
+}
+
+static void queue_push(TimeoutQueue *q, uint64_t seq, uint64_t deadline)
+{
+    // Si la cola está llena el elemento más viejo se pierde: su slot ya fue
+    // reutilizado por la ventana de envíos, así que no tiene efecto
+    if (q->tail - q->head > q->mask) q->head++;
+    q->seqs[q->tail & q->mask] = seq;
+    q->deadlines[q->tail & q->mask] = deadline;
+    q->tail++;
+}
+
+static int send_slot(Worker *w, Slot *s)
+{
+    int sock = w->socks[s->seq % (uint64_t)w->cfg->sockets];
+    // Se marca antes de sendto: en loopback el kernel puede entregar y
+    // procesar el datagrama antes de que sendto retorne
+    s->sent_ns = now_ns();
+    ssize_t r = sendto(sock, s->packet, s->len, 0, (struct sockaddr*)&w->server, sizeof(w->server));
+    if (r < 0) {
+        w->send_failures++;
+        return -1;
+    }
+    return 0;
+}
+
+static int issue_request(Worker *w, uint64_t seq, uint64_t intended_ns)
+{
+    Slot *s = &w->slots[seq & w->mask];
+    if (s->pending) {
+        // La ventana dio la vuelta con el request anterior sin resolver
+        s->pending = 0;
+        w->outstanding--;
+        w->lost++;
+    }
+    s->seq = seq;
+    s->intended_ns = intended_ns;
+    s->retries = 0;
+
+    WorkloadOp op;
+    workload_next(&profile, &w->rng, &op);
+    char uri[LG_PACKET_SIZE];
+    if (workload_uri(&profile, op.uri_index, w->cfg->path, uri, sizeof(uri)) >= (int)sizeof(uri)) {
+        fprintf(stderr, "La URI %s... no entra en %d bytes: se aborta la corrida\n", uri, LG_PACKET_SIZE);
+        return -1;
+    }
+
+    char payload[128];
+    int plen = 0;
+    if (op.method == 2 || op.method == 3) {
+        long device = (long)(seq % (uint64_t)w->cfg->devices) + 1;
+        int temp_tenths = 180 + (int)(seq % 110);
+        plen = snprintf(payload, sizeof(payload), "{\"id\":\"esp32-%ld\",\"seq\":%llu,\"temp_c\":%d.%d}",
+                        device, (unsigned long long)seq, temp_tenths / 10, temp_tenths % 10);
+    }
+    // Token = (thread << 56) | seq
+    uint64_t token = ((uint64_t)w->id << 56) | (seq & 0x00FFFFFFFFFFFFFFULL);
+    int len = encode_request(s->packet, sizeof(s->packet), &op, (uint16_t)seq, token, uri, payload, plen);
+    if (len < 0) {
+        fprintf(stderr, "El request a %s (payload de %d bytes) no entra en %d bytes: se aborta la corrida\n",
+                uri, plen, LG_PACKET_SIZE);
+        return -1;
+    }
+    s->len = (uint16_t)len;
+
+    if (send_slot(w, s) == 0) {
+        w->sent++;
+        w->by_method[op.method]++;
+        if (!op.confirmable) w->sent_non++;
+        s->pending = op.confirmable ? 1 : 0;
+        w->outstanding += s->pending;
+        if (s->pending) queue_push(&w->queues[0], seq, s->sent_ns + (uint64_t)w->cfg->timeout_ms * 1000000ULL);
+    } else {
+        s->pending = 0;
+    }
+    return 0;
+}
+
+static void expire_timeouts(Worker *w, uint64_t now)
+{
+    for (int level = 0; level <= w->cfg->max_retries; level++) {
+        TimeoutQueue *q = &w->queues[level];
+        while (q->head != q->tail && q->deadlines[q->head & q->mask] <= now) {
+            uint64_t seq = q->seqs[q->head & q->mask];
+            q->head++;
+            Slot *s = &w->slots[seq & w->mask];
+            if (!s->pending || s->seq != seq || s->retries != level) continue;
+            if (level < w->cfg->max_retries) {
+                // Backoff exponencial: cada reintento duplica el timeout
+                s->retries++;
+                w->retransmits++;
+                send_slot(w, s);
+                uint64_t timeout = (uint64_t)w->cfg->timeout_ms * 1000000ULL << s->retries;
+                queue_push(&w->queues[level + 1], seq, s->sent_ns + timeout);
+            } else {
+                s->pending = 0;
+                w->outstanding--;
+                w->lost++;
+            }
+        }
+    }
+}
+
+static void handle_datagram(Worker *w, const uint8_t *buf, ssize_t n, uint64_t now)
+{
+    if (n < 4) return;
+    int tkl = buf[0] & 0x0F;
+    if (tkl != LG_TOKEN_LEN || n < 4 + tkl) return;
+    uint64_t token = 0;
+    for (int i = 0; i < LG_TOKEN_LEN; i++) token = (token << 8) | buf[4 + i];
+    if ((int)(token >> 56) != w->id) return;
+    uint64_t seq = token & 0x00FFFFFFFFFFFFFFULL;
+
+    Slot *s = &w->slots[seq & w->mask];
+    if (!s->pending || s->seq != seq) {
+        // Duplicado por retransmisión o respuesta a un request ya dado por perdido
+        w->late_responses++;
+        return;
+    }
+    s->pending = 0;
+    w->outstanding--;
+    w->responses++;
+    if ((buf[1] >> 5) >= 4) w->errors++;
+    hist_record(&w->corrected, (now - s->intended_ns) / 1000);
+    hist_record(&w->uncorrected, (now - s->sent_ns) / 1000);
+}
+
+static void drain_socket(Worker *w, int sock)
+{
+    uint8_t bufs[LG_RECV_BATCH][LG_PACKET_SIZE];
+    struct mmsghdr msgs[LG_RECV_BATCH];
+    struct iovec iovs[LG_RECV_BATCH];
+    for (;;) {
+        for (int i = 0; i < LG_RECV_BATCH; i++) {
+            iovs[i].iov_base = bufs[i];
+            iovs[i].iov_len = LG_PACKET_SIZE;
+            memset(&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        int got = recvmmsg(sock, msgs, LG_RECV_BATCH, MSG_DONTWAIT, NULL);
+        if (got <= 0) return;
+        uint64_t now = now_ns();
+        for (int i = 0; i < got; i++) handle_datagram(w, bufs[i], (ssize_t)msgs[i].msg_len, now);
+        if (got < LG_RECV_BATCH) return;
+    }
+}
+
+static void poll_events(Worker *w, int timeout_ms)
+{
+    struct epoll_event events[LG_MAX_SOCKETS];
+    int n = epoll_wait(w->epfd, events, LG_MAX_SOCKETS, timeout_ms);
+    for (int i = 0; i < n; i++) drain_socket(w, events[i].data.fd);
+}
+
+static void *worker_thread(void *arg)
+{
+    Worker *w = (Worker*)arg;
+    const LoadgenConfig *cfg = w->cfg;
+    double per_thread_rate = cfg->rate / cfg->threads;
+    uint64_t interval_ns = (uint64_t)(1e9 / per_thread_rate);
+    if (interval_ns == 0) interval_ns = 1;
+
+    uint64_t start = now_ns();
+    uint64_t end = start + (uint64_t)cfg->duration_s * 1000000000ULL;
+    uint64_t seq = 0;
+    uint64_t next_send = start;
+
+    while (1) {
+        uint64_t now = now_ns();
+        if (now >= end || atomic_load_explicit(&run_aborted, memory_order_relaxed)) break;
+        // Ponerse al día con el calendario aunque el loop se haya atrasado;
+        // durante una ráfaga del perfil el intervalo se divide por su factor
+        while (next_send <= now && next_send < end) {
+            if (issue_request(w, seq++, next_send) != 0) {
+                atomic_store(&run_aborted, 1);
+                return NULL;
+            }
+            int factor = workload_rate_factor(&profile, (next_send - start) / 1000000ULL);
+            next_send += interval_ns / (uint64_t)factor;
+        }
+        expire_timeouts(w, now);
+        uint64_t wait_ns = next_send > now ? next_send - now : 0;
+        poll_events(w, (int)(wait_ns / 1000000ULL));
+    }
+
+    // Esperar respuestas y retransmisiones pendientes
+    while (w->outstanding > 0 && !atomic_load_explicit(&run_aborted, memory_order_relaxed)) {
+        uint64_t now = now_ns();
+        expire_timeouts(w, now);
+        poll_events(w, 10);
+    }
+    poll_events(w, 0);
+    return NULL;
+}
+
+static int worker_init(Worker *w, int id, const LoadgenConfig *cfg)
+{
+    memset(w, 0, sizeof(*w));
+    w->id = id;
+    w->cfg = cfg;
+    w->mask = cfg->window - 1;
+    w->rng = ((uint64_t)(id + 1) << 40) ^ (uint64_t)time(NULL) ^ (uint64_t)getpid();
+    hist_init(&w->corrected);
+    hist_init(&w->uncorrected);
+
+    w->server.sin_family = AF_INET;
+    w->server.sin_port = htons(cfg->port);
+    if (inet_pton(AF_INET, cfg->host, &w->server.sin_addr) != 1) {
+        fprintf(stderr, "IP inválida: %s\n", cfg->host);
+        return -1;
+    }
+
+    w->slots = calloc(cfg->window, sizeof(Slot));
+    if (!w->slots) return -1;
+    for (int level = 0; level <= cfg->max_retries; level++) {
+        if (queue_init(&w->queues[level], cfg->window) != 0) return -1;
+    }
+
+    w->epfd = epoll_create1(0);
+    if (w->epfd < 0) {
+        perror("epoll_create1");
+        return -1;
+    }
+    for (int i = 0; i < cfg->sockets; i++) {
+        int sock = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, IPPROTO_UDP);
+        if (sock < 0) {
+            perror("socket");
+            return -1;
+        }
+        int rcvbuf = 4 * 1024 * 1024;
+        setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+        struct epoll_event ev = { .events = EPOLLIN, .data.fd = sock };
+        epoll_ctl(w->epfd, EPOLL_CTL_ADD, sock, &ev);
+        w->socks[i] = sock;
+    }
+    return 0;
+}
+
+static void worker_cleanup(Worker *w)
+{
+    for (int i = 0; i < w->cfg->sockets; i++) if (w->socks[i] > 0) close(w->socks[i]);
+    if (w->epfd > 0) close(w->epfd);
+    for (int level = 0; level <= LG_MAX_RETRIES; level++) {
+        free(w->queues[level].seqs);
+        free(w->queues[level].deadlines);
+    }
+    free(w->slots);
+}
+
+static void print_latency(const char *label, const Histogram *h)
+{
+    printf("%-28s p50=%llu p90=%llu p99=%llu p99.9=%llu max=%llu (us)\n", label,
+           (unsigned long long)hist_percentile(h, 50.0),
+           (unsigned long long)hist_percentile(h, 90.0),
+           (unsigned long long)hist_percentile(h, 99.0),
+           (unsigned long long)hist_percentile(h, 99.9),
+           (unsigned long long)hist_max(h));
+}
+
+static uint32_t next_pow2(uint32_t v)
+{
+    uint32_t p = 1;
+    while (p < v) p <<= 1;
+    return p;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Uso: %s <host> <puerto> <ruta> [opciones]\n"
+            "  --rate <req/s>        tasa objetivo total (por defecto 1000)\n"
+            "  --duration <s>        duración de la prueba (por defecto 10)\n"
+            "  --devices <N>         dispositivos virtuales (por defecto 100000)\n"
+            "  --threads <N>         loops epoll (por defecto uno por core)\n"
+            "  --sockets <N>         sockets UDP por thread (por defecto 4)\n"
+            "  --mode <con|non>      tipo de mensaje (por defecto con)\n"
+            "  --profile <perfil>    telemetry|mixed|readheavy|storm o clave=valor,...\n"
+            "  --timeout <ms>        ACK_TIMEOUT inicial (por defecto 2000)\n"
+            "  --retries <N>         MAX_RETRANSMIT (por defecto 4)\n"
+            "  --window <N>          requests en vuelo por thread (por defecto 65536)\n",
+            prog);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 4) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    LoadgenConfig cfg = {
+        .host = argv[1], .port = atoi(argv[2]), .path = argv[3],
+        .rate = 1000, .duration_s = 10, .devices = 100000,
+        .threads = (int)sysconf(_SC_NPROCESSORS_ONLN), .sockets = 4,
+        .confirmable = 1, .profile_spec = NULL, .timeout_ms = 2000, .max_retries = 4, .window = 65536,
+    };
+    for (int i = 4; i + 1 < argc; i += 2) {
+        const char *opt = argv[i], *val = argv[i + 1];
+        if (strcmp(opt, "--rate") == 0) cfg.rate = atof(val);
+        else if (strcmp(opt, "--duration") == 0) cfg.duration_s = atoi(val);
+        else if (strcmp(opt, "--devices") == 0) cfg.devices = atol(val);
+        else if (strcmp(opt, "--threads") == 0) cfg.threads = atoi(val);
+        else if (strcmp(opt, "--sockets") == 0) cfg.sockets = atoi(val);
+        else if (strcmp(opt, "--mode") == 0) cfg.confirmable = strcmp(val, "non") != 0;
+        else if (strcmp(opt, "--profile") == 0) cfg.profile_spec = val;
+        else if (strcmp(opt, "--timeout") == 0) cfg.timeout_ms = atoi(val);
+        else if (strcmp(opt, "--retries") == 0) cfg.max_retries = atoi(val);
+        else if (strcmp(opt, "--window") == 0) cfg.window = (uint32_t)atol(val);
+        else {
+            fprintf(stderr, "Opción desconocida: %s\n", opt);
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (cfg.threads < 1) cfg.threads = 1;
+    if (cfg.threads > 255) cfg.threads = 255;
+    if (cfg.sockets < 1) cfg.sockets = 1;
+    if (cfg.sockets > LG_MAX_SOCKETS) cfg.sockets = LG_MAX_SOCKETS;
+    if (cfg.max_retries < 0) cfg.max_retries = 0;
+    if (cfg.max_retries > LG_MAX_RETRIES) cfg.max_retries = LG_MAX_RETRIES;
+    if (cfg.devices < 1) cfg.devices = 1;
+    if (cfg.rate <= 0 || cfg.duration_s <= 0) {
+        fprintf(stderr, "rate y duration deben ser > 0\n");
+        return 1;
+    }
+    cfg.window = next_pow2(cfg.window < 16 ? 16 : cfg.window);
+
+    char profile_spec[512];
+    snprintf(profile_spec, sizeof(profile_spec), "con=%d%s%s", cfg.confirmable ? 100 : 0,
+             cfg.profile_spec ? "," : "", cfg.profile_spec ? cfg.profile_spec : "");
+    if (workload_init(&profile, profile_spec) != 0) {
+        fprintf(stderr, "Perfil de carga inválido: %s\n", profile_spec);
+        return 1;
+    }
+    char profile_desc[256];
+    workload_describe(&profile, profile_desc, sizeof(profile_desc));
+
+    printf("=== Generador de carga CoAP (open-loop) ===\n");
+    printf("Destino: coap://%s:%d%s\n", cfg.host, cfg.port, cfg.path);
+    printf("Perfil: %s\n", profile_desc);
+    printf("Tasa: %.0f req/s  Duración: %d s  Dispositivos: %ld  Threads: %d x %d sockets\n",
+           cfg.rate, cfg.duration_s, cfg.devices, cfg.threads, cfg.sockets);
+
+    Worker *workers = calloc((size_t)cfg.threads, sizeof(Worker));
+    pthread_t *threads = calloc((size_t)cfg.threads, sizeof(pthread_t));
+    if (!workers || !threads) {
+        fprintf(stderr, "Sin memoria\n");
+        return 1;
+    }
+    for (int i = 0; i < cfg.threads; i++) {
+        if (worker_init(&workers[i], i, &cfg) != 0) return 1;
+    }
+
+    uint64_t t0 = now_ns();
+    for (int i = 0; i < cfg.threads; i++) pthread_create(&threads[i], NULL, worker_thread, &workers[i]);
+    for (int i = 0; i < cfg.threads; i++) pthread_join(threads[i], NULL);
+    double elapsed = (double)(now_ns() - t0) / 1e9;
+    if (atomic_load(&run_aborted)) {
+        for (int i = 0; i < cfg.threads; i++) worker_cleanup(&workers[i]);
+        workload_free(&profile);
+        free(workers);
+        free(threads);
+        return 1;
+    }
+
+    Histogram *corrected = malloc(sizeof(Histogram));
+    Histogram *uncorrected = malloc(sizeof(Histogram));
+    hist_init(corrected);
+    hist_init(uncorrected);
+    uint64_t sent = 0, sent_non = 0, responses = 0, lost = 0, retransmits = 0, errors = 0, late = 0, send_failures = 0;
+    uint64_t by_method[5] = {0};
+    for (int i = 0; i < cfg.threads; i++) {
+        Worker *w = &workers[i];
+        sent += w->sent; sent_non += w->sent_non; responses += w->responses; lost += w->lost;
+        for (int m = 1; m <= 4; m++) by_method[m] += w->by_method[m];
+        retransmits += w->retransmits; errors += w->errors; late += w->late_responses;
+        send_failures += w->send_failures;
+        hist_merge(corrected, &w->corrected);
+        hist_merge(uncorrected, &w->uncorrected);
+        worker_cleanup(w);
+    }
+
+    printf("\n=== Resultados (%.1f s) ===\n", elapsed);
+    printf("Enviados: %llu (%.0f req/s)  Fallos de envío: %llu\n",
+           (unsigned long long)sent, (double)sent / (double)cfg.duration_s, (unsigned long long)send_failures);
+    printf("Por método: GET=%llu POST=%llu PUT=%llu DELETE=%llu  NON (sin respuesta esperada): %llu\n",
+           (unsigned long long)by_method[1], (unsigned long long)by_method[2],
+           (unsigned long long)by_method[3], (unsigned long long)by_method[4], (unsigned long long)sent_non);
+    if (sent > sent_non) {
+        printf("Respuestas: %llu (%.0f resp/s)  Errores 4.xx/5.xx: %llu\n",
+               (unsigned long long)responses, (double)responses / elapsed, (unsigned long long)errors);
+        printf("Perdidos: %llu (%.3f%%)  Retransmisiones: %llu  Respuestas tardías/duplicadas: %llu\n",
+               (unsigned long long)lost, 100.0 * (double)lost / (double)(sent - sent_non),
+               (unsigned long long)retransmits, (unsigned long long)late);
+        print_latency("Latencia (corregida CO):", corrected);
+        print_latency("Latencia (sin corregir):", uncorrected);
+    } else {
+        printf("Solo NON: el servidor no responde, solo se reporta la tasa de envío\n");
+    }
+    workload_free(&profile);
+
+    free(corrected);
+    free(uncorrected);
+    free(workers);
+    free(threads);
+    return 0;
+}
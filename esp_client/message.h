@@ -7,7 +7,7 @@ extern "C" {
 
 #define MAX_TOKEN_LEN 8
 #define MAX_OPTIONS 16
-#define MAX_PAYLOAD 256
+#define MAX_PAYLOAD 512
 
 typedef struct
 {
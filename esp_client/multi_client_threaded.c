@@ -10,6 +10,8 @@
 #include <semaphore.h>
 
 #include "message.h"
+#include "workload.h"
+#include "coap_client.h"
 
 typedef struct {
     int device_id;
@@ -18,7 +20,9 @@ typedef struct {
     const char *path;
     int interval_ms;
     long rounds;
-    int confirmable_msgs;
+    const WorkloadProfile *profile;
+    int pipeline;               // requests en vuelo por dispositivo (0 = stop-and-wait)
+    struct timespec *start_time;
     int *seq_ptr;
     pthread_mutex_t *seq_mutex;
     sem_t *start_semaphore;
@@ -41,19 +45,37 @@ static double rand_temp_tenth(void) {
     return r / 10.0;
 }
 
+static const char *method_name(uint8_t method) {
+    switch (method) {
+        case 1: return "GET";
+        case 2: return "POST";
+        case 3: return "PUT";
+        case 4: return "DELETE";
+        default: return "?";
+    }
+}
+
+static uint64_t elapsed_ms_since(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)(now.tv_sec - start->tv_sec) * 1000ULL +
+           (uint64_t)((now.tv_nsec - start->tv_nsec) / 1000000L);
+}
+
 static int send_one_udp(int sockfd,
                         const struct sockaddr_in *server_addr,
                         const char *path,
                         const char *device_id,
                         unsigned seq,
                         double temp_c,
+                        uint8_t method,
                         int confirmable) {
     unsigned char buffer[1024];
     CoapMessage msg;
     coap_message_init(&msg);
 
     msg.type = confirmable ? 0 : 1;
-    msg.code = 2;
+    msg.code = method;
     msg.message_id = (unsigned short)(rand() & 0xFFFF);
 
     msg.tkl = 2;
@@ -62,15 +84,21 @@ static int send_one_udp(int sockfd,
 
     add_uri_path_options(&msg, path);
 
-    unsigned char cf = 50;
-    coap_add_option(&msg, 12, &cf, 1);
+    // Solo POST y PUT llevan payload
+    if (method == 2 || method == 3) {
+        unsigned char cf = 50;
+        coap_add_option(&msg, 12, &cf, 1);
 
-    char payload[160];
-    snprintf(payload, sizeof(payload),
-             "{\"id\":\"%s\",\"seq\":%u,\"temp_c\":%.1f}", device_id, seq, temp_c);
-    coap_set_payload(&msg, (const unsigned char*)payload, (int)strlen(payload));
+        char payload[160];
+        snprintf(payload, sizeof(payload),
+                 "{\"id\":\"%s\",\"seq\":%u,\"temp_c\":%.1f}", device_id, seq, temp_c);
+        coap_set_payload(&msg, (const unsigned char*)payload, (int)strlen(payload));
+    }
 
     int len = coap_serialize(&msg, buffer, sizeof(buffer));
+    for (int i = 0; i < msg.option_count; i++) {
+        if (msg.options[i].value) free(msg.options[i].value);
+    }
     if (len <= 0) {
         fprintf(stderr, "[%s] Error al serializar CoAP\n", device_id);
         return -1;
@@ -102,6 +130,32 @@ static int send_one_udp(int sockfd,
     return 0;
 }
 
+static void on_pipelined_response(const CoapClientResult *result, void *user) {
+    const char *device_id = (const char *)user;
+    if (result->status == COAP_CLIENT_OK) {
+        printf("  <- [%s] resp code=%d len=%d (%llu us)\n", device_id, result->response->code,
+               result->response->payload_len, (unsigned long long)result->latency_us);
+    } else if (result->status != COAP_CLIENT_CANCELLED) {
+        printf("  <- [%s] sin respuesta (estado %d, %d retransmisiones)\n", device_id,
+               result->status, result->retransmissions);
+    }
+}
+
+// El servidor no responde los NON: que no llegue respuesta no es un error
+static void on_pipelined_non_response(const CoapClientResult *result, void *user) {
+    if (result->status == COAP_CLIENT_OK) on_pipelined_response(result, user);
+}
+
+// Espera ms procesando respuestas mientras tanto
+static void client_sleep(CoapClient *client, uint64_t ms) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    uint64_t elapsed;
+    while ((elapsed = elapsed_ms_since(&start)) < ms) {
+        coap_client_poll(client, (int)(ms - elapsed));
+    }
+}
+
 void* device_thread(void* arg) {
     device_data_t *data = (device_data_t*)arg;
     sem_wait(data->start_semaphore);
@@ -125,9 +179,28 @@ void* device_thread(void* arg) {
     char dev_id[32];
     snprintf(dev_id, sizeof(dev_id), "esp32-%d", data->device_id);
 
+    // Con pipeline el dispositivo no espera cada respuesta: un CoapClient
+    // lleva hasta 'pipeline' requests en vuelo sobre un único socket
+    CoapClient *client = NULL;
+    if (data->pipeline > 0) {
+        CoapTxParams params;
+        coap_tx_params_default(&params);
+        params.nstart = data->pipeline;
+        client = coap_client_create(&params);
+        if (!client) {
+            fprintf(stderr, "[ESP32-%d] No se pudo crear el cliente CoAP\n", data->device_id);
+            close(sockfd);
+            return NULL;
+        }
+    }
+
     printf("[ESP32-%d] Dispositivo iniciado -> coap://%s:%d%s\n", 
            data->device_id, data->host, data->port, data->path);
 
+    const WorkloadProfile *profile = data->profile;
+    uint64_t rng = ((uint64_t)data->device_id << 32) ^ (uint64_t)time(NULL) ^ (uint64_t)getpid();
+    char uri[192];
+
     long round = 0;
     while (data->rounds == 0 || round < data->rounds) {
         double t = rand_temp_tenth();
@@ -136,19 +209,46 @@ void* device_thread(void* arg) {
         unsigned seq = ++(*(data->seq_ptr));
         pthread_mutex_unlock(data->seq_mutex);
 
-        if (send_one_udp(sockfd, &server_addr, data->path, dev_id, seq, t, data->confirmable_msgs) == 0) {
-            printf("[ESP32-%d] [round %ld] seq=%u -> %.1f°C\n", data->device_id, round+1, seq, t);
+        WorkloadOp op;
+        workload_next(profile, &rng, &op);
+        workload_uri(profile, op.uri_index, data->path, uri, sizeof(uri));
+
+        int sent_ok;
+        if (client) {
+            while (coap_client_pending(client) >= (size_t)data->pipeline) coap_client_poll(client, 100);
+            char payload[160];
+            snprintf(payload, sizeof(payload), "{\"id\":\"%s\",\"seq\":%u,\"temp_c\":%.1f}", dev_id, seq, t);
+            sent_ok = coap_client_request(client, &server_addr, op.method, uri, op.confirmable, payload,
+                                          op.confirmable ? on_pipelined_response : on_pipelined_non_response, dev_id);
+        } else {
+            sent_ok = send_one_udp(sockfd, &server_addr, uri, dev_id, seq, t, op.method, op.confirmable);
+        }
+        if (sent_ok == 0) {
+            printf("[ESP32-%d] [round %ld] seq=%u %s %s %s -> %.1f°C\n", data->device_id, round+1, seq,
+                   op.confirmable ? "CON" : "NON", method_name(op.method), uri, t);
         }
 
         int jitter = 1000 * (5 + (rand() % 20));
-        usleep(jitter);
+        if (client) client_sleep(client, (uint64_t)jitter / 1000);
+        else usleep(jitter);
 
         if (data->interval_ms > 0) {
-            usleep((useconds_t)data->interval_ms * 1000);
+            // En ráfaga el intervalo se divide; si el sueño cruza el inicio de la
+            // próxima ráfaga se corta ahí para que todos despierten juntos
+            uint64_t elapsed = elapsed_ms_since(data->start_time);
+            uint64_t sleep_ms = (uint64_t)data->interval_ms / (uint64_t)workload_rate_factor(profile, elapsed);
+            uint64_t to_burst = workload_ms_to_next_burst(profile, elapsed);
+            if (to_burst > 0 && to_burst < sleep_ms) sleep_ms = to_burst;
+            if (client) client_sleep(client, sleep_ms);
+            else usleep((useconds_t)(sleep_ms * 1000));
         }
         round++;
     }
 
+    if (client) {
+        coap_client_run(client);
+        coap_client_destroy(client);
+    }
     printf("[ESP32-%d] Dispositivo terminado\n", data->device_id);
     close(sockfd);
     return NULL;
@@ -157,7 +257,10 @@ void* device_thread(void* arg) {
 int main(int argc, char **argv) {
     if (argc < 5) {
         fprintf(stderr,
-          "Uso: %s <host> <puerto> <ruta> <num_devices> [interval_ms=5000] [rounds=0] [mode=non|con]\n", argv[0]);
+          "Uso: %s <host> <puerto> <ruta> <num_devices> [interval_ms=5000] [rounds=0] [mode=non|con] [perfil] [pipeline=0]\n"
+          "  perfil: telemetry | mixed | readheavy | storm, o clave=valor separados por coma\n"
+          "          (get,post,put,delete,con,uris,zipf,burst_period,burst_len,burst_x)\n"
+          "  pipeline: requests en vuelo por dispositivo (0 = esperar cada respuesta)\n", argv[0]);
         return 1;
     }
 
@@ -168,18 +271,35 @@ int main(int argc, char **argv) {
     int interval_ms       = (argc >= 6) ? atoi(argv[5]) : 5000;
     long rounds           = (argc >= 7) ? atol(argv[6]) : 0;
     int confirmable_msgs  = (argc >= 8 && strcmp(argv[7], "con") == 0) ? 1 : 0;
+    // El modo fija la mezcla CON/NON por defecto; el perfil puede redefinirla
+    char profile_spec[512];
+    snprintf(profile_spec, sizeof(profile_spec), "con=%d%s%s", confirmable_msgs ? 100 : 0,
+             argc >= 9 ? "," : "", argc >= 9 ? argv[8] : "");
+
+    int pipeline          = (argc >= 10) ? atoi(argv[9]) : 0;
 
     if (num_devices <= 0) { fprintf(stderr, "num_devices debe ser > 0\n"); return 1; }
 
+    WorkloadProfile profile;
+    if (workload_init(&profile, profile_spec) != 0) {
+        fprintf(stderr, "Perfil de carga inválido: %s\n", profile_spec);
+        return 1;
+    }
+    char profile_desc[256];
+    workload_describe(&profile, profile_desc, sizeof(profile_desc));
+
     srand((unsigned)(time(NULL) ^ getpid()));
 
     printf("=== Cliente CoAP Multi-threaded (ESP sim) ===\n");
     printf("Simulando %d dispositivos %s -> coap://%s:%d%s\n",
            num_devices, confirmable_msgs ? "(CON)" : "(NON)", host, port, path);
     printf("Intervalo: %d ms, Rondas: %s\n", interval_ms, rounds ? "finitas" : "infinitas");
+    printf("Perfil: %s\n", profile_desc);
+    if (pipeline > 0) printf("Pipeline: hasta %d requests en vuelo por dispositivo\n", pipeline);
 
     sem_t start_semaphore; sem_init(&start_semaphore, 0, 0);
     pthread_mutex_t seq_mutex = PTHREAD_MUTEX_INITIALIZER; int shared_seq = 0;
+    struct timespec start_time;
 
     pthread_t *threads = malloc(num_devices * sizeof(pthread_t));
     device_data_t *device_data = malloc(num_devices * sizeof(device_data_t));
@@ -191,7 +311,9 @@ int main(int argc, char **argv) {
         device_data[i].path = path;
         device_data[i].interval_ms = interval_ms;
         device_data[i].rounds = rounds;
-        device_data[i].confirmable_msgs = confirmable_msgs;
+        device_data[i].profile = &profile;
+        device_data[i].pipeline = pipeline;
+        device_data[i].start_time = &start_time;
         device_data[i].seq_ptr = &shared_seq;
         device_data[i].seq_mutex = &seq_mutex;
         device_data[i].start_semaphore = &start_semaphore;
@@ -201,6 +323,7 @@ int main(int argc, char **argv) {
     printf("✓ %d threads de dispositivos creados\n", num_devices);
     printf("Iniciando dispositivos en 2 segundos...\n");
     sleep(2);
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
     for (int i = 0; i < num_devices; i++) sem_post(&start_semaphore);
     printf("✓ Todos los dispositivos iniciados\n\n");
 
@@ -208,6 +331,7 @@ int main(int argc, char **argv) {
 
     printf("\n✓ Todos los dispositivos terminaron\n");
     free(threads); free(device_data);
+    workload_free(&profile);
     sem_destroy(&start_semaphore); pthread_mutex_destroy(&seq_mutex);
     return 0;
 }
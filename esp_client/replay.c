@@ -0,0 +1,581 @@
+// Replay de tráfico grabado contra el servidor CoAP.
+//
+// Fuentes soportadas:
+//   - data_store.log (binario, store_log.h, o el texto "uri\tpayload" por
+//     línea de versiones anteriores): se reenvía cada valor como POST/PUT,
+//     descomprimiendo los que usan el diccionario. El binario respeta la
+//     marca de tiempo de cada registro; el texto no tiene, así que sus
+//     líneas van cada 1 ms. --interval-us fija el espaciado en los dos.
+//   - capturas pcap (Ethernet, Linux SLL/SLL2, loopback BSD o IP crudo,
+//     IPv4/IPv6 + UDP): se reenvían los requests CoAP dirigidos al puerto
+//     --capture-port respetando los tiempos entre llegadas originales.
+//
+// --speed 1 reproduce a velocidad original, N acelera N veces y 0 envía tan
+// rápido como sea posible. La latencia se mide desde el instante programado.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include "histogram.h"
+#include "store_log.h"
+#include "json_dict.h"
+
+#define RP_TOKEN_LEN   8
+#define RP_PACKET_SIZE 1500
+#define RP_WINDOW      65536
+
+typedef struct {
+    uint64_t ts_ns;         // marca de tiempo relativa al primer registro
+    int len;
+    uint8_t data[RP_PACKET_SIZE];
+} TraceRecord;
+
+typedef struct TraceReader TraceReader;
+struct TraceReader {
+    FILE *f;
+    int (*next)(TraceReader *r, TraceRecord *rec);
+    // pcap
+    int swapped;
+    int nanosecond;
+    uint32_t linktype;
+    uint16_t capture_port;
+    int64_t first_ts_ns;            // también el primer registro del log binario
+    uint64_t last_ts_ns;
+    // data_store.log
+    StoreLogReader *store_log;      // NULL = texto
+    uint64_t interval_ns;           // 0 = tiempos del log (binario) o 1 ms (texto)
+    uint64_t line_no;
+    uint8_t method;
+    int confirmable;
+    uint64_t skipped;               // valores que no se pudieron reenviar
+};
+
+typedef struct {
+    uint64_t seq;
+    uint64_t intended_ns;
+    uint64_t sent_ns;
+    uint8_t pending;
+} Slot;
+
+typedef struct {
+    uint64_t sent, responses, lost, late, send_failures, non_sent;
+    uint64_t by_class[8];
+    Histogram corrected;
+    Histogram uncorrected;
+} ReplayStats;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t rd32(const TraceReader *r, const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return r->swapped ? __builtin_bswap32(v) : v;
+}
+
+// ---------- data_store.log ----------
+
+// Delta o largo de opción (RFC 7252 3.1), como en message.c: 0-12 van en
+// el nibble, 13 = un byte extra (+13), 14 = dos bytes extra (+269)
+static uint8_t option_nibble(size_t v, uint8_t *ext, size_t *ext_len)
+{
+    if (v < 13) return (uint8_t)v;
+    if (v < 269) {
+        ext[(*ext_len)++] = (uint8_t)(v - 13);
+        return 13;
+    }
+    ext[(*ext_len)++] = (uint8_t)((v - 269) >> 8);
+    ext[(*ext_len)++] = (uint8_t)(v - 269);
+    return 14;
+}
+
+static int put_option(uint8_t *p, size_t size, size_t *off, int delta, const void *value, size_t len)
+{
+    uint8_t ext[4];
+    size_t ext_len = 0;
+    uint8_t d = option_nibble((size_t)delta, ext, &ext_len);
+    uint8_t l = option_nibble(len, ext, &ext_len);
+    if (len > 65535 + 269 || *off + 1 + ext_len + len > size) return -1;
+    p[(*off)++] = (uint8_t)((d << 4) | l);
+    memcpy(p + *off, ext, ext_len);
+    *off += ext_len;
+    memcpy(p + *off, value, len);
+    *off += len;
+    return 0;
+}
+
+// -1 si el request no entra en un datagrama (se cuenta como omitido)
+static int encode_store_line(TraceReader *r, const char *uri, const char *payload, TraceRecord *rec)
+{
+    uint8_t *p = rec->data;
+    size_t off = 0;
+    p[off++] = (uint8_t)((1 << 6) | ((r->confirmable ? 0 : 1) << 4));
+    p[off++] = r->method;
+    p[off++] = 0;
+    p[off++] = 0;
+    int last_number = 0;
+    const char *s = uri;
+    while (*s == '/') s++;
+    while (*s) {
+        const char *start = s;
+        while (*s && *s != '/') s++;
+        size_t len = (size_t)(s - start);
+        if (len) {
+            if (put_option(p, sizeof(rec->data), &off, 11 - last_number, start, len) != 0) return -1;
+            last_number = 11;
+        }
+        while (*s == '/') s++;
+    }
+    size_t plen = strlen(payload);
+    const uint8_t json = 50;  // application/json
+    if (put_option(p, sizeof(rec->data), &off, 12 - last_number, &json, 1) != 0) return -1;
+    if (off + 1 + plen > sizeof(rec->data)) return -1;
+    p[off++] = 0xFF;
+    memcpy(p + off, payload, plen);
+    rec->len = (int)(off + plen);
+    return 0;
+}
+
+static int store_log_next(TraceReader *r, TraceRecord *rec)
+{
+    char line[2048];
+    while (fgets(line, sizeof(line), r->f)) {
+        char *tab = strchr(line, '\t');
+        if (!tab) continue;
+        *tab = '\0';
+        char *val = tab + 1;
+        size_t L = strlen(val);
+        while (L > 0 && (val[L-1] == '\n' || val[L-1] == '\r')) val[--L] = '\0';
+        if (encode_store_line(r, line, val, rec) != 0) {
+            r->skipped++;
+            continue;
+        }
+        rec->ts_ns = r->line_no++ * (r->interval_ns ? r->interval_ns : 1000000ULL);
+        return 1;
+    }
+    return 0;
+}
+
+static int store_bin_next(TraceReader *r, TraceRecord *rec)
+{
+    StoreRecord sr;
+    int n;
+    while ((n = store_log_read(r->store_log, &sr)) == 1) {
+        if (sr.type == STORE_REC_TEMPLATE) {
+            json_dict_define(sr.version, sr.value, sr.value_len);
+            continue;
+        }
+        if (sr.type != STORE_REC_VALUE) continue;
+        char uri[STORE_LOG_KEY_MAX + 1];
+        memcpy(uri, sr.key, sr.key_len);
+        uri[sr.key_len] = '\0';
+        char raw[STORE_LOG_VALUE_MAX + 1];
+        const char *payload = sr.value;
+        if (payload[0] == JSON_DICT_MARK) {
+            if (json_dict_decode(sr.value, sr.value_len, raw, sizeof(raw)) < 0) {
+                r->skipped++;
+                continue;
+            }
+            payload = raw;
+        }
+        if (encode_store_line(r, uri, payload, rec) != 0) {
+            r->skipped++;
+            continue;
+        }
+        if (r->interval_ns) {
+            rec->ts_ns = r->line_no++ * r->interval_ns;
+            return 1;
+        }
+        // CLOCK_REALTIME del servidor: si volvió para atrás (NTP) el
+        // registro sale junto con el anterior
+        int64_t ts = (int64_t)sr.timestamp_ms * 1000000LL;
+        if (r->first_ts_ns < 0) r->first_ts_ns = ts;
+        uint64_t rel = ts >= r->first_ts_ns ? (uint64_t)(ts - r->first_ts_ns) : 0;
+        rec->ts_ns = rel > r->last_ts_ns ? rel : r->last_ts_ns;
+        r->last_ts_ns = rec->ts_ns;
+        return 1;
+    }
+    if (n < 0) fprintf(stderr, "data_store.log: registro cortado o corrupto en el byte %llu\n", (unsigned long long)r->store_log->offset);
+    return 0;
+}
+
+// ---------- pcap ----------
+
+// Devuelve el offset del payload UDP dentro del frame, o -1
+static int udp_payload_offset(const TraceReader *r, const uint8_t *frame, int caplen, int *udp_len)
+{
+    int off = 0;
+    uint16_t ethertype = 0;
+    switch (r->linktype) {
+        case 1:   // Ethernet
+            if (caplen < 14) return -1;
+            ethertype = (uint16_t)((frame[12] << 8) | frame[13]);
+            off = 14;
+            while ((ethertype == 0x8100 || ethertype == 0x88A8) && caplen >= off + 4) {
+                ethertype = (uint16_t)((frame[off + 2] << 8) | frame[off + 3]);
+                off += 4;
+            }
+            break;
+        case 113: // Linux cooked (SLL)
+            if (caplen < 16) return -1;
+            ethertype = (uint16_t)((frame[14] << 8) | frame[15]);
+            off = 16;
+            break;
+        case 276: // Linux cooked v2 (SLL2)
+            if (caplen < 20) return -1;
+            ethertype = (uint16_t)((frame[0] << 8) | frame[1]);
+            off = 20;
+            break;
+        case 0: { // Loopback BSD: familia en orden del host que capturó
+            if (caplen < 4) return -1;
+            uint32_t family;
+            memcpy(&family, frame, 4);
+            if (family > 0xFFFF) family = __builtin_bswap32(family);
+            ethertype = family == 2 ? 0x0800 : 0x86DD;
+            off = 4;
+            break;
+        }
+        case 101: // IP crudo
+        case 12:
+            if (caplen < 1) return -1;
+            ethertype = (frame[0] >> 4) == 6 ? 0x86DD : 0x0800;
+            break;
+        default:
+            return -1;
+    }
+
+    int proto;
+    if (ethertype == 0x0800) {
+        if (caplen < off + 20) return -1;
+        int ihl = (frame[off] & 0x0F) * 4;
+        proto = frame[off + 9];
+        off += ihl;
+    } else if (ethertype == 0x86DD) {
+        if (caplen < off + 40) return -1;
+        proto = frame[off + 6];
+        off += 40;
+    } else {
+        return -1;
+    }
+    if (proto != 17 || caplen < off + 8) return -1;
+
+    uint16_t dport = (uint16_t)((frame[off + 2] << 8) | frame[off + 3]);
+    uint16_t len = (uint16_t)((frame[off + 4] << 8) | frame[off + 5]);
+    if (r->capture_port && dport != r->capture_port) return -1;
+    if (len < 8) return -1;
+    *udp_len = len - 8;
+    if (off + 8 + *udp_len > caplen) *udp_len = caplen - off - 8;
+    return off + 8;
+}
+
+static int pcap_next(TraceReader *r, TraceRecord *rec)
+{
+    uint8_t hdr[16];
+    uint8_t frame[65536];
+    while (fread(hdr, 1, sizeof(hdr), r->f) == sizeof(hdr)) {
+        uint32_t sec = rd32(r, hdr), frac = rd32(r, hdr + 4);
+        uint32_t caplen = rd32(r, hdr + 8);
+        if (caplen > sizeof(frame)) return 0;
+        if (fread(frame, 1, caplen, r->f) != caplen) return 0;
+
+        int udp_len = 0;
+        int off = udp_payload_offset(r, frame, (int)caplen, &udp_len);
+        if (off < 0 || udp_len < 4 || udp_len > (int)sizeof(rec->data)) continue;
+        const uint8_t *coap = frame + off;
+        // Solo requests (clase 0, código 1..31) con versión 1
+        if ((coap[0] >> 6) != 1 || coap[1] == 0 || (coap[1] >> 5) != 0) continue;
+
+        int64_t ts = (int64_t)sec * 1000000000LL + (int64_t)frac * (r->nanosecond ? 1 : 1000);
+        if (r->first_ts_ns < 0) r->first_ts_ns = ts;
+        rec->ts_ns = ts >= r->first_ts_ns ? (uint64_t)(ts - r->first_ts_ns) : 0;
+        memcpy(rec->data, coap, (size_t)udp_len);
+        rec->len = udp_len;
+        return 1;
+    }
+    return 0;
+}
+
+static int reader_open(TraceReader *r, const char *path)
+{
+    r->f = fopen(path, "rb");
+    if (!r->f) {
+        perror("fopen");
+        return -1;
+    }
+    r->first_ts_ns = -1;
+    uint8_t gh[24];
+    if (fread(gh, 1, sizeof(gh), r->f) == sizeof(gh)) {
+        uint32_t magic;
+        memcpy(&magic, gh, 4);
+        int known = 1;
+        if (magic == 0xA1B2C3D4) { r->swapped = 0; r->nanosecond = 0; }
+        else if (magic == 0xD4C3B2A1) { r->swapped = 1; r->nanosecond = 0; }
+        else if (magic == 0xA1B23C4D) { r->swapped = 0; r->nanosecond = 1; }
+        else if (magic == 0x4D3CB2A1) { r->swapped = 1; r->nanosecond = 1; }
+        else known = 0;
+        if (known) {
+            r->linktype = rd32(r, gh + 20) & 0x0FFFFFFF;
+            r->next = pcap_next;
+            return 1;
+        }
+    }
+    rewind(r->f);
+    r->store_log = malloc(sizeof(StoreLogReader));
+    if (r->store_log && store_log_open(r->store_log, r->f)) {
+        r->next = store_bin_next;
+        return 0;
+    }
+    free(r->store_log);
+    r->store_log = NULL;
+    r->next = store_log_next;
+    return 0;
+}
+
+// ---------- replay ----------
+
+static void rewrite_token(TraceRecord *rec, uint64_t seq, uint8_t *out, int *out_len)
+{
+    // Cabecera con token propio de 8 bytes para emparejar respuestas; el resto
+    // del mensaje (opciones y payload) se reenvía tal cual
+    int tkl = rec->data[0] & 0x0F;
+    if (tkl > 8 || 4 + tkl > rec->len) tkl = 0;
+    int rest = rec->len - 4 - tkl;
+    out[0] = (uint8_t)((rec->data[0] & 0xF0) | RP_TOKEN_LEN);
+    out[1] = rec->data[1];
+    out[2] = (uint8_t)(seq >> 8);
+    out[3] = (uint8_t)seq;
+    for (int i = 0; i < RP_TOKEN_LEN; i++) out[4 + i] = (uint8_t)(seq >> (56 - 8 * i));
+    memcpy(out + 4 + RP_TOKEN_LEN, rec->data + 4 + tkl, (size_t)rest);
+    *out_len = 4 + RP_TOKEN_LEN + rest;
+}
+
+static void handle_response(Slot *slots, ReplayStats *st, const uint8_t *buf, ssize_t n, uint64_t now)
+{
+    if (n < 4 + RP_TOKEN_LEN || (buf[0] & 0x0F) != RP_TOKEN_LEN) return;
+    uint64_t seq = 0;
+    for (int i = 0; i < RP_TOKEN_LEN; i++) seq = (seq << 8) | buf[4 + i];
+    Slot *s = &slots[seq % RP_WINDOW];
+    if (!s->pending || s->seq != seq) {
+        st->late++;
+        return;
+    }
+    s->pending = 0;
+    st->responses++;
+    st->by_class[(buf[1] >> 5) & 7]++;
+    hist_record(&st->corrected, (now - s->intended_ns) / 1000);
+    hist_record(&st->uncorrected, (now - s->sent_ns) / 1000);
+}
+
+static void poll_responses(int sock, Slot *slots, ReplayStats *st, int timeout_ms)
+{
+    struct pollfd pfd = { .fd = sock, .events = POLLIN };
+    if (poll(&pfd, 1, timeout_ms) <= 0) return;
+    uint8_t buf[RP_PACKET_SIZE];
+    ssize_t n;
+    while ((n = recv(sock, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+        handle_response(slots, st, buf, n, now_ns());
+    }
+}
+
+static void expire(Slot *slots, ReplayStats *st, uint64_t *oldest, uint64_t next_seq, uint64_t now, uint64_t timeout_ns)
+{
+    // Los requests salen en orden y con el mismo timeout: basta avanzar un cursor
+    while (*oldest < next_seq) {
+        Slot *s = &slots[*oldest % RP_WINDOW];
+        if (s->seq == *oldest && s->pending) {
+            if (s->sent_ns + timeout_ns > now) break;
+            s->pending = 0;
+            st->lost++;
+        }
+        (*oldest)++;
+    }
+}
+
+static void print_latency(const char *label, const Histogram *h)
+{
+    printf("%-28s p50=%llu p90=%llu p99=%llu p99.9=%llu max=%llu (us)\n", label,
+           (unsigned long long)hist_percentile(h, 50.0),
+           (unsigned long long)hist_percentile(h, 90.0),
+           (unsigned long long)hist_percentile(h, 99.0),
+           (unsigned long long)hist_percentile(h, 99.9),
+           (unsigned long long)hist_max(h));
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Uso: %s <host> <puerto> <traza> [opciones]\n"
+            "  traza: data_store.log o captura .pcap\n"
+            "  --speed <x>           1 = original, N = N veces más rápido, 0 = sin pausas (por defecto 1)\n"
+            "  --timeout <ms>        espera máxima por respuesta (por defecto 2000)\n"
+            "  --capture-port <p>    puerto destino a filtrar en pcap (por defecto 5683, 0 = todos)\n"
+            "  --interval-us <us>    espaciado fijo entre valores de data_store.log en vez de\n"
+            "                        sus marcas de tiempo (el texto no tiene: 1000 por defecto)\n"
+            "  --method <post|put>   método para data_store.log (por defecto post)\n"
+            "  --mode <con|non>      tipo para data_store.log (por defecto con)\n"
+            "  --limit <N>           máximo de requests a reenviar\n",
+            prog);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 4) {
+        usage(argv[0]);
+        return 1;
+    }
+    const char *host = argv[1];
+    int port = atoi(argv[2]);
+    const char *trace_path = argv[3];
+    double speed = 1.0;
+    int timeout_ms = 2000;
+    uint64_t limit = 0;
+
+    TraceReader reader;
+    memset(&reader, 0, sizeof(reader));
+    reader.capture_port = 5683;
+    reader.method = 2;
+    reader.confirmable = 1;
+
+    for (int i = 4; i + 1 < argc; i += 2) {
+        const char *opt = argv[i], *val = argv[i + 1];
+        if (strcmp(opt, "--speed") == 0) speed = atof(val);
+        else if (strcmp(opt, "--timeout") == 0) timeout_ms = atoi(val);
+        else if (strcmp(opt, "--capture-port") == 0) reader.capture_port = (uint16_t)atoi(val);
+        else if (strcmp(opt, "--interval-us") == 0) reader.interval_ns = (uint64_t)atoll(val) * 1000ULL;
+        else if (strcmp(opt, "--method") == 0) reader.method = strcmp(val, "put") == 0 ? 3 : 2;
+        else if (strcmp(opt, "--mode") == 0) reader.confirmable = strcmp(val, "non") != 0;
+        else if (strcmp(opt, "--limit") == 0) limit = (uint64_t)atoll(val);
+        else {
+            fprintf(stderr, "Opción desconocida: %s\n", opt);
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (speed < 0) speed = 0;
+
+    int is_pcap = reader_open(&reader, trace_path);
+    if (is_pcap < 0) return 1;
+
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0) {
+        perror("socket");
+        return 1;
+    }
+    int rcvbuf = 4 * 1024 * 1024;
+    setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    struct sockaddr_in server;
+    memset(&server, 0, sizeof(server));
+    server.sin_family = AF_INET;
+    server.sin_port = htons(port);
+    if (inet_pton(AF_INET, host, &server.sin_addr) != 1) {
+        fprintf(stderr, "IP inválida: %s\n", host);
+        return 1;
+    }
+
+    printf("=== Replay CoAP ===\n");
+    printf("Traza: %s (%s)  Destino: %s:%d\n", trace_path, is_pcap ? "pcap" : "data_store.log", host, port);
+    if (speed > 0) printf("Velocidad: %.2fx\n", speed);
+    else printf("Velocidad: máxima\n");
+
+    Slot *slots = calloc(RP_WINDOW, sizeof(Slot));
+    ReplayStats *st = calloc(1, sizeof(ReplayStats));
+    TraceRecord *rec = malloc(sizeof(TraceRecord));
+    if (!slots || !st || !rec) {
+        fprintf(stderr, "Sin memoria\n");
+        return 1;
+    }
+    hist_init(&st->corrected);
+    hist_init(&st->uncorrected);
+
+    uint64_t timeout_ns = (uint64_t)timeout_ms * 1000000ULL;
+    uint64_t start = now_ns();
+    uint64_t seq = 0, oldest = 0;
+    uint8_t out[RP_PACKET_SIZE + RP_TOKEN_LEN];
+    uint64_t trace_span_ns = 0;
+
+    while ((limit == 0 || seq < limit) && reader.next(&reader, rec)) {
+        trace_span_ns = rec->ts_ns;
+        uint64_t intended = speed > 0 ? start + (uint64_t)((double)rec->ts_ns / speed) : now_ns();
+
+        // Esperar al instante programado atendiendo respuestas mientras tanto
+        for (;;) {
+            uint64_t now = now_ns();
+            if (now >= intended) break;
+            uint64_t wait_ms = (intended - now) / 1000000ULL;
+            poll_responses(sock, slots, st, (int)(wait_ms > 100 ? 100 : wait_ms));
+            expire(slots, st, &oldest, seq, now_ns(), timeout_ns);
+        }
+
+        Slot *s = &slots[seq % RP_WINDOW];
+        if (s->pending) {
+            s->pending = 0;
+            st->lost++;
+        }
+        int out_len = 0;
+        rewrite_token(rec, seq, out, &out_len);
+        int confirmable = ((out[0] >> 4) & 0x03) == 0;
+
+        s->seq = seq;
+        s->intended_ns = intended;
+        s->sent_ns = now_ns();
+        if (sendto(sock, out, (size_t)out_len, 0, (struct sockaddr*)&server, sizeof(server)) < 0) {
+            st->send_failures++;
+            s->pending = 0;
+        } else {
+            st->sent++;
+            s->pending = (uint8_t)confirmable;
+            if (!confirmable) st->non_sent++;
+        }
+        seq++;
+
+        poll_responses(sock, slots, st, 0);
+        expire(slots, st, &oldest, seq, now_ns(), timeout_ns);
+    }
+    fclose(reader.f);
+    free(reader.store_log);
+
+    // Esperar las respuestas pendientes
+    while (oldest < seq) {
+        poll_responses(sock, slots, st, 10);
+        expire(slots, st, &oldest, seq, now_ns(), timeout_ns);
+    }
+    double elapsed = (double)(now_ns() - start) / 1e9;
+
+    uint64_t expected = st->sent - st->non_sent;
+    printf("\n=== Resultados (%.2f s, traza de %.2f s) ===\n", elapsed, (double)trace_span_ns / 1e9);
+    printf("Enviados: %llu (%.0f req/s)  NON: %llu  Fallos de envío: %llu\n",
+           (unsigned long long)st->sent, elapsed > 0 ? (double)st->sent / elapsed : 0.0,
+           (unsigned long long)st->non_sent, (unsigned long long)st->send_failures);
+    printf("Respuestas: %llu  2.xx=%llu 4.xx=%llu 5.xx=%llu\n", (unsigned long long)st->responses,
+           (unsigned long long)st->by_class[2], (unsigned long long)st->by_class[4],
+           (unsigned long long)st->by_class[5]);
+    printf("Perdidos: %llu (%.3f%%)  Respuestas tardías/duplicadas: %llu\n", (unsigned long long)st->lost,
+           expected ? 100.0 * (double)st->lost / (double)expected : 0.0, (unsigned long long)st->late);
+    if (!is_pcap) {
+        printf("Valores omitidos (ilegibles o más grandes que un datagrama): %llu\n",
+               (unsigned long long)reader.skipped);
+    }
+    if (st->responses > 0) {
+        print_latency("Latencia (desde programado):", &st->corrected);
+        print_latency("Latencia (desde envío):", &st->uncorrected);
+    }
+
+    close(sock);
+    free(slots);
+    free(st);
+    free(rec);
+    return 0;
+}
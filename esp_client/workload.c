@@ -0,0 +1,198 @@
+#include "workload.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+typedef struct {
+    const char *name;
+    const char *spec;
+} NamedProfile;
+
+static const NamedProfile named_profiles[] = {
+    {"telemetry", "post=100,uris=1,con=0"},
+    {"mixed",     "get=40,post=30,put=25,delete=5,uris=1000,zipf=1.0,con=50"},
+    {"readheavy", "get=90,put=10,uris=10000,zipf=1.1,con=100"},
+    {"storm",     "post=100,uris=1000,zipf=0.8,con=100,burst_period=10000,burst_len=1000,burst_x=10"},
+};
+
+static void set_defaults(WorkloadProfile *wp)
+{
+    memset(wp, 0, sizeof(*wp));
+    wp->weight_post = 100;
+    wp->uri_count = 1;
+    wp->burst_multiplier = 1;
+}
+
+static int is_method_key(const char *key)
+{
+    return strcmp(key, "get") == 0 || strcmp(key, "post") == 0 ||
+           strcmp(key, "put") == 0 || strcmp(key, "delete") == 0;
+}
+
+static int apply_pair(WorkloadProfile *wp, const char *key, const char *value, int *weights_set)
+{
+    // El primer peso explícito reemplaza la mezcla por defecto (100% POST)
+    if (is_method_key(key) && !*weights_set) {
+        wp->weight_get = wp->weight_post = wp->weight_put = wp->weight_delete = 0;
+        *weights_set = 1;
+    }
+    if (strcmp(key, "get") == 0) wp->weight_get = atoi(value);
+    else if (strcmp(key, "post") == 0) wp->weight_post = atoi(value);
+    else if (strcmp(key, "put") == 0) wp->weight_put = atoi(value);
+    else if (strcmp(key, "delete") == 0) wp->weight_delete = atoi(value);
+    else if (strcmp(key, "con") == 0) wp->con_percent = atoi(value);
+    else if (strcmp(key, "uris") == 0) wp->uri_count = atoi(value);
+    else if (strcmp(key, "zipf") == 0) wp->zipf_s = atof(value);
+    else if (strcmp(key, "burst_period") == 0) wp->burst_period_ms = atoi(value);
+    else if (strcmp(key, "burst_len") == 0) wp->burst_len_ms = atoi(value);
+    else if (strcmp(key, "burst_x") == 0) wp->burst_multiplier = atoi(value);
+    else {
+        fprintf(stderr, "WORKLOAD: clave desconocida '%s'\n", key);
+        return -1;
+    }
+    return 0;
+}
+
+static int apply_spec(WorkloadProfile *wp, const char *spec, int allow_names, int *weights_set)
+{
+    char buf[512];
+    strncpy(buf, spec, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+
+    char *save = NULL;
+    for (char *tok = strtok_r(buf, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        char *eq = strchr(tok, '=');
+        if (!eq) {
+            int found = 0;
+            for (size_t i = 0; allow_names && i < sizeof(named_profiles) / sizeof(named_profiles[0]); i++) {
+                if (strcmp(tok, named_profiles[i].name) == 0) {
+                    int named_weights = 0;
+                    apply_spec(wp, named_profiles[i].spec, 0, &named_weights);
+                    found = 1;
+                    break;
+                }
+            }
+            if (!found) {
+                fprintf(stderr, "WORKLOAD: perfil desconocido '%s'\n", tok);
+                return -1;
+            }
+            continue;
+        }
+        *eq = '\0';
+        if (apply_pair(wp, tok, eq + 1, weights_set) != 0) return -1;
+    }
+    return 0;
+}
+
+static int build_zipf(WorkloadProfile *wp)
+{
+    wp->zipf_cdf = malloc(sizeof(double) * (size_t)wp->uri_count);
+    if (!wp->zipf_cdf) return -1;
+    double sum = 0.0;
+    for (int k = 0; k < wp->uri_count; k++) {
+        sum += 1.0 / pow((double)(k + 1), wp->zipf_s);
+        wp->zipf_cdf[k] = sum;
+    }
+    for (int k = 0; k < wp->uri_count; k++) wp->zipf_cdf[k] /= sum;
+    return 0;
+}
+
+int workload_init(WorkloadProfile *wp, const char *spec)
+{
+    set_defaults(wp);
+    int weights_set = 0;
+    if (spec && spec[0] && apply_spec(wp, spec, 1, &weights_set) != 0) return -1;
+    if (wp->weight_get + wp->weight_post + wp->weight_put + wp->weight_delete <= 0) {
+        fprintf(stderr, "WORKLOAD: la suma de pesos de métodos debe ser > 0\n");
+        return -1;
+    }
+    if (wp->uri_count < 1) wp->uri_count = 1;
+    if (wp->con_percent < 0) wp->con_percent = 0;
+    if (wp->con_percent > 100) wp->con_percent = 100;
+    if (wp->burst_multiplier < 1) wp->burst_multiplier = 1;
+    if (wp->burst_len_ms > wp->burst_period_ms) wp->burst_len_ms = wp->burst_period_ms;
+    return build_zipf(wp);
+}
+
+void workload_free(WorkloadProfile *wp)
+{
+    free(wp->zipf_cdf);
+    wp->zipf_cdf = NULL;
+}
+
+void workload_describe(const WorkloadProfile *wp, char *out, size_t out_size)
+{
+    snprintf(out, out_size,
+             "GET/POST/PUT/DELETE=%d/%d/%d/%d CON=%d%% URIs=%d zipf=%.2f ráfagas=%s",
+             wp->weight_get, wp->weight_post, wp->weight_put, wp->weight_delete,
+             wp->con_percent, wp->uri_count, wp->zipf_s,
+             wp->burst_period_ms > 0 ? "sí" : "no");
+    if (wp->burst_period_ms > 0) {
+        size_t len = strlen(out);
+        snprintf(out + len, out_size - len, " (%d ms cada %d ms, x%d)",
+                 wp->burst_len_ms, wp->burst_period_ms, wp->burst_multiplier);
+    }
+}
+
+// xorshift64*: barato y sin estado compartido entre threads
+uint64_t workload_rand(uint64_t *state)
+{
+    uint64_t x = *state ? *state : 0x9E3779B97F4A7C15ULL;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+static double rand_unit(uint64_t *rng)
+{
+    return (double)(workload_rand(rng) >> 11) / (double)(1ULL << 53);
+}
+
+void workload_next(const WorkloadProfile *wp, uint64_t *rng, WorkloadOp *op)
+{
+    int total = wp->weight_get + wp->weight_post + wp->weight_put + wp->weight_delete;
+    int r = (int)(workload_rand(rng) % (uint64_t)total);
+    if (r < wp->weight_get) op->method = 1;
+    else if (r < wp->weight_get + wp->weight_post) op->method = 2;
+    else if (r < wp->weight_get + wp->weight_post + wp->weight_put) op->method = 3;
+    else op->method = 4;
+
+    op->confirmable = (int)(workload_rand(rng) % 100) < wp->con_percent;
+
+    if (wp->uri_count <= 1) {
+        op->uri_index = -1;
+        return;
+    }
+    // Búsqueda binaria en la CDF
+    double u = rand_unit(rng);
+    int lo = 0, hi = wp->uri_count - 1;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (wp->zipf_cdf[mid] < u) lo = mid + 1;
+        else hi = mid;
+    }
+    op->uri_index = lo;
+}
+
+int workload_uri(const WorkloadProfile *wp, int uri_index, const char *base, char *out, size_t out_size)
+{
+    (void)wp;
+    if (uri_index < 0) return snprintf(out, out_size, "%s", base);
+    return snprintf(out, out_size, "%s/%d", base, uri_index);
+}
+
+int workload_rate_factor(const WorkloadProfile *wp, uint64_t elapsed_ms)
+{
+    if (wp->burst_period_ms <= 0) return 1;
+    return (elapsed_ms % (uint64_t)wp->burst_period_ms) < (uint64_t)wp->burst_len_ms ? wp->burst_multiplier : 1;
+}
+
+uint64_t workload_ms_to_next_burst(const WorkloadProfile *wp, uint64_t elapsed_ms)
+{
+    if (wp->burst_period_ms <= 0) return 0;
+    uint64_t phase = elapsed_ms % (uint64_t)wp->burst_period_ms;
+    return phase == 0 ? 0 : (uint64_t)wp->burst_period_ms - phase;
+}
@@ -0,0 +1,56 @@
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Perfil de carga para los simuladores: mezcla de métodos, URIs con
+// distribución Zipf, fases de ráfaga sincronizadas y mezcla CON/NON.
+//
+// Se construye a partir de un perfil predefinido o de una especificación
+// "clave=valor,..." por ejemplo:
+//   telemetry
+//   mixed,uris=5000,zipf=1.2
+//   get=30,post=50,put=15,delete=5,uris=1000,zipf=0.99,con=40,burst_period=10000,burst_len=500,burst_x=8
+typedef struct {
+    int weight_get;
+    int weight_post;
+    int weight_put;
+    int weight_delete;
+    int con_percent;        // % de mensajes confirmables
+    int uri_count;          // 1 = solo la ruta base; N = <ruta>/0 .. <ruta>/N-1
+    double zipf_s;          // exponente Zipf (0 = uniforme)
+    int burst_period_ms;    // 0 = sin ráfagas
+    int burst_len_ms;       // duración de la ráfaga al inicio de cada periodo
+    int burst_multiplier;   // factor de tasa durante la ráfaga
+    double *zipf_cdf;       // CDF acumulada (uri_count entradas)
+} WorkloadProfile;
+
+typedef struct {
+    uint8_t method;         // 1=GET 2=POST 3=PUT 4=DELETE
+    int confirmable;
+    int uri_index;          // -1 = ruta base
+} WorkloadOp;
+
+int workload_init(WorkloadProfile *wp, const char *spec);
+void workload_free(WorkloadProfile *wp);
+void workload_describe(const WorkloadProfile *wp, char *out, size_t out_size);
+
+uint64_t workload_rand(uint64_t *state);
+void workload_next(const WorkloadProfile *wp, uint64_t *rng, WorkloadOp *op);
+int workload_uri(const WorkloadProfile *wp, int uri_index, const char *base, char *out, size_t out_size);
+
+// Factor de tasa para el instante elapsed_ms (1 fuera de ráfaga)
+int workload_rate_factor(const WorkloadProfile *wp, uint64_t elapsed_ms);
+// Milisegundos hasta el inicio de la próxima ráfaga (0 si no hay ráfagas)
+uint64_t workload_ms_to_next_burst(const WorkloadProfile *wp, uint64_t elapsed_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,5 +1,7 @@
 #include "config.h"
 #include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
 
 void set_default_config(AppConfig *cfg)
 {
@@ -7,18 +9,170 @@ void set_default_config(AppConfig *cfg)
     cfg->log_file = "server.log";
     cfg->store_file = "data_store.log";  // Ruta simple en el directorio actual
     cfg->resource_path = "/sensors/temp";
+    cfg->metrics_file = NULL;            // Sin volcado Prometheus por defecto
+    cfg->metrics_interval_s = 10;
+    cfg->trace_file = NULL;
+    cfg->trace_sample = 100;
+    cfg->trace_threshold_us = 0;
+    cfg->unix_socket = NULL;
+    cfg->verbose = 1;
+    cfg->rate_limit = 0;
+    cfg->rate_burst = 0;
+    cfg->max_pending = 1024;
+    cfg->shed_max_age = 1;
+    cfg->workers = -1;                  // uno por core
+    cfg->lane_capacity = 1024;
+    cfg->stale_ms = 3000;               // ACK_TIMEOUT * ACK_RANDOM_FACTOR: la 1ª retransmisión sale a los 2-3 s
+    cfg->coalesce_ms = 0;
+    cfg->compress = 0;
+    cfg->ttl_s = 0;
+    cfg->memory_budget_kb = 0;
+    cfg->index_fields = NULL;
+    cfg->shm_table = NULL;
+    cfg->shm_slots = 65536;
+    cfg->feed_socket = NULL;
+    cfg->feed_buffer_kb = 4096;
+    cfg->snapshot_file = NULL;
+    cfg->snapshot_interval_s = 0;
 }
 
-void parse_config(AppConfig *cfg, int argc, char **argv)
+// Opciones con nombre: --<nombre> <valor>
+static void apply_option(AppConfig *cfg, const char *name, const char *value)
 {
-    if (argc > 1)
+    if (strcmp(name, "store") == 0)
+    {
+        cfg->store_file = value;
+    }
+    else if (strcmp(name, "resource") == 0)
+    {
+        cfg->resource_path = value;
+    }
+    else if (strcmp(name, "metrics-file") == 0)
+    {
+        cfg->metrics_file = value;
+    }
+    else if (strcmp(name, "metrics-interval") == 0)
+    {
+        cfg->metrics_interval_s = atoi(value);
+    }
+    else if (strcmp(name, "trace-file") == 0)
+    {
+        cfg->trace_file = value;
+    }
+    else if (strcmp(name, "trace-sample") == 0)
+    {
+        cfg->trace_sample = atoi(value);
+    }
+    else if (strcmp(name, "trace-threshold-us") == 0)
+    {
+        cfg->trace_threshold_us = atoi(value);
+    }
+    else if (strcmp(name, "unix-socket") == 0)
     {
-        cfg->port = atoi(argv[1]);
+        cfg->unix_socket = value;
     }
-    if (argc > 2)
+    else if (strcmp(name, "verbose") == 0)
     {
-        cfg->log_file = argv[2];
+        cfg->verbose = atoi(value);
+    }
+    else if (strcmp(name, "rate-limit") == 0)
+    {
+        cfg->rate_limit = atof(value);
+    }
+    else if (strcmp(name, "rate-burst") == 0)
+    {
+        cfg->rate_burst = atof(value);
+    }
+    else if (strcmp(name, "max-pending") == 0)
+    {
+        cfg->max_pending = atoi(value);
+    }
+    else if (strcmp(name, "shed-max-age") == 0)
+    {
+        cfg->shed_max_age = atoi(value);
+    }
+    else if (strcmp(name, "workers") == 0)
+    {
+        cfg->workers = atoi(value);
+    }
+    else if (strcmp(name, "lane-capacity") == 0)
+    {
+        cfg->lane_capacity = atoi(value);
+    }
+    else if (strcmp(name, "stale-ms") == 0)
+    {
+        cfg->stale_ms = atoi(value);
+    }
+    else if (strcmp(name, "coalesce-ms") == 0)
+    {
+        cfg->coalesce_ms = atoi(value);
+    }
+    else if (strcmp(name, "compress") == 0)
+    {
+        cfg->compress = atoi(value);
+    }
+    else if (strcmp(name, "ttl") == 0)
+    {
+        cfg->ttl_s = atoi(value);
+    }
+    else if (strcmp(name, "memory-budget-kb") == 0)
+    {
+        cfg->memory_budget_kb = atoi(value);
+    }
+    else if (strcmp(name, "index-fields") == 0)
+    {
+        cfg->index_fields = value;
+    }
+    else if (strcmp(name, "shm-table") == 0)
+    {
+        cfg->shm_table = value;
+    }
+    else if (strcmp(name, "shm-slots") == 0)
+    {
+        cfg->shm_slots = atoi(value);
+    }
+    else if (strcmp(name, "feed-socket") == 0)
+    {
+        cfg->feed_socket = value;
+    }
+    else if (strcmp(name, "feed-buffer-kb") == 0)
+    {
+        cfg->feed_buffer_kb = atoi(value);
+    }
+    else if (strcmp(name, "snapshot-file") == 0)
+    {
+        cfg->snapshot_file = value;
+    }
+    else if (strcmp(name, "snapshot-interval") == 0)
+    {
+        cfg->snapshot_interval_s = atoi(value);
+    }
+    else
+    {
+        fprintf(stderr, "CONFIG: Opción desconocida --%s (ignorada)\n", name);
     }
 }
 
-
+void parse_config(AppConfig *cfg, int argc, char **argv)
+{
+    // Posicionales: <puerto> <archivo_log>; el resto son opciones --nombre valor
+    int positional = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "--", 2) == 0 && i + 1 < argc)
+        {
+            apply_option(cfg, argv[i] + 2, argv[i + 1]);
+            i++;
+            continue;
+        }
+        if (positional == 0)
+        {
+            cfg->port = atoi(argv[i]);
+        }
+        else if (positional == 1)
+        {
+            cfg->log_file = argv[i];
+        }
+        positional++;
+    }
+}
@@ -1,8 +1,11 @@
 #include "handlers.h"
 #include "data_store.h"
+#include "metrics.h"
 #include <string.h>
 #include <stdio.h>
 #include <ctype.h>
+#include <limits.h>
+#include <stdlib.h>
 
 // Función simple para validar JSON básico
 int is_valid_json(const char *str) {
@@ -43,7 +46,9 @@ int HandlerFunctionTempPost(const coap_message_t *msg, char *responseBuffer)
         return -1;
     }
     
-    if (data_store_set(msg->uri_path, tmp) != 0)
+    // Max-Age del request = TTL de la clave; sin Max-Age, el de la ruta
+    int ttl_s = msg->max_age < 0 ? DATA_STORE_TTL_ROUTE : (msg->max_age > INT_MAX ? INT_MAX : (int)msg->max_age);
+    if (data_store_set_with_ttl(msg->uri_path, tmp, ttl_s) != 0)
     {
         snprintf(responseBuffer, 512, "Error al persistir payload (%zu bytes)", msg->payload_len);
         return -1;
@@ -52,12 +57,42 @@ int HandlerFunctionTempPost(const coap_message_t *msg, char *responseBuffer)
     return 0;
 }
 
+// GET con ?campo=valor: última lectura de ese valor en el índice por campo
+static int get_by_query(const coap_message_t *msg, char *responseBuffer)
+{
+    char query[sizeof(msg->uri_query)];
+    memcpy(query, msg->uri_query, msg->uri_query_len + 1);
+    char *value = strchr(query, '=');
+    if (!value)
+    {
+        snprintf(responseBuffer, 512, "Consulta inválida: %s (se espera campo=valor)", msg->uri_query);
+        return 0;
+    }
+    *value++ = '\0';
+    char *next = strchr(value, '&');
+    if (next) *next = '\0';
+    int n = data_store_get_by_field(msg->uri_path, query, value, responseBuffer, 512);
+    if (n < 0)
+    {
+        snprintf(responseBuffer, 512, "El campo %s no está indexado", query);
+    }
+    else if (n == 0)
+    {
+        snprintf(responseBuffer, 512, "No hay datos para %s con %s=%s", msg->uri_path, query, value);
+    }
+    return 0;
+}
+
 int HandlerFunctionTempGet(const coap_message_t *msg, char *responseBuffer)
 {
     if (msg == NULL || responseBuffer == NULL)
     {
         return -1;
     }
+    if (msg->uri_query_len > 0)
+    {
+        return get_by_query(msg, responseBuffer);
+    }
     int n = data_store_get(msg->uri_path, responseBuffer, 512);
     if (n < 0)
     {
@@ -71,6 +106,44 @@ int HandlerFunctionTempGet(const coap_message_t *msg, char *responseBuffer)
     return 0;
 }
 
+// GET con patrón (/sensors/*, /sensors/*/temp): una página de las claves
+// que cumplen, con ?after=<clave> para seguir y ?limit=<n> para acotarla
+int HandlerFunctionBulkGet(const coap_message_t *msg, char *responseBuffer)
+{
+    if (msg == NULL || responseBuffer == NULL)
+    {
+        return -1;
+    }
+    char query[sizeof(msg->uri_query)];
+    memcpy(query, msg->uri_query, msg->uri_query_len + 1);
+    const char *after = NULL;
+    int limit = 0;
+    for (char *arg = query, *next; *arg; arg = next)
+    {
+        next = arg + strcspn(arg, "&");
+        if (*next) *next++ = '\0';
+        if (strncmp(arg, "after=", 6) == 0)
+        {
+            after = arg + 6;
+        }
+        else if (strncmp(arg, "limit=", 6) == 0)
+        {
+            limit = atoi(arg + 6);
+        }
+        else
+        {
+            snprintf(responseBuffer, 512, "Consulta inválida: %s (se espera after=<clave> o limit=<n>)", arg);
+            return 0;
+        }
+    }
+    if (data_store_get_matching(msg->uri_path, after, limit > 0 ? limit : 0, responseBuffer, 512) < 0)
+    {
+        snprintf(responseBuffer, 512, "Error al recorrer %s", msg->uri_path);
+        return -1;
+    }
+    return 0;
+}
+
 int HandlerFunctionTempPut(const coap_message_t *msg, char *responseBuffer)
 {
     if (msg == NULL || responseBuffer == NULL)
@@ -93,7 +166,9 @@ int HandlerFunctionTempPut(const coap_message_t *msg, char *responseBuffer)
         return -1;
     }
     
-    if (data_store_set(msg->uri_path, tmp) != 0)
+    // Max-Age del request = TTL de la clave; sin Max-Age, el de la ruta
+    int ttl_s = msg->max_age < 0 ? DATA_STORE_TTL_ROUTE : (msg->max_age > INT_MAX ? INT_MAX : (int)msg->max_age);
+    if (data_store_set_with_ttl(msg->uri_path, tmp, ttl_s) != 0)
     {
         snprintf(responseBuffer, 512, "Error al actualizar payload (%zu bytes)", msg->payload_len);
         return -1;
@@ -118,3 +193,74 @@ int HandlerFunctionTempDelete(const coap_message_t *msg, char *responseBuffer)
 }
 
 
+
+// Una página del snapshot lleva al menos un campo y el cursor
+_Static_assert(METRICS_JSON_FIELD_MAX + 64 <= 512, "Un campo de métricas debe entrar en una respuesta");
+
+int HandlerFunctionMetricsGet(const coap_message_t *msg, char *responseBuffer)
+{
+    if (msg == NULL || responseBuffer == NULL)
+    {
+        return -1;
+    }
+    // ?after=<campo>: página siguiente del snapshot
+    const char *after = NULL;
+    if (msg->uri_query_len > 0)
+    {
+        if (strncmp(msg->uri_query, "after=", 6) != 0 || strchr(msg->uri_query, '&'))
+        {
+            snprintf(responseBuffer, 512, "Consulta inválida: %s (se espera after=<campo>)", msg->uri_query);
+            return 0;
+        }
+        after = msg->uri_query + 6;
+    }
+    // Solo lee contadores atómicos: no toma ningún lock del camino de requests
+    if (metrics_snapshot_json(responseBuffer, 512, after) < 0)
+    {
+        if (after)
+        {
+            snprintf(responseBuffer, 512, "Campo de métricas desconocido: %s", after);
+            return 0;
+        }
+        snprintf(responseBuffer, 512, "Error al generar snapshot de métricas");
+        return -1;
+    }
+    return 0;
+}
+
+int HandlerFunctionSnapshotGet(const coap_message_t *msg, char *responseBuffer)
+{
+    if (msg == NULL || responseBuffer == NULL)
+    {
+        return -1;
+    }
+    DataStoreSnapshotInfo info;
+    data_store_snapshot_info(&info);
+    snprintf(responseBuffer, 512,
+             "{\"state\":\"%s\",\"completed\":%llu,\"failed\":%llu,\"last\":{\"ok\":%d,"
+             "\"entries\":%llu,\"bytes\":%llu,\"fork_us\":%llu,\"duration_ms\":%llu,"
+             "\"cow_pages\":%llu,\"cow_kb\":%llu}}",
+             info.running ? "running" : "idle",
+             (unsigned long long)info.completed, (unsigned long long)info.failed, info.last_ok,
+             (unsigned long long)info.last_entries, (unsigned long long)info.last_bytes,
+             (unsigned long long)info.last_fork_us, (unsigned long long)info.last_duration_ms,
+             (unsigned long long)info.last_cow_pages, (unsigned long long)info.last_cow_kb);
+    return 0;
+}
+
+int HandlerFunctionSnapshotPost(const coap_message_t *msg, char *responseBuffer)
+{
+    if (msg == NULL || responseBuffer == NULL)
+    {
+        return -1;
+    }
+    // Solo el fork es sincrónico; el archivo lo escribe el proceso hijo
+    int rc = data_store_snapshot_start();
+    if (rc < 0)
+    {
+        snprintf(responseBuffer, 512, "Error al iniciar el snapshot");
+        return -1;
+    }
+    snprintf(responseBuffer, 512, rc == 0 ? "Snapshot iniciado" : "Ya hay un snapshot en curso");
+    return 0;
+}
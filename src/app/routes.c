@@ -3,29 +3,61 @@
 #include "coap_api.h"
 #include <stdio.h>
 
-int register_routes(const char *resource_path)
+static int register_resource(const char *path)
 {
-    if (coap_register_handler(resource_path, COAP_METHOD_POST, HandlerFunctionTempPost) != 0)
+    if (coap_register_handler(path, COAP_METHOD_POST, HandlerFunctionTempPost) != 0)
     {
-        fprintf(stderr, "Error registrando handler POST %s\n", resource_path);
+        fprintf(stderr, "Error registrando handler POST %s\n", path);
         return -1;
     }
-    if (coap_register_handler(resource_path, COAP_METHOD_GET, HandlerFunctionTempGet) != 0)
+    if (coap_register_handler(path, COAP_METHOD_GET, HandlerFunctionTempGet) != 0)
     {
-        fprintf(stderr, "Error registrando handler GET %s\n", resource_path);
+        fprintf(stderr, "Error registrando handler GET %s\n", path);
         return -1;
     }
-    if (coap_register_handler(resource_path, COAP_METHOD_PUT, HandlerFunctionTempPut) != 0)
+    if (coap_register_handler(path, COAP_METHOD_PUT, HandlerFunctionTempPut) != 0)
     {
-        fprintf(stderr, "Error registrando handler PUT %s\n", resource_path);
+        fprintf(stderr, "Error registrando handler PUT %s\n", path);
         return -1;
     }
-    if (coap_register_handler(resource_path, COAP_METHOD_DELETE, HandlerFunctionTempDelete) != 0)
+    if (coap_register_handler(path, COAP_METHOD_DELETE, HandlerFunctionTempDelete) != 0)
     {
-        fprintf(stderr, "Error registrando handler DELETE %s\n", resource_path);
+        fprintf(stderr, "Error registrando handler DELETE %s\n", path);
         return -1;
     }
     return 0;
 }
 
-
+int register_routes(const char *resource_path)
+{
+    if (register_resource(resource_path) != 0)
+    {
+        return -1;
+    }
+    // Sub-recursos (<ruta>/<id>): cada dispositivo o sensor con su propia clave
+    char subtree[128];
+    snprintf(subtree, sizeof(subtree), "%s/*", resource_path);
+    if (register_resource(subtree) != 0)
+    {
+        return -1;
+    }
+    // GET con patrón (/sensors/*, <ruta>/*/temp), paginados: el store solo
+    // tiene claves de <ruta>, así que el patrón puede empezar más arriba
+    if (coap_register_pattern_handler("/", COAP_METHOD_GET, HandlerFunctionBulkGet) != 0)
+    {
+        fprintf(stderr, "Error registrando handler GET con patrón\n");
+        return -1;
+    }
+    if (coap_register_handler(METRICS_RESOURCE_PATH, COAP_METHOD_GET, HandlerFunctionMetricsGet) != 0)
+    {
+        fprintf(stderr, "Error registrando handler GET %s\n", METRICS_RESOURCE_PATH);
+        return -1;
+    }
+    if (coap_register_handler(SNAPSHOT_RESOURCE_PATH, COAP_METHOD_GET, HandlerFunctionSnapshotGet) != 0 ||
+        coap_register_handler(SNAPSHOT_RESOURCE_PATH, COAP_METHOD_POST, HandlerFunctionSnapshotPost) != 0)
+    {
+        fprintf(stderr, "Error registrando handlers de %s\n", SNAPSHOT_RESOURCE_PATH);
+        return -1;
+    }
+    return 0;
+}
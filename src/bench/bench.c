@@ -0,0 +1,649 @@
+// Microbenchmarks del servidor CoAP: parser, serializer, router, data store
+// y validación de JSON, medidos aislados del socket, más el camino completo
+// (parseo, router, handler, respuesta) sobre el transporte loopback en memoria.
+//
+// Cada caso corre durante un tiempo fijo con 1..N threads (y, para el store,
+// con distintas cantidades de claves precargadas). La salida es TSV, una fila
+// por caso, para guardarla como baseline y comparar corridas posteriores:
+//   make bench BENCH_ARGS="--out bench/baseline.tsv"
+//   make bench BENCH_ARGS="--baseline bench/baseline.tsv --max-regression 10"
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "coap_parser.h"
+#include "coap_api.h"
+#include "data_store.h"
+#include "handlers.h"
+#include "routes.h"
+#include "message.h"
+#include "metrics.h"
+#include "server.h"
+#include "transport.h"
+#include "arena.h"
+#include "shm_table.h"
+#include "store_log.h"
+
+#define BENCH_MAX_THREADS   64
+#define BENCH_MAX_LIST      16
+#define BENCH_PACKETS       64
+#define BENCH_BATCH         64
+#define BENCH_MAX_BASELINE  256
+#define BENCH_RESOURCE      "/temp"
+#define BENCH_SHM_TABLE     "coap_bench_shm"
+#define BENCH_SHM_SLOTS     131072
+
+typedef struct {
+    int id;
+    int keys;               // claves precargadas en el store (0 = no aplica)
+    uint64_t rng;
+    uint64_t ops;
+    coap_message_t request; // request ya parseado para el caso de respuesta
+} BenchThread;
+
+typedef void (*bench_fn)(BenchThread *t);
+
+typedef struct {
+    const char *name;
+    bench_fn fn;
+    int uses_store;         // se repite para cada cantidad de claves
+    int (*setup)(void);     // opcionales: antes de arrancar, al parar y al final
+    void (*stop)(void);
+    void (*teardown)(void);
+} BenchCase;
+
+typedef struct {
+    char name[64];
+    int keys;
+    int threads;
+    double ops_per_s;
+} BaselineRow;
+
+static uint8_t packets[BENCH_PACKETS][256];
+static size_t packet_lens[BENCH_PACKETS];
+static const char *json_sample = "{\"id\":\"esp32-0042\",\"temp\":21.75,\"hum\":48.2,\"bat\":{\"v\":3.71,\"pct\":88}}";
+static const char *router_uris[] = {
+    BENCH_RESOURCE, BENCH_RESOURCE "/17", BENCH_RESOURCE "/9999", METRICS_RESOURCE_PATH, "/inexistente",
+};
+static const uint8_t router_methods[] = {
+    COAP_METHOD_GET, COAP_METHOD_POST, COAP_METHOD_PUT, COAP_METHOD_GET, COAP_METHOD_DELETE,
+};
+
+static atomic_int stop_flag;
+static Transport loopback;
+static pthread_barrier_t start_barrier;
+static char store_path[256];
+static ShmTable *shm_reader;
+static int prepared_keys;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t next_rand(uint64_t *state)
+{
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+// Requests CON con Uri-Path, Content-Format y payload JSON, como los del ESP
+static void build_packets(void)
+{
+    for (int i = 0; i < BENCH_PACKETS; i++) {
+        CoapMessage m;
+        coap_message_init(&m);
+        m.version = 1;
+        m.type = COAP_TYPE_CONFIRMABLE;
+        m.code = (i % 4 == 0) ? COAP_METHOD_GET : COAP_METHOD_POST;
+        m.message_id = (unsigned short)(1000 + i);
+        m.tkl = m.token_len = 4;
+        for (int k = 0; k < 4; k++) m.token[k] = (unsigned char)(i * 7 + k);
+
+        char id[16];
+        int id_len = snprintf(id, sizeof(id), "%d", i);
+        coap_add_option(&m, COAP_OPTION_URI_PATH, (const unsigned char *)"temp", 4);
+        coap_add_option(&m, COAP_OPTION_URI_PATH, (const unsigned char *)id, (unsigned short)id_len);
+        unsigned char cf = 50;
+        coap_add_option(&m, COAP_OPTION_CONTENT_FORMAT, &cf, 1);
+        if (m.code == COAP_METHOD_POST) {
+            coap_set_payload(&m, (const unsigned char *)json_sample, (int)strlen(json_sample));
+        }
+        int len = coap_serialize(&m, packets[i], sizeof(packets[i]));
+        packet_lens[i] = len > 0 ? (size_t)len : 0;
+        for (int k = 0; k < m.option_count; k++) free(m.options[k].value);
+    }
+}
+
+static void bench_parse(BenchThread *t)
+{
+    Arena *arena = arena_thread();
+    for (int i = 0; i < BENCH_BATCH; i++) {
+        int idx = (int)((t->ops + (uint64_t)i) % BENCH_PACKETS);
+        coap_message_t msg;
+        if (parse_coap_message(packets[idx], packet_lens[idx], &msg) == 0) {
+            free_coap_message(&msg);
+        }
+        arena_reset(arena);
+    }
+    t->ops += BENCH_BATCH;
+}
+
+static void bench_response(BenchThread *t)
+{
+    static const char body[] = "JSON válido recibido y guardado (68 bytes)";
+    uint8_t out[1024];
+    Arena *arena = arena_thread();
+    for (int i = 0; i < BENCH_BATCH; i++) {
+        coap_message_t resp;
+        create_coap_response(&t->request, &resp, COAP_RESPONSE_CREATED, body, sizeof(body) - 1);
+        size_t n = serialize_coap_message(&resp, out, sizeof(out));
+        free_coap_message(&resp);
+        arena_reset(arena);
+        if (n == 0) break;
+    }
+    t->ops += BENCH_BATCH;
+}
+
+static void bench_router(BenchThread *t)
+{
+    size_t count = sizeof(router_uris) / sizeof(router_uris[0]);
+    volatile uintptr_t sink = 0;
+    for (int i = 0; i < BENCH_BATCH; i++) {
+        size_t idx = (size_t)(t->ops + (uint64_t)i) % count;
+        sink ^= (uintptr_t)find_handler(router_uris[idx], router_methods[idx]);
+    }
+    (void)sink;
+    t->ops += BENCH_BATCH;
+}
+
+static void bench_json(BenchThread *t)
+{
+    volatile int sink = 0;
+    for (int i = 0; i < BENCH_BATCH; i++) sink += is_valid_json(json_sample);
+    (void)sink;
+    t->ops += BENCH_BATCH;
+}
+
+static void bench_store_get(BenchThread *t)
+{
+    char key[64], out[512];
+    for (int i = 0; i < BENCH_BATCH; i++) {
+        snprintf(key, sizeof(key), BENCH_RESOURCE "/%d", (int)(next_rand(&t->rng) % (uint64_t)t->keys));
+        data_store_get(key, out, sizeof(out));
+    }
+    t->ops += BENCH_BATCH;
+}
+
+static void bench_store_set(BenchThread *t)
+{
+    char key[64];
+    for (int i = 0; i < BENCH_BATCH; i++) {
+        snprintf(key, sizeof(key), BENCH_RESOURCE "/%d", (int)(next_rand(&t->rng) % (uint64_t)t->keys));
+        data_store_set(key, json_sample);
+    }
+    t->ops += BENCH_BATCH;
+}
+
+// Registro del log binario con su CRC32C, como en cada append
+static void bench_store_record(BenchThread *t)
+{
+    char buf[512];
+    StoreRecord rec = {
+        .type = STORE_REC_VALUE,
+        .key = BENCH_RESOURCE "/0",
+        .key_len = sizeof(BENCH_RESOURCE "/0") - 1,
+        .value = json_sample,
+        .value_len = strlen(json_sample),
+    };
+    volatile size_t sink = 0;
+    for (int i = 0; i < BENCH_BATCH; i++) {
+        rec.version = (uint32_t)i;
+        sink += store_log_encode(buf, sizeof(buf), &rec);
+    }
+    (void)sink;
+    t->ops += BENCH_BATCH;
+}
+
+// Consulta al índice por campo: todos los dispositivos escribieron la misma
+// ruta (index_setup), así que casi todas las lecturas salen de las copias que
+// guarda el índice
+static void bench_store_get_by_field(BenchThread *t)
+{
+    char id[32], out[512];
+    for (int i = 0; i < BENCH_BATCH; i++) {
+        snprintf(id, sizeof(id), "esp32-%d", (int)(next_rand(&t->rng) % (uint64_t)t->keys));
+        data_store_get_by_field(BENCH_RESOURCE, "id", id, out, sizeof(out));
+    }
+    t->ops += BENCH_BATCH;
+}
+
+// Una página de GET con patrón desde una clave al azar: posicionarse en la
+// skip list y armar el JSON de las claves que entran en 512 bytes
+static void bench_store_get_matching(BenchThread *t)
+{
+    char after[64], out[512];
+    for (int i = 0; i < BENCH_BATCH; i++) {
+        snprintf(after, sizeof(after), BENCH_RESOURCE "/%d", (int)(next_rand(&t->rng) % (uint64_t)t->keys));
+        data_store_get_matching(BENCH_RESOURCE "/*", after, 0, out, sizeof(out));
+    }
+    t->ops += BENCH_BATCH;
+}
+
+// Lector de la tabla compartida: mismo acceso aleatorio que data_store_get
+static void bench_shm_get(BenchThread *t)
+{
+    char key[64], out[SHM_VALUE_MAX + 1];
+    for (int i = 0; i < BENCH_BATCH; i++) {
+        snprintf(key, sizeof(key), BENCH_RESOURCE "/%d", (int)(next_rand(&t->rng) % (uint64_t)t->keys));
+        shm_table_get(shm_reader, key, out, sizeof(out), NULL);
+    }
+    t->ops += BENCH_BATCH;
+}
+
+static int count_value(const ShmValue *v, void *ctx)
+{
+    (void)v;
+    (*(uint64_t *)ctx)++;
+    return 0;
+}
+
+// Recorrido completo; las ops son valores leídos
+static void bench_shm_scan(BenchThread *t)
+{
+    shm_table_scan(shm_reader, count_value, &t->ops);
+}
+
+static int index_setup(void)
+{
+    if (data_store_set_index_fields("id") != 0) return -1;
+    char payload[128];
+    for (int i = 0; i < prepared_keys; i++) {
+        snprintf(payload, sizeof(payload),
+                 "{\"id\":\"esp32-%d\",\"temp\":21.75,\"hum\":48.2,\"bat\":{\"v\":3.71,\"pct\":88}}", i);
+        if (data_store_set(BENCH_RESOURCE, payload) != 0) return -1;
+    }
+    return 0;
+}
+
+static void index_teardown(void)
+{
+    data_store_set_index_fields(NULL);
+}
+
+static int shm_setup(void)
+{
+    if (data_store_set_shared_table(BENCH_SHM_TABLE, BENCH_SHM_SLOTS) != 0) return -1;
+    shm_reader = shm_table_open(BENCH_SHM_TABLE);
+    return shm_reader ? 0 : -1;
+}
+
+static void shm_teardown(void)
+{
+    shm_table_close(shm_reader, 0);
+    shm_reader = NULL;
+    data_store_set_shared_table(NULL, 0);
+}
+
+static void *loopback_handle(void *arg)
+{
+    server_handle_datagram((struct MessageData *)arg, NULL);
+    return NULL;
+}
+
+// Cada thread hace de cliente (inyecta un lote de GET) y de servidor (recibe
+// un lote y lo procesa con server_handle_datagram); las ops son respuestas
+// recogidas. Mide el stack completo sin red del kernel. Con spawn cada
+// datagrama se procesa en un thread nuevo, como con --workers 0.
+static void loopback_round(BenchThread *t, int spawn)
+{
+    static __thread struct MessageData msgs[TRANSPORT_BATCH];
+    TransportDatagram dgrams[TRANSPORT_BATCH];
+    uint8_t reply[TRANSPORT_MAX_DATAGRAM];
+
+    for (int i = 0; i < TRANSPORT_BATCH; i++) {
+        // packets[i] con i múltiplo de 4 son GET
+        int idx = (int)(((t->ops + (uint64_t)i) * 4) % BENCH_PACKETS);
+        if (transport_loopback_send(&loopback, (uint32_t)t->id, packets[idx], packet_lens[idx]) != 0) break;
+    }
+
+    for (int i = 0; i < TRANSPORT_BATCH; i++) dgrams[i].data = msgs[i].buffer;
+    int n = transport_recv_batch(&loopback, dgrams, TRANSPORT_BATCH);
+    uint64_t rx_ns = metrics_now_ns();
+    pthread_t threads[TRANSPORT_BATCH];
+    int spawned[TRANSPORT_BATCH];
+    for (int i = 0; i < n; i++) {
+        msgs[i].len = (ssize_t)dgrams[i].len;
+        msgs[i].peer = dgrams[i].peer;
+        msgs[i].transport = &loopback;
+        msgs[i].rx_ns = rx_ns;
+        spawned[i] = spawn && pthread_create(&threads[i], NULL, loopback_handle, &msgs[i]) == 0;
+        if (!spawned[i]) server_handle_datagram(&msgs[i], NULL);
+    }
+    for (int i = 0; i < n; i++) {
+        if (spawned[i]) pthread_join(threads[i], NULL);
+    }
+
+    uint32_t client_id;
+    while (transport_loopback_recv(&loopback, &client_id, reply, sizeof(reply)) > 0) t->ops++;
+}
+
+static void bench_loopback(BenchThread *t)
+{
+    loopback_round(t, 0);
+}
+
+static void bench_loopback_spawn(BenchThread *t)
+{
+    loopback_round(t, 1);
+}
+
+static int loopback_setup(void)
+{
+    return transport_loopback_open(&loopback, 4096);
+}
+
+static void loopback_stop(void)
+{
+    // Libera a los threads que quedaron esperando en recv_batch
+    transport_loopback_shutdown(&loopback);
+}
+
+static void loopback_teardown(void)
+{
+    transport_close(&loopback);
+}
+
+static const BenchCase cases[] = {
+    {"parse_coap_message", bench_parse, 0, NULL, NULL, NULL},
+    {"create_response+serialize", bench_response, 0, NULL, NULL, NULL},
+    {"find_handler", bench_router, 0, NULL, NULL, NULL},
+    {"is_valid_json", bench_json, 0, NULL, NULL, NULL},
+    {"data_store_get", bench_store_get, 1, NULL, NULL, NULL},
+    {"data_store_set", bench_store_set, 1, NULL, NULL, NULL},
+    {"store_log_encode", bench_store_record, 0, NULL, NULL, NULL},
+    {"data_store_get_by_field", bench_store_get_by_field, 1, index_setup, NULL, index_teardown},
+    {"data_store_get_matching", bench_store_get_matching, 1, NULL, NULL, NULL},
+    {"shm_table_get", bench_shm_get, 1, shm_setup, NULL, shm_teardown},
+    {"shm_table_scan", bench_shm_scan, 1, shm_setup, NULL, shm_teardown},
+    {"loopback_get", bench_loopback, 1, loopback_setup, loopback_stop, loopback_teardown},
+    {"loopback_get_thread", bench_loopback_spawn, 1, loopback_setup, loopback_stop, loopback_teardown},
+};
+
+typedef struct {
+    BenchThread state;
+    bench_fn fn;
+} ThreadArg;
+
+static void *bench_thread(void *arg)
+{
+    ThreadArg *a = (ThreadArg *)arg;
+    pthread_barrier_wait(&start_barrier);
+    while (!atomic_load_explicit(&stop_flag, memory_order_relaxed)) {
+        a->fn(&a->state);
+    }
+    return NULL;
+}
+
+// Corre un caso con nthreads durante time_ms y devuelve las ops/s agregadas
+static double run_case(const BenchCase *bc, int keys, int nthreads, int time_ms, uint64_t *total_ops)
+{
+    ThreadArg args[BENCH_MAX_THREADS];
+    pthread_t tids[BENCH_MAX_THREADS];
+    memset(args, 0, sizeof(args));
+
+    for (int i = 0; i < nthreads; i++) {
+        args[i].fn = bc->fn;
+        args[i].state.id = i;
+        args[i].state.keys = keys;
+        args[i].state.rng = 0x9E3779B97F4A7C15ULL * (uint64_t)(i + 1);
+        if (bc->fn == bench_response) {
+            parse_coap_message(packets[1], packet_lens[1], &args[i].state.request);
+        }
+    }
+
+    if (bc->setup && bc->setup() != 0) {
+        fprintf(stderr, "No se pudo preparar el caso %s\n", bc->name);
+        *total_ops = 0;
+        return 0.0;
+    }
+    atomic_store(&stop_flag, 0);
+    pthread_barrier_init(&start_barrier, NULL, (unsigned)nthreads + 1);
+    for (int i = 0; i < nthreads; i++) pthread_create(&tids[i], NULL, bench_thread, &args[i]);
+
+    pthread_barrier_wait(&start_barrier);
+    uint64_t t0 = now_ns();
+    struct timespec pause = {time_ms / 1000, (long)(time_ms % 1000) * 1000000L};
+    nanosleep(&pause, NULL);
+    atomic_store(&stop_flag, 1);
+    if (bc->stop) bc->stop();
+    for (int i = 0; i < nthreads; i++) pthread_join(tids[i], NULL);
+    uint64_t elapsed = now_ns() - t0;
+    pthread_barrier_destroy(&start_barrier);
+    if (bc->teardown) bc->teardown();
+
+    uint64_t ops = 0;
+    for (int i = 0; i < nthreads; i++) {
+        ops += args[i].state.ops;
+        if (bc->fn == bench_response) free_coap_message(&args[i].state.request);
+    }
+    // Los requests de bench_response se parsearon en la arena de este thread
+    arena_reset(arena_thread());
+    *total_ops = ops;
+    return elapsed > 0 ? (double)ops * 1e9 / (double)elapsed : 0.0;
+}
+
+// Reinicia el store con 'keys' claves precargadas sobre un archivo vacío
+static int prepare_store(int keys)
+{
+    data_store_cleanup();
+    FILE *f = fopen(store_path, "w");
+    if (!f) return -1;
+    fclose(f);
+    if (data_store_init(store_path) != 0) return -1;
+    prepared_keys = keys;
+    char key[64];
+    for (int i = 0; i < keys; i++) {
+        snprintf(key, sizeof(key), BENCH_RESOURCE "/%d", i);
+        data_store_set(key, json_sample);
+    }
+    return 0;
+}
+
+static int parse_list(const char *spec, int *out, int max)
+{
+    int n = 0;
+    char buf[128];
+    strncpy(buf, spec, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+    char *save = NULL;
+    for (char *tok = strtok_r(buf, ",", &save); tok && n < max; tok = strtok_r(NULL, ",", &save)) {
+        int v = atoi(tok);
+        if (v > 0) out[n++] = v;
+    }
+    return n;
+}
+
+static int load_baseline(const char *path, BaselineRow *rows, int max)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "No se pudo abrir el baseline: %s\n", path);
+        return -1;
+    }
+    char line[512];
+    int n = 0;
+    while (n < max && fgets(line, sizeof(line), f)) {
+        if (line[0] == '#' || line[0] == '\n') continue;
+        BaselineRow r;
+        unsigned long long ops;
+        double ns_op;
+        if (sscanf(line, "%63s %d %d %llu %lf %lf", r.name, &r.keys, &r.threads, &ops, &ns_op, &r.ops_per_s) == 6) {
+            rows[n++] = r;
+        }
+    }
+    fclose(f);
+    return n;
+}
+
+static const BaselineRow *find_baseline(const BaselineRow *rows, int n, const char *name, int keys, int threads)
+{
+    for (int i = 0; i < n; i++) {
+        if (strcmp(rows[i].name, name) == 0 && rows[i].keys == keys && rows[i].threads == threads) return &rows[i];
+    }
+    return NULL;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Uso: %s [opciones]\n"
+            "  --time <ms>              duración de cada caso (por defecto 300)\n"
+            "  --threads <a,b,..>       cantidades de threads (por defecto 1,2,4,8)\n"
+            "  --keys <a,b,..>          claves precargadas en el store (por defecto 100,1000,10000)\n"
+            "  --filter <texto>         solo casos cuyo nombre contiene el texto\n"
+            "  --out <archivo>          además escribe los resultados en el archivo\n"
+            "  --baseline <archivo>     compara contra una corrida anterior\n"
+            "  --max-regression <pct>   sale con código 2 si algún caso cae más que pct%%\n"
+            "  --compress <0|1>         valores del store comprimidos (data_store_set_compression)\n"
+            "  --memory-budget-kb <KiB> presupuesto de memoria del store (data_store_set_memory_budget)\n",
+            prog);
+}
+
+int main(int argc, char **argv)
+{
+    int time_ms = 300;
+    int threads[BENCH_MAX_LIST] = {1, 2, 4, 8};
+    int thread_count = 4;
+    int keys[BENCH_MAX_LIST] = {100, 1000, 10000};
+    int key_count = 3;
+    const char *filter = NULL, *out_path = NULL, *baseline_path = NULL;
+    double max_regression = 0.0;
+
+    for (int i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        const char *val = argv[++i];
+        if (strcmp(opt, "--time") == 0) time_ms = atoi(val);
+        else if (strcmp(opt, "--threads") == 0) thread_count = parse_list(val, threads, BENCH_MAX_LIST);
+        else if (strcmp(opt, "--keys") == 0) key_count = parse_list(val, keys, BENCH_MAX_LIST);
+        else if (strcmp(opt, "--filter") == 0) filter = val;
+        else if (strcmp(opt, "--out") == 0) out_path = val;
+        else if (strcmp(opt, "--baseline") == 0) baseline_path = val;
+        else if (strcmp(opt, "--max-regression") == 0) max_regression = atof(val);
+        else if (strcmp(opt, "--compress") == 0) data_store_set_compression(atoi(val));
+        else if (strcmp(opt, "--memory-budget-kb") == 0) data_store_set_memory_budget((size_t)atoi(val) * 1024);
+        else {
+            fprintf(stderr, "Opción desconocida: %s\n", opt);
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (time_ms < 10) time_ms = 10;
+    for (int i = 0; i < thread_count; i++) {
+        if (threads[i] > BENCH_MAX_THREADS) threads[i] = BENCH_MAX_THREADS;
+    }
+    if (thread_count == 0 || key_count == 0) {
+        fprintf(stderr, "Listas de threads/claves vacías\n");
+        return 1;
+    }
+
+    BaselineRow baseline[BENCH_MAX_BASELINE];
+    int baseline_count = 0;
+    if (baseline_path) {
+        baseline_count = load_baseline(baseline_path, baseline, BENCH_MAX_BASELINE);
+        if (baseline_count < 0) return 1;
+    }
+    FILE *out_file = NULL;
+    if (out_path) {
+        out_file = fopen(out_path, "w");
+        if (!out_file) {
+            fprintf(stderr, "No se pudo abrir %s\n", out_path);
+            return 1;
+        }
+    }
+
+    // El data store imprime una línea por escritura: se silencia stdout y los
+    // resultados van por un duplicado del descriptor original.
+    FILE *results = fdopen(dup(STDOUT_FILENO), "w");
+    if (!results || !freopen("/dev/null", "w", stdout)) {
+        fprintf(stderr, "No se pudo redirigir stdout\n");
+        return 1;
+    }
+
+    metrics_init();
+    server_set_verbose(0);
+    build_packets();
+    if (register_routes(BENCH_RESOURCE) != 0) return 1;
+    snprintf(store_path, sizeof(store_path), "/tmp/coap_bench_store_%d.log", (int)getpid());
+
+    const char *header = baseline_count > 0
+        ? "# bench\tkeys\tthreads\tops\tns_op\tops_s\tbase_ops_s\tdelta_pct\n"
+        : "# bench\tkeys\tthreads\tops\tns_op\tops_s\n";
+    fputs(header, results);
+    if (out_file) fputs("# bench\tkeys\tthreads\tops\tns_op\tops_s\n", out_file);
+
+    int regressions = 0;
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        const BenchCase *bc = &cases[c];
+        if (filter && !strstr(bc->name, filter)) continue;
+        int nkeys = bc->uses_store ? key_count : 1;
+        for (int k = 0; k < nkeys; k++) {
+            int key_n = bc->uses_store ? keys[k] : 0;
+            if (bc->uses_store && prepare_store(key_n) != 0) {
+                fprintf(stderr, "No se pudo preparar el store en %s\n", store_path);
+                return 1;
+            }
+            for (int t = 0; t < thread_count; t++) {
+                uint64_t ops = 0;
+                double ops_s = run_case(bc, key_n, threads[t], time_ms, &ops);
+                // Costo por operación visto por cada thread
+                double ns_op = ops_s > 0 ? 1e9 * threads[t] / ops_s : 0.0;
+
+                char row[256];
+                snprintf(row, sizeof(row), "%s\t%d\t%d\t%llu\t%.1f\t%.0f",
+                         bc->name, key_n, threads[t], (unsigned long long)ops, ns_op, ops_s);
+                if (out_file) fprintf(out_file, "%s\n", row);
+
+                const BaselineRow *base = baseline_count > 0
+                    ? find_baseline(baseline, baseline_count, bc->name, key_n, threads[t]) : NULL;
+                if (base && base->ops_per_s > 0) {
+                    double delta = (ops_s - base->ops_per_s) * 100.0 / base->ops_per_s;
+                    int regressed = max_regression > 0 && delta < -max_regression;
+                    regressions += regressed;
+                    fprintf(results, "%s\t%.0f\t%+.1f%s\n", row, base->ops_per_s, delta, regressed ? "\tREGRESION" : "");
+                } else if (baseline_count > 0) {
+                    fprintf(results, "%s\t-\t-\n", row);
+                } else {
+                    fprintf(results, "%s\n", row);
+                }
+                fflush(results);
+            }
+        }
+    }
+
+    data_store_cleanup();
+    unlink(store_path);
+    if (out_file) fclose(out_file);
+    fclose(results);
+    if (regressions > 0) {
+        fprintf(stderr, "%d caso(s) con regresión mayor a %.1f%%\n", regressions, max_regression);
+        return 2;
+    }
+    return 0;
+}
@@ -3,6 +3,9 @@
 #include "persistence.h"
 #include "data_store.h"
 #include "coap_api.h"
+#include "metrics.h"
+#include "tracer.h"
+#include "server.h"
 #include <stdio.h>
 
 int main(int argc, char **argv)
@@ -14,6 +17,62 @@ int main(int argc, char **argv)
     printf("MAIN: Configuración cargada - Puerto: %d, Log: %s, Store: %s\n", 
            cfg.port, cfg.log_file, cfg.store_file);
 
+    metrics_init();
+    if (cfg.metrics_file)
+    {
+        if (metrics_start_prometheus_dump(cfg.metrics_file, cfg.metrics_interval_s) == 0)
+        {
+            printf("MAIN: Volcado de métricas cada %d s en %s\n", cfg.metrics_interval_s, cfg.metrics_file);
+        }
+        else
+        {
+            printf("MAIN: ERROR - No se pudo iniciar el volcado de métricas\n");
+        }
+    }
+
+    if (cfg.trace_file)
+    {
+        if (tracer_init(cfg.trace_file, cfg.trace_sample, (uint64_t)cfg.trace_threshold_us) == 0)
+        {
+            printf("MAIN: Trazas en %s (1/%d requests, umbral %d us)\n",
+                   cfg.trace_file, cfg.trace_sample, cfg.trace_threshold_us);
+        }
+        else
+        {
+            printf("MAIN: ERROR - No se pudo iniciar el tracer\n");
+        }
+    }
+
+    if (cfg.compress)
+    {
+        // Antes de cargar el log: los valores se recomprimen al cargarlos
+        data_store_set_compression(1);
+        printf("MAIN: Valores JSON comprimidos con diccionario de plantillas\n");
+    }
+    if (cfg.ttl_s > 0)
+    {
+        // También antes de cargar: lo cargado sin vencimiento toma este TTL
+        data_store_set_route_ttl(cfg.resource_path, cfg.ttl_s);
+        printf("MAIN: TTL por defecto de %s: %d s\n", cfg.resource_path, cfg.ttl_s);
+    }
+    if (cfg.memory_budget_kb > 0)
+    {
+        // Antes de cargar: un log más grande que el presupuesto se desaloja al cargarlo
+        data_store_set_memory_budget((size_t)cfg.memory_budget_kb * 1024);
+        printf("MAIN: Presupuesto de memoria del store: %d KiB\n", cfg.memory_budget_kb);
+    }
+    if (cfg.index_fields)
+    {
+        // Antes de cargar: el índice se arma con los valores del log
+        if (data_store_set_index_fields(cfg.index_fields) == 0)
+        {
+            printf("MAIN: Índice por campos del payload: %s\n", cfg.index_fields);
+        }
+        else
+        {
+            printf("MAIN: ERROR - No se pudo crear el índice por %s\n", cfg.index_fields);
+        }
+    }
     printf("MAIN: Inicializando persistencia...\n");
     if (init_persistence(cfg.store_file) != 0)
     {
@@ -21,6 +80,40 @@ int main(int argc, char **argv)
         return 1;
     }
     printf("MAIN: Persistencia inicializada correctamente\n");
+    if (cfg.coalesce_ms > 0)
+    {
+        if (data_store_set_coalescing(cfg.coalesce_ms) == 0)
+        {
+            printf("MAIN: Coalescing del log cada %d ms\n", cfg.coalesce_ms);
+        }
+        else
+        {
+            printf("MAIN: ERROR - No se pudo iniciar el coalescing del log\n");
+        }
+    }
+    // Siempre disponible a pedido (POST /.well-known/snapshot); agendado si hay intervalo
+    if (data_store_set_snapshot(cfg.snapshot_file, cfg.snapshot_interval_s) == 0 && cfg.snapshot_interval_s > 0)
+    {
+        printf("MAIN: Snapshot del data store cada %d s\n", cfg.snapshot_interval_s);
+    }
+    if (cfg.shm_table)
+    {
+        if (data_store_set_shared_table(cfg.shm_table, (unsigned)cfg.shm_slots) == 0)
+        {
+            printf("MAIN: Tabla compartida %s con %d slots\n", cfg.shm_table, cfg.shm_slots);
+        }
+        else
+        {
+            printf("MAIN: ERROR - No se pudo crear la tabla compartida %s\n", cfg.shm_table);
+        }
+    }
+    if (cfg.feed_socket)
+    {
+        if (data_store_set_change_feed(cfg.feed_socket, (size_t)cfg.feed_buffer_kb * 1024) == 0)
+        {
+            printf("MAIN: Change feed en %s (buffer de %d KiB)\n", cfg.feed_socket, cfg.feed_buffer_kb);
+        }
+    }
     
     printf("MAIN: Registrando rutas...\n");
     if (register_routes(cfg.resource_path) != 0)
@@ -32,9 +125,32 @@ int main(int argc, char **argv)
     printf("MAIN: Rutas registradas correctamente\n");
 
     printf("MAIN: Iniciando servidor CoAP...\n");
-    int rc = coap_server_start(cfg.port, cfg.log_file);
+    server_set_verbose(cfg.verbose);
+    server_set_workers(cfg.workers, cfg.lane_capacity > 0 ? (uint32_t)cfg.lane_capacity : 0);
+    server_set_stale_deadline(cfg.stale_ms);
+    if (cfg.rate_limit > 0 || cfg.max_pending > 0)
+    {
+        AdmissionConfig admission;
+        admission_config_default(&admission);
+        admission.rate = cfg.rate_limit;
+        admission.burst = cfg.rate_burst;
+        admission.max_pending = cfg.max_pending;
+        admission.max_age_s = cfg.shed_max_age;
+        if (server_set_admission(&admission) == 0)
+        {
+            printf("MAIN: Control de admisión - %.1f req/s por origen, %d pendientes como máximo\n",
+                   cfg.rate_limit, cfg.max_pending);
+        }
+        else
+        {
+            printf("MAIN: ERROR - No se pudo iniciar el control de admisión\n");
+        }
+    }
+    int rc = cfg.unix_socket ? coap_server_start_unix(cfg.unix_socket, cfg.log_file)
+                             : coap_server_start(cfg.port, cfg.log_file);
     printf("MAIN: Servidor terminó con código: %d\n", rc);
 
+    tracer_shutdown();
     data_store_cleanup();
     return rc;
 }
@@ -0,0 +1,177 @@
+#include "admission.h"
+#include <stdlib.h>
+#include <string.h>
+#include <netinet/in.h>
+
+#define ADMISSION_PROBE 8
+#define ADMISSION_DEFAULT_TABLE 4096
+
+// 16 bytes por origen: clave de 64 bits, tokens y último acceso
+typedef struct {
+    uint64_t key;           // 0 = libre
+    float tokens;
+    uint32_t last_ms;       // relativo a start_ns
+} AdmissionEntry;
+
+struct AdmissionControl {
+    AdmissionConfig cfg;
+    AdmissionEntry *table;
+    uint32_t mask;
+    uint64_t start_ns;
+    uint16_t next_mid;      // MID de las 5.03 a requests NON
+    uint8_t tail[8];        // opción Max-Age ya codificada
+    size_t tail_len;
+};
+
+void admission_config_default(AdmissionConfig *cfg)
+{
+    cfg->rate = 0;
+    cfg->burst = 0;
+    cfg->max_pending = 0;
+    cfg->max_age_s = 1;
+    cfg->table_size = ADMISSION_DEFAULT_TABLE;
+}
+
+// Max-Age (14) es la primera opción: delta 14 va extendido (13 + 1)
+static size_t encode_max_age(uint8_t *out, uint32_t max_age)
+{
+    uint8_t value[4];
+    size_t len = 0;
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        uint8_t b = (uint8_t)(max_age >> shift);
+        if (len == 0 && b == 0) continue;
+        value[len++] = b;
+    }
+    out[0] = (uint8_t)((13 << 4) | len);
+    out[1] = ADMISSION_OPTION_MAX_AGE - 13;
+    memcpy(out + 2, value, len);
+    return 2 + len;
+}
+
+AdmissionControl *admission_create(const AdmissionConfig *cfg)
+{
+    AdmissionControl *ac = calloc(1, sizeof(AdmissionControl));
+    if (!ac) return NULL;
+    if (cfg) ac->cfg = *cfg;
+    else admission_config_default(&ac->cfg);
+    if (ac->cfg.burst <= 0) ac->cfg.burst = ac->cfg.rate;
+    if (ac->cfg.burst < 1) ac->cfg.burst = 1;
+    if (ac->cfg.max_age_s < 0) ac->cfg.max_age_s = 0;
+
+    uint32_t n = 64;
+    while (n < ac->cfg.table_size) n <<= 1;
+    ac->table = calloc(n, sizeof(AdmissionEntry));
+    if (!ac->table) {
+        free(ac);
+        return NULL;
+    }
+    ac->mask = n - 1;
+    ac->tail_len = encode_max_age(ac->tail, (uint32_t)ac->cfg.max_age_s);
+    return ac;
+}
+
+void admission_destroy(AdmissionControl *ac)
+{
+    if (!ac) return;
+    free(ac->table);
+    free(ac);
+}
+
+static uint64_t hash_bytes(const uint8_t *p, size_t len)
+{
+    // FNV-1a con mezcla final
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 0x100000001b3ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// El origen es la IP (sin puerto: un dispositivo que reconecta cambia de
+// puerto); en Unix la ruta y en loopback el id de cliente.
+static uint64_t peer_key(const TransportPeer *peer)
+{
+    const struct sockaddr *sa = (const struct sockaddr *)&peer->addr;
+    uint64_t h;
+    if (sa->sa_family == AF_INET) {
+        const struct sockaddr_in *in = (const struct sockaddr_in *)sa;
+        h = hash_bytes((const uint8_t *)&in->sin_addr, sizeof(in->sin_addr));
+    } else if (sa->sa_family == AF_INET6) {
+        const struct sockaddr_in6 *in6 = (const struct sockaddr_in6 *)sa;
+        h = hash_bytes((const uint8_t *)&in6->sin6_addr, sizeof(in6->sin6_addr));
+    } else {
+        h = hash_bytes((const uint8_t *)&peer->addr, peer->addr_len);
+    }
+    return h | 1;
+}
+
+// Busca el origen; si no está, ocupa un hueco libre o el más viejo de la ventana
+static AdmissionEntry *lookup(AdmissionControl *ac, uint64_t key, uint32_t now_ms)
+{
+    AdmissionEntry *oldest = NULL;
+    for (uint32_t i = 0; i < ADMISSION_PROBE; i++) {
+        AdmissionEntry *e = &ac->table[(key + i) & ac->mask];
+        if (e->key == key) return e;
+        if (e->key == 0) {
+            oldest = e;
+            break;
+        }
+        if (!oldest || now_ms - e->last_ms > now_ms - oldest->last_ms) oldest = e;
+    }
+    oldest->key = key;
+    oldest->tokens = (float)ac->cfg.burst;
+    oldest->last_ms = now_ms;
+    return oldest;
+}
+
+int admission_check(AdmissionControl *ac, const TransportPeer *peer, uint64_t now_ns, int pending)
+{
+    if (ac->cfg.max_pending > 0 && pending >= ac->cfg.max_pending) return ADMISSION_OVERLOADED;
+    if (ac->cfg.rate <= 0) return ADMISSION_ACCEPT;
+
+    if (ac->start_ns == 0) ac->start_ns = now_ns;
+    uint32_t now_ms = (uint32_t)((now_ns - ac->start_ns) / 1000000ULL);
+    AdmissionEntry *e = lookup(ac, peer_key(peer), now_ms);
+
+    uint32_t elapsed = now_ms - e->last_ms;
+    if (elapsed > 0) {
+        double tokens = e->tokens + (double)elapsed * ac->cfg.rate / 1000.0;
+        e->tokens = (float)(tokens > ac->cfg.burst ? ac->cfg.burst : tokens);
+        e->last_ms = now_ms;
+    }
+    if (e->tokens < 1.0f) return ADMISSION_RATE_LIMITED;
+    e->tokens -= 1.0f;
+    return ADMISSION_ACCEPT;
+}
+
+size_t admission_build_reject(AdmissionControl *ac, const uint8_t *request, size_t len,
+                              uint8_t *out, size_t size)
+{
+    if (len < 4) return 0;
+    uint8_t ver = request[0] >> 6;
+    uint8_t type = (request[0] >> 4) & 0x03;
+    uint8_t tkl = request[0] & 0x0F;
+    uint8_t code = request[1];
+    // Solo requests CON/NON (clase 0, código != 0); ACK, RST y vacíos se descartan
+    if (ver != 1 || tkl > 8 || len < 4u + tkl || code == 0 || (code >> 5) != 0 || type > 1) return 0;
+    if (size < 4u + tkl + ac->tail_len) return 0;
+
+    // CON -> ACK piggybacked con el mismo MID; NON -> NON con MID propio
+    out[0] = (uint8_t)((1 << 6) | ((type == 0 ? 2 : 1) << 4) | tkl);
+    out[1] = ADMISSION_COAP_503;
+    if (type == 0) {
+        out[2] = request[2];
+        out[3] = request[3];
+    } else {
+        uint16_t mid = ac->next_mid++;
+        out[2] = (uint8_t)(mid >> 8);
+        out[3] = (uint8_t)mid;
+    }
+    memcpy(out + 4, request + 4, tkl);
+    memcpy(out + 4 + tkl, ac->tail, ac->tail_len);
+    return 4 + tkl + ac->tail_len;
+}
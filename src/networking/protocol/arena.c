@@ -0,0 +1,68 @@
+#include "arena.h"
+#include "slab.h"
+#include <stdlib.h>
+#include <pthread.h>
+
+struct ArenaOverflow {
+    ArenaOverflow *next;
+};
+
+static SlabPool *block_pool = NULL;
+static pthread_key_t arena_key;
+static pthread_once_t arena_once = PTHREAD_ONCE_INIT;
+static __thread Arena tls_arena;
+
+static void release_arena(void *arg)
+{
+    Arena *a = (Arena *)arg;
+    arena_reset(a);
+    slab_free(a->base);
+    a->base = NULL;
+}
+
+static void init_arena_pool(void)
+{
+    block_pool = slab_pool_create("arena", ARENA_BLOCK_SIZE);
+    pthread_key_create(&arena_key, release_arena);
+}
+
+Arena *arena_thread(void)
+{
+    Arena *a = &tls_arena;
+    if (a->base) return a;
+    pthread_once(&arena_once, init_arena_pool);
+    if (!block_pool) return NULL;
+    a->base = slab_alloc(block_pool);
+    if (!a->base) return NULL;
+    a->size = ARENA_BLOCK_SIZE;
+    a->used = 0;
+    a->overflow = NULL;
+    pthread_setspecific(arena_key, a);
+    return a;
+}
+
+void *arena_alloc(Arena *a, size_t size)
+{
+    size_t aligned = (size + 15) & ~(size_t)15;
+    if (aligned <= a->size - a->used) {
+        void *p = a->base + a->used;
+        a->used += aligned;
+        return p;
+    }
+    // Request grande: bloque propio que vive hasta el reset
+    ArenaOverflow *o = malloc(sizeof(ArenaOverflow) + 16 + aligned);
+    if (!o) return NULL;
+    o->next = a->overflow;
+    a->overflow = o;
+    return (uint8_t *)o + 16;
+}
+
+void arena_reset(Arena *a)
+{
+    while (a->overflow) {
+        ArenaOverflow *next = a->overflow->next;
+        free(a->overflow);
+        a->overflow = next;
+    }
+    a->used = 0;
+}
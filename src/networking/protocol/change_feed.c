@@ -0,0 +1,494 @@
+#define _GNU_SOURCE
+#include "change_feed.h"
+#include "metrics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define FEED_MAX_SUBSCRIBERS    64
+#define FEED_RING_MIN           (64 * 1024)
+#define FEED_LINE_MAX           64
+#define FEED_FRAMES_PER_ROUND   16      // por suscriptor y vuelta del loop
+
+typedef struct {
+    int fd;
+    int subscribed;
+    int closing;                // se envía lo pendiente (el GAP) y se cierra
+    int reset;                  // pidió otra época: se le manda RESET
+    uint64_t seq;               // próximo cambio a enviar
+    size_t offset;              // posición de seq en el buffer
+    char line[FEED_LINE_MAX];
+    size_t line_len;
+    uint8_t *out;               // frame en curso
+    size_t out_len;
+    size_t out_sent;
+} Subscriber;
+
+struct ChangeFeed {
+    char path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+    int listen_fd;
+    int wake_fd;
+    atomic_int wake_pending;    // ya hay un aviso en wake_fd sin leer
+    atomic_int running;
+    pthread_t thread;
+
+    // Buffer circular de FeedRecord; los registros pueden cruzar el final
+    pthread_mutex_t mutex;
+    uint8_t *ring;
+    size_t cap;
+    size_t head;                // registro más viejo
+    size_t tail;                // donde va el próximo
+    size_t used;
+    uint64_t oldest_seq;        // secuencia del registro en head
+    uint64_t next_seq;          // secuencia del próximo cambio
+    uint64_t epoch;             // distinta en cada arranque
+
+    Subscriber subs[FEED_MAX_SUBSCRIBERS];
+    int sub_count;
+};
+
+static uint64_t realtime_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static size_t record_size(size_t key_len, size_t value_len)
+{
+    return (sizeof(FeedRecord) + key_len + value_len + 7) & ~(size_t)7;
+}
+
+static void ring_write(ChangeFeed *f, size_t off, const void *src, size_t len)
+{
+    size_t first = f->cap - off < len ? f->cap - off : len;
+    memcpy(f->ring + off, src, first);
+    if (first < len) memcpy(f->ring, (const uint8_t *)src + first, len - first);
+}
+
+static void ring_read(const ChangeFeed *f, size_t off, void *dst, size_t len)
+{
+    size_t first = f->cap - off < len ? f->cap - off : len;
+    memcpy(dst, f->ring + off, first);
+    if (first < len) memcpy((uint8_t *)dst + first, f->ring, len - first);
+}
+
+static size_t ring_advance(const ChangeFeed *f, size_t off, size_t len)
+{
+    off += len;
+    return off >= f->cap ? off - f->cap : off;
+}
+
+static uint32_t record_at(const ChangeFeed *f, size_t off)
+{
+    FeedRecord h;
+    ring_read(f, off, &h, sizeof(h));
+    return h.size;
+}
+
+static void drop_oldest(ChangeFeed *f)
+{
+    uint32_t size = record_at(f, f->head);
+    f->head = ring_advance(f, f->head, size);
+    f->used -= size;
+    f->oldest_seq++;
+}
+
+void change_feed_publish(ChangeFeed *f, uint8_t op, const char *key, size_t key_len,
+                         const char *value, size_t value_len, uint32_t version)
+{
+    static const uint8_t zeros[8];
+    if (!f) return;
+    if (!value) value_len = 0;
+    size_t size = record_size(key_len, value_len);
+    if (key_len > UINT16_MAX || value_len > UINT16_MAX ||
+        size > FEED_FRAME_MAX - sizeof(FeedFrameHeader) || size > f->cap) return;
+
+    FeedRecord h;
+    memset(&h, 0, sizeof(h));
+    h.size = (uint32_t)size;
+    h.op = op;
+    h.key_len = (uint16_t)key_len;
+    h.value_len = (uint16_t)value_len;
+    h.version = version;
+    h.ts_ns = realtime_ns();
+
+    pthread_mutex_lock(&f->mutex);
+    // Acotado: lo más viejo se pisa; los suscriptores que lo necesitaban
+    // reciben un GAP cuando llegan ahí
+    while (f->cap - f->used < size) drop_oldest(f);
+    h.seq = f->next_seq++;
+    size_t off = f->tail;
+    ring_write(f, off, &h, sizeof(h));
+    off = ring_advance(f, off, sizeof(h));
+    ring_write(f, off, key, key_len);
+    off = ring_advance(f, off, key_len);
+    if (value_len) {
+        ring_write(f, off, value, value_len);
+        off = ring_advance(f, off, value_len);
+    }
+    size_t pad = size - sizeof(h) - key_len - value_len;
+    if (pad) ring_write(f, off, zeros, pad);
+    f->tail = ring_advance(f, f->tail, size);
+    f->used += size;
+    pthread_mutex_unlock(&f->mutex);
+
+    // Un solo aviso por tanda: el thread lee todo lo acumulado al despertar
+    if (!atomic_exchange_explicit(&f->wake_pending, 1, memory_order_acq_rel)) {
+        uint64_t one = 1;
+        ssize_t w = write(f->wake_fd, &one, sizeof(one));
+        (void)w;
+    }
+}
+
+uint64_t change_feed_last_seq(ChangeFeed *f)
+{
+    pthread_mutex_lock(&f->mutex);
+    uint64_t seq = f->next_seq - 1;
+    pthread_mutex_unlock(&f->mutex);
+    return seq;
+}
+
+uint64_t change_feed_epoch(ChangeFeed *f)
+{
+    return f->epoch;
+}
+
+static void close_subscriber(ChangeFeed *f, int i)
+{
+    Subscriber *s = &f->subs[i];
+    close(s->fd);
+    free(s->out);
+    if (s->subscribed) metrics_gauge_add(METRIC_GAUGE_FEED_SUBSCRIBERS, -1);
+    f->subs[i] = f->subs[--f->sub_count];
+}
+
+// Frame GAP o RESET: lo último que recibe el suscriptor
+static void build_gap(ChangeFeed *f, Subscriber *s, uint16_t type)
+{
+    FeedFrameHeader *fh = (FeedFrameHeader *)s->out;
+    memset(fh, 0, sizeof(*fh));
+    fh->magic = FEED_FRAME_MAGIC;
+    fh->length = sizeof(*fh);
+    fh->type = type;
+    fh->first_seq = f->oldest_seq;
+    fh->epoch = f->epoch;
+    s->out_len = sizeof(*fh);
+    s->out_sent = 0;
+    s->closing = 1;
+    if (type == FEED_FRAME_GAP) metrics_inc(METRIC_FEED_LAGGED);
+}
+
+// Arma el próximo frame del suscriptor. Devuelve 0 si no había nada.
+static int fill_frame(ChangeFeed *f, Subscriber *s)
+{
+    pthread_mutex_lock(&f->mutex);
+    if (s->reset || s->seq < f->oldest_seq) {
+        build_gap(f, s, s->reset ? FEED_FRAME_RESET : FEED_FRAME_GAP);
+        pthread_mutex_unlock(&f->mutex);
+        return 1;
+    }
+    size_t len = sizeof(FeedFrameHeader);
+    uint64_t first = s->seq;
+    uint16_t count = 0;
+    while (s->seq < f->next_seq && count < UINT16_MAX) {
+        uint32_t size = record_at(f, s->offset);
+        if (len + size > FEED_FRAME_MAX) break;
+        ring_read(f, s->offset, s->out + len, size);
+        len += size;
+        s->offset = ring_advance(f, s->offset, size);
+        s->seq++;
+        count++;
+    }
+    pthread_mutex_unlock(&f->mutex);
+    if (count == 0) return 0;
+
+    FeedFrameHeader *fh = (FeedFrameHeader *)s->out;
+    memset(fh, 0, sizeof(*fh));
+    fh->magic = FEED_FRAME_MAGIC;
+    fh->length = (uint32_t)len;
+    fh->type = FEED_FRAME_CHANGES;
+    fh->count = count;
+    fh->first_seq = first;
+    fh->epoch = f->epoch;
+    s->out_len = len;
+    s->out_sent = 0;
+    return 1;
+}
+
+// Envía sin bloquear. Devuelve -1 si hay que cerrar al suscriptor y 1 si
+// cortó por el límite de frames con cambios todavía por enviar.
+static int pump(ChangeFeed *f, Subscriber *s)
+{
+    for (int frames = 0; ; ) {
+        if (s->out_sent < s->out_len) {
+            ssize_t n = send(s->fd, s->out + s->out_sent, s->out_len - s->out_sent,
+                             MSG_DONTWAIT | MSG_NOSIGNAL);
+            if (n < 0) return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+            s->out_sent += (size_t)n;
+            if (s->out_sent < s->out_len) return 0;     // socket lleno: esperar POLLOUT
+            frames++;
+        }
+        if (s->closing) return -1;
+        if (frames >= FEED_FRAMES_PER_ROUND) return 1;
+        if (!fill_frame(f, s)) return 0;
+    }
+}
+
+// Posiciona el cursor en from_seq (0 = lo más viejo disponible). Una
+// secuencia de otra época, o posterior al último cambio (de otro arranque
+// aunque no traiga la época), no se puede reanudar: recibe RESET.
+static void start_subscription(ChangeFeed *f, Subscriber *s, uint64_t from, uint64_t epoch)
+{
+    pthread_mutex_lock(&f->mutex);
+    if (from == 0) from = f->oldest_seq;
+    else if ((epoch != 0 && epoch != f->epoch) || from > f->next_seq) s->reset = 1;
+    s->seq = from;
+    if (!s->reset && from >= f->oldest_seq) {
+        size_t off = f->head;
+        for (uint64_t seq = f->oldest_seq; seq < from; seq++) off = ring_advance(f, off, record_at(f, off));
+        s->offset = off;
+    }
+    // from < oldest_seq: el primer fill_frame manda el GAP
+    pthread_mutex_unlock(&f->mutex);
+    s->subscribed = 1;
+    metrics_gauge_add(METRIC_GAUGE_FEED_SUBSCRIBERS, 1);
+}
+
+// Lee la línea "SUB <seq>". Devuelve -1 si hay que cerrar.
+static int read_request(ChangeFeed *f, Subscriber *s)
+{
+    char buf[FEED_LINE_MAX];
+    ssize_t n = recv(s->fd, buf, sizeof(buf), MSG_DONTWAIT);
+    if (n == 0) return -1;
+    if (n < 0) return (errno == EAGAIN || errno == EINTR) ? 0 : -1;
+    if (s->subscribed) return 0;    // después de suscribirse no se espera nada más
+
+    for (ssize_t i = 0; i < n; i++) {
+        if (buf[i] != '\n') {
+            if (s->line_len + 1 >= sizeof(s->line)) return -1;
+            s->line[s->line_len++] = buf[i];
+            continue;
+        }
+        s->line[s->line_len] = '\0';
+        unsigned long long from = 0, epoch = 0;
+        if (sscanf(s->line, "SUB %llu %llu", &from, &epoch) < 1) return -1;
+        start_subscription(f, s, (uint64_t)from, (uint64_t)epoch);
+        return 0;
+    }
+    return 0;
+}
+
+static void accept_subscriber(ChangeFeed *f)
+{
+    int fd = accept4(f->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) return;
+    uint8_t *out = f->sub_count < FEED_MAX_SUBSCRIBERS ? malloc(FEED_FRAME_MAX) : NULL;
+    if (!out) {
+        close(fd);
+        return;
+    }
+    Subscriber *s = &f->subs[f->sub_count++];
+    memset(s, 0, sizeof(*s));
+    s->fd = fd;
+    s->out = out;
+}
+
+static void *feed_main(void *arg)
+{
+    ChangeFeed *f = (ChangeFeed *)arg;
+    struct pollfd pfds[FEED_MAX_SUBSCRIBERS + 2];
+    int backlog = 0;            // algún suscriptor quedó con cambios sin enviar
+
+    while (atomic_load(&f->running)) {
+        pfds[0] = (struct pollfd){f->listen_fd, POLLIN, 0};
+        pfds[1] = (struct pollfd){f->wake_fd, POLLIN, 0};
+        int count = f->sub_count;
+        for (int i = 0; i < count; i++) {
+            Subscriber *s = &f->subs[i];
+            short events = POLLIN;
+            if (s->out_sent < s->out_len) events |= POLLOUT;
+            pfds[2 + i] = (struct pollfd){s->fd, events, 0};
+        }
+        if (poll(pfds, (nfds_t)count + 2, backlog ? 0 : 1000) < 0 && errno != EINTR) break;
+
+        if (pfds[1].revents & POLLIN) {
+            uint64_t v;
+            ssize_t r = read(f->wake_fd, &v, sizeof(v));
+            (void)r;
+            atomic_store(&f->wake_pending, 0);
+        }
+        // De atrás para adelante: close_subscriber mueve el último al hueco
+        backlog = 0;
+        for (int i = count - 1; i >= 0; i--) {
+            Subscriber *s = &f->subs[i];
+            short re = pfds[2 + i].revents;
+            int rc = 0;
+            if ((re & (POLLERR | POLLNVAL)) ||
+                ((re & (POLLIN | POLLHUP)) && read_request(f, s) != 0) ||
+                (s->subscribed && (rc = pump(f, s)) < 0)) {
+                close_subscriber(f, i);
+            } else if (rc > 0) {
+                backlog = 1;
+            }
+        }
+        if (pfds[0].revents & POLLIN) accept_subscriber(f);
+    }
+    return NULL;
+}
+
+ChangeFeed *change_feed_create(const char *path, size_t ring_bytes)
+{
+    if (!path || !path[0]) return NULL;
+    ChangeFeed *f = calloc(1, sizeof(ChangeFeed));
+    if (!f) return NULL;
+    if (strlen(path) >= sizeof(f->path)) {
+        free(f);
+        return NULL;
+    }
+    strcpy(f->path, path);
+    f->cap = ring_bytes < FEED_RING_MIN ? FEED_RING_MIN : (ring_bytes + 7) & ~(size_t)7;
+    f->ring = malloc(f->cap);
+    f->oldest_seq = f->next_seq = 1;
+    // Nunca 0 (= época desconocida) y distinta entre arranques
+    f->epoch = (realtime_ns() ^ ((uint64_t)getpid() << 48)) | 1;
+    f->listen_fd = f->wake_fd = -1;
+    pthread_mutex_init(&f->mutex, NULL);
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path);
+    f->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    f->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (!f->ring || f->listen_fd < 0 || f->wake_fd < 0 ||
+        bind(f->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(f->listen_fd, 16) != 0) {
+        perror("change_feed");
+        if (f->listen_fd >= 0) close(f->listen_fd);
+        if (f->wake_fd >= 0) close(f->wake_fd);
+        pthread_mutex_destroy(&f->mutex);
+        free(f->ring);
+        free(f);
+        return NULL;
+    }
+
+    atomic_store(&f->running, 1);
+    if (pthread_create(&f->thread, NULL, feed_main, f) != 0) {
+        close(f->listen_fd);
+        close(f->wake_fd);
+        unlink(path);
+        pthread_mutex_destroy(&f->mutex);
+        free(f->ring);
+        free(f);
+        return NULL;
+    }
+    return f;
+}
+
+void change_feed_destroy(ChangeFeed *f)
+{
+    if (!f) return;
+    atomic_store(&f->running, 0);
+    uint64_t one = 1;
+    ssize_t w = write(f->wake_fd, &one, sizeof(one));
+    (void)w;
+    pthread_join(f->thread, NULL);
+    while (f->sub_count > 0) close_subscriber(f, f->sub_count - 1);
+    close(f->listen_fd);
+    close(f->wake_fd);
+    unlink(f->path);
+    pthread_mutex_destroy(&f->mutex);
+    free(f->ring);
+    free(f);
+}
+
+int change_feed_subscribe(const char *path, uint64_t from_seq, uint64_t epoch)
+{
+    struct sockaddr_un addr;
+    if (!path || strlen(path) >= sizeof(addr.sun_path)) return -1;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    char line[FEED_LINE_MAX];
+    int n = snprintf(line, sizeof(line), "SUB %llu %llu\n", (unsigned long long)from_seq, (unsigned long long)epoch);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        send(fd, line, (size_t)n, MSG_NOSIGNAL) != n) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int read_full(int fd, void *buf, size_t len)
+{
+    size_t got = 0;
+    while (got < len) {
+        ssize_t n = recv(fd, (uint8_t *)buf + got, len - got, 0);
+        if (n == 0) return -1;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        got += (size_t)n;
+    }
+    return 0;
+}
+
+int change_feed_consume(int fd, change_feed_fn fn, void *ctx, uint64_t *oldest_seq)
+{
+    uint8_t *buf = malloc(FEED_FRAME_MAX);
+    if (!buf) return -1;
+    int rc = -1;
+    for (;;) {
+        FeedFrameHeader fh;
+        if (read_full(fd, &fh, sizeof(fh)) != 0) break;
+        if (fh.magic != FEED_FRAME_MAGIC || fh.length < sizeof(fh) || fh.length > FEED_FRAME_MAX) break;
+        size_t body = fh.length - sizeof(fh);
+        if (read_full(fd, buf, body) != 0) break;
+        if (fh.type == FEED_FRAME_GAP || fh.type == FEED_FRAME_RESET) {
+            if (oldest_seq) *oldest_seq = fh.first_seq;
+            rc = fh.type;
+            break;
+        }
+
+        size_t off = 0;
+        int stop = 0;
+        for (uint16_t i = 0; i < fh.count && !stop; i++) {
+            FeedRecord r;
+            if (off + sizeof(r) > body) break;
+            memcpy(&r, buf + off, sizeof(r));
+            if (r.size < sizeof(r) + r.key_len + r.value_len || off + r.size > body) break;
+            FeedChange c;
+            c.epoch = fh.epoch;
+            c.seq = r.seq;
+            c.ts_ns = r.ts_ns;
+            c.version = r.version;
+            c.op = r.op;
+            c.key = (const char *)buf + off + sizeof(r);
+            c.key_len = r.key_len;
+            c.value = c.key + r.key_len;
+            c.value_len = r.value_len;
+            stop = fn(&c, ctx) != 0;
+            off += r.size;
+        }
+        if (stop) {
+            rc = 0;
+            break;
+        }
+    }
+    free(buf);
+    return rc;
+}
@@ -3,6 +3,7 @@
 #include "coap_router.h"
 #include "message.h"
 #include "server.h"
+#include "coap_client.h"
 #include <string.h>
 #include <pthread.h>
 #include <stdio.h>
@@ -14,204 +15,187 @@
 
 #define MAX_BUFFER 1024
 #define MAX_ROUTES 16
-#define MAX_TRANSACTIONS 32
-
-static CoapTransaction transactions[MAX_TRANSACTIONS];
 static Route routes[MAX_ROUTES];
 static int route_count = 0;
 static int running = 0;
 
-static uint16_t next_message_id() {
-    static uint16_t mid = 1;
-    return mid++;
-}
-
-static void generate_token(uint8_t *token, uint8_t *len) {
-    *len = 2; // RFC: mínimo 1 byte, máximo 8
-    token[0] = rand() & 0xFF;
-    token[1] = rand() & 0xFF;
+// Imprimir información detallada de la respuesta
+static void print_response(const CoapMessage *resp) {
+    printf("<- Respuesta recibida:\n");
+    printf("   Código: %d", resp->code);
+    
+    // Interpretar código de respuesta
+    switch(resp->code) {
+        case 65: printf(" (2.01 Created)"); break;
+        case 66: printf(" (2.02 Deleted)"); break;
+        case 67: printf(" (2.03 Valid)"); break;
+        case 68: printf(" (2.04 Changed)"); break;
+        case 69: printf(" (2.05 Content)"); break;
+        case 132: printf(" (4.04 Not Found)"); break;
+        case 160: printf(" (5.00 Internal Server Error)"); break;
+        case 199: printf(" (NON response)"); break;
+        default: printf(" (Código desconocido)"); break;
+    }
+    printf("\n");
+    
+    printf("   Tipo: %d", resp->type);
+    switch(resp->type) {
+        case 0: printf(" (CON - Confirmable)"); break;
+        case 1: printf(" (NON - Non-Confirmable)"); break;
+        case 2: printf(" (ACK - Acknowledgment)"); break;
+        case 3: printf(" (RST - Reset)"); break;
+        default: printf(" (Tipo desconocido)"); break;
+    }
+    printf("\n");
+    
+    printf("   Message ID: %u\n", resp->message_id);
+    printf("   Token: ");
+    for (int i = 0; i < resp->tkl; i++) {
+        printf("%02X ", resp->token[i]);
+    }
+    printf("\n");
+    
+    printf("   Opciones: %d\n", resp->option_count);
+    for (int i = 0; i < resp->option_count; i++) {
+        printf("     Opción %d: número=%d, longitud=%d\n", 
+               i+1, resp->options[i].number, resp->options[i].length);
+    }
+    
+    if (resp->payload_len > 0) {
+        printf("   Payload (%d bytes): %.*s\n", resp->payload_len, resp->payload_len, resp->payload);
+    } else {
+        printf("   Payload: (vacío)\n");
+    }
 }
 
-static void register_transaction(uint16_t mid, const uint8_t *token, uint8_t tkl) {
-    for (int i = 0; i < MAX_TRANSACTIONS; i++) {
-        if (!transactions[i].active) {
-            transactions[i].message_id = mid;
-            memcpy(transactions[i].token, token, tkl);
-            transactions[i].token_len = tkl;
-            transactions[i].active = 1;
-            return;
-        }
+// Espera de la respuesta a un NON (no hay ACK que marque el fin)
+#define NON_RESPONSE_TIMEOUT_MS 1000
+
+// Cliente reutilizado entre llamadas: un socket por thread, no por request
+static __thread CoapClient *default_client = NULL;
+
+static void on_response(const CoapClientResult *result, void *user) {
+    (void)user;
+    switch (result->status) {
+        case COAP_CLIENT_OK:
+            print_response(result->response);
+            break;
+        case COAP_CLIENT_RESET:
+            printf("<- RST: el servidor rechazó el mensaje\n");
+            break;
+        case COAP_CLIENT_ERROR:
+            printf("<- Error al enviar el request\n");
+            break;
+        default:
+            printf("<- Timeout: sin respuesta dentro del tiempo límite\n");
+            break;
+    }
+    if (result->retransmissions > 0) {
+        printf("   Retransmisiones: %d\n", result->retransmissions);
     }
 }
 
-static void clear_transaction(uint16_t mid) {
-    for (int i = 0; i < MAX_TRANSACTIONS; i++) {
-        if (transactions[i].active && transactions[i].message_id == mid) {
-            transactions[i].active = 0;
-            return;
-        }
-    }
+int coap_parse_method(const char *method_str) {
+    if (strcmp(method_str, "get") == 0 || strcmp(method_str, "GET") == 0) return COAP_METHOD_GET;
+    if (strcmp(method_str, "post") == 0 || strcmp(method_str, "POST") == 0) return COAP_METHOD_POST;
+    if (strcmp(method_str, "put") == 0 || strcmp(method_str, "PUT") == 0) return COAP_METHOD_PUT;
+    if (strcmp(method_str, "delete") == 0 || strcmp(method_str, "DELETE") == 0) return COAP_METHOD_DELETE;
+    return -1;
 }
 
 int coap_send_request(const char *host, int port, const char *path,const char *method_str, const char *mode_str,const char *json_payload) {
-    int method_code = COAP_METHOD_GET;
-    if (strcmp(method_str, "get") == 0) method_code = COAP_METHOD_GET;
-    else if (strcmp(method_str, "post") == 0) method_code = COAP_METHOD_POST;
-    else if (strcmp(method_str, "put") == 0) method_code = COAP_METHOD_PUT;
-    else if (strcmp(method_str, "delete") == 0) method_code = COAP_METHOD_DELETE;
-
+    int method_code = coap_parse_method(method_str);
+    if (method_code < 0) method_code = COAP_METHOD_GET;
     int confirmable = (strcmp(mode_str, "con") == 0) ? 1 : 0;
 
-    int sockfd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-    if (sockfd < 0) {
-        perror("socket");
-        return 1;
-    }
-
     struct sockaddr_in server_addr; 
     memset(&server_addr, 0, sizeof(server_addr));
     server_addr.sin_family = AF_INET;
     server_addr.sin_port = htons(port);
     if (inet_pton(AF_INET, host, &server_addr.sin_addr) != 1) {
         fprintf(stderr, "IP inválida: %s\n", host);
-        close(sockfd);
         return 1;
     }
 
-    unsigned char buffer[1024];
-    CoapMessage msg; coap_message_init(&msg);
-
-    msg.type = confirmable ? 0 : 1; // CON = 0, NON = 1
-    msg.code = (unsigned char)method_code;
-    msg.message_id = next_message_id();
-
-    msg.tkl = 0;
-    generate_token(msg.token, &msg.tkl);
-
-    // Guardar transacción
-    register_transaction(msg.message_id, msg.token, msg.tkl);
-
-    // Dividir el path en opciones Uri-Path
-    const char *p = path;
-    while (*p == '/') p++;
-    while (*p) {
-        const char *start = p;
-        while (*p && *p != '/') p++;
-        size_t len = (size_t)(p - start);
-        if (len) coap_add_option(&msg, 11, (const unsigned char*)start, (unsigned short)len);
-        while (*p == '/') p++;
-    }
-
-    // Payload para POST/PUT
-    if ((method_code == COAP_METHOD_POST || method_code == COAP_METHOD_PUT) &&
-        json_payload && strlen(json_payload) > 0) {
-        unsigned char cf = 50; // application/json
-        coap_add_option(&msg, 12, &cf, 1);
-        coap_set_payload(&msg, (const unsigned char*)json_payload, (int)strlen(json_payload));
-    }
-
-    int len = coap_serialize(&msg, buffer, sizeof(buffer));
-    if (len <= 0) {
-        fprintf(stderr, "Error al serializar CoAP\n");
-        close(sockfd);
-        return 1;
+    if (!default_client) {
+        default_client = coap_client_create(NULL);
+        if (!default_client) {
+            fprintf(stderr, "Error al crear el cliente CoAP\n");
+            return 1;
+        }
+        coap_client_set_response_timeout(default_client, NON_RESPONSE_TIMEOUT_MS);
     }
 
-    ssize_t sent = sendto(sockfd, buffer, (size_t)len, 0,
-                          (struct sockaddr*)&server_addr, sizeof(server_addr));
-    if (sent < 0) {
-        perror("sendto");
-        close(sockfd);
+    if (coap_client_request(default_client, &server_addr, (uint8_t)method_code, path, confirmable,
+                            json_payload, on_response, NULL) != 0) {
+        fprintf(stderr, "Error al enviar el request CoAP\n");
         return 1;
     }
-    printf("-> %s %s (MID=%u, %zd bytes)\n", method_str, path, msg.message_id, sent);
-
-    struct timeval tv; tv.tv_sec = 1; tv.tv_usec = 0;
-    setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
-
-    unsigned char recv_buf[1024]; socklen_t addr_len = sizeof(server_addr);
-    ssize_t recvd = recvfrom(sockfd, recv_buf, sizeof(recv_buf), 0,
-                             (struct sockaddr*)&server_addr, &addr_len);
-    if (recvd > 0) {
-        CoapMessage resp;
-        if (coap_parse(&resp, recv_buf, (int)recvd) == 0) {
-            // Imprimir información detallada de la respuesta
-            printf("<- Respuesta recibida:\n");
-            printf("   Código: %d", resp.code);
-            
-            // Interpretar código de respuesta
-            switch(resp.code) {
-                case 65: printf(" (2.01 Created)"); break;
-                case 66: printf(" (2.02 Deleted)"); break;
-                case 67: printf(" (2.03 Valid)"); break;
-                case 68: printf(" (2.04 Changed)"); break;
-                case 69: printf(" (2.05 Content)"); break;
-                case 132: printf(" (4.04 Not Found)"); break;
-                case 160: printf(" (5.00 Internal Server Error)"); break;
-                case 199: printf(" (NON response)"); break;
-                default: printf(" (Código desconocido)"); break;
-            }
-            printf("\n");
-            
-            printf("   Tipo: %d", resp.type);
-            switch(resp.type) {
-                case 0: printf(" (CON - Confirmable)"); break;
-                case 1: printf(" (NON - Non-Confirmable)"); break;
-                case 2: printf(" (ACK - Acknowledgment)"); break;
-                case 3: printf(" (RST - Reset)"); break;
-                default: printf(" (Tipo desconocido)"); break;
-            }
-            printf("\n");
-            
-            printf("   Message ID: %u\n", resp.message_id);
-            printf("   Token: ");
-            for (int i = 0; i < resp.tkl; i++) {
-                printf("%02X ", resp.token[i]);
-            }
-            printf("\n");
-            
-            printf("   Opciones: %d\n", resp.option_count);
-            for (int i = 0; i < resp.option_count; i++) {
-                printf("     Opción %d: número=%d, longitud=%d\n", 
-                       i+1, resp.options[i].number, resp.options[i].length);
-            }
-            
-            if (resp.payload_len > 0) {
-                printf("   Payload (%d bytes): %.*s\n", resp.payload_len, resp.payload_len, resp.payload);
-            } else {
-                printf("   Payload: (vacío)\n");
-            }
-            
-            // Limpiar transacción
-            clear_transaction(resp.message_id);
-
-            for (int i = 0; i < resp.option_count; i++) {
-                if (resp.options[i].value) free(resp.options[i].value);
-            }
-        } else {
-            printf("<- Error: recibido %zd bytes (no es un mensaje CoAP válido)\n", recvd);
-        }
-    } else {
-        printf("<- Timeout: sin respuesta dentro del tiempo límite\n");
-        // Aquí podrías reintentar si fuera CON
-    }
+    printf("-> %s %s\n", method_str, path);
 
-    close(sockfd);
+    coap_client_run(default_client);
     return 0;
 }
 
 int coap_register_handler(const char* uri, uint8_t method, coap_handler_fn fn) {
     if (route_count >= MAX_ROUTES) return -1;
     strncpy(routes[route_count].uri, uri, sizeof(routes[route_count].uri)-1);
+    const char *copy = routes[route_count].uri;
+    size_t len = strlen(copy);
+    int wildcard = len >= 2 && copy[len - 2] == '/' && copy[len - 1] == '*';
+    // La misma clave que usará el data store para el recurso
+    routes[route_count].key = wildcard ? NULL : intern_get(copy, len);
+    routes[route_count].pattern = 0;
     routes[route_count].method = method;
     routes[route_count].handler = fn;
     route_count++;
     return 0;
 }
 
+int coap_register_pattern_handler(const char* prefix, uint8_t method, coap_handler_fn fn) {
+    if (route_count >= MAX_ROUTES) return -1;
+    strncpy(routes[route_count].uri, prefix, sizeof(routes[route_count].uri)-1);
+    routes[route_count].key = NULL;
+    routes[route_count].pattern = 1;
+    routes[route_count].method = method;
+    routes[route_count].handler = fn;
+    route_count++;
+    return 0;
+}
+
+// La URI tiene algún segmento que es exactamente "*"
+static int is_pattern(const char *uri) {
+    for (const char *p = strchr(uri, '*'); p; p = strchr(p + 1, '*')) {
+        if ((p == uri || p[-1] == '/') && (p[1] == '/' || p[1] == '\0')) return 1;
+    }
+    return 0;
+}
+
+// Una ruta terminada en "/*" acepta cualquier sub-recurso de su prefijo
+static int route_matches(const Route *route, const char *uri, size_t uri_len, uint64_t hash) {
+    if (route->pattern) {
+        return strncmp(route->uri, uri, strlen(route->uri)) == 0;
+    }
+    if (route->key) {
+        // El hash ya calculado descarta casi todas las rutas sin tocar el texto
+        return route->key->hash == hash && route->key->len == uri_len &&
+               memcmp(route->key->str, uri, uri_len) == 0;
+    }
+    size_t len = strlen(route->uri);
+    if (len >= 2 && route->uri[len - 2] == '/' && route->uri[len - 1] == '*') {
+        return strncmp(route->uri, uri, len - 1) == 0 && uri[len - 1] != '\0';
+    }
+    return strcmp(route->uri, uri) == 0;
+}
+
 coap_handler_fn find_handler(const char* uri, uint8_t method) {
+    // No se busca en la tabla de claves: el data store puede estar liberando
+    // claves de otros recursos mientras se atiende este request
+    size_t len = strlen(uri);
+    uint64_t hash = intern_hash(uri, len);
+    int pattern = is_pattern(uri);
     for (int i = 0; i < route_count; i++) {
-        if (routes[i].method == method && strcmp(routes[i].uri, uri) == 0) {
+        if (routes[i].method == method && routes[i].pattern == pattern && route_matches(&routes[i], uri, len, hash)) {
             return routes[i].handler;
         }
     }
@@ -235,4 +219,28 @@ int coap_server_start(int port,const char *logFileName)
     return 0;
 }
 
+int coap_server_start_unix(const char *socketPath, const char *logFileName)
+{
+    Logger *logger = logger_init(logFileName);
+    if (!logger) {
+        fprintf(stderr, "Error al inicializar logger\n");
+        return 1;
+    }
+
+    Transport transport;
+    if (transport_unix_open(&transport, socketPath) != 0) {
+        logger_log(logger, "Error al abrir socket Unix");
+        logger_cleanup(logger);
+        return 1;
+    }
+    printf("Servidor CoAP escuchando en socket Unix %s...\n", socketPath);
+    logger_log(logger, "Servidor iniciado en socket Unix...");
+
+    server_run(&transport, logger);
+
+    transport_close(&transport);
+    logger_cleanup(logger);
+    return 0;
+}
+
 
@@ -0,0 +1,342 @@
+#include "coap_client.h"
+#include "timer_wheel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#define CLIENT_TOKEN_LEN        8
+#define CLIENT_TOKEN_BUCKETS    16384
+#define CLIENT_TICK_MS          10
+#define CLIENT_WHEEL_SLOTS      1024
+#define CLIENT_MAX_DATAGRAM     1024
+
+#define TYPE_CON 0
+#define TYPE_ACK 2
+#define TYPE_RST 3
+
+typedef struct ClientRequest {
+    TimerEntry timer;               // espera de respuesta NON o separada
+    struct ClientRequest *hash_next;
+    uint64_t token;
+    uint16_t mid;
+    struct sockaddr_in server;
+    int awaiting_ack;               // CON todavía en la capa de confiabilidad
+    int retransmissions;
+    uint64_t start_us;
+    coap_client_cb cb;
+    void *user;
+} ClientRequest;
+
+struct CoapClient {
+    int fd;
+    CoapReliability rel;
+    TimerWheel response_timers;
+    ClientRequest **by_token;
+    uint32_t token_mask;
+    uint64_t token_base;
+    uint64_t token_seq;
+    uint16_t next_mid;
+    size_t pending;
+    int response_timeout_ms;
+    int completed;
+};
+
+static uint64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+static uint32_t token_bucket(const CoapClient *c, uint64_t token)
+{
+    token ^= token >> 33;
+    token *= 0xff51afd7ed558ccdULL;
+    token ^= token >> 33;
+    return (uint32_t)token & c->token_mask;
+}
+
+static uint64_t token_from_bytes(const unsigned char *bytes)
+{
+    uint64_t v = 0;
+    for (int i = 0; i < CLIENT_TOKEN_LEN; i++) v = (v << 8) | bytes[i];
+    return v;
+}
+
+// Solo cuenta una respuesta del servidor al que se mandó el request: el
+// socket recibe de cualquiera y el token solo no alcanza
+static ClientRequest *find_request(CoapClient *c, const CoapMessage *msg, const struct sockaddr_in *from)
+{
+    if (msg->tkl != CLIENT_TOKEN_LEN) return NULL;
+    uint64_t token = token_from_bytes(msg->token);
+    for (ClientRequest *r = c->by_token[token_bucket(c, token)]; r; r = r->hash_next) {
+        if (r->token == token && r->server.sin_addr.s_addr == from->sin_addr.s_addr &&
+            r->server.sin_port == from->sin_port) {
+            return r;
+        }
+    }
+    return NULL;
+}
+
+static void remove_request(CoapClient *c, ClientRequest *req)
+{
+    ClientRequest **pp = &c->by_token[token_bucket(c, req->token)];
+    while (*pp && *pp != req) pp = &(*pp)->hash_next;
+    if (*pp) *pp = req->hash_next;
+}
+
+static void complete_request(CoapClient *c, ClientRequest *req, int status, const CoapMessage *response)
+{
+    timer_wheel_cancel(&c->response_timers, &req->timer);
+    remove_request(c, req);
+    c->pending--;
+    c->completed++;
+
+    CoapClientResult result;
+    result.status = status;
+    result.response = status == COAP_CLIENT_OK ? response : NULL;
+    result.latency_us = now_us() - req->start_us;
+    result.retransmissions = req->retransmissions;
+    if (req->cb) req->cb(&result, req->user);
+    free(req);
+}
+
+// Fin del exchange CON en la capa de confiabilidad
+static void on_exchange_done(CoapExchange *ex, int result, void *ctx)
+{
+    CoapClient *c = (CoapClient *)ctx;
+    ClientRequest *req = (ClientRequest *)ex->user;
+    req->awaiting_ack = 0;
+    req->retransmissions = ex->retransmits;
+    switch (result) {
+        case COAP_EXCHANGE_ACKED:
+            // Si el ACK no traía la respuesta, llegará separada
+            timer_wheel_add(&c->response_timers, &req->timer,
+                            coap_reliability_now_ms() + (uint64_t)c->response_timeout_ms);
+            break;
+        case COAP_EXCHANGE_RESET:
+            complete_request(c, req, COAP_CLIENT_RESET, NULL);
+            break;
+        case COAP_EXCHANGE_TIMEOUT:
+            complete_request(c, req, COAP_CLIENT_TIMEOUT, NULL);
+            break;
+        case COAP_EXCHANGE_CANCELLED:
+            complete_request(c, req, COAP_CLIENT_CANCELLED, NULL);
+            break;
+        default:
+            complete_request(c, req, COAP_CLIENT_ERROR, NULL);
+            break;
+    }
+}
+
+static void on_response_timeout(TimerEntry *timer, void *ctx)
+{
+    complete_request((CoapClient *)ctx, (ClientRequest *)timer, COAP_CLIENT_TIMEOUT, NULL);
+}
+
+CoapClient *coap_client_create(const CoapTxParams *params)
+{
+    CoapClient *c = calloc(1, sizeof(CoapClient));
+    if (!c) return NULL;
+    c->fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (c->fd < 0) {
+        perror("socket");
+        free(c);
+        return NULL;
+    }
+    c->by_token = calloc(CLIENT_TOKEN_BUCKETS, sizeof(ClientRequest *));
+    if (!c->by_token ||
+        coap_reliability_init(&c->rel, c->fd, params, on_exchange_done, c) != 0 ||
+        timer_wheel_init(&c->response_timers, CLIENT_WHEEL_SLOTS, CLIENT_TICK_MS, coap_reliability_now_ms()) != 0) {
+        close(c->fd);
+        free(c->by_token);
+        free(c);
+        return NULL;
+    }
+    c->token_mask = CLIENT_TOKEN_BUCKETS - 1;
+    c->response_timeout_ms = c->rel.params.ack_timeout_ms;
+
+    // Base de tokens aleatoria por cliente; cada request suma uno
+    uint64_t seed = now_us() ^ ((uint64_t)getpid() << 32) ^ (uint64_t)(uintptr_t)c;
+    c->token_base = seed * 0x9E3779B97F4A7C15ULL;
+    c->next_mid = (uint16_t)(seed >> 7);
+    return c;
+}
+
+void coap_client_destroy(CoapClient *c)
+{
+    if (!c) return;
+    coap_reliability_free(&c->rel);
+    // Lo que queda son NON o respuestas separadas sin llegar
+    for (uint32_t b = 0; b <= c->token_mask; b++) {
+        while (c->by_token[b]) complete_request(c, c->by_token[b], COAP_CLIENT_CANCELLED, NULL);
+    }
+    timer_wheel_free(&c->response_timers);
+    free(c->by_token);
+    close(c->fd);
+    free(c);
+}
+
+void coap_client_set_response_timeout(CoapClient *c, int timeout_ms)
+{
+    c->response_timeout_ms = timeout_ms > 0 ? timeout_ms : 1;
+}
+
+static void add_uri_path_options(CoapMessage *msg, const char *path)
+{
+    const char *p = path;
+    while (*p == '/') p++;
+    while (*p && *p != '?') {
+        const char *start = p;
+        while (*p && *p != '/' && *p != '?') p++;
+        size_t len = (size_t)(p - start);
+        if (len) coap_add_option(msg, 11, (const unsigned char *)start, (unsigned short)len);
+        while (*p == '/') p++;
+    }
+}
+
+// "?id=esp32-7&x=1" -> una opción Uri-Query (15) por argumento. Va después
+// de Content-Format: las opciones se serializan en orden de número.
+static void add_uri_query_options(CoapMessage *msg, const char *path)
+{
+    const char *p = strchr(path, '?');
+    if (!p) return;
+    while (*p) {
+        const char *start = ++p;
+        while (*p && *p != '&') p++;
+        size_t len = (size_t)(p - start);
+        if (len) coap_add_option(msg, 15, (const unsigned char *)start, (unsigned short)len);
+    }
+}
+
+int coap_client_request(CoapClient *c, const struct sockaddr_in *server, uint8_t method,
+                        const char *path, int confirmable, const char *payload,
+                        coap_client_cb cb, void *user)
+{
+    ClientRequest *req = calloc(1, sizeof(ClientRequest));
+    if (!req) return -1;
+    req->token = c->token_base + ++c->token_seq;
+    req->mid = c->next_mid++;
+    req->server = *server;
+    req->cb = cb;
+    req->user = user;
+    req->awaiting_ack = confirmable;
+    req->start_us = now_us();
+
+    CoapMessage msg;
+    coap_message_init(&msg);
+    msg.type = confirmable ? TYPE_CON : 1;
+    msg.code = method;
+    msg.message_id = req->mid;
+    msg.tkl = msg.token_len = CLIENT_TOKEN_LEN;
+    for (int i = 0; i < CLIENT_TOKEN_LEN; i++) {
+        msg.token[i] = (unsigned char)(req->token >> (8 * (CLIENT_TOKEN_LEN - 1 - i)));
+    }
+    add_uri_path_options(&msg, path);
+    // Payload para POST/PUT
+    if ((method == 2 || method == 3) && payload && payload[0]) {
+        unsigned char cf = 50; // application/json
+        coap_add_option(&msg, 12, &cf, 1);
+        coap_set_payload(&msg, (const unsigned char *)payload, (int)strlen(payload));
+    }
+    add_uri_query_options(&msg, path);
+    unsigned char buffer[CLIENT_MAX_DATAGRAM];
+    int len = coap_serialize(&msg, buffer, sizeof(buffer));
+    for (int i = 0; i < msg.option_count; i++) free(msg.options[i].value);
+    if (len <= 0) {
+        free(req);
+        return -1;
+    }
+
+    // Se indexa antes de enviar: un error inmediato completa el request
+    uint32_t b = token_bucket(c, req->token);
+    req->hash_next = c->by_token[b];
+    c->by_token[b] = req;
+    c->pending++;
+
+    if (coap_reliability_submit(&c->rel, server, buffer, (size_t)len, req) != 0) {
+        remove_request(c, req);
+        c->pending--;
+        free(req);
+        return -1;
+    }
+    if (!confirmable) {
+        timer_wheel_add(&c->response_timers, &req->timer,
+                        coap_reliability_now_ms() + (uint64_t)c->response_timeout_ms);
+    }
+    return 0;
+}
+
+static void send_empty(CoapClient *c, uint8_t type, uint16_t mid, const struct sockaddr_in *to)
+{
+    unsigned char pkt[4] = {(unsigned char)(0x40 | (type << 4)), 0x00, (unsigned char)(mid >> 8), (unsigned char)mid};
+    sendto(c->fd, pkt, sizeof(pkt), 0, (const struct sockaddr *)to, sizeof(*to));
+}
+
+static void handle_datagram(CoapClient *c, const unsigned char *buf, int len, const struct sockaddr_in *from)
+{
+    // Entrada de la red: el parser con límites, sin copiar las opciones
+    CoapMessage msg;
+    if (coap_parse_view(&msg, buf, len) != 0) return;
+
+    coap_reliability_handle(&c->rel, from, msg.message_id, msg.type);
+    if (msg.code != 0) {
+        ClientRequest *req = find_request(c, &msg, from);
+        if (req) {
+            // La respuesta implica el ACK aunque este se haya perdido
+            if (req->awaiting_ack) coap_reliability_handle(&c->rel, &req->server, req->mid, TYPE_ACK);
+            if (msg.type == TYPE_CON) send_empty(c, TYPE_ACK, msg.message_id, from);
+            complete_request(c, req, COAP_CLIENT_OK, &msg);
+        } else if (msg.type == TYPE_CON) {
+            send_empty(c, TYPE_RST, msg.message_id, from);
+        }
+    }
+}
+
+int coap_client_poll(CoapClient *c, int timeout_ms)
+{
+    c->completed = 0;
+    uint64_t now = coap_reliability_now_ms();
+    int wait_ms = timeout_ms;
+    int next = coap_reliability_next_timeout_ms(&c->rel, now);
+    if (next >= 0 && (wait_ms < 0 || next < wait_ms)) wait_ms = next;
+    next = timer_wheel_next_timeout_ms(&c->response_timers, now);
+    if (next >= 0 && (wait_ms < 0 || next < wait_ms)) wait_ms = next;
+
+    struct pollfd pfd = {c->fd, POLLIN, 0};
+    if (poll(&pfd, 1, wait_ms) > 0 && (pfd.revents & POLLIN)) {
+        unsigned char buf[CLIENT_MAX_DATAGRAM];
+        for (;;) {
+            struct sockaddr_in from;
+            socklen_t from_len = sizeof(from);
+            ssize_t n = recvfrom(c->fd, buf, sizeof(buf), MSG_DONTWAIT, (struct sockaddr *)&from, &from_len);
+            if (n < 0) break;
+            if (n >= 4) handle_datagram(c, buf, (int)n, &from);
+        }
+    }
+
+    now = coap_reliability_now_ms();
+    coap_reliability_tick(&c->rel, now);
+    timer_wheel_advance(&c->response_timers, now, on_response_timeout, c);
+    return c->completed;
+}
+
+void coap_client_run(CoapClient *c)
+{
+    while (c->pending > 0) coap_client_poll(c, 1000);
+}
+
+size_t coap_client_pending(const CoapClient *c)
+{
+    return c->pending;
+}
+
+int coap_client_fd(const CoapClient *c)
+{
+    return c->fd;
+}
@@ -1,5 +1,6 @@
 #include "coap_parser.h"
 #include "message.h"
+#include "arena.h"
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -15,9 +16,11 @@ static void convert_from_coap_message(const CoapMessage *src, coap_message_t *ds
         memcpy(dst->token, src->token, src->tkl);
     }
     if (src->payload_len > 0) {
-        dst->payload_len = src->payload_len;
-        dst->payload = (uint8_t*)malloc(src->payload_len);
+        // Vive hasta el arena_reset del request
+        Arena *arena = arena_thread();
+        dst->payload = arena ? (uint8_t*)arena_alloc(arena, src->payload_len) : NULL;
         if (dst->payload) {
+            dst->payload_len = src->payload_len;
             memcpy(dst->payload, src->payload, src->payload_len);
         }
     }
@@ -44,13 +47,16 @@ int parse_coap_message(const uint8_t *data, size_t len, coap_message_t *msg) {
         return -1;
     }
     CoapMessage parsed_coap_message;
-    if (coap_parse(&parsed_coap_message, data, len) != 0) {
+    if (coap_parse_view(&parsed_coap_message, data, len) != 0) {
         return -1;
     }
     convert_from_coap_message(&parsed_coap_message, msg);
     msg->uri_path[0] = '\0';
     msg->uri_path_len = 0;
     msg->content_format = -1;
+    msg->max_age = -1;
+    msg->uri_query[0] = '\0';
+    msg->uri_query_len = 0;
     for (int i = 0; i < parsed_coap_message.option_count; i++) {
         int number = parsed_coap_message.options[i].number;
         if (number == COAP_OPTION_URI_PATH) {
@@ -67,22 +73,35 @@ int parse_coap_message(const uint8_t *data, size_t len, coap_message_t *msg) {
             if (parsed_coap_message.options[i].length == 1) {
                 msg->content_format = parsed_coap_message.options[i].value[0];
             }
-        }
-    }
-    for (int i = 0; i < parsed_coap_message.option_count; i++) {
-        if (parsed_coap_message.options[i].value) {
-            free(parsed_coap_message.options[i].value);
+        } else if (number == COAP_OPTION_MAX_AGE) {
+            // uint de 0 a 4 bytes, big-endian
+            if (parsed_coap_message.options[i].length <= 4) {
+                long v = 0;
+                for (int b = 0; b < parsed_coap_message.options[i].length; b++) {
+                    v = v << 8 | parsed_coap_message.options[i].value[b];
+                }
+                msg->max_age = v;
+            }
+        } else if (number == COAP_OPTION_URI_QUERY) {
+            // Un argumento por opción; el que no entra se descarta entero
+            unsigned short arg_len = parsed_coap_message.options[i].length;
+            size_t sep = msg->uri_query_len > 0 ? 1 : 0;
+            if (msg->uri_query_len + sep + arg_len < sizeof(msg->uri_query)) {
+                if (sep) msg->uri_query[msg->uri_query_len++] = '&';
+                memcpy(&msg->uri_query[msg->uri_query_len], parsed_coap_message.options[i].value, arg_len);
+                msg->uri_query_len += arg_len;
+                msg->uri_query[msg->uri_query_len] = '\0';
+            }
         }
     }
     return 0;
 }
 
+// El payload es de la arena del thread: se libera con arena_reset
 void free_coap_message(coap_message_t *msg) {
     if (msg) {
-        if (msg->payload) {
-            free(msg->payload);
-            msg->payload = NULL;
-        }
+        msg->payload = NULL;
+        msg->payload_len = 0;
         if (msg->options) {
             free(msg->options);
             msg->options = NULL;
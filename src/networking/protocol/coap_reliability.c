@@ -0,0 +1,289 @@
+#include "coap_reliability.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/socket.h>
+
+#define COAP_TYPE_CON 0
+#define COAP_TYPE_ACK 2
+#define COAP_TYPE_RST 3
+
+#define RELIABILITY_TICK_MS       10
+#define RELIABILITY_WHEEL_SLOTS   1024
+#define RELIABILITY_MID_BUCKETS   4096
+#define RELIABILITY_PEER_BUCKETS  256
+
+struct CoapEndpoint {
+    uint32_t addr;              // orden de red
+    uint16_t port;
+    int in_flight;
+    CoapExchange *queue_head;
+    CoapExchange *queue_tail;
+    CoapEndpoint *next;
+};
+
+void coap_tx_params_default(CoapTxParams *p)
+{
+    p->ack_timeout_ms = COAP_ACK_TIMEOUT_MS;
+    p->ack_random_factor = COAP_ACK_RANDOM_FACTOR;
+    p->max_retransmit = COAP_MAX_RETRANSMIT;
+    p->nstart = COAP_NSTART;
+}
+
+uint64_t coap_reliability_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000ULL + (uint64_t)ts.tv_nsec / 1000000ULL;
+}
+
+static uint32_t peer_hash(uint32_t addr, uint16_t port)
+{
+    return (addr * 2654435761u) ^ ((uint32_t)port * 40503u);
+}
+
+static uint32_t mid_bucket(const CoapReliability *r, const CoapEndpoint *ep, uint16_t mid)
+{
+    return (peer_hash(ep->addr, ep->port) ^ ((uint32_t)mid * 2246822519u)) & r->mid_mask;
+}
+
+static CoapEndpoint *find_endpoint(CoapReliability *r, const struct sockaddr_in *peer, int create)
+{
+    uint32_t addr = peer->sin_addr.s_addr;
+    uint16_t port = peer->sin_port;
+    uint32_t b = peer_hash(addr, port) & r->endpoint_mask;
+    for (CoapEndpoint *ep = r->endpoints[b]; ep; ep = ep->next) {
+        if (ep->addr == addr && ep->port == port) return ep;
+    }
+    if (!create) return NULL;
+    CoapEndpoint *ep = calloc(1, sizeof(CoapEndpoint));
+    if (!ep) return NULL;
+    ep->addr = addr;
+    ep->port = port;
+    ep->next = r->endpoints[b];
+    r->endpoints[b] = ep;
+    return ep;
+}
+
+static uint64_t next_rand(CoapReliability *r)
+{
+    uint64_t x = r->rng;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    r->rng = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+// Timeout inicial uniforme en [ACK_TIMEOUT, ACK_TIMEOUT * ACK_RANDOM_FACTOR]
+static uint32_t initial_timeout(CoapReliability *r)
+{
+    double u = (double)(next_rand(r) >> 11) / (double)(1ULL << 53);
+    double factor = 1.0 + u * (r->params.ack_random_factor - 1.0);
+    return (uint32_t)(r->params.ack_timeout_ms * factor);
+}
+
+static int send_packet(CoapReliability *r, const CoapExchange *ex)
+{
+    struct sockaddr_in to;
+    memset(&to, 0, sizeof(to));
+    to.sin_family = AF_INET;
+    to.sin_addr.s_addr = ex->endpoint->addr;
+    to.sin_port = ex->endpoint->port;
+    return sendto(r->fd, ex->packet, ex->len, 0, (struct sockaddr *)&to, sizeof(to)) < 0 ? -1 : 0;
+}
+
+static void hash_remove(CoapReliability *r, CoapExchange *ex)
+{
+    CoapExchange **pp = &r->by_mid[mid_bucket(r, ex->endpoint, ex->mid)];
+    while (*pp && *pp != ex) pp = &(*pp)->hash_next;
+    if (*pp) *pp = ex->hash_next;
+    ex->hash_next = NULL;
+}
+
+static void start_exchange(CoapReliability *r, CoapExchange *ex);
+
+// Cierra el exchange, avisa al llamador y deja pasar al siguiente en cola
+static void finish_exchange(CoapReliability *r, CoapExchange *ex, int result)
+{
+    CoapEndpoint *ep = ex->endpoint;
+    timer_wheel_cancel(&r->wheel, &ex->timer);
+    if (ex->in_flight) {
+        hash_remove(r, ex);
+        ep->in_flight--;
+    }
+    r->outstanding--;
+    if (result == COAP_EXCHANGE_TIMEOUT) r->timeouts++;
+    if (r->on_done) r->on_done(ex, result, r->ctx);
+    free(ex);
+
+    while (ep->in_flight < r->params.nstart && ep->queue_head) {
+        CoapExchange *next = ep->queue_head;
+        ep->queue_head = next->queue_next;
+        if (!ep->queue_head) ep->queue_tail = NULL;
+        next->queue_next = NULL;
+        start_exchange(r, next);
+    }
+}
+
+static void start_exchange(CoapReliability *r, CoapExchange *ex)
+{
+    CoapEndpoint *ep = ex->endpoint;
+    uint32_t b = mid_bucket(r, ep, ex->mid);
+    ex->hash_next = r->by_mid[b];
+    r->by_mid[b] = ex;
+    ex->in_flight = 1;
+    ep->in_flight++;
+
+    uint64_t now = coap_reliability_now_ms();
+    ex->first_sent_ms = now;
+    ex->timeout_ms = initial_timeout(r);
+    if (send_packet(r, ex) != 0) {
+        finish_exchange(r, ex, COAP_EXCHANGE_SEND_ERROR);
+        return;
+    }
+    r->sent++;
+    timer_wheel_add(&r->wheel, &ex->timer, now + ex->timeout_ms);
+}
+
+static void on_timer(TimerEntry *timer, void *ctx)
+{
+    CoapReliability *r = (CoapReliability *)ctx;
+    CoapExchange *ex = (CoapExchange *)timer;
+    if (ex->retransmits >= r->params.max_retransmit) {
+        finish_exchange(r, ex, COAP_EXCHANGE_TIMEOUT);
+        return;
+    }
+    ex->retransmits++;
+    ex->timeout_ms *= 2;
+    if (send_packet(r, ex) != 0) {
+        finish_exchange(r, ex, COAP_EXCHANGE_SEND_ERROR);
+        return;
+    }
+    r->retransmissions++;
+    timer_wheel_add(&r->wheel, &ex->timer, coap_reliability_now_ms() + ex->timeout_ms);
+}
+
+int coap_reliability_init(CoapReliability *r, int fd, const CoapTxParams *params,
+                          coap_exchange_fn on_done, void *ctx)
+{
+    memset(r, 0, sizeof(*r));
+    r->fd = fd;
+    if (params) r->params = *params;
+    else coap_tx_params_default(&r->params);
+    if (r->params.nstart < 1) r->params.nstart = 1;
+    if (r->params.max_retransmit < 0) r->params.max_retransmit = 0;
+    if (r->params.ack_random_factor < 1.0) r->params.ack_random_factor = 1.0;
+    r->on_done = on_done;
+    r->ctx = ctx;
+    r->rng = coap_reliability_now_ms() ^ ((uint64_t)(uintptr_t)r << 16) ^ 0x9E3779B97F4A7C15ULL;
+
+    r->by_mid = calloc(RELIABILITY_MID_BUCKETS, sizeof(CoapExchange *));
+    r->endpoints = calloc(RELIABILITY_PEER_BUCKETS, sizeof(CoapEndpoint *));
+    if (!r->by_mid || !r->endpoints ||
+        timer_wheel_init(&r->wheel, RELIABILITY_WHEEL_SLOTS, RELIABILITY_TICK_MS, coap_reliability_now_ms()) != 0) {
+        free(r->by_mid);
+        free(r->endpoints);
+        return -1;
+    }
+    r->mid_mask = RELIABILITY_MID_BUCKETS - 1;
+    r->endpoint_mask = RELIABILITY_PEER_BUCKETS - 1;
+    return 0;
+}
+
+void coap_reliability_free(CoapReliability *r)
+{
+    for (uint32_t b = 0; b <= r->endpoint_mask; b++) {
+        CoapEndpoint *ep = r->endpoints[b];
+        while (ep) {
+            // Primero la cola, para que finish_exchange no arranque nada nuevo
+            CoapExchange *q = ep->queue_head;
+            ep->queue_head = ep->queue_tail = NULL;
+            while (q) {
+                CoapExchange *next = q->queue_next;
+                r->outstanding--;
+                if (r->on_done) r->on_done(q, COAP_EXCHANGE_CANCELLED, r->ctx);
+                free(q);
+                q = next;
+            }
+            ep = ep->next;
+        }
+    }
+    for (uint32_t b = 0; b <= r->mid_mask; b++) {
+        while (r->by_mid[b]) finish_exchange(r, r->by_mid[b], COAP_EXCHANGE_CANCELLED);
+    }
+    for (uint32_t b = 0; b <= r->endpoint_mask; b++) {
+        CoapEndpoint *ep = r->endpoints[b];
+        while (ep) {
+            CoapEndpoint *next = ep->next;
+            free(ep);
+            ep = next;
+        }
+    }
+    free(r->by_mid);
+    free(r->endpoints);
+    timer_wheel_free(&r->wheel);
+    memset(r, 0, sizeof(*r));
+}
+
+int coap_reliability_submit(CoapReliability *r, const struct sockaddr_in *peer,
+                            const uint8_t *packet, size_t len, void *user)
+{
+    if (len < 4 || len > COAP_MAX_PACKET) return -1;
+    uint8_t type = (packet[0] >> 4) & 0x03;
+    if (type != COAP_TYPE_CON) {
+        if (sendto(r->fd, packet, len, 0, (const struct sockaddr *)peer, sizeof(*peer)) < 0) return -1;
+        r->sent++;
+        return 0;
+    }
+
+    CoapEndpoint *ep = find_endpoint(r, peer, 1);
+    CoapExchange *ex = malloc(sizeof(CoapExchange));
+    if (!ep || !ex) {
+        free(ex);
+        return -1;
+    }
+    memset(ex, 0, offsetof(CoapExchange, packet));
+    ex->endpoint = ep;
+    ex->mid = (uint16_t)((packet[2] << 8) | packet[3]);
+    ex->user = user;
+    ex->len = len;
+    memcpy(ex->packet, packet, len);
+    r->outstanding++;
+
+    if (ep->in_flight < r->params.nstart) {
+        start_exchange(r, ex);
+    } else {
+        if (ep->queue_tail) ep->queue_tail->queue_next = ex;
+        else ep->queue_head = ex;
+        ep->queue_tail = ex;
+        r->queued++;
+    }
+    return 0;
+}
+
+int coap_reliability_handle(CoapReliability *r, const struct sockaddr_in *peer,
+                            uint16_t mid, uint8_t type)
+{
+    if (type != COAP_TYPE_ACK && type != COAP_TYPE_RST) return 0;
+    CoapEndpoint *ep = find_endpoint(r, peer, 0);
+    if (!ep) return 0;
+    for (CoapExchange *ex = r->by_mid[mid_bucket(r, ep, mid)]; ex; ex = ex->hash_next) {
+        if (ex->endpoint == ep && ex->mid == mid) {
+            finish_exchange(r, ex, type == COAP_TYPE_ACK ? COAP_EXCHANGE_ACKED : COAP_EXCHANGE_RESET);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void coap_reliability_tick(CoapReliability *r, uint64_t now_ms)
+{
+    timer_wheel_advance(&r->wheel, now_ms, on_timer, r);
+}
+
+int coap_reliability_next_timeout_ms(const CoapReliability *r, uint64_t now_ms)
+{
+    return timer_wheel_next_timeout_ms(&r->wheel, now_ms);
+}
@@ -1,5 +1,6 @@
 #include "coap_router.h"
 #include "coap_api.h"
+#include "tracer.h"
 #include <string.h>
 #include <stdio.h>
 
@@ -29,7 +30,10 @@ int coap_router_handle_request(const coap_message_t *request, uint8_t *out_code,
     }
     else
     {
-        if (handler(request, out_payload) == 0)
+        tracer_span_begin("handler");
+        int handler_result = handler(request, out_payload);
+        tracer_span_end();
+        if (handler_result == 0)
         {
             *out_code = coap_default_success_code(request->code);
             return 0;
@@ -0,0 +1,297 @@
+#include "cold_store.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define COLD_BATCH_BYTES    (256 * 1024)
+#define COLD_BATCH_MAX      4096
+#define COLD_RECORD_MAX     (sizeof(ColdRecordHeader) + 2048)
+#define COLD_COMPACT_MIN    (4 * 1024 * 1024)
+
+typedef struct {
+    const InternKey *key;       // NULL = libre
+    uint64_t off;
+    ColdMeta meta;
+} ColdRef;
+
+_Static_assert(sizeof(ColdRef) == 24, "ColdRef debe ocupar 24 bytes");
+
+struct ColdStore {
+    char path[300];
+    int fd;
+    uint64_t end;               // bytes escritos (próximo offset)
+    uint64_t live;              // bytes de registros indexados
+    ColdRef *refs;
+    size_t mask;
+    size_t count;
+    // Lote en curso: registros contiguos que van en un solo pwrite
+    char *batch;
+    size_t batch_used;
+    ColdRef staged[COLD_BATCH_MAX];     // off relativo al lote
+    size_t staged_count;
+};
+
+static size_t record_size(const InternKey *key, uint16_t len)
+{
+    return sizeof(ColdRecordHeader) + key->len + len;
+}
+
+ColdStore *cold_store_create(const char *path)
+{
+    ColdStore *cs = calloc(1, sizeof(ColdStore));
+    if (!cs) return NULL;
+    snprintf(cs->path, sizeof(cs->path), "%s", path);
+    cs->fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    cs->batch = malloc(COLD_BATCH_BYTES);
+    cs->mask = 1023;
+    cs->refs = calloc(cs->mask + 1, sizeof(ColdRef));
+    if (cs->fd < 0 || !cs->batch || !cs->refs) {
+        if (cs->fd >= 0) close(cs->fd);
+        free(cs->batch);
+        free(cs->refs);
+        free(cs);
+        return NULL;
+    }
+    return cs;
+}
+
+void cold_store_destroy(ColdStore *cs)
+{
+    if (!cs) return;
+    close(cs->fd);
+    unlink(cs->path);
+    free(cs->batch);
+    free(cs->refs);
+    free(cs);
+}
+
+static size_t find_slot(const ColdStore *cs, const InternKey *key)
+{
+    size_t i = key->hash & cs->mask;
+    while (cs->refs[i].key && cs->refs[i].key != key) i = (i + 1) & cs->mask;
+    return i;
+}
+
+static int grow_index(ColdStore *cs)
+{
+    size_t n = (cs->mask + 1) * 2;
+    ColdRef *refs = calloc(n, sizeof(ColdRef));
+    if (!refs) return -1;
+    for (size_t i = 0; i <= cs->mask; i++) {
+        if (!cs->refs[i].key) continue;
+        size_t j = cs->refs[i].key->hash & (n - 1);
+        while (refs[j].key) j = (j + 1) & (n - 1);
+        refs[j] = cs->refs[i];
+    }
+    free(cs->refs);
+    cs->refs = refs;
+    cs->mask = n - 1;
+    return 0;
+}
+
+int cold_store_stage(ColdStore *cs, const InternKey *key, const char *value, size_t len, const ColdMeta *meta)
+{
+    size_t size = sizeof(ColdRecordHeader) + key->len + len;
+    if (len > UINT16_MAX || size > COLD_RECORD_MAX) return -1;
+    if (cs->staged_count == COLD_BATCH_MAX || cs->batch_used + size > COLD_BATCH_BYTES) return -1;
+    ColdRecordHeader h = {key->len, (uint32_t)len, meta->flags, meta->version};
+    char *p = cs->batch + cs->batch_used;
+    memcpy(p, &h, sizeof(h));
+    memcpy(p + sizeof(h), key->str, key->len);
+    memcpy(p + sizeof(h) + key->len, value, len);
+    ColdRef *r = &cs->staged[cs->staged_count++];
+    r->key = key;
+    r->off = cs->batch_used;
+    r->meta = *meta;
+    r->meta.len = (uint16_t)len;
+    cs->batch_used += size;
+    return 0;
+}
+
+static int write_at(int fd, const char *buf, size_t len, uint64_t off)
+{
+    while (len > 0) {
+        ssize_t n = pwrite(fd, buf, len, (off_t)off);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        buf += n;
+        len -= (size_t)n;
+        off += (uint64_t)n;
+    }
+    return 0;
+}
+
+static int read_at(int fd, char *buf, size_t len, uint64_t off)
+{
+    while (len > 0) {
+        ssize_t n = pread(fd, buf, len, (off_t)off);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        buf += n;
+        len -= (size_t)n;
+        off += (uint64_t)n;
+    }
+    return 0;
+}
+
+// Registro completo de r en rec (COLD_RECORD_MAX bytes), validando la clave
+static int read_record(const ColdStore *cs, const ColdRef *r, char *rec)
+{
+    size_t size = record_size(r->key, r->meta.len);
+    if (read_at(cs->fd, rec, size, r->off) != 0) return -1;
+    ColdRecordHeader h;
+    memcpy(&h, rec, sizeof(h));
+    if (h.key_len != r->key->len || h.value_len != r->meta.len ||
+        memcmp(rec + sizeof(h), r->key->str, h.key_len) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+// Reescribe solo lo indexado en un archivo nuevo (con el buffer del lote,
+// que está vacío) y lo pone en lugar del viejo
+static void compact(ColdStore *cs)
+{
+    char tmp[sizeof(cs->path) + 8];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", cs->path);
+    int fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) return;
+    uint64_t out = 0;
+    size_t used = 0;
+    int ok = 1;
+    char rec[COLD_RECORD_MAX + 1];
+    for (size_t i = 0; ok && i <= cs->mask; i++) {
+        ColdRef *r = &cs->refs[i];
+        if (!r->key) continue;
+        size_t size = record_size(r->key, r->meta.len);
+        if (used + size > COLD_BATCH_BYTES) {
+            ok = write_at(fd, cs->batch, used, out - used) == 0;
+            used = 0;
+        }
+        ok = ok && read_record(cs, r, rec) == 0;
+        if (!ok) break;
+        memcpy(cs->batch + used, rec, size);
+        used += size;
+        out += size;
+    }
+    ok = ok && write_at(fd, cs->batch, used, out - used) == 0;
+    if (!ok || rename(tmp, cs->path) != 0) {
+        close(fd);
+        unlink(tmp);
+        return;
+    }
+    // Mismo orden que la copia: los offsets nuevos son la suma de los tamaños
+    uint64_t off = 0;
+    for (size_t i = 0; i <= cs->mask; i++) {
+        if (!cs->refs[i].key) continue;
+        cs->refs[i].off = off;
+        off += record_size(cs->refs[i].key, cs->refs[i].meta.len);
+    }
+    close(cs->fd);
+    cs->fd = fd;
+    cs->end = out;
+    cs->live = out;
+}
+
+int cold_store_commit(ColdStore *cs)
+{
+    if (cs->staged_count == 0) return 0;
+    int ok = write_at(cs->fd, cs->batch, cs->batch_used, cs->end) == 0;
+    while (ok && (cs->count + cs->staged_count) * 2 > cs->mask + 1) ok = grow_index(cs) == 0;
+    if (!ok) {
+        cs->staged_count = 0;
+        cs->batch_used = 0;
+        return -1;
+    }
+    for (size_t s = 0; s < cs->staged_count; s++) {
+        ColdRef r = cs->staged[s];
+        r.off += cs->end;
+        size_t i = find_slot(cs, r.key);
+        if (cs->refs[i].key) cs->live -= record_size(r.key, cs->refs[i].meta.len);
+        else cs->count++;
+        cs->refs[i] = r;
+        cs->live += record_size(r.key, r.meta.len);
+    }
+    cs->end += cs->batch_used;
+    cs->staged_count = 0;
+    cs->batch_used = 0;
+    if (cs->end > COLD_COMPACT_MIN && cs->end > cs->live * 2) compact(cs);
+    return 0;
+}
+
+int cold_store_contains(const ColdStore *cs, const InternKey *key)
+{
+    return cs->refs[find_slot(cs, key)].key != NULL;
+}
+
+int cold_store_meta(const ColdStore *cs, const InternKey *key, ColdMeta *meta)
+{
+    const ColdRef *r = &cs->refs[find_slot(cs, key)];
+    if (!r->key) return 0;
+    *meta = r->meta;
+    return 1;
+}
+
+int cold_store_read(ColdStore *cs, const InternKey *key, char *value, size_t cap, ColdMeta *meta)
+{
+    const ColdRef *r = &cs->refs[find_slot(cs, key)];
+    if (!r->key || r->meta.len + 1u > cap) return -1;
+    char rec[COLD_RECORD_MAX + 1];
+    if (read_record(cs, r, rec) != 0) return -1;
+    memcpy(value, rec + sizeof(ColdRecordHeader) + key->len, r->meta.len);
+    value[r->meta.len] = '\0';
+    if (meta) *meta = r->meta;
+    return r->meta.len;
+}
+
+int cold_store_take(ColdStore *cs, const InternKey *key, ColdMeta *meta)
+{
+    size_t i = find_slot(cs, key);
+    if (!cs->refs[i].key) return 0;
+    if (meta) *meta = cs->refs[i].meta;
+    cs->live -= record_size(key, cs->refs[i].meta.len);
+    cs->count--;
+    // Borrado con corrimiento hacia atrás: sin marcas de borrado
+    size_t hole = i;
+    for (size_t j = (i + 1) & cs->mask; cs->refs[j].key; j = (j + 1) & cs->mask) {
+        size_t home = cs->refs[j].key->hash & cs->mask;
+        // j se puede mover al hueco si su posición ideal no está entre hole y j
+        if (((j - home) & cs->mask) >= ((j - hole) & cs->mask)) {
+            cs->refs[hole] = cs->refs[j];
+            hole = j;
+        }
+    }
+    cs->refs[hole].key = NULL;
+    return 1;
+}
+
+size_t cold_store_scan(ColdStore *cs, cold_store_fn fn, void *ctx)
+{
+    size_t failed = 0;
+    char rec[COLD_RECORD_MAX + 1];
+    for (size_t i = 0; i <= cs->mask; i++) {
+        const ColdRef *r = &cs->refs[i];
+        if (!r->key) continue;
+        if (read_record(cs, r, rec) != 0) {
+            failed++;
+            continue;
+        }
+        char *value = rec + sizeof(ColdRecordHeader) + r->key->len;
+        value[r->meta.len] = '\0';
+        fn(r->key, value, r->meta.len, &r->meta, ctx);
+    }
+    return failed;
+}
+
+size_t cold_store_count(const ColdStore *cs)
+{
+    return cs ? cs->count : 0;
+}
+
+uint64_t cold_store_file_bytes(const ColdStore *cs)
+{
+    return cs ? cs->end : 0;
+}
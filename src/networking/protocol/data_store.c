@@ -1,53 +1,888 @@
+#define _GNU_SOURCE
 #include "data_store.h"
+#include "metrics.h"
+#include "tracer.h"
+#include "slab.h"
+#include "intern.h"
+#include "shm_table.h"
+#include "change_feed.h"
+#include "json_dict.h"
+#include "timer_wheel.h"
+#include "cold_store.h"
+#include "store_log.h"
+#include "field_index.h"
+#include "skiplist.h"
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <pthread.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+// Entrada de una línea de cache: los valores chicos (la mayoría de los
+// payloads de sensores) van dentro de la entrada; los más grandes en un
+// bloque de value_pools. En ambos casos sobra capacidad, así que una
+// actualización del mismo tamaño o menor se escribe en el lugar.
+#define ENTRY_INLINE 28
+#define VALUE_CLASSES 5
+#define VALUE_MAX 1024
+#define ENTRY_DIRTY 1u              // escrita desde el último flush (coalescing)
+#define ENTRY_COMPRESSED 2u         // value codificado con json_dict
+#define ENTRY_TTL 4u                // tiene un TtlTimer armado
+#define ENTRY_PINNED 8u             // Max-Age 0: no expira aunque la ruta tenga TTL
+#define ENTRY_REF 16u               // bit de referencia de CLOCK
+#define ENTRY_EVICTING 32u          // elegida en la pasada de desalojo en curso
+#define ENTRY_INDEXED 64u           // el valor es la lectura de alguna entrada de field_index
+#define ENTRY_COLD_FLAGS (ENTRY_COMPRESSED | ENTRY_TTL | ENTRY_PINNED | ENTRY_INDEXED)
+
+// Registros del log (store_log.h): las plantillas son de hasta VALUE_MAX
+// bytes (json_dict.c) y cada valor puede llevar la suya adelante
+#define VALUE_RECORD_MAX store_log_record_size(STORE_LOG_KEY_MAX, VALUE_MAX)
+#define ENTRY_RECORDS_MAX (store_log_record_size(0, VALUE_MAX) + VALUE_RECORD_MAX)
 
 typedef struct Entry {
-    char *key;
-    char *value;
-    struct Entry *next;
+    const InternKey *key;       // compartida con el router
+    struct Entry *next;         // cadena del índice
+    char *value;                // inline_value o un bloque de value_pools
+    uint16_t len;
+    uint16_t cap;               // bytes de value, '\0' incluido
+    uint32_t flags;             // ENTRY_*
+    uint32_t version;           // escrituras de la clave (change feed)
+    char inline_value[ENTRY_INLINE];
 } Entry;
 
-static Entry *head = NULL;
+_Static_assert(sizeof(Entry) == 64, "Entry debe ocupar una línea de cache");
+
+static const size_t value_class_size[VALUE_CLASSES] = {64, 128, 256, 512, VALUE_MAX};
+
+// Índice hash por clave internada (el hash ya viene en la clave)
+static Entry **index_buckets = NULL;
+static size_t index_mask = 0;
+static size_t entry_count = 0;
+
 static pthread_mutex_t store_mutex = PTHREAD_MUTEX_INITIALIZER;
 static char store_file[256] = {0};
+static SlabPool *entry_pool = NULL;
+static SlabPool *value_pools[VALUE_CLASSES];
+static pthread_once_t pools_once = PTHREAD_ONCE_INIT;
 
-static void set_in_memory(const char *key, const char *value) {
-    Entry *e = head;
-    while (e) {
-        if (strcmp(e->key, key) == 0) {
-            free(e->value);
-            e->value = strdup(value);
-            return;
+// Coalescing: las escrituras solo marcan la clave y el flusher escribe un
+// registro por clave cada coalesce_ms. Orden de locks: file_mutex -> store_mutex.
+static int coalesce_ms = 0;
+static const InternKey **dirty_keys = NULL;
+static size_t dirty_count = 0;
+static size_t dirty_cap = 0;
+static pthread_mutex_t file_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t flusher_thread;
+static pthread_cond_t flusher_cond = PTHREAD_COND_INITIALIZER;
+static int flusher_running = 0;
+
+// Tabla de últimos valores para lectores locales; se escribe con store_mutex
+static ShmTable *shared_table = NULL;
+// Stream de cambios para suscriptores locales; se publica con store_mutex
+// para que el orden de las secuencias sea el de las escrituras
+static ChangeFeed *change_feed = NULL;
+// Valores JSON guardados como plantilla + huecos (json_dict.c)
+static int compress_values = 0;
+
+// Presupuesto de memoria: con resident_bytes (entradas y bloques de valores)
+// por encima de memory_budget se desalojan entradas frías al cold store con
+// CLOCK; la aguja recorre los buckets del índice y el bit de referencia va en
+// flags, así que no cuesta memoria por entrada.
+static size_t memory_budget = 0;
+static size_t resident_bytes = 0;
+static size_t clock_hand = 0;
+static ColdStore *cold_store = NULL;
+
+// Índice por campos del payload ("id" -> última lectura de cada dispositivo).
+// Apunta a la clave mientras la lectura sea su valor actual y se queda con
+// una copia solo cuando otra escritura la pisa (field_index.h).
+static FieldIndex *field_index = NULL;
+
+// Todas las claves (en memoria y en el cold store) en orden, para los GET
+// con patrón: un rango de claves se recorre sin pasar por el índice hash.
+// Tiene una referencia de cada clave (intern.h): al borrarla de acá, la
+// tabla de claves puede liberarla.
+static SkipList *key_order = NULL;
+
+// TTL: solo las claves que expiran tienen un TtlTimer (fuera de la entrada,
+// que ocupa una línea de cache), indexado por clave y colgado de una rueda
+// jerárquica con ticks de un segundo. Todo con store_mutex; el expirer avanza
+// la rueda una vez por tick sin recorrer el store.
+#define TTL_TICK_MS 1000
+#define TTL_ROUTES_MAX 16
+
+typedef struct TtlTimer {
+    TimerEntry timer;           // primero: la rueda devuelve el TimerEntry
+    const InternKey *key;
+    struct TtlTimer *next;      // cadena de ttl_buckets
+    uint64_t expires_ms;        // CLOCK_REALTIME, es lo que va al log
+} TtlTimer;
+
+static HierTimerWheel ttl_wheel;
+static int ttl_wheel_ready = 0;
+static TtlTimer **ttl_buckets = NULL;
+static size_t ttl_mask = 0;
+static size_t ttl_count = 0;
+static SlabPool *ttl_pool = NULL;
+static pthread_t expirer_thread;
+static pthread_mutex_t expirer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t expirer_cond = PTHREAD_COND_INITIALIZER;
+static int expirer_running = 0;
+
+// TTL por defecto de las claves bajo un prefijo de ruta (el más largo gana)
+static struct {
+    char prefix[128];
+    size_t len;
+    int ttl_s;
+} ttl_routes[TTL_ROUTES_MAX];
+static int ttl_route_count = 0;
+
+// Snapshots con fork(): store_mutex se toma solo durante el fork y el hijo
+// escribe su copia copy-on-write. snapshot_mutex protege el estado de abajo.
+static pthread_mutex_t snapshot_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t snapshot_cond = PTHREAD_COND_INITIALIZER;
+static char snapshot_file[300] = {0};
+static int snapshot_interval_s = 0;
+static int snapshot_scheduler_running = 0;
+static pthread_t snapshot_scheduler;
+static int snapshot_waiter_active = 0;     // hay un waiter sin join
+static pthread_t snapshot_waiter;
+static DataStoreSnapshotInfo snapshot_info;
+
+static void create_pools(void) {
+    entry_pool = slab_pool_create("Entry", sizeof(Entry));
+    ttl_pool = slab_pool_create("TtlTimer", sizeof(TtlTimer));
+    for (int i = 0; i < VALUE_CLASSES; i++) {
+        value_pools[i] = slab_pool_create("value", value_class_size[i]);
+    }
+}
+
+static int value_class(size_t size) {
+    for (int i = 0; i < VALUE_CLASSES; i++) {
+        if (size <= value_class_size[i]) return i;
+    }
+    return -1;
+}
+
+static void release_value(Entry *e) {
+    if (e->value != e->inline_value) slab_free(e->value);
+    e->value = e->inline_value;
+    e->cap = ENTRY_INLINE;
+}
+
+// Cambia el bloque del valor por uno de al menos size bytes (+25% de holgura)
+static int grow_value(Entry *e, size_t size) {
+    size_t want = size + size / 4;
+    if (want > VALUE_MAX) want = VALUE_MAX;
+    int cls = value_class(want);
+    if (cls < 0 || !value_pools[cls]) return -1;
+    char *block = slab_alloc(value_pools[cls]);
+    if (!block) return -1;
+    release_value(e);
+    e->value = block;
+    e->cap = (uint16_t)value_class_size[cls];
+    return 0;
+}
+
+static int index_grow(void) {
+    size_t n = index_buckets ? (index_mask + 1) * 2 : 1024;
+    Entry **nb = calloc(n, sizeof(Entry *));
+    if (!nb) return -1;
+    if (index_buckets) {
+        for (size_t b = 0; b <= index_mask; b++) {
+            Entry *e = index_buckets[b];
+            while (e) {
+                Entry *next = e->next;
+                size_t nb_idx = e->key->hash & (n - 1);
+                e->next = nb[nb_idx];
+                nb[nb_idx] = e;
+                e = next;
+            }
         }
-        e = e->next;
+        free(index_buckets);
     }
-    Entry *n = (Entry*)malloc(sizeof(Entry));
-    n->key = strdup(key);
-    n->value = strdup(value);
-    n->next = head;
-    head = n;
+    index_buckets = nb;
+    index_mask = n - 1;
+    return 0;
 }
 
-static const char* get_in_memory(const char *key) {
-    Entry *e = head;
-    while (e) {
-        if (strcmp(e->key, key) == 0) return e->value;
-        e = e->next;
+static Entry *find_entry(const InternKey *key) {
+    if (!index_buckets || !key) return NULL;
+    for (Entry *e = index_buckets[key->hash & index_mask]; e; e = e->next) {
+        if (e->key == key) return e;
     }
     return NULL;
 }
 
-static void rewrite_file(void) {
-    if (!store_file[0]) return;
-    FILE *f = fopen(store_file, "w");
+// La clave k deja el store (borrada o expirada, no desalojada)
+static void key_order_remove(const InternKey *k) {
+    if (key_order && skiplist_remove(key_order, k)) intern_release(k);
+}
+
+static Entry *put_entry(const InternKey *k, const char *value, size_t len, int compressed);
+static void evict_to_budget(const Entry *protect);
+
+static void index_keep_previous(const InternKey *k, const FieldValue *next, size_t n_next);
+static void index_point(Entry *e, const FieldValue *fields, size_t n);
+
+static Entry *set_in_memory(const char *key, const char *value) {
+    size_t len = strlen(value);
+    if (len + 1 > VALUE_MAX || strlen(key) > STORE_LOG_KEY_MAX) return NULL;
+    const char *raw = value;
+    size_t raw_len = len;
+    // Lo que empieza con '@' se codifica siempre (literal) para que no se
+    // confunda con un valor comprimido al recargar el log
+    char enc[VALUE_MAX];
+    int enc_len = -1;
+    if (value[0] == JSON_DICT_MARK) {
+        enc_len = json_dict_encode_literal(value, len, enc, sizeof(enc));
+        if (enc_len < 0) return NULL;
+    } else if (compress_values) {
+        enc_len = json_dict_encode(value, len, enc, sizeof(enc));
+    }
+    if (enc_len >= 0) {
+        value = enc;
+        len = (size_t)enc_len;
+    }
+    const InternKey *k = intern_get(key, strlen(key));
+    if (!k) return NULL;
+    FieldValue fields[FIELD_INDEX_FIELDS_MAX];
+    size_t nfields = 0;
+    if (field_index) {
+        nfields = field_index_extract(field_index, raw, raw_len, fields);
+        index_keep_previous(k, fields, nfields);
+    }
+    Entry *e = put_entry(k, value, len, enc_len >= 0);
+    if (e && field_index) index_point(e, fields, nfields);
+    if (e) evict_to_budget(e);
+    // La entrada ya tiene la suya (en key_order)
+    intern_release(k);
+    return e;
+}
+
+static size_t entry_bytes(const Entry *e) {
+    return sizeof(Entry) + (e->value != e->inline_value ? e->cap : 0);
+}
+
+// Crea o actualiza la entrada de k con el valor ya codificado. Una clave que
+// estaba en el cold store vuelve con su versión y su TTL.
+static Entry *put_entry(const InternKey *k, const char *value, size_t len, int compressed) {
+    Entry *e = find_entry(k);
+    size_t before = e ? entry_bytes(e) : 0;
+    if (!e) {
+        pthread_once(&pools_once, create_pools);
+        if (!entry_pool) return NULL;
+        if (entry_count >= (index_buckets ? index_mask + 1 : 0) && index_grow() != 0) return NULL;
+        // Una clave nueva entra al orden de claves, que se queda con su
+        // referencia hasta que se borre (las del cold store ya están)
+        int cold = cold_store && cold_store_contains(cold_store, k);
+        if (!cold) {
+            if (!key_order) key_order = skiplist_create();
+            int r = key_order ? skiplist_insert(key_order, k) : -1;
+            if (r < 0) return NULL;
+            if (r == 0) intern_acquire(k);
+        }
+        e = (Entry*)slab_alloc(entry_pool);
+        if (!e) {
+            if (!cold) key_order_remove(k);
+            return NULL;
+        }
+        e->key = k;
+        e->value = e->inline_value;
+        e->cap = ENTRY_INLINE;
+        e->len = 0;
+        e->flags = 0;
+        e->version = 0;
+        // El bloque del valor antes de enlazarla o de sacar la clave del cold
+        // store: si no hay memoria la clave queda como estaba
+        if (len + 1 > e->cap && grow_value(e, len + 1) != 0) {
+            slab_free(e);
+            if (!cold) key_order_remove(k);
+            return NULL;
+        }
+        e->next = index_buckets[k->hash & index_mask];
+        index_buckets[k->hash & index_mask] = e;
+        entry_count++;
+        metrics_gauge_add(METRIC_GAUGE_STORE_ENTRIES, 1);
+        ColdMeta meta;
+        if (cold && cold_store_take(cold_store, k, &meta)) {
+            e->version = meta.version;
+            e->flags = meta.flags & (ENTRY_TTL | ENTRY_PINNED | ENTRY_INDEXED);
+            metrics_gauge_add(METRIC_GAUGE_COLD_KEYS, -1);
+        }
+    } else if (len + 1 <= e->cap) {
+        metrics_inc(METRIC_STORE_INPLACE);
+    }
+    if (len + 1 > e->cap && grow_value(e, len + 1) != 0) return NULL;
+    memcpy(e->value, value, len + 1);
+    metrics_gauge_add(METRIC_GAUGE_STORE_BYTES, (long)len - (long)e->len);
+    e->len = (uint16_t)len;
+    if (compressed) e->flags |= ENTRY_COMPRESSED;
+    else e->flags &= ~ENTRY_COMPRESSED;
+    e->flags |= ENTRY_REF;
+    e->version++;
+    resident_bytes += entry_bytes(e) - before;
+    metrics_gauge_set(METRIC_GAUGE_RESIDENT_BYTES, (long)resident_bytes);
+    return e;
+}
+
+// Entrada de k, trayéndola del cold store si hace falta
+static Entry *lookup_entry(const InternKey *k) {
+    Entry *e = find_entry(k);
+    if (e || !k || !cold_store) return e;
+    char value[VALUE_MAX];
+    ColdMeta meta;
+    int len = cold_store_read(cold_store, k, value, sizeof(value), &meta);
+    if (len < 0) return NULL;
+    e = put_entry(k, value, (size_t)len, meta.flags & ENTRY_COMPRESSED);
+    if (!e) return NULL;
+    e->version = meta.version;
+    evict_to_budget(e);
+    return e;
+}
+
+// Con store_mutex tomado: lugar para una clave más en la lista de
+// pendientes. Se pide antes de tocar la memoria, así una escritura que no
+// se puede encolar se rechaza en vez de aceptarse sin llegar al log.
+static int dirty_reserve(void) {
+    if (dirty_count < dirty_cap) return 0;
+    size_t cap = dirty_cap ? dirty_cap * 2 : 1024;
+    const InternKey **nk = realloc(dirty_keys, cap * sizeof(*nk));
+    if (!nk) return -1;
+    dirty_keys = nk;
+    dirty_cap = cap;
+    return 0;
+}
+
+// Con store_mutex tomado y lugar reservado (dirty_reserve). Una clave ya
+// marcada es una escritura ahorrada.
+static void mark_dirty(Entry *e) {
+    if (e->flags & ENTRY_DIRTY) {
+        metrics_inc(METRIC_STORE_COALESCED);
+        return;
+    }
+    // La lista se queda con una referencia: la clave puede borrarse antes del flush
+    intern_acquire(e->key);
+    dirty_keys[dirty_count++] = e->key;
+    e->flags |= ENTRY_DIRTY;
+}
+
+// Valor original de e en out (cap >= VALUE_MAX). Devuelve el largo.
+static int entry_value(const Entry *e, char *out, size_t cap) {
+    if (e->flags & ENTRY_COMPRESSED) return json_dict_decode(e->value, e->len, out, cap);
+    memcpy(out, e->value, e->len + 1);
+    return e->len;
+}
+
+// Plantilla de e que todavía no tiene su registro en el log actual (queda
+// marcada como escrita). NULL si no hace falta.
+static const char *pending_template(const char *value, size_t len, uint32_t flags, int *id) {
+    if (!(flags & ENTRY_COMPRESSED)) return NULL;
+    *id = json_dict_id(value, len);
+    if (*id <= 0 || !json_dict_take_unpersisted((uint32_t)*id)) return NULL;
+    return json_dict_template((uint32_t)*id);
+}
+
+static uint64_t wall_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static int route_ttl(const InternKey *k) {
+    int ttl = 0;
+    size_t best = 0;
+    for (int i = 0; i < ttl_route_count; i++) {
+        size_t n = ttl_routes[i].len;
+        if (n < best || n > k->len || memcmp(k->str, ttl_routes[i].prefix, n) != 0) continue;
+        // "/sensors" vale para "/sensors" y "/sensors/x", no para "/sensors2"
+        int boundary = n == 0 || k->str[n] == '\0' || k->str[n] == '/' || k->str[n - 1] == '/';
+        if (!boundary) continue;
+        best = n;
+        ttl = ttl_routes[i].ttl_s;
+    }
+    return ttl;
+}
+
+static TtlTimer *ttl_find(const InternKey *k) {
+    if (!ttl_buckets) return NULL;
+    for (TtlTimer *t = ttl_buckets[k->hash & ttl_mask]; t; t = t->next) {
+        if (t->key == k) return t;
+    }
+    return NULL;
+}
+
+static int ttl_index_grow(void) {
+    size_t n = ttl_buckets ? (ttl_mask + 1) * 2 : 1024;
+    TtlTimer **nb = calloc(n, sizeof(TtlTimer *));
+    if (!nb) return -1;
+    for (size_t b = 0; ttl_buckets && b <= ttl_mask; b++) {
+        TtlTimer *t = ttl_buckets[b];
+        while (t) {
+            TtlTimer *next = t->next;
+            t->next = nb[t->key->hash & (n - 1)];
+            nb[t->key->hash & (n - 1)] = t;
+            t = next;
+        }
+    }
+    free(ttl_buckets);
+    ttl_buckets = nb;
+    ttl_mask = n - 1;
+    return 0;
+}
+
+static void expirer_start(void);
+
+// Arma (o re-arma) el vencimiento de e para expires_ms (CLOCK_REALTIME)
+static int ttl_set(Entry *e, uint64_t expires_ms) {
+    TtlTimer *t = (e->flags & ENTRY_TTL) ? ttl_find(e->key) : NULL;
+    if (!t) {
+        if (!ttl_pool) return -1;
+        if (ttl_count >= (ttl_buckets ? ttl_mask + 1 : 0) && ttl_index_grow() != 0) return -1;
+        t = (TtlTimer *)slab_alloc(ttl_pool);
+        if (!t) return -1;
+        memset(&t->timer, 0, sizeof(t->timer));
+        t->key = e->key;
+        t->next = ttl_buckets[e->key->hash & ttl_mask];
+        ttl_buckets[e->key->hash & ttl_mask] = t;
+        ttl_count++;
+        metrics_gauge_add(METRIC_GAUGE_TTL_KEYS, 1);
+    }
+    uint64_t now = metrics_now_ns() / 1000000, wall = wall_ms();
+    if (!ttl_wheel_ready) {
+        timer_hwheel_init(&ttl_wheel, TTL_TICK_MS, now);
+        ttl_wheel_ready = 1;
+    }
+    // La rueda va con el reloj monótono; el log, con la hora
+    t->expires_ms = expires_ms;
+    timer_hwheel_add(&ttl_wheel, &t->timer, expires_ms > wall ? now + (expires_ms - wall) : now);
+    e->flags = (e->flags | ENTRY_TTL) & ~ENTRY_PINNED;
+    expirer_start();
+    return 0;
+}
+
+// Saca el TtlTimer de k del índice y de la rueda y lo libera
+static void ttl_forget(const InternKey *k) {
+    if (!ttl_buckets) return;
+    TtlTimer **pp = &ttl_buckets[k->hash & ttl_mask];
+    while (*pp && (*pp)->key != k) pp = &(*pp)->next;
+    TtlTimer *t = *pp;
+    if (!t) return;
+    *pp = t->next;
+    timer_hwheel_cancel(&ttl_wheel, &t->timer);
+    slab_free(t);
+    ttl_count--;
+    metrics_gauge_add(METRIC_GAUGE_TTL_KEYS, -1);
+}
+
+static void ttl_clear(Entry *e) {
+    if (!(e->flags & ENTRY_TTL)) return;
+    e->flags &= ~ENTRY_TTL;
+    ttl_forget(e->key);
+}
+
+// ttl_s < 0: el de la ruta; 0: no expira
+static void apply_ttl(Entry *e, int ttl_s) {
+    int pinned = ttl_s == 0;
+    if (ttl_s < 0) ttl_s = route_ttl(e->key);
+    if (ttl_s > 0 && ttl_set(e, wall_ms() + (uint64_t)ttl_s * 1000) == 0) return;
+    ttl_clear(e);
+    if (pinned) e->flags |= ENTRY_PINNED;
+    else e->flags &= ~ENTRY_PINNED;
+}
+
+static void index_gauges(void) {
+    metrics_gauge_set(METRIC_GAUGE_INDEX_KEYS, (long)field_index_count(field_index));
+    metrics_gauge_set(METRIC_GAUGE_INDEX_KEPT_BYTES, (long)field_index_kept_bytes(field_index));
+}
+
+static int same_field_value(const FieldValue *a, const FieldValue *b) {
+    return a->field == b->field && a->len == b->len && memcmp(a->value, b->value, a->len) == 0;
+}
+
+// Antes de que k cambie de valor: las lecturas indexadas del valor actual
+// que la escritura nueva no reemplaza (otro dispositivo en la misma clave)
+// pasan a guardarse en el índice, con el vencimiento que tenían
+static void index_keep_previous(const InternKey *k, const FieldValue *next, size_t n_next) {
+    Entry *old = lookup_entry(k);
+    if (!old || !(old->flags & ENTRY_INDEXED)) return;
+    char raw[VALUE_MAX];
+    int len = entry_value(old, raw, sizeof(raw));
+    if (len < 0) return;
+    FieldValue prev[FIELD_INDEX_FIELDS_MAX];
+    size_t n = field_index_extract(field_index, raw, (size_t)len, prev);
+    const TtlTimer *t = (old->flags & ENTRY_TTL) ? ttl_find(k) : NULL;
+    for (size_t i = 0; i < n; i++) {
+        size_t j = 0;
+        while (j < n_next && !same_field_value(&prev[i], &next[j])) j++;
+        if (j < n_next) continue;
+        FieldIndexEntry *ie = field_index_find(field_index, prev[i].field, prev[i].value, prev[i].len);
+        if (!ie || ie->key != k || ie->reading) continue;
+        if (field_index_keep(field_index, ie, old->value, old->len, old->flags & ENTRY_COMPRESSED,
+                             t ? t->expires_ms : 0) != 0) {
+            // Sin la copia apuntaría a la lectura de otro dispositivo
+            field_index_remove(field_index, ie);
+        }
+    }
+}
+
+// Después de escribir e: cada valor indexado de su payload apunta a e
+static void index_point(Entry *e, const FieldValue *fields, size_t n) {
+    e->flags &= ~ENTRY_INDEXED;
+    for (size_t i = 0; i < n; i++) {
+        FieldIndexEntry *ie = field_index_put(field_index, fields[i].field, fields[i].value, fields[i].len);
+        if (!ie) continue;
+        field_index_release(field_index, ie);
+        field_index_set_key(ie, e->key);
+        e->flags |= ENTRY_INDEXED;
+    }
+    index_gauges();
+}
+
+// e se borra (DELETE, TTL o tombstone): lo que apuntaba a su valor también
+// Entradas del índice cuya lectura es raw, el valor actual de k
+static void index_drop_value(const InternKey *k, const char *raw, size_t len) {
+    FieldValue fields[FIELD_INDEX_FIELDS_MAX];
+    size_t n = field_index_extract(field_index, raw, len, fields);
+    for (size_t i = 0; i < n; i++) {
+        FieldIndexEntry *ie = field_index_find(field_index, fields[i].field, fields[i].value, fields[i].len);
+        if (ie && ie->key == k && !ie->reading) field_index_remove(field_index, ie);
+    }
+    index_gauges();
+}
+
+static void index_drop(Entry *e) {
+    if (!field_index || !(e->flags & ENTRY_INDEXED)) return;
+    char raw[VALUE_MAX];
+    int len = entry_value(e, raw, sizeof(raw));
+    if (len < 0) return;
+    index_drop_value(e->key, raw, (size_t)len);
+}
+
+static void index_drop_kept(FieldIndexEntry *ie, void *ctx) {
+    if (ie->reading && ie->key == (const InternKey *)ctx) field_index_remove(field_index, ie);
+}
+
+static void index_drop_current(FieldIndexEntry *ie, void *ctx) {
+    if (!ie->reading && ie->key == (const InternKey *)ctx) field_index_remove(field_index, ie);
+}
+
+static int kept_expired(const FieldIndexEntry *ie, uint64_t now_ms) {
+    return ie->reading && ie->expires_ms > 0 && ie->expires_ms <= now_ms;
+}
+
+// Registro STORE_REC_INDEXED del log: la lectura vuelve al índice salvo que
+// un valor ya cargado la haya reemplazado
+static void index_load(const InternKey *k, const StoreRecord *rec) {
+    if (!field_index || !k || (rec->expires_ms > 0 && rec->expires_ms <= wall_ms())) return;
+    char raw[VALUE_MAX];
+    int compressed = rec->value_len > 0 && rec->value[0] == JSON_DICT_MARK;
+    int len = compressed ? json_dict_decode(rec->value, rec->value_len, raw, sizeof(raw)) : (int)rec->value_len;
+    if (len < 0) return;
+    FieldValue fields[FIELD_INDEX_FIELDS_MAX];
+    size_t n = field_index_extract(field_index, compressed ? raw : rec->value, (size_t)len, fields);
+    for (size_t i = 0; i < n; i++) {
+        FieldIndexEntry *ie = field_index_find(field_index, fields[i].field, fields[i].value, fields[i].len);
+        if (ie && !ie->reading) continue;
+        if (!ie) ie = field_index_put(field_index, fields[i].field, fields[i].value, fields[i].len);
+        if (!ie) continue;
+        field_index_set_key(ie, k);
+        if (field_index_keep(field_index, ie, rec->value, rec->value_len, compressed, rec->expires_ms) != 0) {
+            field_index_remove(field_index, ie);
+        }
+    }
+    index_gauges();
+}
+
+// Registro del último valor de k, ya codificado, con su vencimiento. Sin
+// stdio: lo usa el hijo del snapshot.
+static size_t encode_value(char *out, size_t cap, const InternKey *k, const char *value, size_t len,
+                           uint32_t flags, uint32_t version) {
+    const TtlTimer *t = (flags & ENTRY_TTL) ? ttl_find(k) : NULL;
+    StoreRecord rec = {
+        .type = STORE_REC_VALUE,
+        .flags = (flags & ENTRY_PINNED) ? STORE_REC_PINNED : 0,
+        .version = version,
+        .timestamp_ms = wall_ms(),
+        .expires_ms = t ? t->expires_ms : 0,
+        .key = k->str,
+        .key_len = k->len,
+        .value = value,
+        .value_len = len,
+    };
+    return store_log_encode(out, cap, &rec);
+}
+
+static size_t encode_template(char *out, size_t cap, uint32_t id, const char *tmpl) {
+    StoreRecord rec = {
+        .type = STORE_REC_TEMPLATE,
+        .version = id,
+        .timestamp_ms = wall_ms(),
+        .value = tmpl,
+        .value_len = strlen(tmpl),
+    };
+    return store_log_encode(out, cap, &rec);
+}
+
+// Registros de un valor para el log actual: su plantilla si todavía no se
+// escribió y el valor. out tiene ENTRY_RECORDS_MAX bytes.
+static size_t encode_entry(char *out, const InternKey *k, const char *value, size_t len,
+                           uint32_t flags, uint32_t version) {
+    size_t n = 0;
+    int id;
+    const char *tmpl = pending_template(value, len, flags, &id);
+    if (tmpl) n = encode_template(out, ENTRY_RECORDS_MAX, (uint32_t)id, tmpl);
+    return n + encode_value(out + n, ENTRY_RECORDS_MAX - n, k, value, len, flags, version);
+}
+
+// Registro de una lectura que solo guarda el índice (sin su plantilla)
+static size_t encode_kept(char *out, size_t cap, const FieldIndexEntry *ie) {
+    StoreRecord rec = {
+        .type = STORE_REC_INDEXED,
+        .timestamp_ms = wall_ms(),
+        .expires_ms = ie->expires_ms,
+        .key = ie->key->str,
+        .key_len = ie->key->len,
+        .value = ie->reading,
+        .value_len = ie->reading_len,
+    };
+    return store_log_encode(out, cap, &rec);
+}
+
+// Saca la entrada de memoria (borrado o desalojo: el TTL sigue en pie)
+static void unlink_entry(Entry *e) {
+    Entry **pp = &index_buckets[e->key->hash & index_mask];
+    while (*pp && *pp != e) pp = &(*pp)->next;
+    if (*pp) *pp = e->next;
+    resident_bytes -= entry_bytes(e);
+    metrics_gauge_set(METRIC_GAUGE_RESIDENT_BYTES, (long)resident_bytes);
+    metrics_gauge_add(METRIC_GAUGE_STORE_BYTES, -(long)e->len);
+    release_value(e);
+    slab_free(e);
+    entry_count--;
+    metrics_gauge_add(METRIC_GAUGE_STORE_ENTRIES, -1);
+}
+
+static void remove_entry(Entry *e) {
+    const InternKey *k = e->key;
+    index_drop(e);
+    ttl_clear(e);
+    unlink_entry(e);
+    key_order_remove(k);
+}
+
+// CLOCK: una entrada con el bit de referencia lo pierde y se salva por una
+// vuelta; sin él se desaloja. Las sucias (coalescing) esperan al flush. Los
+// desalojos van en lotes: un pwrite por lote.
+static void evict_to_budget(const Entry *protect) {
+    if (memory_budget == 0 || resident_bytes <= memory_budget || !index_buckets) return;
+    if (!cold_store) {
+        if (!store_file[0]) return;
+        char path[sizeof(store_file) + 8];
+        snprintf(path, sizeof(path), "%s.cold", store_file);
+        cold_store = cold_store_create(path);
+        if (!cold_store) {
+            printf("DATA_STORE: ERROR - No se pudo crear el cold store %s\n", path);
+            memory_budget = 0;
+            return;
+        }
+    }
+    // Se baja a 15/16 del presupuesto para no desalojar en cada escritura
+    size_t target = memory_budget - memory_budget / 16;
+    while (resident_bytes > target) {
+        Entry *victims[256];
+        size_t n = 0, freed = 0;
+        size_t steps = 2 * (index_mask + 1);
+        for (; steps > 0 && n < 256 && resident_bytes - freed > target; steps--) {
+            int full = 0;
+            for (Entry *e = index_buckets[clock_hand & index_mask]; e && n < 256; e = e->next) {
+                if (e == protect || (e->flags & (ENTRY_DIRTY | ENTRY_EVICTING))) continue;
+                if (e->flags & ENTRY_REF) {
+                    e->flags &= ~ENTRY_REF;
+                    continue;
+                }
+                // Lo cargado sin vencimiento toma el de su ruta antes de irse:
+                // al final de la carga solo se recorre lo que quedó en memoria
+                if (ttl_route_count > 0 && !(e->flags & (ENTRY_TTL | ENTRY_PINNED))) apply_ttl(e, -1);
+                ColdMeta meta = {e->version, e->len, (uint16_t)(e->flags & ENTRY_COLD_FLAGS)};
+                if (cold_store_stage(cold_store, e->key, e->value, e->len, &meta) != 0) {
+                    // Con el lote vacío es un registro que no entra: queda en memoria
+                    if (n == 0) continue;
+                    full = 1;
+                    break;
+                }
+                e->flags |= ENTRY_EVICTING;
+                victims[n++] = e;
+                freed += entry_bytes(e);
+            }
+            if (full) break;
+            clock_hand++;
+        }
+        if (n == 0) break;
+        if (cold_store_commit(cold_store) != 0) {
+            for (size_t i = 0; i < n; i++) victims[i]->flags &= ~ENTRY_EVICTING;
+            printf("DATA_STORE: ERROR - No se pudo escribir el cold store\n");
+            break;
+        }
+        for (size_t i = 0; i < n; i++) unlink_entry(victims[i]);
+        metrics_add(METRIC_STORE_EVICTIONS, n);
+        metrics_gauge_set(METRIC_GAUGE_COLD_KEYS, (long)cold_store_count(cold_store));
+    }
+}
+
+static void rewrite_cold(const InternKey *k, const char *value, size_t len, const ColdMeta *meta, void *ctx) {
+    char rec[ENTRY_RECORDS_MAX];
+    fwrite(rec, 1, encode_entry(rec, k, value, len, meta->flags, meta->version), (FILE *)ctx);
+}
+
+// Las lecturas guardadas en el índice van antes que los valores: al cargar,
+// un valor de la misma clave y el mismo dispositivo las reemplaza
+static void rewrite_kept(FieldIndexEntry *ie, void *ctx) {
+    if (!ie->reading) return;
+    if (kept_expired(ie, wall_ms())) {
+        field_index_remove(field_index, ie);
+        return;
+    }
+    char rec[ENTRY_RECORDS_MAX];
+    size_t n = 0;
+    int id;
+    const char *tmpl = pending_template(ie->reading, ie->reading_len, ie->compressed ? ENTRY_COMPRESSED : 0, &id);
+    if (tmpl) n = encode_template(rec, sizeof(rec), (uint32_t)id, tmpl);
+    n += encode_kept(rec + n, sizeof(rec) - n, ie);
+    fwrite(rec, 1, n, (FILE *)ctx);
+}
+
+// Reescribe el log con el estado actual en un .tmp que reemplaza al archivo
+// solo si quedó completo
+static int rewrite_file(void) {
+    if (!store_file[0]) return -1;
+    char tmp[sizeof(store_file) + 8];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", store_file);
+    FILE *f = fopen(tmp, "wb");
+    if (!f) return -1;
+    json_dict_clear_persisted();
+    fwrite(STORE_LOG_MAGIC, 1, STORE_LOG_MAGIC_LEN, f);
+    if (field_index) {
+        field_index_scan(field_index, rewrite_kept, f);
+        index_gauges();
+    }
+    char rec[ENTRY_RECORDS_MAX];
+    for (size_t b = 0; index_buckets && b <= index_mask; b++) {
+        for (Entry *e = index_buckets[b]; e; e = e->next) {
+            fwrite(rec, 1, encode_entry(rec, e->key, e->value, e->len, e->flags, e->version), f);
+        }
+    }
+    if (cold_store && cold_store_scan(cold_store, rewrite_cold, f) > 0) {
+        printf("DATA_STORE: ERROR - Claves del cold store que no se pudieron leer\n");
+    }
+    int ok = !ferror(f);
+    ok = fclose(f) == 0 && ok;
+    if (!ok || rename(tmp, store_file) != 0) {
+        printf("DATA_STORE: ERROR - No se pudo reescribir '%s'\n", store_file);
+        unlink(tmp);
+        return -1;
+    }
+    // El log nuevo ya lleva el valor actual de las claves pendientes
+    for (size_t i = 0; i < dirty_count; i++) {
+        Entry *e = find_entry(dirty_keys[i]);
+        if (e) e->flags &= ~ENTRY_DIRTY;
+        intern_release(dirty_keys[i]);
+    }
+    dirty_count = 0;
+    return 0;
+}
+
+// Log de texto de la versión original: "clave\tvalor" por línea, sin
+// compresión ni vencimientos. Se carga una vez para convertirlo a binario.
+static void load_text(FILE *f) {
+    char line[1024];
+    while (fgets(line, sizeof(line), f)) {
+        char *tab = strchr(line, '\t');
+        if (!tab) continue;
+        *tab = '\0';
+        char *val = tab + 1;
+        size_t L = strlen(val);
+        if (L > 0 && (val[L-1] == '\n' || val[L-1] == '\r')) val[L-1] = '\0';
+        pthread_mutex_lock(&store_mutex);
+        set_in_memory(line, val);
+        pthread_mutex_unlock(&store_mutex);
+    }
+}
+
+// Copia lo que sigue a offset en <store>.corrupt y trunca el log ahí
+static void truncate_tail(uint64_t offset) {
+    FILE *f = fopen(store_file, "rb");
     if (!f) return;
-    for (Entry *e = head; e; e = e->next) {
-        fprintf(f, "%s\t%s\n", e->key, e->value);
+    char path[sizeof(store_file) + 16];
+    snprintf(path, sizeof(path), "%s.corrupt", store_file);
+    FILE *out = fopen(path, "wb");
+    uint64_t dropped = 0;
+    if (fseeko(f, (off_t)offset, SEEK_SET) == 0) {
+        char buf[64 * 1024];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+            if (out) fwrite(buf, 1, n, out);
+            dropped += n;
+        }
     }
     fclose(f);
+    if (out) fclose(out);
+    if (truncate(store_file, (off_t)offset) != 0) {
+        printf("DATA_STORE_INIT: ERROR - No se pudo truncar %s\n", store_file);
+        return;
+    }
+    printf("DATA_STORE_INIT: Registro cortado o corrupto en el byte %llu de %s; se descartaron %llu bytes (copia en %s)\n",
+           (unsigned long long)offset, store_file, (unsigned long long)dropped, path);
+}
+
+// Recorre los registros en orden. Devuelve el offset del primer registro
+// inválido o 0 si el archivo terminó bien.
+static uint64_t load_binary(StoreLogReader *rd) {
+    StoreRecord rec;
+    int r;
+    while ((r = store_log_read(rd, &rec)) == 1) {
+        pthread_mutex_lock(&store_mutex);
+        if (rec.type == STORE_REC_TEMPLATE) {
+            if (json_dict_define(rec.version, rec.value, rec.value_len) != 0) {
+                printf("DATA_STORE_INIT: Plantilla inválida @%u\n", (unsigned)rec.version);
+            }
+        } else {
+            char key[STORE_LOG_KEY_MAX + 1];
+            memcpy(key, rec.key, rec.key_len);
+            key[rec.key_len] = '\0';
+            if (rec.type == STORE_REC_TOMBSTONE) {
+                Entry *e = lookup_entry(intern_lookup(key, rec.key_len));
+                if (e) remove_entry(e);
+            } else if (rec.type == STORE_REC_INDEXED) {
+                const InternKey *k = intern_get(key, rec.key_len);
+                index_load(k, &rec);
+                intern_release(k);
+            } else {
+                Entry *e;
+                if (rec.value[0] == JSON_DICT_MARK) {
+                    char raw[VALUE_MAX];
+                    e = json_dict_decode(rec.value, rec.value_len, raw, sizeof(raw)) >= 0 ? set_in_memory(key, raw) : NULL;
+                    if (!e) printf("DATA_STORE_INIT: Valor comprimido ilegible para %s\n", key);
+                } else {
+                    e = set_in_memory(key, rec.value);
+                }
+                if (e) {
+                    // El vencimiento viene en el mismo registro
+                    ttl_clear(e);
+                    e->flags &= ~ENTRY_PINNED;
+                    if (rec.expires_ms > 0) ttl_set(e, rec.expires_ms);
+                    else if (rec.flags & STORE_REC_PINNED) e->flags |= ENTRY_PINNED;
+                    if (rec.version > 0) e->version = rec.version;
+                }
+            }
+        }
+        pthread_mutex_unlock(&store_mutex);
+    }
+    return r < 0 ? rd->offset : 0;
 }
 
 int data_store_init(const char *filepath) {
@@ -55,10 +890,11 @@ int data_store_init(const char *filepath) {
     strncpy(store_file, filepath, sizeof(store_file)-1);
     store_file[sizeof(store_file)-1] = '\0';
 
-    FILE *f = fopen(store_file, "r");
+    FILE *f = fopen(store_file, "rb");
     if (!f) {
-        f = fopen(store_file, "w");
+        f = fopen(store_file, "wb");
         if (f) {
+            fwrite(STORE_LOG_MAGIC, 1, STORE_LOG_MAGIC_LEN, f);
             fclose(f);
             printf("DATA_STORE_INIT: Archivo creado: %s\n", store_file);
         } else {
@@ -69,37 +905,87 @@ int data_store_init(const char *filepath) {
         return 0;
     }
     printf("DATA_STORE_INIT: Archivo existente: %s\n", store_file);
-    char line[1024];
-    while (fgets(line, sizeof(line), f)) {
-        char *tab = strchr(line, '\t');
-        if (!tab) continue;
-        *tab = '\0';
-        char *key = line;
-        char *val = tab + 1;
-        size_t L = strlen(val);
-        if (L > 0 && (val[L-1] == '\n' || val[L-1] == '\r')) val[L-1] = '\0';
-        pthread_mutex_lock(&store_mutex);
-        set_in_memory(key, val);
-        pthread_mutex_unlock(&store_mutex);
+    StoreLogReader *rd = malloc(sizeof(StoreLogReader));
+    if (!rd) {
+        fclose(f);
+        return -1;
     }
-    fclose(f);
+    if (store_log_open(rd, f)) {
+        uint64_t bad = load_binary(rd);
+        fclose(f);
+        if (bad > 0) truncate_tail(bad);
+    } else {
+        // Texto (o vacío): se carga y se convierte; el original queda en .txt
+        int empty = fgetc(f) == EOF;
+        rewind(f);
+        load_text(f);
+        fclose(f);
+        char txt[sizeof(store_file) + 8];
+        snprintf(txt, sizeof(txt), "%s.txt", store_file);
+        if (!empty && rename(store_file, txt) != 0) {
+            printf("DATA_STORE_INIT: ERROR - No se pudo renombrar %s\n", store_file);
+        } else {
+            pthread_mutex_lock(&store_mutex);
+            int rc = rewrite_file();
+            pthread_mutex_unlock(&store_mutex);
+            if (rc != 0 && !empty) rename(txt, store_file);
+            else if (!empty) printf("DATA_STORE_INIT: Log de texto convertido a binario (original en %s)\n", txt);
+        }
+    }
+    free(rd);
+    // Lo que no trae vencimiento propio toma el de su ruta desde ahora
+    pthread_mutex_lock(&store_mutex);
+    for (size_t b = 0; ttl_route_count > 0 && index_buckets && b <= index_mask; b++) {
+        for (Entry *e = index_buckets[b]; e; e = e->next) {
+            if (!(e->flags & (ENTRY_TTL | ENTRY_PINNED))) apply_ttl(e, -1);
+        }
+    }
+    pthread_mutex_unlock(&store_mutex);
     return 0;
 }
 
 int data_store_set(const char *uri_path, const char *json_payload) {
+    return data_store_set_with_ttl(uri_path, json_payload, DATA_STORE_TTL_ROUTE);
+}
+
+int data_store_set_with_ttl(const char *uri_path, const char *json_payload, int ttl_s) {
     if (!uri_path || !json_payload) return -1;
-    
+    uint64_t t0 = metrics_now_ns();
+    tracer_span_begin("data_store_set");
+
+    tracer_span_begin("store_mutex wait");
     pthread_mutex_lock(&store_mutex);
-    set_in_memory(uri_path, json_payload);
-    
-    if (store_file[0]) {
-        FILE *f = fopen(store_file, "a");
+    tracer_span_end();
+    Entry *e = coalesce_ms > 0 && dirty_reserve() != 0 ? NULL : set_in_memory(uri_path, json_payload);
+    if (!e) {
+        pthread_mutex_unlock(&store_mutex);
+        tracer_span_end();
+        printf("DATA_STORE: ERROR - No se pudo guardar %s (%zu bytes)\n", uri_path, strlen(json_payload));
+        return -1;
+    }
+    // Cada escritura reinicia el TTL: expiran las claves que dejan de escribirse
+    if (ttl_s >= 0 || (e->flags & (ENTRY_TTL | ENTRY_PINNED)) || ttl_route_count > 0) apply_ttl(e, ttl_s);
+    size_t payload_len = strlen(json_payload);
+    if (shared_table) shm_table_publish(shared_table, e->key->str, e->key->len, json_payload, payload_len);
+    if (change_feed) {
+        change_feed_publish(change_feed, FEED_OP_SET, e->key->str, e->key->len, json_payload, payload_len, e->version);
+    }
+
+    if (coalesce_ms > 0) {
+        // El flusher escribe el último valor de la clave
+        mark_dirty(e);
+    } else if (store_file[0]) {
+        tracer_span_begin("store append");
+        FILE *f = fopen(store_file, "ab");
         if (f) {
-            fprintf(f, "%s\t%s\n", uri_path, json_payload);
+            char rec[ENTRY_RECORDS_MAX];
+            fwrite(rec, 1, encode_entry(rec, e->key, e->value, e->len, e->flags, e->version), f);
             fflush(f);
             fclose(f);
+            tracer_span_end();
             printf("DATA_STORE: Guardado exitoso - %s -> %s\n", uri_path, json_payload);
         } else {
+            tracer_span_end();
             printf("DATA_STORE: ERROR - No se pudo abrir '%s'\n", store_file);
             perror("fopen");
         }
@@ -108,55 +994,958 @@ int data_store_set(const char *uri_path, const char *json_payload) {
     }
     
     pthread_mutex_unlock(&store_mutex);
+    metrics_inc(METRIC_STORE_WRITES);
+    metrics_observe(METRIC_HIST_STORE_SET_US, (metrics_now_ns() - t0) / 1000);
+    tracer_span_end();
     return 0;
 }
 
 int data_store_get(const char *uri_path, char *out_payload, size_t out_size) {
     if (!uri_path || !out_payload || out_size == 0) return -1;
+    tracer_span_begin("store_mutex wait");
     pthread_mutex_lock(&store_mutex);
-    const char *val = get_in_memory(uri_path);
+    tracer_span_end();
+    const InternKey *k = intern_lookup(uri_path, strlen(uri_path));
+    Entry *e = find_entry(k);
+    if (e) {
+        e->flags |= ENTRY_REF;
+        metrics_inc(METRIC_STORE_HITS);
+    } else if (k && cold_store && cold_store_contains(cold_store, k)) {
+        e = lookup_entry(k);
+        metrics_inc(METRIC_STORE_MISSES);
+    }
     int n = 0;
-    if (val) {
-        n = (int)snprintf(out_payload, out_size, "%s", val);
+    if (e) {
+        // Mismo resultado que snprintf: se trunca y se devuelve el largo completo
+        const char *value = e->value;
+        size_t len = e->len;
+        char raw[VALUE_MAX];
+        if (e->flags & ENTRY_COMPRESSED) {
+            // Se descomprime solo al leer
+            int dl = json_dict_decode(e->value, e->len, raw, sizeof(raw));
+            value = raw;
+            len = dl > 0 ? (size_t)dl : 0;
+        }
+        size_t copy = len < out_size ? len : out_size - 1;
+        memcpy(out_payload, value, copy);
+        out_payload[copy] = '\0';
+        n = (int)len;
     }
     pthread_mutex_unlock(&store_mutex);
     return n;
 }
 
+// key es uri_path o está debajo ("/sensors/temp" incluye "/sensors/temp/x")
+static int key_under(const InternKey *k, const char *uri_path, size_t len) {
+    if (k->len < len || memcmp(k->str, uri_path, len) != 0) return 0;
+    return k->len == len || k->str[len] == '/' || (len > 0 && uri_path[len - 1] == '/');
+}
+
+int data_store_get_by_field(const char *uri_path, const char *field, const char *value,
+                            char *out_payload, size_t out_size) {
+    if (!uri_path || !field || !value || !out_payload || out_size == 0) return -1;
+    tracer_span_begin("store_mutex wait");
+    pthread_mutex_lock(&store_mutex);
+    tracer_span_end();
+    int f = field_index ? field_index_field(field_index, field, strlen(field)) : -1;
+    if (f < 0) {
+        pthread_mutex_unlock(&store_mutex);
+        return -1;
+    }
+    size_t value_len = strlen(value);
+    FieldIndexEntry *ie = field_index_find(field_index, f, value, value_len);
+    if (ie && !key_under(ie->key, uri_path, strlen(uri_path))) ie = NULL;
+    char raw[VALUE_MAX];
+    int len = -1;
+    if (ie && kept_expired(ie, wall_ms())) {
+        field_index_remove(field_index, ie);
+        index_gauges();
+    } else if (ie && ie->reading) {
+        if (ie->compressed) {
+            len = json_dict_decode(ie->reading, ie->reading_len, raw, sizeof(raw));
+        } else {
+            memcpy(raw, ie->reading, ie->reading_len + 1u);
+            len = ie->reading_len;
+        }
+    } else if (ie) {
+        Entry *e = lookup_entry(ie->key);
+        if (e) {
+            e->flags |= ENTRY_REF;
+            len = entry_value(e, raw, sizeof(raw));
+        }
+        // El valor actual de la clave tiene que seguir siendo de este dispositivo
+        FieldValue fields[FIELD_INDEX_FIELDS_MAX];
+        size_t n = len >= 0 ? field_index_extract(field_index, raw, (size_t)len, fields) : 0;
+        FieldValue want = {f, value, value_len};
+        size_t i = 0;
+        while (i < n && !same_field_value(&fields[i], &want)) i++;
+        if (i == n) len = -1;
+    }
+    int n = 0;
+    if (len > 0) {
+        size_t copy = (size_t)len < out_size ? (size_t)len : out_size - 1;
+        memcpy(out_payload, raw, copy);
+        out_payload[copy] = '\0';
+        n = len;
+    }
+    pthread_mutex_unlock(&store_mutex);
+    return n;
+}
+
+// Largo del prefijo literal de pattern (hasta el primer segmento "*"), -1
+// si no tiene ninguno
+static int pattern_prefix(const char *pattern) {
+    for (const char *p = strchr(pattern, '*'); p; p = strchr(p + 1, '*')) {
+        if ((p == pattern || p[-1] == '/') && (p[1] == '/' || p[1] == '\0')) return (int)(p - pattern);
+    }
+    return -1;
+}
+
+// Un segmento "*" vale un segmento completo; al final, uno o más
+static int pattern_match(const char *pat, const char *key) {
+    const char *start = pat;
+    while (*pat) {
+        if (*pat == '*' && (pat == start || pat[-1] == '/') && (pat[1] == '/' || pat[1] == '\0')) {
+            if (pat[1] == '\0') return *key != '\0';
+            const char *slash = strchr(key, '/');
+            if (!slash || slash == key) return 0;
+            key = slash;
+            pat++;
+            continue;
+        }
+        if (*pat++ != *key++) return 0;
+    }
+    return *key == '\0';
+}
+
+// s como string JSON en out. Devuelve los bytes escritos o 0 si no entra.
+static size_t json_string(char *out, size_t cap, const char *s, size_t len) {
+    size_t n = 0;
+    if (cap < 2) return 0;
+    out[n++] = '"';
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)s[i];
+        char esc[8];
+        size_t m = 1;
+        esc[0] = (char)c;
+        if (c == '"' || c == '\\') {
+            esc[0] = '\\';
+            esc[1] = (char)c;
+            m = 2;
+        } else if (c < 0x20) {
+            m = (size_t)snprintf(esc, sizeof(esc), "\\u%04x", c);
+        }
+        if (n + m + 1 > cap) return 0;
+        memcpy(out + n, esc, m);
+        n += m;
+    }
+    out[n++] = '"';
+    return n;
+}
+
+// Valor original de k sin traerlo a memoria: un recorrido no desaloja lo
+// que se está usando
+static int scan_value(const InternKey *k, char *out, size_t cap) {
+    Entry *e = find_entry(k);
+    if (e) return entry_value(e, out, cap);
+    char value[VALUE_MAX];
+    ColdMeta meta;
+    int len = cold_store ? cold_store_read(cold_store, k, value, sizeof(value), &meta) : -1;
+    if (len < 0) return -1;
+    if (meta.flags & ENTRY_COMPRESSED) return json_dict_decode(value, (size_t)len, out, cap);
+    memcpy(out, value, (size_t)len + 1);
+    return len;
+}
+
+int data_store_get_matching(const char *pattern, const char *after, int limit, char *out, size_t out_size) {
+    static const char head[] = "{\"items\":{";
+    int plen = pattern ? pattern_prefix(pattern) : -1;
+    if (plen < 0 || !out || out_size < 64) return -1;
+    tracer_span_begin("store_mutex wait");
+    pthread_mutex_lock(&store_mutex);
+    tracer_span_end();
+    // Desde el prefijo o desde la clave siguiente al cursor, lo que esté después
+    const SkipNode *node = NULL;
+    if (key_order && after && after[0] && strncmp(after, pattern, (size_t)plen) >= 0) {
+        node = skiplist_seek(key_order, after, strlen(after));
+        if (node && strcmp(node->key->str, after) == 0) node = skiplist_next(node);
+    } else if (key_order) {
+        node = skiplist_seek(key_order, pattern, (size_t)plen);
+    }
+    size_t used = sizeof(head) - 1;
+    memcpy(out, head, used);
+    const InternKey *last = NULL;
+    size_t last_json = 0;
+    int items = 0, more = 0;
+    char item[STORE_LOG_KEY_MAX * 6 + VALUE_MAX + 4];
+    for (; node; node = skiplist_next(node)) {
+        const InternKey *k = node->key;
+        if (k->len < (size_t)plen || memcmp(k->str, pattern, (size_t)plen) != 0) break;
+        if (!pattern_match(pattern, k->str)) continue;
+        if (limit > 0 && items == limit) {
+            more = 1;
+            break;
+        }
+        size_t key_json = json_string(item, sizeof(item), k->str, k->len);
+        char raw[VALUE_MAX];
+        int len = key_json > 0 ? scan_value(k, raw, sizeof(raw)) : -1;
+        if (len < 0) continue;
+        item[key_json] = ':';
+        size_t n = key_json + 1;
+        // Cierre con el cursor: },"next":<clave>}
+        size_t close = 1 + 8 + key_json + 1 + 1;
+        if (sizeof(head) - 1 + n + (size_t)len + close > out_size) {
+            // No entra ni en una página vacía: va null y se pide con un GET
+            memcpy(item + n, "null", 4);
+            n += 4;
+        } else {
+            memcpy(item + n, raw, (size_t)len);
+            n += (size_t)len;
+        }
+        if (used + (items > 0) + n + close > out_size) {
+            // Una clave que no entra ni sola en la página se saltea
+            if (items == 0) continue;
+            more = 1;
+            break;
+        }
+        if (items > 0) out[used++] = ',';
+        memcpy(out + used, item, n);
+        used += n;
+        last = k;
+        last_json = key_json;
+        items++;
+    }
+    out[used++] = '}';
+    if (more && last) {
+        memcpy(out + used, ",\"next\":", 8);
+        used += 8;
+        used += json_string(out + used, last_json + 1, last->str, last->len);
+    }
+    out[used++] = '}';
+    out[used] = '\0';
+    pthread_mutex_unlock(&store_mutex);
+    metrics_add(METRIC_STORE_BULK_KEYS, (uint64_t)items);
+    return (int)used;
+}
+
 int data_store_delete(const char *uri_path) {
     if (!uri_path) return -1;
+    // file_mutex: que un flush en curso no vuelva a escribir la clave borrada
+    pthread_mutex_lock(&file_mutex);
     pthread_mutex_lock(&store_mutex);
-    Entry *prev = NULL, *cur = head;
-    int removed = 0;
-    while (cur) {
-        if (strcmp(cur->key, uri_path) == 0) {
-            if (prev) prev->next = cur->next; else head = cur->next;
-            free(cur->key);
-            free(cur->value);
-            free(cur);
-            removed = 1;
-            break;
+    Entry *e = lookup_entry(intern_lookup(uri_path, strlen(uri_path)));
+    if (e) {
+        if (shared_table) shm_table_remove(shared_table, e->key->str, e->key->len);
+        if (change_feed) {
+            change_feed_publish(change_feed, FEED_OP_DELETE, e->key->str, e->key->len, NULL, 0, e->version + 1);
+        }
+        // Con la clave se van las lecturas de otros dispositivos que guardaba el índice
+        if (field_index) field_index_scan(field_index, index_drop_kept, (void *)e->key);
+        remove_entry(e);
+        rewrite_file();
+    }
+    pthread_mutex_unlock(&store_mutex);
+    pthread_mutex_unlock(&file_mutex);
+    return 0;
+}
+
+// Escribe un registro por clave pendiente. Los valores se copian con
+// store_mutex y la escritura al archivo se hace sin él. Una clave deja de
+// estar pendiente solo si su registro quedó en el buffer: si no se puede
+// abrir el log o agrandar el buffer, el resto espera al próximo flush.
+static void flush_dirty(void) {
+    pthread_mutex_lock(&file_mutex);
+    pthread_mutex_lock(&store_mutex);
+    FILE *f = NULL;
+    if (dirty_count > 0 && store_file[0]) {
+        f = fopen(store_file, "ab");
+        if (!f) {
+            pthread_mutex_unlock(&store_mutex);
+            pthread_mutex_unlock(&file_mutex);
+            printf("DATA_STORE: ERROR - No se pudo abrir '%s'\n", store_file);
+            return;
         }
-        prev = cur;
-        cur = cur->next;
     }
-    if (removed) rewrite_file();
+    size_t size = 0, used = 0, done = 0;
+    char *buf = NULL;
+    for (; done < dirty_count; done++) {
+        const InternKey *k = dirty_keys[done];
+        Entry *e = find_entry(k);
+        if (e && (e->flags & ENTRY_DIRTY)) {
+            if (f) {
+                size_t need = ENTRY_RECORDS_MAX;
+                if (used + need > size) {
+                    size_t ns = size ? size * 2 : 64 * 1024;
+                    while (ns < used + need) ns *= 2;
+                    char *nb = realloc(buf, ns);
+                    if (!nb) break;
+                    buf = nb;
+                    size = ns;
+                }
+                used += encode_entry(buf + used, e->key, e->value, e->len, e->flags, e->version);
+            }
+            e->flags &= ~ENTRY_DIRTY;
+        }
+        intern_release(k);
+    }
+    if (done > 0) {
+        dirty_count -= done;
+        memmove(dirty_keys, dirty_keys + done, dirty_count * sizeof(*dirty_keys));
+    }
+    pthread_mutex_unlock(&store_mutex);
+
+    if (f) {
+        if (used > 0) fwrite(buf, 1, used, f);
+        fclose(f);
+    }
+    pthread_mutex_unlock(&file_mutex);
+    free(buf);
+}
+
+static void *flusher_main(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&file_mutex);
+    while (flusher_running) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += coalesce_ms / 1000;
+        deadline.tv_nsec += (long)(coalesce_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&flusher_cond, &file_mutex, &deadline);
+        pthread_mutex_unlock(&file_mutex);
+        flush_dirty();
+        pthread_mutex_lock(&file_mutex);
+    }
+    pthread_mutex_unlock(&file_mutex);
+    return NULL;
+}
+
+typedef struct {
+    char *buf;
+    size_t used;
+    size_t size;
+} Tombstones;
+
+// Saca una clave fría del índice por campo sin traerla a memoria
+static void index_drop_cold(const InternKey *k) {
+    if (!field_index) return;
+    char raw[VALUE_MAX];
+    int len = scan_value(k, raw, sizeof(raw));
+    if (len >= 0) index_drop_value(k, raw, (size_t)len);
+    else field_index_scan(field_index, index_drop_current, (void *)k);
+}
+
+// Con file_mutex y store_mutex tomados (desde la rueda). El timer siempre
+// se libera o se vuelve a armar, y la clave se borra solo con su tombstone
+// ya en el lote: sin él volvería al reproducir el log.
+static void on_ttl_expired(TimerEntry *timer, void *ctx) {
+    TtlTimer *t = (TtlTimer *)timer;
+    Tombstones *tb = (Tombstones *)ctx;
+    const InternKey *k = t->key;
+    Entry *e = find_entry(k);
+    ColdMeta meta;
+    if (!e && !(cold_store && cold_store_meta(cold_store, k, &meta))) {
+        ttl_forget(k);
+        return;
+    }
+    size_t need = store_log_record_size(k->len, 0);
+    if (tb->used + need > tb->size) {
+        size_t ns = tb->size ? tb->size * 2 : 16 * 1024;
+        while (ns < tb->used + need) ns *= 2;
+        char *nb = realloc(tb->buf, ns);
+        if (!nb) {
+            // Se reintenta en el próximo tick
+            timer_hwheel_add(&ttl_wheel, &t->timer, metrics_now_ns() / 1000000 + TTL_TICK_MS);
+            return;
+        }
+        tb->buf = nb;
+        tb->size = ns;
+    }
+    uint32_t version = (e ? e->version : meta.version) + 1;
+    if (shared_table) shm_table_remove(shared_table, k->str, k->len);
+    if (change_feed) change_feed_publish(change_feed, FEED_OP_DELETE, k->str, k->len, NULL, 0, version);
+    StoreRecord rec = {
+        .type = STORE_REC_TOMBSTONE,
+        .version = version,
+        .timestamp_ms = wall_ms(),
+        .key = k->str,
+        .key_len = k->len,
+    };
+    tb->used += store_log_encode(tb->buf + tb->used, tb->size - tb->used, &rec);
+    if (e) {
+        remove_entry(e);
+    } else {
+        // Fría: se borra del cold store sin volver a memoria
+        if (meta.flags & ENTRY_INDEXED) index_drop_cold(k);
+        cold_store_take(cold_store, k, NULL);
+        metrics_gauge_add(METRIC_GAUGE_COLD_KEYS, -1);
+        ttl_forget(k);
+        key_order_remove(k);
+    }
+    metrics_inc(METRIC_STORE_EXPIRED);
+}
+
+// Un tick de la rueda: borra lo vencido y agrega sus tombstones al log. El
+// append va con store_mutex, como en data_store_set, para que un valor nuevo
+// de la misma clave no quede antes de su tombstone.
+static void expire_due(void) {
+    pthread_mutex_lock(&file_mutex);
+    pthread_mutex_lock(&store_mutex);
+    Tombstones tb = {NULL, 0, 0};
+    int expired = 0;
+    if (ttl_wheel_ready) {
+        expired = timer_hwheel_advance(&ttl_wheel, metrics_now_ns() / 1000000, on_ttl_expired, &tb);
+    }
+    if (tb.used > 0 && store_file[0]) {
+        FILE *f = fopen(store_file, "ab");
+        if (f) {
+            fwrite(tb.buf, 1, tb.used, f);
+            fclose(f);
+        } else {
+            printf("DATA_STORE: ERROR - No se pudo abrir '%s'\n", store_file);
+        }
+    }
+    pthread_mutex_unlock(&store_mutex);
+    pthread_mutex_unlock(&file_mutex);
+    free(tb.buf);
+    if (expired > 0) printf("DATA_STORE: %d claves expiradas\n", expired);
+}
+
+static void *expirer_main(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&expirer_mutex);
+    while (expirer_running) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += TTL_TICK_MS / 1000;
+        pthread_cond_timedwait(&expirer_cond, &expirer_mutex, &deadline);
+        if (!expirer_running) break;
+        pthread_mutex_unlock(&expirer_mutex);
+        expire_due();
+        pthread_mutex_lock(&expirer_mutex);
+    }
+    pthread_mutex_unlock(&expirer_mutex);
+    return NULL;
+}
+
+// Con store_mutex: se arranca con el primer TTL
+static void expirer_start(void) {
+    pthread_mutex_lock(&expirer_mutex);
+    if (!expirer_running) {
+        expirer_running = 1;
+        if (pthread_create(&expirer_thread, NULL, expirer_main, NULL) != 0) {
+            expirer_running = 0;
+            printf("DATA_STORE: ERROR - No se pudo iniciar el thread de expiración\n");
+        }
+    }
+    pthread_mutex_unlock(&expirer_mutex);
+}
+
+static void expirer_stop(void) {
+    pthread_mutex_lock(&expirer_mutex);
+    int was_running = expirer_running;
+    expirer_running = 0;
+    pthread_cond_signal(&expirer_cond);
+    pthread_mutex_unlock(&expirer_mutex);
+    if (was_running) pthread_join(expirer_thread, NULL);
+}
+
+int data_store_set_route_ttl(const char *prefix, int ttl_s) {
+    if (!prefix || strlen(prefix) >= sizeof(ttl_routes[0].prefix)) return -1;
+    pthread_mutex_lock(&store_mutex);
+    int i = 0;
+    while (i < ttl_route_count && strcmp(ttl_routes[i].prefix, prefix) != 0) i++;
+    if (i == TTL_ROUTES_MAX) {
+        pthread_mutex_unlock(&store_mutex);
+        return -1;
+    }
+    if (i == ttl_route_count) {
+        strcpy(ttl_routes[i].prefix, prefix);
+        ttl_routes[i].len = strlen(prefix);
+        ttl_route_count++;
+    }
+    ttl_routes[i].ttl_s = ttl_s > 0 ? ttl_s : 0;
+    pthread_mutex_unlock(&store_mutex);
+    return 0;
+}
+
+int data_store_set_memory_budget(size_t bytes) {
+    pthread_mutex_lock(&store_mutex);
+    memory_budget = bytes;
+    pthread_mutex_unlock(&store_mutex);
+    return 0;
+}
+
+int data_store_set_index_fields(const char *fields) {
+    FieldIndex *fi = fields && fields[0] ? field_index_create(fields) : NULL;
+    if (fields && fields[0] && !fi) {
+        printf("DATA_STORE: ERROR - Campos a indexar inválidos: %s\n", fields);
+        return -1;
+    }
+    pthread_mutex_lock(&store_mutex);
+    FieldIndex *old = field_index;
+    field_index = fi;
+    index_gauges();
     pthread_mutex_unlock(&store_mutex);
+    field_index_destroy(old);
     return 0;
 }
 
+int data_store_set_compression(int enabled) {
+    pthread_mutex_lock(&store_mutex);
+    compress_values = enabled ? 1 : 0;
+    pthread_mutex_unlock(&store_mutex);
+    return 0;
+}
+
+int data_store_set_coalescing(int interval_ms) {
+    if (interval_ms <= 0 || flusher_running) return interval_ms <= 0 ? 0 : -1;
+    coalesce_ms = interval_ms;
+    flusher_running = 1;
+    if (pthread_create(&flusher_thread, NULL, flusher_main, NULL) != 0) {
+        flusher_running = 0;
+        coalesce_ms = 0;
+        return -1;
+    }
+    return 0;
+}
+
+static void publish_cold(const InternKey *k, const char *value, size_t len, const ColdMeta *meta, void *ctx) {
+    size_t *skipped = (size_t *)ctx;
+    char raw[VALUE_MAX];
+    int n = (int)len;
+    if (meta->flags & ENTRY_COMPRESSED) {
+        n = json_dict_decode(value, len, raw, sizeof(raw));
+        value = raw;
+    }
+    if (n < 0 || shm_table_publish(shared_table, k->str, k->len, value, (size_t)n) != 0) (*skipped)++;
+}
+
+int data_store_set_shared_table(const char *name, unsigned slots) {
+    pthread_mutex_lock(&store_mutex);
+    if (shared_table) {
+        shm_table_close(shared_table, 1);
+        shared_table = NULL;
+    }
+    if (!name || !name[0]) {
+        pthread_mutex_unlock(&store_mutex);
+        return 0;
+    }
+    shared_table = shm_table_create(name, slots);
+    if (!shared_table) {
+        pthread_mutex_unlock(&store_mutex);
+        printf("DATA_STORE: ERROR - No se pudo crear la tabla compartida %s\n", name);
+        return -1;
+    }
+    // Lo que ya estaba cargado (del archivo o de escrituras previas)
+    size_t skipped = 0;
+    for (size_t b = 0; index_buckets && b <= index_mask; b++) {
+        for (Entry *e = index_buckets[b]; e; e = e->next) {
+            char raw[VALUE_MAX];
+            int len = entry_value(e, raw, sizeof(raw));
+            if (len < 0 || shm_table_publish(shared_table, e->key->str, e->key->len, raw, (size_t)len) != 0) skipped++;
+        }
+    }
+    if (cold_store) {
+        size_t failed = cold_store_scan(cold_store, publish_cold, &skipped);
+        skipped += failed;
+    }
+    pthread_mutex_unlock(&store_mutex);
+    if (skipped > 0) {
+        printf("DATA_STORE: %zu claves no entran en la tabla compartida %s\n", skipped, name);
+    }
+    return 0;
+}
+
+int data_store_set_change_feed(const char *path, size_t ring_bytes) {
+    // Se crea fuera del lock: el thread del feed no toca el data store
+    ChangeFeed *feed = path && path[0] ? change_feed_create(path, ring_bytes) : NULL;
+    if (path && path[0] && !feed) {
+        printf("DATA_STORE: ERROR - No se pudo abrir el change feed en %s\n", path);
+        return -1;
+    }
+    pthread_mutex_lock(&store_mutex);
+    ChangeFeed *old = change_feed;
+    change_feed = feed;
+    pthread_mutex_unlock(&store_mutex);
+    change_feed_destroy(old);
+    return 0;
+}
+
+// Lo que el hijo le manda al padre por el pipe al terminar
+typedef struct {
+    int ok;
+    uint64_t entries;
+    uint64_t bytes;
+    uint64_t write_us;
+    uint64_t cow_kb;
+} SnapshotReport;
+
+static int write_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// Páginas que dejaron de compartirse con el padre desde el fork (las que
+// alguno de los dos escribió), en KiB. 0 si el kernel no lo informa.
+static uint64_t private_dirty_kb(void) {
+    int fd = open("/proc/self/smaps_rollup", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return 0;
+    char buf[4096];
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0) return 0;
+    buf[n] = '\0';
+    const char *p = strstr(buf, "Private_Dirty:");
+    if (!p) return 0;
+    p += strlen("Private_Dirty:");
+    while (*p == ' ') p++;
+    uint64_t kb = 0;
+    while (*p >= '0' && *p <= '9') kb = kb * 10 + (uint64_t)(*p++ - '0');
+    return kb;
+}
+
+// Buffer de escritura del hijo: se vacía con write_all cuando no entra un
+// registro más
+typedef struct {
+    int fd;
+    int ok;
+    size_t used;
+    SnapshotReport *report;
+    char buf[64 * 1024];
+} SnapshotWriter;
+
+static char *snapshot_reserve(SnapshotWriter *w, size_t need) {
+    if (w->used + need > sizeof(w->buf)) {
+        w->ok = w->ok && write_all(w->fd, w->buf, w->used) == 0;
+        w->report->bytes += w->used;
+        w->used = 0;
+    }
+    return w->ok ? w->buf + w->used : NULL;
+}
+
+static void snapshot_entry(SnapshotWriter *w, const InternKey *k, const char *value, size_t len,
+                           uint32_t flags, uint32_t version) {
+    char *p = snapshot_reserve(w, VALUE_RECORD_MAX);
+    if (!p) return;
+    w->used += encode_value(p, VALUE_RECORD_MAX, k, value, len, flags, version);
+    w->report->entries++;
+}
+
+static void snapshot_cold(const InternKey *k, const char *value, size_t len, const ColdMeta *meta, void *ctx) {
+    snapshot_entry((SnapshotWriter *)ctx, k, value, len, meta->flags, meta->version);
+}
+
+static void snapshot_kept(FieldIndexEntry *ie, void *ctx) {
+    SnapshotWriter *w = (SnapshotWriter *)ctx;
+    if (!ie->reading || kept_expired(ie, wall_ms())) return;
+    char *p = snapshot_reserve(w, VALUE_RECORD_MAX);
+    if (!p) return;
+    w->used += encode_kept(p, VALUE_RECORD_MAX, ie);
+}
+
+// Proceso hijo: único thread, con la copia de store_mutex tomada. Solo usa
+// syscalls y las estructuras del store (nada de stdio ni de otros locks,
+// que otro thread del padre podía tener tomados en el momento del fork).
+static void snapshot_child(int report_fd, const char *path) {
+    uint64_t t0 = metrics_now_ns();
+    SnapshotReport r;
+    memset(&r, 0, sizeof(r));
+    char tmp[sizeof(snapshot_file) + 8];
+    size_t plen = strlen(path);
+    memcpy(tmp, path, plen);
+    memcpy(tmp + plen, ".tmp", 5);
+
+    // Estático: el hijo tiene su propia copia y no agranda la pila
+    static SnapshotWriter w;
+    w.fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    w.ok = w.fd >= 0;
+    w.report = &r;
+    memcpy(w.buf, STORE_LOG_MAGIC, STORE_LOG_MAGIC_LEN);
+    w.used = STORE_LOG_MAGIC_LEN;
+    // Primero todo el diccionario, para que el archivo se cargue solo
+    for (uint32_t id = 1; w.ok && id < JSON_DICT_MAX; id++) {
+        const char *tmpl = json_dict_template(id);
+        if (!tmpl) continue;
+        size_t need = store_log_record_size(0, VALUE_MAX);
+        char *p = snapshot_reserve(&w, need);
+        if (!p) break;
+        w.used += encode_template(p, need, id, tmpl);
+    }
+    if (w.ok && field_index) field_index_scan(field_index, snapshot_kept, &w);
+    for (size_t b = 0; w.ok && index_buckets && b <= index_mask; b++) {
+        for (Entry *e = index_buckets[b]; w.ok && e; e = e->next) {
+            snapshot_entry(&w, e->key, e->value, e->len, e->flags, e->version);
+        }
+    }
+    // Las claves desalojadas se leen del archivo frío, también sin stdio
+    if (w.ok && cold_store && cold_store_scan(cold_store, snapshot_cold, &w) > 0) w.ok = 0;
+    int ok = w.ok;
+    if (ok && w.used > 0) {
+        ok = write_all(w.fd, w.buf, w.used) == 0;
+        r.bytes += w.used;
+    }
+    if (w.fd >= 0) {
+        ok = ok && fsync(w.fd) == 0;
+        ok = close(w.fd) == 0 && ok;
+    }
+    // El archivo anterior se reemplaza solo si el nuevo quedó completo
+    ok = ok && rename(tmp, path) == 0;
+    if (!ok) unlink(tmp);
+    r.ok = ok;
+    r.write_us = (metrics_now_ns() - t0) / 1000;
+    r.cow_kb = private_dirty_kb();
+    write_all(report_fd, (const char *)&r, sizeof(r));
+    _exit(ok ? 0 : 1);
+}
+
+typedef struct {
+    pid_t pid;
+    int report_fd;
+    uint64_t start_ns;
+} SnapshotChild;
+
+static void *snapshot_wait(void *arg) {
+    SnapshotChild c = *(SnapshotChild *)arg;
+    free(arg);
+    SnapshotReport r;
+    memset(&r, 0, sizeof(r));
+    size_t got = 0;
+    while (got < sizeof(r)) {
+        ssize_t n = read(c.report_fd, (char *)&r + got, sizeof(r) - got);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        got += (size_t)n;
+    }
+    close(c.report_fd);
+    int status = 0;
+    while (waitpid(c.pid, &status, 0) < 0 && errno == EINTR) {}
+    int ok = got == sizeof(r) && r.ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    long page_kb = sysconf(_SC_PAGESIZE) / 1024;
+
+    pthread_mutex_lock(&snapshot_mutex);
+    snapshot_info.running = 0;
+    snapshot_info.last_ok = ok;
+    snapshot_info.last_entries = r.entries;
+    snapshot_info.last_bytes = r.bytes;
+    snapshot_info.last_duration_ms = (metrics_now_ns() - c.start_ns) / 1000000;
+    snapshot_info.last_cow_kb = r.cow_kb;
+    snapshot_info.last_cow_pages = page_kb > 0 ? r.cow_kb / (uint64_t)page_kb : 0;
+    if (ok) snapshot_info.completed++;
+    else snapshot_info.failed++;
+    DataStoreSnapshotInfo info = snapshot_info;
+    pthread_mutex_unlock(&snapshot_mutex);
+
+    if (ok) {
+        metrics_inc(METRIC_SNAPSHOTS);
+        printf("DATA_STORE: Snapshot %s - %llu claves, %llu bytes en %llu ms (fork %llu us, COW %llu páginas)\n",
+               snapshot_file, (unsigned long long)info.last_entries, (unsigned long long)info.last_bytes,
+               (unsigned long long)info.last_duration_ms, (unsigned long long)info.last_fork_us,
+               (unsigned long long)info.last_cow_pages);
+    } else {
+        printf("DATA_STORE: ERROR - Falló el snapshot a %s\n", snapshot_file);
+    }
+    return NULL;
+}
+
+int data_store_snapshot_start(void) {
+    pthread_mutex_lock(&snapshot_mutex);
+    if (snapshot_info.running || !snapshot_file[0]) {
+        int busy = snapshot_info.running;
+        pthread_mutex_unlock(&snapshot_mutex);
+        return busy ? 1 : -1;
+    }
+    if (snapshot_waiter_active) {
+        pthread_join(snapshot_waiter, NULL);
+        snapshot_waiter_active = 0;
+    }
+    int report[2];
+    SnapshotChild *c = malloc(sizeof(SnapshotChild));
+    if (!c || pipe2(report, O_CLOEXEC) != 0) {
+        free(c);
+        pthread_mutex_unlock(&snapshot_mutex);
+        return -1;
+    }
+    fflush(stdout);
+
+    uint64_t t0 = metrics_now_ns();
+    pthread_mutex_lock(&store_mutex);
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(report[0]);
+        snapshot_child(report[1], snapshot_file);
+    }
+    pthread_mutex_unlock(&store_mutex);
+    uint64_t fork_us = (metrics_now_ns() - t0) / 1000;
+    close(report[1]);
+    if (pid < 0) {
+        perror("fork");
+        close(report[0]);
+        free(c);
+        pthread_mutex_unlock(&snapshot_mutex);
+        return -1;
+    }
+
+    c->pid = pid;
+    c->report_fd = report[0];
+    c->start_ns = t0;
+    if (pthread_create(&snapshot_waiter, NULL, snapshot_wait, c) != 0) {
+        // Sin waiter: se espera acá para no dejar un zombie
+        close(report[0]);
+        waitpid(pid, NULL, 0);
+        free(c);
+        pthread_mutex_unlock(&snapshot_mutex);
+        return -1;
+    }
+    snapshot_waiter_active = 1;
+    snapshot_info.running = 1;
+    snapshot_info.last_fork_us = fork_us;
+    snapshot_info.started_ns = t0;
+    pthread_mutex_unlock(&snapshot_mutex);
+    return 0;
+}
+
+void data_store_snapshot_info(DataStoreSnapshotInfo *out) {
+    pthread_mutex_lock(&snapshot_mutex);
+    *out = snapshot_info;
+    pthread_mutex_unlock(&snapshot_mutex);
+}
+
+static void *snapshot_scheduler_main(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&snapshot_mutex);
+    while (snapshot_scheduler_running) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += snapshot_interval_s;
+        int rc = pthread_cond_timedwait(&snapshot_cond, &snapshot_mutex, &deadline);
+        if (!snapshot_scheduler_running || rc != ETIMEDOUT) continue;
+        pthread_mutex_unlock(&snapshot_mutex);
+        data_store_snapshot_start();
+        pthread_mutex_lock(&snapshot_mutex);
+    }
+    pthread_mutex_unlock(&snapshot_mutex);
+    return NULL;
+}
+
+int data_store_set_snapshot(const char *path, int interval_s) {
+    pthread_mutex_lock(&snapshot_mutex);
+    if (path && path[0]) {
+        snprintf(snapshot_file, sizeof(snapshot_file), "%s", path);
+    } else if (store_file[0]) {
+        snprintf(snapshot_file, sizeof(snapshot_file), "%s.snapshot", store_file);
+    }
+    int start = interval_s > 0 && !snapshot_scheduler_running && snapshot_file[0];
+    if (start) {
+        snapshot_interval_s = interval_s;
+        snapshot_scheduler_running = 1;
+    }
+    pthread_mutex_unlock(&snapshot_mutex);
+    if (start && pthread_create(&snapshot_scheduler, NULL, snapshot_scheduler_main, NULL) != 0) {
+        snapshot_scheduler_running = 0;
+        return -1;
+    }
+    return snapshot_file[0] ? 0 : -1;
+}
+
+// Detiene el scheduler y espera al snapshot en curso
+static void snapshot_stop(void) {
+    pthread_mutex_lock(&snapshot_mutex);
+    int scheduler = snapshot_scheduler_running;
+    snapshot_scheduler_running = 0;
+    pthread_cond_signal(&snapshot_cond);
+    pthread_mutex_unlock(&snapshot_mutex);
+    if (scheduler) pthread_join(snapshot_scheduler, NULL);
+
+    pthread_mutex_lock(&snapshot_mutex);
+    int waiter = snapshot_waiter_active;
+    snapshot_waiter_active = 0;
+    pthread_mutex_unlock(&snapshot_mutex);
+    if (waiter) pthread_join(snapshot_waiter, NULL);
+}
+
 void data_store_cleanup(void) {
+    snapshot_stop();
+    expirer_stop();
+    if (flusher_running) {
+        pthread_mutex_lock(&file_mutex);
+        flusher_running = 0;
+        pthread_cond_signal(&flusher_cond);
+        pthread_mutex_unlock(&file_mutex);
+        pthread_join(flusher_thread, NULL);
+        // Lo que quedó pendiente desde el último flush
+        flush_dirty();
+        coalesce_ms = 0;
+    }
     pthread_mutex_lock(&store_mutex);
-    Entry *e = head;
-    while (e) {
-        Entry *n = e->next;
-        free(e->key);
-        free(e->value);
-        free(e);
-        e = n;
+    if (shared_table) {
+        shm_table_close(shared_table, 1);
+        shared_table = NULL;
+    }
+    ChangeFeed *feed = change_feed;
+    change_feed = NULL;
+    for (size_t b = 0; index_buckets && b <= index_mask; b++) {
+        Entry *e = index_buckets[b];
+        while (e) {
+            Entry *n = e->next;
+            release_value(e);
+            slab_free(e);
+            e = n;
+        }
+    }
+    free(index_buckets);
+    for (size_t i = 0; i < dirty_count; i++) intern_release(dirty_keys[i]);
+    free(dirty_keys);
+    dirty_keys = NULL;
+    dirty_count = dirty_cap = 0;
+    index_buckets = NULL;
+    index_mask = 0;
+    entry_count = 0;
+    metrics_gauge_set(METRIC_GAUGE_STORE_ENTRIES, 0);
+    metrics_gauge_set(METRIC_GAUGE_STORE_BYTES, 0);
+    for (size_t b = 0; ttl_buckets && b <= ttl_mask; b++) {
+        TtlTimer *t = ttl_buckets[b];
+        while (t) {
+            TtlTimer *n = t->next;
+            slab_free(t);
+            t = n;
+        }
+    }
+    free(ttl_buckets);
+    ttl_buckets = NULL;
+    ttl_mask = 0;
+    ttl_count = 0;
+    ttl_wheel_ready = 0;
+    metrics_gauge_set(METRIC_GAUGE_TTL_KEYS, 0);
+    cold_store_destroy(cold_store);
+    cold_store = NULL;
+    resident_bytes = 0;
+    clock_hand = 0;
+    metrics_gauge_set(METRIC_GAUGE_RESIDENT_BYTES, 0);
+    metrics_gauge_set(METRIC_GAUGE_COLD_KEYS, 0);
+    // Los campos configurados quedan, como la compresión y el presupuesto
+    if (field_index) field_index_clear(field_index);
+    index_gauges();
+    // Las claves del store sueltan la referencia de key_order
+    for (const SkipNode *n = key_order ? skiplist_seek(key_order, "", 0) : NULL; n; n = skiplist_next(n)) {
+        intern_release(n->key);
     }
-    head = NULL;
+    skiplist_destroy(key_order);
+    key_order = NULL;
+    json_dict_reset();
     pthread_mutex_unlock(&store_mutex);
+    change_feed_destroy(feed);
 }
 
 
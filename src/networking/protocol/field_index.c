@@ -0,0 +1,265 @@
+#include "field_index.h"
+#include <stdlib.h>
+#include <string.h>
+
+struct FieldIndex {
+    char names[FIELD_INDEX_FIELDS_MAX][FIELD_INDEX_NAME_MAX];
+    size_t name_len[FIELD_INDEX_FIELDS_MAX];
+    int field_count;
+    FieldIndexEntry **buckets;
+    size_t mask;
+    size_t count;
+    size_t kept_bytes;
+};
+
+FieldIndex *field_index_create(const char *fields)
+{
+    if (!fields) return NULL;
+    FieldIndex *fi = calloc(1, sizeof(FieldIndex));
+    if (!fi) return NULL;
+    const char *p = fields;
+    while (*p) {
+        const char *start = p;
+        while (*p && *p != ',') p++;
+        size_t len = (size_t)(p - start);
+        if (*p == ',') p++;
+        if (len == 0) continue;
+        if (len >= FIELD_INDEX_NAME_MAX || fi->field_count == FIELD_INDEX_FIELDS_MAX) {
+            free(fi);
+            return NULL;
+        }
+        memcpy(fi->names[fi->field_count], start, len);
+        fi->name_len[fi->field_count++] = len;
+    }
+    fi->mask = 255;
+    fi->buckets = calloc(fi->mask + 1, sizeof(FieldIndexEntry *));
+    if (fi->field_count == 0 || !fi->buckets) {
+        free(fi->buckets);
+        free(fi);
+        return NULL;
+    }
+    return fi;
+}
+
+void field_index_clear(FieldIndex *fi)
+{
+    for (size_t b = 0; b <= fi->mask; b++) {
+        FieldIndexEntry *ie = fi->buckets[b];
+        while (ie) {
+            FieldIndexEntry *next = ie->next;
+            intern_release(ie->key);
+            free(ie->reading);
+            free(ie);
+            ie = next;
+        }
+        fi->buckets[b] = NULL;
+    }
+    fi->count = 0;
+    fi->kept_bytes = 0;
+}
+
+void field_index_destroy(FieldIndex *fi)
+{
+    if (!fi) return;
+    field_index_clear(fi);
+    free(fi->buckets);
+    free(fi);
+}
+
+int field_index_field(const FieldIndex *fi, const char *name, size_t len)
+{
+    for (int i = 0; i < fi->field_count; i++) {
+        if (fi->name_len[i] == len && memcmp(fi->names[i], name, len) == 0) return i;
+    }
+    return -1;
+}
+
+static const char *skip_space(const char *p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) p++;
+    return p;
+}
+
+// Comilla que cierra el string que empieza en p (después de la que abre)
+static const char *string_end(const char *p, const char *end)
+{
+    while (p < end && *p != '"') p += *p == '\\' ? 2 : 1;
+    return p < end ? p : NULL;
+}
+
+size_t field_index_extract(const FieldIndex *fi, const char *json, size_t len,
+                           FieldValue out[FIELD_INDEX_FIELDS_MAX])
+{
+    size_t n = 0;
+    unsigned seen = 0;
+    int depth = 0;
+    const char *p = json, *end = json + len;
+    while (p < end) {
+        char c = *p;
+        if (c == '{' || c == '[') {
+            depth++;
+        } else if (c == '}' || c == ']') {
+            depth--;
+        } else if (c == '"') {
+            const char *name = p + 1;
+            const char *close = string_end(name, end);
+            if (!close) break;
+            p = close + 1;
+            const char *colon = skip_space(p, end);
+            // Un string seguido de ':' en el primer nivel es un nombre de campo
+            if (depth != 1 || colon == end || *colon != ':') continue;
+            int field = field_index_field(fi, name, (size_t)(close - name));
+            if (field < 0 || (seen & (1u << field))) continue;
+            const char *v = skip_space(colon + 1, end), *v_end;
+            if (v < end && *v == '"') {
+                v_end = string_end(++v, end);
+                if (!v_end) break;
+                p = v_end + 1;
+            } else {
+                // Número o literal; objetos y arrays no se indexan
+                v_end = v;
+                while (v_end < end && *v_end != ',' && *v_end != '}' && *v_end != ']' &&
+                       *v_end != ' ' && *v_end != '\t' && *v_end != '\n' && *v_end != '\r' &&
+                       *v_end != '{' && *v_end != '[') {
+                    v_end++;
+                }
+                if (v_end == v) continue;
+                p = v_end;
+            }
+            size_t vlen = (size_t)(v_end - v);
+            if (vlen == 0 || vlen > FIELD_INDEX_VALUE_MAX) continue;
+            seen |= 1u << field;
+            out[n].field = field;
+            out[n].value = v;
+            out[n].len = vlen;
+            if (++n == (size_t)fi->field_count) break;
+            continue;
+        }
+        p++;
+    }
+    return n;
+}
+
+static uint64_t entry_hash(int field, const char *value, size_t len)
+{
+    return intern_hash(value, len) ^ ((uint64_t)field * 0x9e3779b97f4a7c15ULL);
+}
+
+FieldIndexEntry *field_index_find(const FieldIndex *fi, int field, const char *value, size_t len)
+{
+    uint64_t h = entry_hash(field, value, len);
+    for (FieldIndexEntry *ie = fi->buckets[h & fi->mask]; ie; ie = ie->next) {
+        if (ie->hash == h && ie->field == field && ie->value_len == len && memcmp(ie->value, value, len) == 0) {
+            return ie;
+        }
+    }
+    return NULL;
+}
+
+static int grow(FieldIndex *fi)
+{
+    size_t n = (fi->mask + 1) * 2;
+    FieldIndexEntry **nb = calloc(n, sizeof(FieldIndexEntry *));
+    if (!nb) return -1;
+    for (size_t b = 0; b <= fi->mask; b++) {
+        FieldIndexEntry *ie = fi->buckets[b];
+        while (ie) {
+            FieldIndexEntry *next = ie->next;
+            ie->next = nb[ie->hash & (n - 1)];
+            nb[ie->hash & (n - 1)] = ie;
+            ie = next;
+        }
+    }
+    free(fi->buckets);
+    fi->buckets = nb;
+    fi->mask = n - 1;
+    return 0;
+}
+
+FieldIndexEntry *field_index_put(FieldIndex *fi, int field, const char *value, size_t len)
+{
+    if (field < 0 || field >= fi->field_count || len == 0 || len > FIELD_INDEX_VALUE_MAX) return NULL;
+    FieldIndexEntry *ie = field_index_find(fi, field, value, len);
+    if (ie) return ie;
+    if (fi->count > fi->mask && grow(fi) != 0) return NULL;
+    ie = calloc(1, sizeof(FieldIndexEntry) + len + 1);
+    if (!ie) return NULL;
+    ie->hash = entry_hash(field, value, len);
+    ie->field = (uint8_t)field;
+    ie->value_len = (uint16_t)len;
+    memcpy(ie->value, value, len);
+    ie->next = fi->buckets[ie->hash & fi->mask];
+    fi->buckets[ie->hash & fi->mask] = ie;
+    fi->count++;
+    return ie;
+}
+
+void field_index_remove(FieldIndex *fi, FieldIndexEntry *ie)
+{
+    FieldIndexEntry **pp = &fi->buckets[ie->hash & fi->mask];
+    while (*pp && *pp != ie) pp = &(*pp)->next;
+    if (!*pp) return;
+    *pp = ie->next;
+    field_index_release(fi, ie);
+    intern_release(ie->key);
+    free(ie);
+    fi->count--;
+}
+
+void field_index_set_key(FieldIndexEntry *ie, const InternKey *k)
+{
+    if (ie->key == k) return;
+    intern_acquire(k);
+    intern_release(ie->key);
+    ie->key = k;
+}
+
+int field_index_keep(FieldIndex *fi, FieldIndexEntry *ie, const char *reading, size_t len,
+                     int compressed, uint64_t expires_ms)
+{
+    if (len > UINT16_MAX) return -1;
+    char *copy = malloc(len + 1);
+    if (!copy) return -1;
+    memcpy(copy, reading, len);
+    copy[len] = '\0';
+    field_index_release(fi, ie);
+    ie->reading = copy;
+    ie->reading_len = (uint16_t)len;
+    ie->compressed = compressed ? 1 : 0;
+    ie->expires_ms = expires_ms;
+    fi->kept_bytes += len + 1;
+    return 0;
+}
+
+void field_index_release(FieldIndex *fi, FieldIndexEntry *ie)
+{
+    if (!ie->reading) return;
+    fi->kept_bytes -= ie->reading_len + 1u;
+    free(ie->reading);
+    ie->reading = NULL;
+    ie->reading_len = 0;
+    ie->compressed = 0;
+    ie->expires_ms = 0;
+}
+
+void field_index_scan(FieldIndex *fi, field_index_fn fn, void *ctx)
+{
+    for (size_t b = 0; b <= fi->mask; b++) {
+        FieldIndexEntry *ie = fi->buckets[b];
+        while (ie) {
+            FieldIndexEntry *next = ie->next;
+            fn(ie, ctx);
+            ie = next;
+        }
+    }
+}
+
+size_t field_index_count(const FieldIndex *fi)
+{
+    return fi ? fi->count : 0;
+}
+
+size_t field_index_kept_bytes(const FieldIndex *fi)
+{
+    return fi ? fi->kept_bytes : 0;
+}
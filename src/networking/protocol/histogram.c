@@ -0,0 +1,109 @@
+#include "histogram.h"
+
+void hist_init(Histogram *h)
+{
+    for (int i = 0; i < HIST_BUCKETS; i++)
+        atomic_init(&h->counts[i], 0);
+    atomic_init(&h->total, 0);
+    atomic_init(&h->sum, 0);
+    atomic_init(&h->max, 0);
+}
+
+int hist_bucket_index(uint64_t value)
+{
+    if (value > HIST_MAX_VALUE) value = HIST_MAX_VALUE;
+    if (value < HIST_SUB_COUNT) return (int)value;
+    int msb = 63 - __builtin_clzll(value);
+    int magnitude = msb - HIST_SUB_BITS + 1;
+    int sub = (int)((value >> (msb - HIST_SUB_BITS)) & (HIST_SUB_COUNT - 1));
+    return magnitude * HIST_SUB_COUNT + sub;
+}
+
+uint64_t hist_bucket_upper(int index)
+{
+    int magnitude = index / HIST_SUB_COUNT;
+    uint64_t sub = (uint64_t)(index % HIST_SUB_COUNT);
+    if (magnitude == 0) return sub;
+    uint64_t width = 1ULL << (magnitude - 1);
+    return ((HIST_SUB_COUNT + sub) << (magnitude - 1)) + width - 1;
+}
+
+void hist_record(Histogram *h, uint64_t value)
+{
+    atomic_fetch_add_explicit(&h->counts[hist_bucket_index(value)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->total, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->sum, value, memory_order_relaxed);
+
+    unsigned long long cur = atomic_load_explicit(&h->max, memory_order_relaxed);
+    while (value > cur &&
+           !atomic_compare_exchange_weak_explicit(&h->max, &cur, value,
+                                                  memory_order_relaxed, memory_order_relaxed))
+        ;
+}
+
+void hist_record_corrected(Histogram *h, uint64_t value, uint64_t expected_interval)
+{
+    hist_record(h, value);
+    if (expected_interval == 0 || value <= expected_interval) return;
+    for (uint64_t missing = value - expected_interval; missing >= expected_interval; missing -= expected_interval)
+        hist_record(h, missing);
+}
+
+void hist_merge(Histogram *dst, const Histogram *src)
+{
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        unsigned long long c = atomic_load_explicit(&src->counts[i], memory_order_relaxed);
+        if (c) atomic_fetch_add_explicit(&dst->counts[i], c, memory_order_relaxed);
+    }
+    atomic_fetch_add_explicit(&dst->total, atomic_load_explicit(&src->total, memory_order_relaxed), memory_order_relaxed);
+    atomic_fetch_add_explicit(&dst->sum, atomic_load_explicit(&src->sum, memory_order_relaxed), memory_order_relaxed);
+
+    unsigned long long src_max = atomic_load_explicit(&src->max, memory_order_relaxed);
+    unsigned long long cur = atomic_load_explicit(&dst->max, memory_order_relaxed);
+    while (src_max > cur &&
+           !atomic_compare_exchange_weak_explicit(&dst->max, &cur, src_max,
+                                                  memory_order_relaxed, memory_order_relaxed))
+        ;
+}
+
+uint64_t hist_count(const Histogram *h)
+{
+    return atomic_load_explicit(&h->total, memory_order_relaxed);
+}
+
+uint64_t hist_max(const Histogram *h)
+{
+    return atomic_load_explicit(&h->max, memory_order_relaxed);
+}
+
+double hist_mean(const Histogram *h)
+{
+    uint64_t n = hist_count(h);
+    if (n == 0) return 0.0;
+    return (double)atomic_load_explicit(&h->sum, memory_order_relaxed) / (double)n;
+}
+
+uint64_t hist_percentile(const Histogram *h, double percentile)
+{
+    // Se suma sobre los buckets y no sobre 'total': el conteo es consistente
+    // aunque otros threads estén registrando al mismo tiempo.
+    uint64_t total = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++)
+        total += atomic_load_explicit(&h->counts[i], memory_order_relaxed);
+    if (total == 0) return 0;
+
+    uint64_t rank = (uint64_t)((percentile / 100.0) * (double)total + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > total) rank = total;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += atomic_load_explicit(&h->counts[i], memory_order_relaxed);
+        if (seen >= rank) {
+            uint64_t upper = hist_bucket_upper(i);
+            uint64_t max = hist_max(h);
+            return (max && upper > max) ? max : upper;
+        }
+    }
+    return hist_max(h);
+}
@@ -0,0 +1,113 @@
+#include "intern.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#define INTERN_BUCKETS (1u << 16)
+
+static _Atomic(InternKey *) buckets[INTERN_BUCKETS];
+static pthread_mutex_t intern_mutex = PTHREAD_MUTEX_INITIALIZER;
+static atomic_size_t key_count;
+
+uint64_t intern_hash(const char *s, size_t len)
+{
+    // FNV-1a con mezcla final para repartir los bits bajos
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (uint8_t)s[i];
+        h *= 0x100000001b3ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static const InternKey *find_in_bucket(InternKey *k, uint64_t hash, const char *s, size_t len)
+{
+    for (; k; k = k->next) {
+        if (k->hash == hash && k->len == len && memcmp(k->str, s, len) == 0) return k;
+    }
+    return NULL;
+}
+
+const InternKey *intern_lookup(const char *s, size_t len)
+{
+    uint64_t hash = intern_hash(s, len);
+    InternKey *head = atomic_load_explicit(&buckets[hash & (INTERN_BUCKETS - 1)], memory_order_acquire);
+    return find_in_bucket(head, hash, s, len);
+}
+
+static _Atomic uint32_t *refs_of(const InternKey *k)
+{
+    return (_Atomic uint32_t *)&((InternKey *)k)->refs;
+}
+
+void intern_acquire(const InternKey *k)
+{
+    atomic_fetch_add_explicit(refs_of(k), 1, memory_order_relaxed);
+}
+
+const InternKey *intern_get(const char *s, size_t len)
+{
+    uint64_t hash = intern_hash(s, len);
+    _Atomic(InternKey *) *bucket = &buckets[hash & (INTERN_BUCKETS - 1)];
+    const InternKey *k = find_in_bucket(atomic_load_explicit(bucket, memory_order_acquire), hash, s, len);
+    if (k) {
+        intern_acquire(k);
+        return k;
+    }
+
+    pthread_mutex_lock(&intern_mutex);
+    // Otro thread pudo insertarla mientras esperábamos
+    InternKey *head = atomic_load_explicit(bucket, memory_order_relaxed);
+    k = find_in_bucket(head, hash, s, len);
+    if (!k) {
+        InternKey *n = malloc(sizeof(InternKey) + len + 1);
+        if (n) {
+            n->next = head;
+            n->hash = hash;
+            n->len = (uint32_t)len;
+            n->refs = 1;
+            memcpy(n->str, s, len);
+            n->str[len] = '\0';
+            // Publicar ya inicializada: los lectores no toman el mutex
+            atomic_store_explicit(bucket, n, memory_order_release);
+            atomic_fetch_add_explicit(&key_count, 1, memory_order_relaxed);
+        }
+        k = n;
+    } else {
+        intern_acquire(k);
+    }
+    pthread_mutex_unlock(&intern_mutex);
+    return k;
+}
+
+void intern_release(const InternKey *k)
+{
+    if (!k || atomic_fetch_sub_explicit(refs_of(k), 1, memory_order_acq_rel) != 1) return;
+
+    // Nadie más la tiene: desengancharla de su cadena y liberarla
+    pthread_mutex_lock(&intern_mutex);
+    _Atomic(InternKey *) *bucket = &buckets[k->hash & (INTERN_BUCKETS - 1)];
+    InternKey *head = atomic_load_explicit(bucket, memory_order_relaxed);
+    if (head == k) {
+        atomic_store_explicit(bucket, head->next, memory_order_release);
+    } else {
+        for (InternKey *p = head; p; p = p->next) {
+            if (p->next == k) {
+                p->next = k->next;
+                break;
+            }
+        }
+    }
+    atomic_fetch_sub_explicit(&key_count, 1, memory_order_relaxed);
+    pthread_mutex_unlock(&intern_mutex);
+    free((InternKey *)k);
+}
+
+size_t intern_count(void)
+{
+    return atomic_load_explicit(&key_count, memory_order_relaxed);
+}
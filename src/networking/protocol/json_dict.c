@@ -0,0 +1,332 @@
+#include "json_dict.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define DICT_MAX_HOLES      64
+#define DICT_MAX_DEPTH      32
+#define DICT_TEMPLATE_MAX   1024
+#define DICT_LOOKUP_SIZE    (JSON_DICT_MAX * 2)
+
+typedef struct {
+    char *text;
+    uint32_t len;
+    uint32_t hash;
+    uint16_t holes;
+    uint8_t persisted;          // ya tiene su registro en el log actual
+} Template;
+
+typedef struct {
+    uint32_t off;
+    uint32_t len;
+} Hole;
+
+static Template *templates[JSON_DICT_MAX];     // por id; el 0 es el literal
+static uint32_t next_id = 1;
+static uint32_t template_count = 0;
+static uint16_t lookup[DICT_LOOKUP_SIZE];      // hash de texto -> id (0 = libre)
+
+static uint32_t text_hash(const char *s, size_t len)
+{
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (uint8_t)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static int is_ws(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// Separa json en plantilla y huecos. Devuelve el largo de la plantilla o -1
+// si no es un objeto/array JSON bien anidado o algo no entra en el formato.
+static int split(const char *json, size_t len, char *tmpl, size_t cap, Hole *holes, int *hole_count)
+{
+    char stack[DICT_MAX_DEPTH];
+    int depth = 0, expect_key = 0, nholes = 0;
+    size_t t = 0;
+    if (len == 0 || (json[0] != '{' && json[0] != '[')) return -1;
+
+    for (size_t i = 0; i < len; ) {
+        char c = json[i];
+        size_t start = i, end;
+        int hole = 0;
+        if (c == '"') {
+            end = i + 1;
+            while (end < len && json[end] != '"') end += json[end] == '\\' ? 2 : 1;
+            if (end >= len) return -1;
+            if (depth > 0 && stack[depth - 1] == '{' && expect_key) {
+                // Clave: va a la plantilla tal cual
+                expect_key = 0;
+                end++;
+            } else {
+                // Solo el contenido es hueco; las comillas quedan en la plantilla
+                if (t + 3 > cap) return -1;
+                tmpl[t++] = '"';
+                start = i + 1;
+                hole = 1;
+            }
+        } else if (c == '{' || c == '[') {
+            if (depth == DICT_MAX_DEPTH) return -1;
+            stack[depth++] = c;
+            expect_key = c == '{';
+            end = i + 1;
+        } else if (c == '}' || c == ']') {
+            if (depth == 0 || stack[depth - 1] != (c == '}' ? '{' : '[')) return -1;
+            depth--;
+            expect_key = 0;
+            end = i + 1;
+        } else if (c == ',') {
+            if (depth == 0) return -1;
+            expect_key = stack[depth - 1] == '{';
+            end = i + 1;
+        } else if (c == ':' || is_ws(c)) {
+            end = i + 1;
+        } else {
+            // Número o literal: hasta el próximo delimitador
+            if (depth == 0 || expect_key) return -1;
+            end = i;
+            while (end < len && json[end] != ',' && json[end] != '}' && json[end] != ']' && !is_ws(json[end])) end++;
+            hole = 1;
+        }
+
+        if (hole) {
+            if (nholes == DICT_MAX_HOLES || t + 2 > cap) return -1;
+            for (size_t k = start; k < end; k++) {
+                // Los huecos se separan con tabs y van en una línea del log
+                if (json[k] == '\t' || json[k] == '\n' || json[k] == '\r') return -1;
+            }
+            holes[nholes].off = (uint32_t)start;
+            holes[nholes].len = (uint32_t)(end - start);
+            nholes++;
+            tmpl[t++] = JSON_DICT_HOLE;
+            if (c == '"') {
+                tmpl[t++] = '"';
+                end++;
+            }
+        } else {
+            if (t + (end - start) > cap) return -1;
+            for (size_t k = start; k < end; k++) {
+                if (json[k] == '\n' || json[k] == '\r' || json[k] == JSON_DICT_HOLE) return -1;
+                tmpl[t++] = json[k];
+            }
+        }
+        i = end;
+        if (depth == 0) {
+            // Después del cierre solo puede haber espacios
+            while (i < len && is_ws(json[i])) {
+                if (t == cap || json[i] == '\n' || json[i] == '\r') return -1;
+                tmpl[t++] = json[i++];
+            }
+            if (i != len) return -1;
+        }
+    }
+    if (depth != 0) return -1;
+    *hole_count = nholes;
+    return (int)t;
+}
+
+static uint32_t find_template(const char *tmpl, size_t len, uint32_t hash)
+{
+    for (uint32_t pos = hash & (DICT_LOOKUP_SIZE - 1); lookup[pos]; pos = (pos + 1) & (DICT_LOOKUP_SIZE - 1)) {
+        const Template *tp = templates[lookup[pos]];
+        if (tp->hash == hash && tp->len == len && memcmp(tp->text, tmpl, len) == 0) return lookup[pos];
+    }
+    return 0;
+}
+
+static int add_template(uint32_t id, const char *tmpl, size_t len, uint32_t hash)
+{
+    if (id == 0 || id >= JSON_DICT_MAX || templates[id]) return -1;
+    Template *tp = malloc(sizeof(Template));
+    char *text = malloc(len + 1);
+    if (!tp || !text) {
+        free(tp);
+        free(text);
+        return -1;
+    }
+    memcpy(text, tmpl, len);
+    text[len] = '\0';
+    tp->text = text;
+    tp->len = (uint32_t)len;
+    tp->hash = hash;
+    tp->holes = 0;
+    tp->persisted = 0;
+    for (size_t i = 0; i < len; i++) tp->holes += tmpl[i] == JSON_DICT_HOLE;
+    templates[id] = tp;
+    uint32_t pos = hash & (DICT_LOOKUP_SIZE - 1);
+    while (lookup[pos]) pos = (pos + 1) & (DICT_LOOKUP_SIZE - 1);
+    lookup[pos] = (uint16_t)id;
+    template_count++;
+    if (id >= next_id) next_id = id + 1;
+    return 0;
+}
+
+static size_t put_uint(char *out, uint32_t v)
+{
+    char tmp[10];
+    size_t n = 0;
+    do {
+        tmp[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    for (size_t i = 0; i < n; i++) out[i] = tmp[n - 1 - i];
+    return n;
+}
+
+int json_dict_encode(const char *json, size_t len, char *out, size_t cap)
+{
+    char tmpl[DICT_TEMPLATE_MAX];
+    Hole holes[DICT_MAX_HOLES];
+    int nholes = 0;
+    int tlen = split(json, len, tmpl, sizeof(tmpl), holes, &nholes);
+    if (tlen < 0 || nholes == 0) return -1;
+
+    // Solo vale la pena si queda más corto que el original (cota con un id
+    // de 4 dígitos, antes de agregar la plantilla al diccionario)
+    size_t limit = cap < len ? cap : len;
+    size_t need = 5;
+    for (int h = 0; h < nholes; h++) need += 1 + holes[h].len;
+    if (need >= limit) return -1;
+
+    uint32_t hash = text_hash(tmpl, (size_t)tlen);
+    uint32_t id = find_template(tmpl, (size_t)tlen, hash);
+    if (id == 0) {
+        if (next_id >= JSON_DICT_MAX || add_template(next_id, tmpl, (size_t)tlen, hash) != 0) return -1;
+        id = next_id - 1;
+    }
+    size_t n = 0;
+    out[n++] = JSON_DICT_MARK;
+    n += put_uint(out + n, id);
+    for (int h = 0; h < nholes; h++) {
+        if (n + 1 + holes[h].len >= limit) return -1;
+        out[n++] = '\t';
+        memcpy(out + n, json + holes[h].off, holes[h].len);
+        n += holes[h].len;
+    }
+    out[n] = '\0';
+    return (int)n;
+}
+
+int json_dict_encode_literal(const char *value, size_t len, char *out, size_t cap)
+{
+    if (len + 4 > cap) return -1;
+    out[0] = JSON_DICT_MARK;
+    out[1] = '0';
+    out[2] = '\t';
+    memcpy(out + 3, value, len);
+    out[len + 3] = '\0';
+    return (int)len + 3;
+}
+
+// Lee "@<id>\t" y deja en *body el resto
+static int parse_header(const char *enc, size_t len, size_t *body)
+{
+    if (len < 3 || enc[0] != JSON_DICT_MARK) return -1;
+    uint32_t id = 0;
+    size_t i = 1;
+    while (i < len && enc[i] >= '0' && enc[i] <= '9' && i < 8) id = id * 10 + (uint32_t)(enc[i++] - '0');
+    if (i == 1 || i >= len || enc[i] != '\t' || id >= JSON_DICT_MAX) return -1;
+    if (id != 0 && !templates[id]) return -1;
+    *body = i + 1;
+    return (int)id;
+}
+
+int json_dict_id(const char *enc, size_t len)
+{
+    size_t body;
+    return parse_header(enc, len, &body);
+}
+
+int json_dict_decode(const char *enc, size_t len, char *out, size_t cap)
+{
+    size_t body;
+    int id = parse_header(enc, len, &body);
+    if (id < 0 || cap == 0) return -1;
+    if (id == 0) {
+        size_t n = len - body;
+        if (n + 1 > cap) return -1;
+        memcpy(out, enc + body, n);
+        out[n] = '\0';
+        return (int)n;
+    }
+
+    const Template *tp = templates[id];
+    size_t n = 0, p = body;
+    int first = 1;
+    for (uint32_t i = 0; i < tp->len; i++) {
+        char c = tp->text[i];
+        if (c != JSON_DICT_HOLE) {
+            if (n + 1 >= cap) return -1;
+            out[n++] = c;
+            continue;
+        }
+        // Cada hueco salvo el primero viene después de un tab
+        if (!first) {
+            if (p >= len || enc[p] != '\t') return -1;
+            p++;
+        }
+        first = 0;
+        size_t start = p;
+        while (p < len && enc[p] != '\t') p++;
+        if (n + (p - start) >= cap) return -1;
+        memcpy(out + n, enc + start, p - start);
+        n += p - start;
+    }
+    if (p != len) return -1;
+    out[n] = '\0';
+    return (int)n;
+}
+
+const char *json_dict_template(uint32_t id)
+{
+    return id < JSON_DICT_MAX && templates[id] ? templates[id]->text : NULL;
+}
+
+int json_dict_define(uint32_t id, const char *tmpl, size_t len)
+{
+    if (len == 0 || len > DICT_TEMPLATE_MAX) return -1;
+    uint32_t hash = text_hash(tmpl, len);
+    if (id < JSON_DICT_MAX && templates[id]) {
+        // Ya definida (el log se cargó dos veces): tiene que ser la misma
+        return templates[id]->hash == hash && templates[id]->len == len &&
+               memcmp(templates[id]->text, tmpl, len) == 0 ? 0 : -1;
+    }
+    if (add_template(id, tmpl, len, hash) != 0) return -1;
+    templates[id]->persisted = 1;
+    return 0;
+}
+
+int json_dict_take_unpersisted(uint32_t id)
+{
+    if (id == 0 || id >= JSON_DICT_MAX || !templates[id] || templates[id]->persisted) return 0;
+    templates[id]->persisted = 1;
+    return 1;
+}
+
+void json_dict_clear_persisted(void)
+{
+    for (uint32_t id = 1; id < next_id; id++) {
+        if (templates[id]) templates[id]->persisted = 0;
+    }
+}
+
+uint32_t json_dict_count(void)
+{
+    return template_count;
+}
+
+void json_dict_reset(void)
+{
+    for (uint32_t id = 1; id < next_id; id++) {
+        if (!templates[id]) continue;
+        free(templates[id]->text);
+        free(templates[id]);
+        templates[id] = NULL;
+    }
+    memset(lookup, 0, sizeof(lookup));
+    next_id = 1;
+    template_count = 0;
+}
@@ -6,6 +6,43 @@
 #include <unistd.h>
 #include "message.h"
 
+// Delta y largo de opción (RFC 7252 3.1): 0-12 van en el nibble, 13 = un
+// byte extra (+13), 14 = dos bytes extra (+269), 15 está reservado
+static unsigned char option_nibble(int v, unsigned char *ext, int *ext_len)
+{
+    if (v < 13)
+        return (unsigned char)v;
+    if (v < 269)
+    {
+        ext[(*ext_len)++] = (unsigned char)(v - 13);
+        return 13;
+    }
+    ext[(*ext_len)++] = (unsigned char)((v - 269) >> 8);
+    ext[(*ext_len)++] = (unsigned char)((v - 269) & 0xFF);
+    return 14;
+}
+
+static int read_option_ext(unsigned char nibble, const unsigned char *buffer, int len, int *offset)
+{
+    if (nibble < 13)
+        return nibble;
+    if (nibble == 13)
+    {
+        if (*offset + 1 > len)
+            return -1;
+        return buffer[(*offset)++] + 13;
+    }
+    if (nibble == 14)
+    {
+        if (*offset + 2 > len)
+            return -1;
+        int v = (buffer[*offset] << 8 | buffer[*offset + 1]) + 269;
+        *offset += 2;
+        return v;
+    }
+    return -1;
+}
+
 int coap_message_init(CoapMessage *msg)
 {
     msg->version = 1;
@@ -75,7 +112,15 @@ int coap_serialize(CoapMessage *msg, unsigned char *buffer, int buf_size)
     {
         int delta = msg->options[i].number - last_number;
         int len = msg->options[i].length;
-        buffer[offset++] = (delta << 4) | (len & 0x0F);
+        unsigned char ext[4];
+        int ext_len = 0;
+        unsigned char d = option_nibble(delta, ext, &ext_len);
+        unsigned char l = option_nibble(len, ext, &ext_len);
+        if (offset + 1 + ext_len + len > buf_size)
+            return -1;
+        buffer[offset++] = (unsigned char)(d << 4 | l);
+        memcpy(&buffer[offset], ext, ext_len);
+        offset += ext_len;
         memcpy(&buffer[offset], msg->options[i].value, len);
         offset += len;
         last_number = msg->options[i].number;
@@ -104,6 +149,8 @@ int coap_parse(CoapMessage *msg, const unsigned char *buffer, int len)
 
     int offset = 4;
     msg->token_len = msg->tkl;
+    if (msg->tkl > MAX_TOKEN_LEN || offset + msg->token_len > len)
+        return -1;
     if (msg->token_len > 0)
     {
         memcpy(msg->token, &buffer[offset], msg->token_len);
@@ -118,28 +165,99 @@ int coap_parse(CoapMessage *msg, const unsigned char *buffer, int len)
         if (buffer[offset] == 0xFF)
         {
             offset++;
+            if (len - offset > MAX_PAYLOAD)
+                goto fail;
             msg->payload_len = len - offset;
             memcpy(msg->payload, &buffer[offset], msg->payload_len);
             return 0;
         }
 
-        unsigned char delta = buffer[offset] >> 4;
-        unsigned char optlen = buffer[offset] & 0x0F;
-        offset++;
+        int ext_off = offset + 1;
+        int delta = read_option_ext(buffer[offset] >> 4, buffer, len, &ext_off);
+        int optlen = read_option_ext(buffer[offset] & 0x0F, buffer, len, &ext_off);
+        if (delta < 0 || optlen < 0 || msg->option_count >= MAX_OPTIONS || ext_off + optlen > len)
+            goto fail;
+        offset = ext_off;
 
         int number = last_number + delta;
         last_number = number;
 
+        unsigned char *value = malloc(optlen > 0 ? optlen : 1);
+        if (!value)
+            goto fail;
         msg->options[msg->option_count].number = number;
         msg->options[msg->option_count].length = optlen;
-        msg->options[msg->option_count].value = malloc(optlen);
-        memcpy(msg->options[msg->option_count].value, &buffer[offset], optlen);
+        msg->options[msg->option_count].value = value;
+        memcpy(value, &buffer[offset], optlen);
         offset += optlen;
         msg->option_count++;
     }
 
     msg->payload_len = 0;
     return 0;
+
+fail:
+    // Lo que ya se copió no llega al llamador
+    for (int i = 0; i < msg->option_count; i++)
+        free(msg->options[i].value);
+    msg->option_count = 0;
+    return -1;
 }
 
+int coap_parse_view(CoapMessage *msg, const unsigned char *buffer, int len)
+{
+    if (len < 4)
+        return -1;
+
+    msg->version = (buffer[0] & 0xC0) >> 6;
+    msg->type = (buffer[0] & 0x30) >> 4;
+    msg->tkl = buffer[0] & 0x0F;
+    msg->code = buffer[1];
+    msg->message_id = (buffer[2] << 8) | buffer[3];
+
+    int offset = 4;
+    msg->token_len = msg->tkl;
+    if (msg->tkl > MAX_TOKEN_LEN || offset + msg->token_len > len)
+        return -1;
+    if (msg->token_len > 0)
+    {
+        memcpy(msg->token, &buffer[offset], msg->token_len);
+        offset += msg->token_len;
+    }
+
+    msg->option_count = 0;
+    msg->payload_len = 0;
+    int last_number = 0;
+
+    while (offset < len)
+    {
+        if (buffer[offset] == 0xFF)
+        {
+            offset++;
+            if (len - offset > MAX_PAYLOAD)
+                return -1;
+            msg->payload_len = len - offset;
+            memcpy(msg->payload, &buffer[offset], msg->payload_len);
+            return 0;
+        }
+
+        int ext_off = offset + 1;
+        int delta = read_option_ext(buffer[offset] >> 4, buffer, len, &ext_off);
+        int optlen = read_option_ext(buffer[offset] & 0x0F, buffer, len, &ext_off);
+        if (delta < 0 || optlen < 0 || msg->option_count >= MAX_OPTIONS || ext_off + optlen > len)
+            return -1;
+        offset = ext_off;
 
+        int number = last_number + delta;
+        last_number = number;
+
+        // Sin copia: el valor apunta al datagrama
+        msg->options[msg->option_count].number = number;
+        msg->options[msg->option_count].length = optlen;
+        msg->options[msg->option_count].value = (unsigned char *)&buffer[offset];
+        offset += optlen;
+        msg->option_count++;
+    }
+
+    return 0;
+}
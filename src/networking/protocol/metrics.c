@@ -0,0 +1,265 @@
+#include "metrics.h"
+#include "histogram.h"
+#include <stdatomic.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct {
+    const char *json_key;
+    const char *prom_name;
+    const char *help;
+} MetricInfo;
+
+static const MetricInfo counter_info[METRIC_COUNTER_COUNT] = {
+    [METRIC_RX_DATAGRAMS]   = {"rx", "coap_rx_datagrams_total", "Datagramas recibidos"},
+    [METRIC_TX_RESPONSES]   = {"tx", "coap_tx_responses_total", "Respuestas enviadas"},
+    [METRIC_NO_REPLY]       = {"no_reply", "coap_no_reply_total", "Requests NON sin respuesta"},
+    [METRIC_PARSE_ERRORS]   = {"parse_err", "coap_parse_errors_total", "Datagramas que no son CoAP valido"},
+    [METRIC_NOT_FOUND]      = {"not_found", "coap_not_found_total", "Requests sin handler (4.04)"},
+    [METRIC_HANDLER_ERRORS] = {"handler_err", "coap_handler_errors_total", "Handlers que retornaron error"},
+    [METRIC_SEND_ERRORS]    = {"send_err", "coap_send_errors_total", "Errores en sendto"},
+    [METRIC_DROPPED]        = {"dropped", "coap_dropped_total", "Datagramas descartados antes de procesarse"},
+    [METRIC_STORE_WRITES]   = {"store_writes", "coap_store_writes_total", "Escrituras al data store"},
+    [METRIC_STORE_INPLACE]  = {"store_inplace", "coap_store_inplace_total", "Escrituras que reusaron el espacio del valor anterior"},
+    [METRIC_STORE_COALESCED] = {"store_coalesced", "coap_store_coalesced_total", "Escrituras al log ahorradas por coalescing"},
+    [METRIC_STORE_EXPIRED] = {"store_expired", "coap_store_expired_total", "Claves borradas por TTL"},
+    [METRIC_STORE_HITS]     = {"store_hits", "coap_store_hits_total", "Lecturas del data store resueltas en memoria"},
+    [METRIC_STORE_MISSES]   = {"store_misses", "coap_store_misses_total", "Lecturas que trajeron la clave del archivo frio"},
+    [METRIC_STORE_EVICTIONS] = {"store_evictions", "coap_store_evictions_total", "Entradas llevadas al archivo frio por el presupuesto de memoria"},
+    [METRIC_STORE_BULK_KEYS] = {"bulk_keys", "coap_store_bulk_keys_total", "Claves devueltas por GET con patron"},
+    [METRIC_SHED_RATE]      = {"shed_rate", "coap_shed_rate_limited_total", "Requests rechazados con 5.03 por el limite del origen"},
+    [METRIC_SHED_OVERLOAD]  = {"shed_overload", "coap_shed_overload_total", "Requests rechazados con 5.03 por sobrecarga global"},
+    [METRIC_STALE_DROPS]    = {"stale", "coap_stale_drops_total", "CON descartados por esperar mas que el deadline"},
+    [METRIC_FEED_LAGGED]    = {"feed_lagged", "coap_feed_lagged_total", "Suscriptores del change feed desconectados por atraso"},
+    [METRIC_SNAPSHOTS]      = {"snapshots", "coap_snapshots_total", "Snapshots del data store completados"},
+    [METRIC_TRACE_DROPPED]  = {"trace_dropped", "coap_trace_dropped_total", "Trazas descartadas con la cola del flusher llena"},
+};
+
+static const MetricInfo gauge_info[METRIC_GAUGE_COUNT] = {
+    [METRIC_GAUGE_IN_FLIGHT]     = {"inflight", "coap_in_flight", "Requests en procesamiento"},
+    [METRIC_GAUGE_STORE_ENTRIES] = {"store", "coap_store_entries", "Recursos en el data store"},
+    [METRIC_GAUGE_STORE_BYTES] = {"store_bytes", "coap_store_value_bytes", "Bytes de valores en memoria del data store (comprimidos)"},
+    [METRIC_GAUGE_TTL_KEYS] = {"ttl_keys", "coap_store_ttl_keys", "Claves del data store con TTL"},
+    [METRIC_GAUGE_RESIDENT_BYTES] = {"resident_bytes", "coap_store_resident_bytes", "Bytes en memoria de las entradas del data store"},
+    [METRIC_GAUGE_COLD_KEYS] = {"cold_keys", "coap_store_cold_keys", "Claves del data store en el archivo frio"},
+    [METRIC_GAUGE_INDEX_KEYS] = {"index_keys", "coap_store_index_keys", "Valores distintos en el indice por campo del payload"},
+    [METRIC_GAUGE_INDEX_KEPT_BYTES] = {"index_kept", "coap_store_index_kept_bytes", "Bytes de lecturas que solo guarda el indice (su clave ya tiene otro valor)"},
+    [METRIC_GAUGE_QUEUED]        = {"queued", "coap_queued_requests", "Datagramas esperando un worker"},
+    [METRIC_GAUGE_FEED_SUBSCRIBERS] = {"feed_subs", "coap_feed_subscribers", "Suscriptores del change feed"},
+};
+
+static const MetricInfo hist_info[METRIC_HIST_COUNT] = {
+    [METRIC_HIST_REQUEST_US]   = {"req_us", "coap_request_latency_seconds", "Latencia desde recvfrom hasta la respuesta"},
+    [METRIC_HIST_STORE_SET_US] = {"store_set_us", "coap_store_set_seconds", "Duracion de data_store_set"},
+};
+
+static atomic_ullong counters[METRIC_COUNTER_COUNT];
+static atomic_long gauges[METRIC_GAUGE_COUNT];
+static Histogram histograms[METRIC_HIST_COUNT];
+static uint64_t start_ns = 0;
+
+static char dump_path[256];
+static int dump_interval_s = 0;
+
+uint64_t metrics_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void metrics_init(void)
+{
+    for (int i = 0; i < METRIC_COUNTER_COUNT; i++) atomic_init(&counters[i], 0);
+    for (int i = 0; i < METRIC_GAUGE_COUNT; i++) atomic_init(&gauges[i], 0);
+    for (int i = 0; i < METRIC_HIST_COUNT; i++) hist_init(&histograms[i]);
+    start_ns = metrics_now_ns();
+}
+
+void metrics_inc(MetricCounter c)
+{
+    atomic_fetch_add_explicit(&counters[c], 1, memory_order_relaxed);
+}
+
+void metrics_add(MetricCounter c, uint64_t n)
+{
+    atomic_fetch_add_explicit(&counters[c], n, memory_order_relaxed);
+}
+
+uint64_t metrics_get(MetricCounter c)
+{
+    return atomic_load_explicit(&counters[c], memory_order_relaxed);
+}
+
+void metrics_gauge_add(MetricGauge g, long delta)
+{
+    atomic_fetch_add_explicit(&gauges[g], delta, memory_order_relaxed);
+}
+
+void metrics_gauge_set(MetricGauge g, long value)
+{
+    atomic_store_explicit(&gauges[g], value, memory_order_relaxed);
+}
+
+long metrics_gauge_get(MetricGauge g)
+{
+    return atomic_load_explicit(&gauges[g], memory_order_relaxed);
+}
+
+void metrics_observe(MetricHistogram h, uint64_t value)
+{
+    hist_record(&histograms[h], value);
+}
+
+// Campo pos del snapshot ("up_s", contadores, gauges, histogramas) en buf,
+// sin la coma. Devuelve el largo, 0 si no va (contador en cero, histograma
+// vacío) o -1 si no hay campo pos. Con cap 0 solo da el nombre.
+static int snapshot_field(int pos, char *buf, size_t cap, const char **name)
+{
+    if (pos == 0) {
+        uint64_t uptime_s = start_ns ? (metrics_now_ns() - start_ns) / 1000000000ULL : 0;
+        *name = "up_s";
+        return snprintf(buf, cap, "\"up_s\":%llu", (unsigned long long)uptime_s);
+    }
+    pos--;
+    if (pos < METRIC_COUNTER_COUNT) {
+        uint64_t v = metrics_get((MetricCounter)pos);
+        *name = counter_info[pos].json_key;
+        if (!v) return 0;
+        return snprintf(buf, cap, "\"%s\":%llu", *name, (unsigned long long)v);
+    }
+    pos -= METRIC_COUNTER_COUNT;
+    if (pos < METRIC_GAUGE_COUNT) {
+        *name = gauge_info[pos].json_key;
+        return snprintf(buf, cap, "\"%s\":%ld", *name, metrics_gauge_get((MetricGauge)pos));
+    }
+    pos -= METRIC_GAUGE_COUNT;
+    if (pos < METRIC_HIST_COUNT) {
+        const Histogram *h = &histograms[pos];
+        *name = hist_info[pos].json_key;
+        if (hist_count(h) == 0) return 0;
+        return snprintf(buf, cap, "\"%s\":{\"n\":%llu,\"p50\":%llu,\"p99\":%llu,\"p999\":%llu,\"max\":%llu}",
+                        *name,
+                        (unsigned long long)hist_count(h),
+                        (unsigned long long)hist_percentile(h, 50.0),
+                        (unsigned long long)hist_percentile(h, 99.0),
+                        (unsigned long long)hist_percentile(h, 99.9),
+                        (unsigned long long)hist_max(h));
+    }
+    return -1;
+}
+
+int metrics_snapshot_json(char *out, size_t out_size, const char *after)
+{
+    if (!out || out_size < 3) return -1;
+    const char *name;
+    int pos = 0;
+    if (after) {
+        // Se sigue después del último campo de la página anterior
+        while (snapshot_field(pos, NULL, 0, &name) >= 0 && strcmp(name, after) != 0) pos++;
+        if (snapshot_field(pos++, NULL, 0, &name) < 0) return -1;
+    }
+    size_t off = 0;
+    const char *last = NULL;
+    int more = 0;
+    out[off++] = '{';
+    for (;; pos++) {
+        char field[METRICS_JSON_FIELD_MAX];
+        int n = snapshot_field(pos, field, sizeof(field), &name);
+        if (n < 0) break;
+        if (n == 0) continue;
+        // Lugar para la coma, el campo y el cierre con el cursor: ,"next":"<name>"}
+        size_t close = 11 + strlen(name) + 1;
+        if (off + (last != NULL) + (size_t)n + close + 1 > out_size) {
+            // Ni un campo entra: no se devuelve una página vacía que parezca completa
+            if (!last) return -1;
+            more = 1;
+            break;
+        }
+        if (last) out[off++] = ',';
+        memcpy(out + off, field, (size_t)n);
+        off += (size_t)n;
+        last = name;
+    }
+    if (more) off += (size_t)snprintf(out + off, out_size - off, "%s\"next\":\"%s\"", off > 1 ? "," : "", last);
+    out[off++] = '}';
+    out[off] = '\0';
+    return (int)off;
+}
+
+int metrics_write_prometheus(FILE *f)
+{
+    if (!f) return -1;
+    for (int i = 0; i < METRIC_COUNTER_COUNT; i++) {
+        fprintf(f, "# HELP %s %s\n# TYPE %s counter\n%s %llu\n",
+                counter_info[i].prom_name, counter_info[i].help, counter_info[i].prom_name,
+                counter_info[i].prom_name, (unsigned long long)metrics_get((MetricCounter)i));
+    }
+    for (int i = 0; i < METRIC_GAUGE_COUNT; i++) {
+        fprintf(f, "# HELP %s %s\n# TYPE %s gauge\n%s %ld\n",
+                gauge_info[i].prom_name, gauge_info[i].help, gauge_info[i].prom_name,
+                gauge_info[i].prom_name, metrics_gauge_get((MetricGauge)i));
+    }
+    for (int i = 0; i < METRIC_HIST_COUNT; i++) {
+        const Histogram *h = &histograms[i];
+        const char *name = hist_info[i].prom_name;
+        fprintf(f, "# HELP %s %s\n# TYPE %s histogram\n", name, hist_info[i].help, name);
+
+        // Cortes en los bordes de magnitud del histograma: lo acumulado antes de
+        // 2^k son los valores <= 2^k - 1 us, y 'le' es inclusivo, así que se
+        // publica ese límite (con %.6f para no redondear el microsegundo)
+        uint64_t cumulative = 0;
+        int bucket = 0;
+        for (int k = 4; k <= 24; k++) {
+            uint64_t le_us = (1ULL << k) - 1;
+            while (bucket < HIST_BUCKETS && hist_bucket_upper(bucket) <= le_us) {
+                cumulative += atomic_load_explicit(&h->counts[bucket], memory_order_relaxed);
+                bucket++;
+            }
+            fprintf(f, "%s_bucket{le=\"%.6f\"} %llu\n", name, (double)le_us / 1e6, (unsigned long long)cumulative);
+        }
+        uint64_t count = hist_count(h);
+        fprintf(f, "%s_bucket{le=\"+Inf\"} %llu\n", name, (unsigned long long)count);
+        fprintf(f, "%s_sum %g\n", name, (double)atomic_load_explicit(&h->sum, memory_order_relaxed) / 1e6);
+        fprintf(f, "%s_count %llu\n", name, (unsigned long long)count);
+    }
+    return 0;
+}
+
+static void *prometheus_dump_thread(void *arg)
+{
+    (void)arg;
+    char tmp_path[300];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", dump_path);
+    while (1) {
+        sleep((unsigned)dump_interval_s);
+        FILE *f = fopen(tmp_path, "w");
+        if (!f) {
+            perror("metrics fopen");
+            continue;
+        }
+        metrics_write_prometheus(f);
+        fclose(f);
+        // rename es atómico: quien lea el archivo nunca ve un volcado a medias
+        if (rename(tmp_path, dump_path) != 0) perror("metrics rename");
+    }
+    return NULL;
+}
+
+int metrics_start_prometheus_dump(const char *path, int interval_s)
+{
+    if (!path || !path[0] || interval_s <= 0) return -1;
+    strncpy(dump_path, path, sizeof(dump_path) - 1);
+    dump_path[sizeof(dump_path) - 1] = '\0';
+    dump_interval_s = interval_s;
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, prometheus_dump_thread, NULL) != 0) {
+        fprintf(stderr, "Error al crear thread de metricas\n");
+        return -1;
+    }
+    pthread_detach(thread);
+    return 0;
+}
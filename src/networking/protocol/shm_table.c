@@ -0,0 +1,325 @@
+#include "shm_table.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Todo lo que comparten los procesos está en el mapeo; nada apunta fuera.
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_size;         // sizeof(ShmSlot) del escritor
+    uint32_t slot_count;
+    uint32_t index_size;        // potencia de 2, el doble de slot_count
+    _Atomic uint32_t used;      // slots asignados (se asignan en orden)
+    uint64_t created_ns;
+    uint8_t reserved[32];
+} ShmHeader;
+
+_Static_assert(sizeof(ShmHeader) == 64, "ShmHeader debe ocupar 64 bytes");
+
+// La clave y el hash no cambian una vez que el slot está en el índice; el
+// resto se lee bajo el seqlock.
+typedef struct {
+    _Atomic uint32_t seq;       // impar = escritura en curso
+    uint16_t key_len;
+    uint16_t value_len;
+    uint32_t flags;
+    uint32_t reserved;
+    uint64_t hash;
+    uint64_t version;
+    uint64_t updated_ns;
+    char key[SHM_KEY_MAX];
+    char value[SHM_VALUE_MAX];
+} ShmSlot;
+
+struct ShmTable {
+    char name[64];
+    void *base;
+    size_t map_size;
+    ShmHeader *header;
+    _Atomic uint32_t *index;    // slot + 1, 0 = libre
+    ShmSlot *slots;
+    uint32_t index_mask;
+    int writable;
+};
+
+// FNV-1a: el lector no depende de otros módulos del servidor
+static uint64_t key_hash(const char *key, size_t len)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (uint8_t)key[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h ^ (h >> 29);
+}
+
+static uint64_t realtime_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void shm_name(char *out, size_t size, const char *name)
+{
+    snprintf(out, size, "%s%s", name[0] == '/' ? "" : "/", name);
+}
+
+static size_t index_offset(void)
+{
+    return sizeof(ShmHeader);
+}
+
+static size_t slots_offset(uint32_t index_size)
+{
+    size_t off = index_offset() + (size_t)index_size * sizeof(uint32_t);
+    return (off + 63) & ~(size_t)63;
+}
+
+static void attach(ShmTable *t, void *base, size_t size)
+{
+    t->base = base;
+    t->map_size = size;
+    t->header = (ShmHeader *)base;
+    t->index = (_Atomic uint32_t *)((char *)base + index_offset());
+    t->slots = (ShmSlot *)((char *)base + slots_offset(t->header->index_size));
+    t->index_mask = t->header->index_size - 1;
+}
+
+ShmTable *shm_table_create(const char *name, uint32_t slots)
+{
+    if (!name || !name[0] || slots == 0) return NULL;
+    ShmTable *t = calloc(1, sizeof(ShmTable));
+    if (!t) return NULL;
+    shm_name(t->name, sizeof(t->name), name);
+
+    uint32_t index_size = 64;
+    while (index_size < slots * 2u && index_size < (1u << 31)) index_size <<= 1;
+    size_t size = slots_offset(index_size) + (size_t)slots * sizeof(ShmSlot);
+
+    // Objeto nuevo: los lectores de una tabla anterior siguen con su mapeo
+    shm_unlink(t->name);
+    int fd = shm_open(t->name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        perror("shm_open");
+        free(t);
+        return NULL;
+    }
+    if (ftruncate(fd, (off_t)size) != 0) {
+        perror("ftruncate");
+        close(fd);
+        shm_unlink(t->name);
+        free(t);
+        return NULL;
+    }
+    void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("mmap");
+        shm_unlink(t->name);
+        free(t);
+        return NULL;
+    }
+
+    // ftruncate deja todo en cero: índice vacío y seqlocks pares
+    ShmHeader *h = (ShmHeader *)base;
+    h->version = SHM_TABLE_VERSION;
+    h->slot_size = sizeof(ShmSlot);
+    h->slot_count = slots;
+    h->index_size = index_size;
+    h->created_ns = realtime_ns();
+    atomic_store_explicit(&h->used, 0, memory_order_relaxed);
+    // El magic al final: un lector que abre antes ve la tabla como inválida
+    atomic_thread_fence(memory_order_release);
+    h->magic = SHM_TABLE_MAGIC;
+    attach(t, base, size);
+    t->writable = 1;
+    return t;
+}
+
+ShmTable *shm_table_open(const char *name)
+{
+    if (!name || !name[0]) return NULL;
+    ShmTable *t = calloc(1, sizeof(ShmTable));
+    if (!t) return NULL;
+    shm_name(t->name, sizeof(t->name), name);
+
+    int fd = shm_open(t->name, O_RDONLY, 0);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ShmHeader)) {
+        if (fd >= 0) close(fd);
+        free(t);
+        return NULL;
+    }
+    size_t size = (size_t)st.st_size;
+    void *base = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        free(t);
+        return NULL;
+    }
+
+    const ShmHeader *h = (const ShmHeader *)base;
+    int ok = h->magic == SHM_TABLE_MAGIC && h->version == SHM_TABLE_VERSION &&
+             h->slot_size == sizeof(ShmSlot) && h->index_size != 0 &&
+             (h->index_size & (h->index_size - 1)) == 0 &&
+             slots_offset(h->index_size) + (size_t)h->slot_count * sizeof(ShmSlot) <= size;
+    atomic_thread_fence(memory_order_acquire);
+    if (!ok) {
+        munmap(base, size);
+        free(t);
+        return NULL;
+    }
+    attach(t, base, size);
+    return t;
+}
+
+void shm_table_close(ShmTable *t, int unlink_name)
+{
+    if (!t) return;
+    munmap(t->base, t->map_size);
+    if (unlink_name && t->writable) shm_unlink(t->name);
+    free(t);
+}
+
+// Posición del índice con la clave o, si no está, la primera libre
+static uint32_t find_pos(const ShmTable *t, const char *key, size_t len, uint64_t hash, uint32_t *slot_out)
+{
+    uint32_t pos = (uint32_t)hash & t->index_mask;
+    for (uint32_t probes = 0; probes <= t->index_mask; probes++) {
+        uint32_t e = atomic_load_explicit(&t->index[pos], memory_order_acquire);
+        if (e == 0) break;
+        const ShmSlot *s = &t->slots[e - 1];
+        if (s->hash == hash && s->key_len == len && memcmp(s->key, key, len) == 0) {
+            *slot_out = e - 1;
+            return pos;
+        }
+        pos = (pos + 1) & t->index_mask;
+    }
+    *slot_out = UINT32_MAX;
+    return pos;
+}
+
+static void write_slot(ShmSlot *s, uint32_t flags, const char *value, size_t len)
+{
+    uint32_t seq = atomic_load_explicit(&s->seq, memory_order_relaxed);
+    atomic_store_explicit(&s->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    if (len) memcpy(s->value, value, len);
+    s->value_len = (uint16_t)len;
+    s->flags = flags;
+    s->version++;
+    s->updated_ns = realtime_ns();
+    atomic_store_explicit(&s->seq, seq + 2, memory_order_release);
+}
+
+int shm_table_publish(ShmTable *t, const char *key, size_t key_len,
+                      const char *value, size_t value_len)
+{
+    if (!t || !t->writable || !key || key_len == 0 || key_len > SHM_KEY_MAX) return -1;
+    uint64_t hash = key_hash(key, key_len);
+    uint32_t slot;
+    uint32_t pos = find_pos(t, key, key_len, hash, &slot);
+    uint32_t flags = value_len > SHM_VALUE_MAX ? SHM_SLOT_TOO_LARGE : 0;
+    size_t len = flags ? 0 : value_len;
+
+    if (slot != UINT32_MAX) {
+        write_slot(&t->slots[slot], flags, value, len);
+        return 0;
+    }
+
+    uint32_t used = atomic_load_explicit(&t->header->used, memory_order_relaxed);
+    if (used >= t->header->slot_count) return -1;
+    ShmSlot *s = &t->slots[used];
+    s->hash = hash;
+    s->key_len = (uint16_t)key_len;
+    memcpy(s->key, key, key_len);
+    write_slot(s, flags, value, len);
+    // Primero el slot, después el contador y por último la entrada del índice
+    atomic_store_explicit(&t->header->used, used + 1, memory_order_release);
+    atomic_store_explicit(&t->index[pos], used + 1, memory_order_release);
+    return 0;
+}
+
+int shm_table_remove(ShmTable *t, const char *key, size_t key_len)
+{
+    if (!t || !t->writable || !key || key_len == 0 || key_len > SHM_KEY_MAX) return -1;
+    uint32_t slot;
+    find_pos(t, key, key_len, key_hash(key, key_len), &slot);
+    if (slot != UINT32_MAX) write_slot(&t->slots[slot], SHM_SLOT_DELETED, NULL, 0);
+    return 0;
+}
+
+// Copia consistente de la parte variable del slot (reintenta mientras el
+// escritor lo esté modificando)
+static void read_slot(const ShmSlot *s, ShmValue *v, char *value, size_t value_size)
+{
+    for (;;) {
+        uint32_t seq = atomic_load_explicit(&s->seq, memory_order_acquire);
+        if (seq & 1) continue;
+        size_t len = s->value_len;
+        if (len > SHM_VALUE_MAX) len = SHM_VALUE_MAX;
+        if (len >= value_size) len = value_size - 1;
+        memcpy(value, s->value, len);
+        v->flags = s->flags;
+        v->version = s->version;
+        v->updated_ns = s->updated_ns;
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&s->seq, memory_order_relaxed) == seq) {
+            value[len] = '\0';
+            return;
+        }
+    }
+}
+
+int shm_table_get(const ShmTable *t, const char *key, char *out, size_t out_size,
+                  uint64_t *version)
+{
+    if (!t || !key || !out || out_size == 0) return SHM_NOT_FOUND;
+    size_t key_len = strlen(key);
+    if (key_len == 0 || key_len > SHM_KEY_MAX) return SHM_NOT_FOUND;
+    uint32_t slot;
+    find_pos(t, key, key_len, key_hash(key, key_len), &slot);
+    if (slot == UINT32_MAX) return SHM_NOT_FOUND;
+
+    ShmValue v;
+    read_slot(&t->slots[slot], &v, out, out_size);
+    if (version) *version = v.version;
+    if (v.flags & SHM_SLOT_DELETED) {
+        out[0] = '\0';
+        return SHM_NOT_FOUND;
+    }
+    if (v.flags & SHM_SLOT_TOO_LARGE) return SHM_TOO_LARGE;
+    return (int)strlen(out);
+}
+
+size_t shm_table_scan(const ShmTable *t, shm_table_fn fn, void *ctx)
+{
+    if (!t || !fn) return 0;
+    uint32_t used = atomic_load_explicit(&t->header->used, memory_order_acquire);
+    if (used > t->header->slot_count) used = t->header->slot_count;
+    ShmValue v;
+    size_t visited = 0;
+    for (uint32_t i = 0; i < used; i++) {
+        const ShmSlot *s = &t->slots[i];
+        size_t klen = s->key_len < SHM_KEY_MAX ? s->key_len : SHM_KEY_MAX;
+        memcpy(v.key, s->key, klen);
+        v.key[klen] = '\0';
+        read_slot(s, &v, v.value, sizeof(v.value));
+        visited++;
+        if (fn(&v, ctx) != 0) break;
+    }
+    return visited;
+}
+
+uint32_t shm_table_count(const ShmTable *t)
+{
+    return t ? atomic_load_explicit(&t->header->used, memory_order_acquire) : 0;
+}
@@ -0,0 +1,122 @@
+#include "skiplist.h"
+#include <stdlib.h>
+#include <string.h>
+
+struct SkipList {
+    SkipNode *head;                 // centinela sin clave, con todos los niveles
+    int level;                      // niveles en uso
+    size_t count;
+    uint64_t rng;
+};
+
+static int compare(const InternKey *k, const char *s, size_t len)
+{
+    size_t n = k->len < len ? k->len : len;
+    int c = memcmp(k->str, s, n);
+    if (c != 0) return c;
+    return k->len < len ? -1 : k->len > len;
+}
+
+static SkipNode *node_create(const InternKey *key, int level)
+{
+    SkipNode *node = calloc(1, sizeof(SkipNode) + (size_t)level * sizeof(SkipNode *));
+    if (!node) return NULL;
+    node->key = key;
+    node->level = (uint8_t)level;
+    return node;
+}
+
+// Un nivel más con probabilidad 1/4 (xorshift: no hace falta más)
+static int random_level(SkipList *sl)
+{
+    uint64_t x = sl->rng;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    sl->rng = x;
+    int level = 1;
+    while (level < SKIPLIST_MAX_LEVEL && (x & 3) == 0) {
+        level++;
+        x >>= 2;
+    }
+    return level;
+}
+
+SkipList *skiplist_create(void)
+{
+    SkipList *sl = calloc(1, sizeof(SkipList));
+    if (!sl) return NULL;
+    sl->head = node_create(NULL, SKIPLIST_MAX_LEVEL);
+    if (!sl->head) {
+        free(sl);
+        return NULL;
+    }
+    sl->level = 1;
+    sl->rng = 0x9e3779b97f4a7c15ULL;
+    return sl;
+}
+
+void skiplist_destroy(SkipList *sl)
+{
+    if (!sl) return;
+    SkipNode *node = sl->head;
+    while (node) {
+        SkipNode *next = node->next[0];
+        free(node);
+        node = next;
+    }
+    free(sl);
+}
+
+// Último nodo de cada nivel con clave < s
+static void find_before(const SkipList *sl, const char *s, size_t len, SkipNode *before[SKIPLIST_MAX_LEVEL])
+{
+    SkipNode *node = sl->head;
+    for (int i = sl->level - 1; i >= 0; i--) {
+        while (node->next[i] && compare(node->next[i]->key, s, len) < 0) node = node->next[i];
+        before[i] = node;
+    }
+}
+
+int skiplist_insert(SkipList *sl, const InternKey *key)
+{
+    SkipNode *before[SKIPLIST_MAX_LEVEL];
+    find_before(sl, key->str, key->len, before);
+    if (before[0]->next[0] && before[0]->next[0]->key == key) return 1;
+    int level = random_level(sl);
+    for (int i = sl->level; i < level; i++) before[i] = sl->head;
+    SkipNode *node = node_create(key, level);
+    if (!node) return -1;
+    for (int i = 0; i < level; i++) {
+        node->next[i] = before[i]->next[i];
+        before[i]->next[i] = node;
+    }
+    if (level > sl->level) sl->level = level;
+    sl->count++;
+    return 0;
+}
+
+int skiplist_remove(SkipList *sl, const InternKey *key)
+{
+    SkipNode *before[SKIPLIST_MAX_LEVEL];
+    find_before(sl, key->str, key->len, before);
+    SkipNode *node = before[0]->next[0];
+    if (!node || node->key != key) return 0;
+    for (int i = 0; i < node->level; i++) before[i]->next[i] = node->next[i];
+    while (sl->level > 1 && !sl->head->next[sl->level - 1]) sl->level--;
+    free(node);
+    sl->count--;
+    return 1;
+}
+
+const SkipNode *skiplist_seek(const SkipList *sl, const char *s, size_t len)
+{
+    SkipNode *before[SKIPLIST_MAX_LEVEL];
+    find_before(sl, s, len, before);
+    return before[0]->next[0];
+}
+
+size_t skiplist_count(const SkipList *sl)
+{
+    return sl ? sl->count : 0;
+}
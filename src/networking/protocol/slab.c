@@ -0,0 +1,210 @@
+#include "slab.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+// Slabs alineados a su tamaño: el dueño de un objeto se encuentra
+// enmascarando el puntero, sin cabecera por objeto
+#define SLAB_BYTES      (64 * 1024)
+#define SLAB_HEADER     64      // los objetos de 64 bytes quedan alineados a línea de cache
+
+typedef struct SlabHeap SlabHeap;
+
+// Un objeto libre guarda el siguiente en sus primeros bytes
+typedef struct SlabObj {
+    struct SlabObj *next;
+} SlabObj;
+
+struct SlabHeap {
+    SlabPool *pool;
+    SlabObj *local_free;                // solo el thread dueño
+    _Atomic(SlabObj *) remote_free;     // pushes de otros threads
+    SlabHeap *orphan_next;
+    SlabHeap *all_next;
+};
+
+typedef struct Slab {
+    struct Slab *next;
+    SlabHeap *owner;
+} Slab;
+
+struct SlabPool {
+    int id;
+    const char *name;
+    size_t obj_size;
+    uint32_t objs_per_slab;
+    pthread_mutex_t lock;
+    Slab *slabs;
+    SlabHeap *heaps;        // todos, para liberar
+    SlabHeap *orphans;
+    atomic_ullong slab_count;
+    atomic_ullong object_count;
+};
+
+static SlabPool *pools[SLAB_MAX_POOLS];
+static pthread_mutex_t pools_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t heap_key;
+static pthread_once_t heap_key_once = PTHREAD_ONCE_INIT;
+static __thread SlabHeap *tls_heaps[SLAB_MAX_POOLS];
+
+// Al terminar el thread sus heaps quedan para el próximo que los pida
+static void release_heaps(void *unused)
+{
+    (void)unused;
+    for (int i = 0; i < SLAB_MAX_POOLS; i++) {
+        SlabHeap *h = tls_heaps[i];
+        if (!h) continue;
+        tls_heaps[i] = NULL;
+        SlabPool *p = h->pool;
+        pthread_mutex_lock(&p->lock);
+        h->orphan_next = p->orphans;
+        p->orphans = h;
+        pthread_mutex_unlock(&p->lock);
+    }
+}
+
+static void make_heap_key(void)
+{
+    pthread_key_create(&heap_key, release_heaps);
+}
+
+SlabPool *slab_pool_create(const char *name, size_t obj_size)
+{
+    pthread_once(&heap_key_once, make_heap_key);
+    SlabPool *p = calloc(1, sizeof(SlabPool));
+    if (!p) return NULL;
+    p->name = name;
+    p->obj_size = (obj_size + 15) & ~(size_t)15;
+    if (p->obj_size < sizeof(SlabObj)) p->obj_size = 16;
+    if (p->obj_size > SLAB_BYTES - SLAB_HEADER) {
+        free(p);
+        return NULL;
+    }
+    p->objs_per_slab = (uint32_t)((SLAB_BYTES - SLAB_HEADER) / p->obj_size);
+    pthread_mutex_init(&p->lock, NULL);
+
+    pthread_mutex_lock(&pools_lock);
+    p->id = -1;
+    for (int i = 0; i < SLAB_MAX_POOLS; i++) {
+        if (!pools[i]) {
+            pools[i] = p;
+            p->id = i;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&pools_lock);
+    if (p->id < 0) {
+        pthread_mutex_destroy(&p->lock);
+        free(p);
+        return NULL;
+    }
+    return p;
+}
+
+void slab_pool_destroy(SlabPool *p)
+{
+    if (!p) return;
+    pthread_mutex_lock(&pools_lock);
+    pools[p->id] = NULL;
+    pthread_mutex_unlock(&pools_lock);
+    // El heap del thread actual; los de otros threads vivos quedan colgando
+    tls_heaps[p->id] = NULL;
+    while (p->slabs) {
+        Slab *next = p->slabs->next;
+        free(p->slabs);
+        p->slabs = next;
+    }
+    while (p->heaps) {
+        SlabHeap *next = p->heaps->all_next;
+        free(p->heaps);
+        p->heaps = next;
+    }
+    pthread_mutex_destroy(&p->lock);
+    free(p);
+}
+
+static SlabHeap *attach_heap(SlabPool *p)
+{
+    pthread_mutex_lock(&p->lock);
+    SlabHeap *h = p->orphans;
+    if (h) {
+        p->orphans = h->orphan_next;
+    } else {
+        h = calloc(1, sizeof(SlabHeap));
+        if (h) {
+            h->pool = p;
+            atomic_init(&h->remote_free, NULL);
+            h->all_next = p->heaps;
+            p->heaps = h;
+        }
+    }
+    pthread_mutex_unlock(&p->lock);
+    if (!h) return NULL;
+    h->orphan_next = NULL;
+    tls_heaps[p->id] = h;
+    // Cualquier valor no nulo hace que corra release_heaps al salir
+    pthread_setspecific(heap_key, tls_heaps);
+    return h;
+}
+
+// Un slab nuevo, ya encadenado como lista libre de h
+static SlabObj *grow_heap(SlabHeap *h)
+{
+    SlabPool *p = h->pool;
+    Slab *slab = aligned_alloc(SLAB_BYTES, SLAB_BYTES);
+    if (!slab) return NULL;
+    slab->owner = h;
+    pthread_mutex_lock(&p->lock);
+    slab->next = p->slabs;
+    p->slabs = slab;
+    pthread_mutex_unlock(&p->lock);
+    atomic_fetch_add_explicit(&p->slab_count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&p->object_count, p->objs_per_slab, memory_order_relaxed);
+
+    uint8_t *base = (uint8_t *)slab + SLAB_HEADER;
+    SlabObj *first = NULL;
+    for (uint32_t i = p->objs_per_slab; i-- > 0;) {
+        SlabObj *o = (SlabObj *)(base + (size_t)i * p->obj_size);
+        o->next = first;
+        first = o;
+    }
+    return first;
+}
+
+void *slab_alloc(SlabPool *p)
+{
+    SlabHeap *h = tls_heaps[p->id];
+    if (!h && !(h = attach_heap(p))) return NULL;
+    SlabObj *o = h->local_free;
+    if (!o) {
+        o = atomic_exchange_explicit(&h->remote_free, NULL, memory_order_acquire);
+        if (!o && !(o = grow_heap(h))) return NULL;
+    }
+    h->local_free = o->next;
+    return o;
+}
+
+void slab_free(void *obj)
+{
+    if (!obj) return;
+    SlabObj *o = (SlabObj *)obj;
+    SlabHeap *h = ((Slab *)((uintptr_t)obj & ~(uintptr_t)(SLAB_BYTES - 1)))->owner;
+    if (h == tls_heaps[h->pool->id]) {
+        o->next = h->local_free;
+        h->local_free = o;
+        return;
+    }
+    // El dueño se lleva la lista entera con un exchange: no hay ABA
+    SlabObj *head = atomic_load_explicit(&h->remote_free, memory_order_relaxed);
+    do {
+        o->next = head;
+    } while (!atomic_compare_exchange_weak_explicit(&h->remote_free, &head, o,
+                                                    memory_order_release, memory_order_relaxed));
+}
+
+void slab_pool_stats(const SlabPool *p, SlabStats *out)
+{
+    out->slabs = atomic_load_explicit(&((SlabPool *)p)->slab_count, memory_order_relaxed);
+    out->objects = atomic_load_explicit(&((SlabPool *)p)->object_count, memory_order_relaxed);
+}
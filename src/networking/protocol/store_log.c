@@ -0,0 +1,76 @@
+#include "store_log.h"
+#include "crc32c.h"
+#include <string.h>
+
+_Static_assert(sizeof(StoreRecordHeader) == 40, "StoreRecordHeader debe ocupar 40 bytes");
+
+// El CRC cubre desde type hasta el final del valor
+#define CRC_START offsetof(StoreRecordHeader, type)
+
+size_t store_log_encode(char *out, size_t cap, const StoreRecord *rec)
+{
+    if (rec->key_len > STORE_LOG_KEY_MAX || rec->value_len > STORE_LOG_VALUE_MAX) return 0;
+    size_t size = store_log_record_size(rec->key_len, rec->value_len);
+    if (size > cap) return 0;
+    StoreRecordHeader h;
+    memset(&h, 0, sizeof(h));
+    h.len = (uint32_t)(size - CRC_START);
+    h.type = (uint8_t)rec->type;
+    h.flags = (uint8_t)rec->flags;
+    h.key_len = (uint16_t)rec->key_len;
+    h.value_len = (uint32_t)rec->value_len;
+    h.version = rec->version;
+    h.timestamp_ms = rec->timestamp_ms;
+    h.expires_ms = rec->expires_ms;
+    memcpy(out, &h, sizeof(h));
+    if (rec->key_len) memcpy(out + sizeof(h), rec->key, rec->key_len);
+    if (rec->value_len) memcpy(out + sizeof(h) + rec->key_len, rec->value, rec->value_len);
+    h.crc = crc32c(out + CRC_START, h.len);
+    memcpy(out + offsetof(StoreRecordHeader, crc), &h.crc, sizeof(h.crc));
+    return size;
+}
+
+int store_log_open(StoreLogReader *rd, FILE *f)
+{
+    char magic[STORE_LOG_MAGIC_LEN];
+    rd->f = f;
+    rd->offset = 0;
+    if (fread(magic, 1, sizeof(magic), f) == sizeof(magic) &&
+        memcmp(magic, STORE_LOG_MAGIC, STORE_LOG_MAGIC_LEN) == 0) {
+        rd->offset = STORE_LOG_MAGIC_LEN;
+        return 1;
+    }
+    rewind(f);
+    return 0;
+}
+
+int store_log_read(StoreLogReader *rd, StoreRecord *rec)
+{
+    StoreRecordHeader h;
+    size_t got = fread(&h, 1, sizeof(h), rd->f);
+    if (got == 0 && feof(rd->f)) return 0;
+    if (got != sizeof(h)) return -1;
+    // El largo tiene que cerrar con los de clave y valor antes de leer nada más
+    if (h.key_len > STORE_LOG_KEY_MAX || h.value_len > STORE_LOG_VALUE_MAX ||
+        h.len != sizeof(h) - CRC_START + h.key_len + h.value_len) {
+        return -1;
+    }
+    size_t body = (size_t)h.key_len + h.value_len;
+    memcpy(rd->buf, &h, sizeof(h));
+    if (fread(rd->buf + sizeof(h), 1, body, rd->f) != body) return -1;
+    if (crc32c(rd->buf + CRC_START, h.len) != h.crc) return -1;
+    if (h.type < STORE_REC_VALUE || h.type > STORE_REC_INDEXED) return -1;
+
+    rec->type = (StoreRecordType)h.type;
+    rec->flags = h.flags;
+    rec->version = h.version;
+    rec->timestamp_ms = h.timestamp_ms;
+    rec->expires_ms = h.expires_ms;
+    rec->key = rd->buf + sizeof(h);
+    rec->key_len = h.key_len;
+    rd->buf[sizeof(h) + body] = '\0';
+    rec->value = rd->buf + sizeof(h) + h.key_len;
+    rec->value_len = h.value_len;
+    rd->offset += sizeof(h) + body;
+    return 1;
+}
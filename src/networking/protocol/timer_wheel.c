@@ -0,0 +1,211 @@
+#include "timer_wheel.h"
+#include <stdlib.h>
+
+static void list_remove(TimerEntry *t)
+{
+    t->prev->next = t->next;
+    t->next->prev = t->prev;
+    t->prev = t->next = NULL;
+}
+
+int timer_wheel_init(TimerWheel *w, uint32_t slots, uint32_t tick_ms, uint64_t now_ms)
+{
+    uint32_t n = 16;
+    while (n < slots) n <<= 1;
+    w->slots = malloc(sizeof(TimerEntry) * n);
+    if (!w->slots) return -1;
+    for (uint32_t i = 0; i < n; i++) {
+        w->slots[i].prev = w->slots[i].next = &w->slots[i];
+    }
+    w->mask = n - 1;
+    w->tick_ms = tick_ms > 0 ? tick_ms : 1;
+    w->current_tick = now_ms / w->tick_ms;
+    w->count = 0;
+    return 0;
+}
+
+void timer_wheel_free(TimerWheel *w)
+{
+    free(w->slots);
+    w->slots = NULL;
+    w->count = 0;
+}
+
+void timer_wheel_add(TimerWheel *w, TimerEntry *timer, uint64_t expires_ms)
+{
+    if (timer->armed) timer_wheel_cancel(w, timer);
+    // Redondeo hacia arriba: nunca disparar antes de tiempo
+    uint64_t tick = (expires_ms + w->tick_ms - 1) / w->tick_ms;
+    if (tick <= w->current_tick) tick = w->current_tick + 1;
+    timer->expires_tick = tick;
+
+    TimerEntry *head = &w->slots[tick & w->mask];
+    timer->next = head;
+    timer->prev = head->prev;
+    head->prev->next = timer;
+    head->prev = timer;
+    timer->armed = 1;
+    w->count++;
+}
+
+void timer_wheel_cancel(TimerWheel *w, TimerEntry *timer)
+{
+    if (!timer->armed) return;
+    list_remove(timer);
+    timer->armed = 0;
+    w->count--;
+}
+
+int timer_wheel_advance(TimerWheel *w, uint64_t now_ms, timer_fn fn, void *ctx)
+{
+    uint64_t target = now_ms / w->tick_ms;
+    int fired = 0;
+    // Con la rueda vacía no hace falta recorrer los ticks intermedios
+    if (w->count == 0) {
+        if (target > w->current_tick) w->current_tick = target;
+        return 0;
+    }
+    // Más de una vuelta de atraso: basta con una pasada por todos los slots
+    if (target - w->current_tick > w->mask + 1) w->current_tick = target - (w->mask + 1);
+
+    while (w->current_tick < target) {
+        w->current_tick++;
+        TimerEntry *head = &w->slots[w->current_tick & w->mask];
+        // Se separan primero los vencidos: fn puede re-armar en este mismo slot
+        TimerEntry expired = {&expired, &expired, 0, 0};
+        TimerEntry *t = head->next;
+        while (t != head) {
+            TimerEntry *next = t->next;
+            if (t->expires_tick <= target) {
+                list_remove(t);
+                t->next = &expired;
+                t->prev = expired.prev;
+                expired.prev->next = t;
+                expired.prev = t;
+            }
+            t = next;
+        }
+        while (expired.next != &expired) {
+            TimerEntry *e = expired.next;
+            list_remove(e);
+            e->armed = 0;
+            w->count--;
+            fired++;
+            fn(e, ctx);
+        }
+    }
+    return fired;
+}
+
+int timer_wheel_next_timeout_ms(const TimerWheel *w, uint64_t now_ms)
+{
+    if (w->count == 0) return -1;
+    // Busca el primer slot no vacío dentro de una vuelta
+    for (uint32_t i = 1; i <= w->mask + 1; i++) {
+        uint64_t tick = w->current_tick + i;
+        const TimerEntry *head = &w->slots[tick & w->mask];
+        if (head->next != head) {
+            uint64_t at = tick * w->tick_ms;
+            return at > now_ms ? (int)(at - now_ms) : 0;
+        }
+    }
+    return (int)w->tick_ms;
+}
+
+static void list_append(TimerEntry *head, TimerEntry *t)
+{
+    t->next = head;
+    t->prev = head->prev;
+    head->prev->next = t;
+    head->prev = t;
+}
+
+void timer_hwheel_init(HierTimerWheel *w, uint32_t tick_ms, uint64_t now_ms)
+{
+    for (int l = 0; l < TIMER_HWHEEL_LEVELS; l++) {
+        for (uint32_t i = 0; i < TIMER_HWHEEL_SLOTS; i++) {
+            w->slots[l][i].prev = w->slots[l][i].next = &w->slots[l][i];
+        }
+    }
+    w->tick_ms = tick_ms > 0 ? tick_ms : 1;
+    w->current_tick = now_ms / w->tick_ms;
+    w->count = 0;
+}
+
+// Slot según la distancia al tick actual: nivel n si faltan menos de 64^(n+1)
+static void hwheel_place(HierTimerWheel *w, TimerEntry *t)
+{
+    uint64_t tick = t->expires_tick;
+    uint64_t delta = tick > w->current_tick ? tick - w->current_tick : 0;
+    int level = 0;
+    while (level < TIMER_HWHEEL_LEVELS - 1 && (delta >> (TIMER_HWHEEL_BITS * (level + 1))) != 0) level++;
+    // Más allá del alcance: al slot más lejano; al bajar se vuelve a ubicar
+    uint64_t span = 1ULL << (TIMER_HWHEEL_BITS * TIMER_HWHEEL_LEVELS);
+    if (delta >= span) tick = w->current_tick + span - 1;
+    uint32_t idx = (uint32_t)(tick >> (TIMER_HWHEEL_BITS * level)) & (TIMER_HWHEEL_SLOTS - 1);
+    list_append(&w->slots[level][idx], t);
+}
+
+void timer_hwheel_add(HierTimerWheel *w, TimerEntry *timer, uint64_t expires_ms)
+{
+    if (timer->armed) timer_hwheel_cancel(w, timer);
+    uint64_t tick = (expires_ms + w->tick_ms - 1) / w->tick_ms;
+    if (tick <= w->current_tick) tick = w->current_tick + 1;
+    timer->expires_tick = tick;
+    hwheel_place(w, timer);
+    timer->armed = 1;
+    w->count++;
+}
+
+void timer_hwheel_cancel(HierTimerWheel *w, TimerEntry *timer)
+{
+    if (!timer->armed) return;
+    list_remove(timer);
+    timer->armed = 0;
+    w->count--;
+}
+
+int timer_hwheel_advance(HierTimerWheel *w, uint64_t now_ms, timer_fn fn, void *ctx)
+{
+    uint64_t target = now_ms / w->tick_ms;
+    int fired = 0;
+    while (w->current_tick < target) {
+        if (w->count == 0) {
+            w->current_tick = target;
+            break;
+        }
+        w->current_tick++;
+        // Los niveles cuya vuelta de abajo se completó bajan su slot, de
+        // arriba hacia abajo (lo que baja puede caer en el slot siguiente)
+        int top = 0;
+        while (top + 1 < TIMER_HWHEEL_LEVELS &&
+               (w->current_tick & ((1ULL << (TIMER_HWHEEL_BITS * (top + 1))) - 1)) == 0) top++;
+        for (int l = top; l >= 1; l--) {
+            TimerEntry *head = &w->slots[l][(w->current_tick >> (TIMER_HWHEEL_BITS * l)) & (TIMER_HWHEEL_SLOTS - 1)];
+            TimerEntry moving = {&moving, &moving, 0, 0};
+            // Se mueve la lista entera antes de reubicar: pueden volver acá
+            if (head->next != head) {
+                moving.next = head->next;
+                moving.prev = head->prev;
+                moving.next->prev = &moving;
+                moving.prev->next = &moving;
+                head->next = head->prev = head;
+            }
+            while (moving.next != &moving) {
+                TimerEntry *t = moving.next;
+                list_remove(t);
+                hwheel_place(w, t);
+            }
+        }
+        TimerEntry *head = &w->slots[0][w->current_tick & (TIMER_HWHEEL_SLOTS - 1)];
+        while (head->next != head) {
+            TimerEntry *t = head->next;
+            list_remove(t);
+            t->armed = 0;
+            w->count--;
+            fired++;
+            fn(t, ctx);
+        }
+    }
+    return fired;
+}
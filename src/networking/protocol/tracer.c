@@ -0,0 +1,309 @@
+#include "tracer.h"
+#include "metrics.h"
+#include "slab.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/syscall.h>
+
+#define TRACE_MAX_SPANS 32
+#define TRACE_MAX_DEPTH 8
+#define TRACE_LABEL_SIZE 128
+// Requests terminadas esperando al flusher; las que no entran se descartan
+#define TRACE_MAX_PENDING 4096
+#define TRACE_FLUSH_MS 100
+
+typedef struct {
+    const char *name;
+    uint64_t start_ns;
+    uint64_t end_ns;
+} TraceSpan;
+
+typedef struct {
+    int active;
+    int sampled;
+    uint64_t start_ns;
+    char label[TRACE_LABEL_SIZE];
+    TraceSpan spans[TRACE_MAX_SPANS];
+    int span_count;
+    int open[TRACE_MAX_DEPTH];
+    int depth;
+    long tid;                   // 0 = todavía no se pidió
+} TraceBuffer;
+
+// Request muestreada lista para escribir. Los threads de request la apilan
+// con un CAS y el flusher se lleva la pila entera con un exchange, como la
+// lista remota de slab.c: el fprintf y el fflush no frenan a ningún request.
+typedef struct TraceRecord {
+    struct TraceRecord *next;
+    long tid;
+    int slow;
+    int span_count;
+    uint64_t start_ns;
+    uint64_t end_ns;
+    char label[TRACE_LABEL_SIZE];
+    TraceSpan spans[TRACE_MAX_SPANS];
+} TraceRecord;
+
+static __thread TraceBuffer tls_trace;
+
+// 1 mientras el tracer acepta requests. trace_pushing cuenta los requests que
+// están apilando un registro: el shutdown baja el flag, espera que llegue a 0
+// y recién ahí hace la última pasada, así no queda nada en la pila sin liberar.
+// Flag y contador van seq_cst porque cada lado escribe uno y lee el otro.
+static atomic_int trace_on = 0;
+static atomic_int trace_pushing = 0;
+// Solo el flusher (y el shutdown, después del join) escriben acá
+static FILE *trace_out = NULL;
+static SlabPool *record_pool = NULL;
+static _Atomic(TraceRecord *) pending = NULL;
+static atomic_int pending_count = 0;
+
+static pthread_t flusher_thread;
+static pthread_mutex_t flusher_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t flusher_cond = PTHREAD_COND_INITIALIZER;
+static int flusher_running = 0;
+
+static int trace_sample_every = 0;
+static uint64_t trace_threshold_ns = 0;
+static uint64_t trace_epoch_ns = 0;
+static atomic_ulong trace_request_seq = 0;
+
+// Escribe lo encolado hasta ahora, en el orden en que terminó
+static void write_pending(FILE *f)
+{
+    TraceRecord *r = atomic_exchange_explicit(&pending, NULL, memory_order_acquire);
+    if (!r) return;
+    TraceRecord *ordered = NULL;
+    int n = 0;
+    while (r) {
+        TraceRecord *next = r->next;
+        r->next = ordered;
+        ordered = r;
+        r = next;
+        n++;
+    }
+    atomic_fetch_sub_explicit(&pending_count, n, memory_order_relaxed);
+
+    while (ordered) {
+        r = ordered;
+        fprintf(f,
+                "{\"name\":\"request\",\"cat\":\"coap\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%ld,"
+                "\"args\":{\"label\":\"%s\",\"slow\":%d}},\n",
+                (double)(r->start_ns - trace_epoch_ns) / 1000.0,
+                (double)(r->end_ns - r->start_ns) / 1000.0, r->tid, r->label, r->slow);
+        for (int i = 0; i < r->span_count; i++) {
+            const TraceSpan *s = &r->spans[i];
+            uint64_t span_end = s->end_ns ? s->end_ns : r->end_ns;
+            fprintf(f,
+                    "{\"name\":\"%s\",\"cat\":\"coap\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%ld},\n",
+                    s->name,
+                    (double)(s->start_ns - trace_epoch_ns) / 1000.0,
+                    (double)(span_end - s->start_ns) / 1000.0, r->tid);
+        }
+        ordered = r->next;
+        slab_free(r);
+    }
+    fflush(f);
+}
+
+static void *flusher_main(void *arg)
+{
+    (void)arg;
+    pthread_mutex_lock(&flusher_mutex);
+    while (flusher_running) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += TRACE_FLUSH_MS * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        int rc = 0;
+        while (flusher_running && rc != ETIMEDOUT) {
+            rc = pthread_cond_timedwait(&flusher_cond, &flusher_mutex, &deadline);
+        }
+        pthread_mutex_unlock(&flusher_mutex);
+        write_pending(trace_out);
+        pthread_mutex_lock(&flusher_mutex);
+    }
+    pthread_mutex_unlock(&flusher_mutex);
+    return NULL;
+}
+
+int tracer_init(const char *path, int sample_every, uint64_t threshold_us)
+{
+    if (!path || !path[0]) return 0;
+    if (!record_pool) record_pool = slab_pool_create("TraceRecord", sizeof(TraceRecord));
+    if (!record_pool) {
+        fprintf(stderr, "No se pudo crear el pool de trazas\n");
+        return -1;
+    }
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "No se pudo abrir el archivo de trazas: %s\n", path);
+        return -1;
+    }
+    trace_sample_every = sample_every > 0 ? sample_every : 0;
+    trace_threshold_ns = threshold_us * 1000ULL;
+    trace_epoch_ns = metrics_now_ns();
+    // Array JSON sin cerrar: Chrome y Perfetto lo aceptan si el proceso muere
+    fprintf(f, "[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"coap-server\"}},\n");
+    fflush(f);
+    trace_out = f;
+    flusher_running = 1;
+    if (pthread_create(&flusher_thread, NULL, flusher_main, NULL) != 0) {
+        fprintf(stderr, "No se pudo crear el thread de trazas\n");
+        flusher_running = 0;
+        fclose(f);
+        trace_out = NULL;
+        return -1;
+    }
+    atomic_store_explicit(&trace_on, 1, memory_order_release);
+    return 0;
+}
+
+void tracer_shutdown(void)
+{
+    if (!trace_out) return;
+    // Los requests dejan de encolar; los que ya estaban apilando terminan
+    atomic_store(&trace_on, 0);
+    while (atomic_load(&trace_pushing) > 0) sched_yield();
+
+    // El flusher termina su pasada
+    pthread_mutex_lock(&flusher_mutex);
+    flusher_running = 0;
+    pthread_cond_signal(&flusher_cond);
+    pthread_mutex_unlock(&flusher_mutex);
+    pthread_join(flusher_thread, NULL);
+
+    write_pending(trace_out);
+    fprintf(trace_out, "{}]\n");
+    fclose(trace_out);
+    trace_out = NULL;
+}
+
+int tracer_enabled(void)
+{
+    return atomic_load_explicit(&trace_on, memory_order_acquire);
+}
+
+static void copy_label(char *dst, const char *src)
+{
+    size_t j = 0;
+    for (size_t i = 0; src && src[i] && j + 2 < TRACE_LABEL_SIZE; i++) {
+        char c = src[i];
+        if (c == '"' || c == '\\') dst[j++] = '\\';
+        else if ((unsigned char)c < 0x20) c = '?';
+        dst[j++] = c;
+    }
+    dst[j] = '\0';
+}
+
+void tracer_request_begin(uint64_t rx_ns, const char *label)
+{
+    if (!tracer_enabled()) return;
+    TraceBuffer *t = &tls_trace;
+    t->active = 1;
+    t->span_count = 0;
+    t->depth = 0;
+    t->start_ns = rx_ns ? rx_ns : metrics_now_ns();
+    copy_label(t->label, label);
+
+    unsigned long seq = atomic_fetch_add_explicit(&trace_request_seq, 1, memory_order_relaxed);
+    t->sampled = trace_sample_every > 0 && (seq % (unsigned long)trace_sample_every) == 0;
+}
+
+void tracer_request_label(const char *label)
+{
+    if (!tracer_enabled() || !tls_trace.active) return;
+    copy_label(tls_trace.label, label);
+}
+
+void tracer_span_add(const char *name, uint64_t start_ns, uint64_t end_ns)
+{
+    TraceBuffer *t = &tls_trace;
+    if (!tracer_enabled() || !t->active || t->span_count >= TRACE_MAX_SPANS) return;
+    TraceSpan *s = &t->spans[t->span_count++];
+    s->name = name;
+    s->start_ns = start_ns;
+    s->end_ns = end_ns;
+}
+
+void tracer_span_begin(const char *name)
+{
+    TraceBuffer *t = &tls_trace;
+    if (!tracer_enabled() || !t->active) return;
+    if (t->depth >= TRACE_MAX_DEPTH || t->span_count >= TRACE_MAX_SPANS) {
+        // Se marca el nivel igual para que el span_end correspondiente no cierre otro span
+        if (t->depth < TRACE_MAX_DEPTH) t->open[t->depth] = -1;
+        t->depth++;
+        return;
+    }
+    int idx = t->span_count++;
+    t->spans[idx].name = name;
+    t->spans[idx].start_ns = metrics_now_ns();
+    t->spans[idx].end_ns = 0;
+    t->open[t->depth++] = idx;
+}
+
+void tracer_span_end(void)
+{
+    TraceBuffer *t = &tls_trace;
+    if (!tracer_enabled() || !t->active || t->depth == 0) return;
+    t->depth--;
+    if (t->depth >= TRACE_MAX_DEPTH) return;
+    int idx = t->open[t->depth];
+    if (idx >= 0) t->spans[idx].end_ns = metrics_now_ns();
+}
+
+void tracer_request_end(void)
+{
+    TraceBuffer *t = &tls_trace;
+    if (!tracer_enabled() || !t->active) return;
+    t->active = 0;
+
+    uint64_t end_ns = metrics_now_ns();
+    int slow = trace_threshold_ns > 0 && end_ns - t->start_ns >= trace_threshold_ns;
+    if (!t->sampled && !slow) return;
+
+    // Anunciarse antes de mirar el flag: si el shutdown ya lo bajó, no se
+    // apila; si no, el shutdown espera a que este push termine
+    atomic_fetch_add(&trace_pushing, 1);
+    if (!atomic_load(&trace_on)) {
+        atomic_fetch_sub(&trace_pushing, 1);
+        return;
+    }
+    // Con el flusher atrasado se pierde la traza, no la latencia del request
+    if (atomic_load_explicit(&pending_count, memory_order_relaxed) >= TRACE_MAX_PENDING) {
+        metrics_inc(METRIC_TRACE_DROPPED);
+        atomic_fetch_sub(&trace_pushing, 1);
+        return;
+    }
+    TraceRecord *r = (TraceRecord *)slab_alloc(record_pool);
+    if (!r) {
+        metrics_inc(METRIC_TRACE_DROPPED);
+        atomic_fetch_sub(&trace_pushing, 1);
+        return;
+    }
+    if (!t->tid) t->tid = (long)syscall(SYS_gettid);
+    r->tid = t->tid;
+    r->slow = slow;
+    r->start_ns = t->start_ns;
+    r->end_ns = end_ns;
+    memcpy(r->label, t->label, sizeof(r->label));
+    r->span_count = t->span_count;
+    memcpy(r->spans, t->spans, (size_t)t->span_count * sizeof(TraceSpan));
+
+    atomic_fetch_add_explicit(&pending_count, 1, memory_order_relaxed);
+    r->next = atomic_load_explicit(&pending, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&pending, &r->next, r,
+                                                  memory_order_release, memory_order_relaxed)) {
+    }
+    atomic_fetch_sub_explicit(&trace_pushing, 1, memory_order_release);
+}
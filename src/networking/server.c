@@ -2,6 +2,12 @@
 #include "logger.h"
 #include "coap_parser.h"
 #include "coap_router.h"
+#include "metrics.h"
+#include "tracer.h"
+#include "admission.h"
+#include "worker_pool.h"
+#include "slab.h"
+#include "arena.h"
 
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -25,6 +31,7 @@ const char* get_coap_response_message(uint8_t code) {
         case 69: return "2.05 Content";
         case 132: return "4.04 Not Found";
         case 160: return "5.00 Internal Server Error";
+        case 163: return "5.03 Service Unavailable";
         case 199: return "NON response";
         default: return "Código desconocido";
     }
@@ -43,6 +50,10 @@ const char* get_coap_method_message(uint8_t code) {
 
 #define BUFFER_SIZE 1024
 
+// printf por request: útil para depurar, caro bajo carga
+static int server_verbose = 1;
+#define server_printf(...) do { if (server_verbose) printf(__VA_ARGS__); } while (0)
+
 typedef struct ThreadData
 {
     struct MessageData *msg_data;
@@ -50,6 +61,26 @@ typedef struct ThreadData
 } ThreadData;
 
 atomic_int active_threads = 0;
+// Requests despachados que todavía no terminaron (marca de agua de admisión)
+static atomic_int pending_requests = 0;
+static AdmissionControl *admission = NULL;
+// MessageData y ThreadData salen de slabs: sin malloc por datagrama
+static SlabPool *message_pool = NULL;
+static SlabPool *thread_data_pool = NULL;
+static pthread_once_t pools_once = PTHREAD_ONCE_INIT;
+
+static void create_pools(void)
+{
+    message_pool = slab_pool_create("MessageData", sizeof(struct MessageData));
+    thread_data_pool = slab_pool_create("ThreadData", sizeof(ThreadData));
+}
+
+// -1 = pool con un worker por core; 0 = un thread por datagrama; N = pool
+// fijo de N workers con carriles de prioridad
+static int server_workers = -1;
+static uint32_t server_lane_capacity = 1024;
+// Un CON que esperó más que esto en cola ya fue retransmitido: se descarta
+static uint64_t server_stale_ns = 0;
 atomic_int total_messages_processed = 0;
 pthread_mutex_t stats_mutex = PTHREAD_MUTEX_INITIALIZER;
 
@@ -58,39 +89,107 @@ unsigned long get_thread_id()
     return (unsigned long)pthread_self();
 }
 
-void *process_message(void *arg)
+void server_set_verbose(int verbose)
 {
-    ThreadData *thread_data = (ThreadData *)arg;
-    struct MessageData *msg_data = thread_data->msg_data;
-    Logger *logger = thread_data->logger;
-    const uint8_t *buffer = msg_data->buffer;
+    server_verbose = verbose;
+}
+
+int server_set_admission(const AdmissionConfig *cfg)
+{
+    AdmissionControl *ac = admission_create(cfg);
+    if (!ac)
+    {
+        return -1;
+    }
+    admission_destroy(admission);
+    admission = ac;
+    return 0;
+}
+
+// Con un thread por datagrama cada request arranca en un thread nuevo que
+// adopta un heap de los slab pools con su mutex: el camino sin locks de
+// slab.c y arena.c es el de los workers, que viven toda la corrida
+static int resolved_workers(void)
+{
+    if (server_workers >= 0)
+    {
+        return server_workers;
+    }
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return cores > 0 ? (int)cores : 1;
+}
+
+void server_set_workers(int workers, uint32_t lane_capacity)
+{
+    server_workers = workers >= 0 ? workers : -1;
+    if (lane_capacity > 0)
+    {
+        server_lane_capacity = lane_capacity;
+    }
+}
+
+void server_set_stale_deadline(int deadline_ms)
+{
+    server_stale_ns = deadline_ms > 0 ? (uint64_t)deadline_ms * 1000000ULL : 0;
+}
+
+// Solo los CON: el emisor retransmite y la copia nueva ya viene en camino.
+// Un NON no se repite, descartarlo sería perderlo.
+static int is_stale(const struct MessageData *msg_data)
+{
+    if (server_stale_ns == 0 || msg_data->len < 4)
+    {
+        return 0;
+    }
+    if (((msg_data->buffer[0] >> 4) & 0x03) != COAP_TYPE_CONFIRMABLE)
+    {
+        return 0;
+    }
+    return metrics_now_ns() - msg_data->rx_ns > server_stale_ns;
+}
 
+void server_handle_datagram(struct MessageData *msg_data, Logger *logger)
+{
+    const uint8_t *buffer = msg_data->buffer;
     ssize_t n = msg_data->len;
-    const struct sockaddr_in *client_addr = &msg_data->client_addr;
-    socklen_t client_len = msg_data->client_len;
-    int sockfd = msg_data->sockfd;
+
+    if (is_stale(msg_data))
+    {
+        metrics_inc(METRIC_STALE_DROPS);
+        server_printf("[Thread %lu] CON descartado: esperó más que el deadline en cola\n", get_thread_id());
+        return;
+    }
+
+    tracer_request_begin(msg_data->rx_ns, NULL);
+    tracer_span_add("start_server", msg_data->rx_ns, metrics_now_ns());
+    tracer_span_begin("process_message");
 
     atomic_fetch_add(&active_threads, 1);
+    metrics_gauge_add(METRIC_GAUGE_IN_FLIGHT, 1);
     unsigned long thread_id = get_thread_id();
 
-    char *client_ip = inet_ntoa(client_addr->sin_addr);
-    int client_port = ntohs(client_addr->sin_port);
+    char peer_str[128];
+    transport_peer_format(&msg_data->peer, peer_str, sizeof(peer_str));
 
-    printf("[Thread %lu] Mensaje recibido desde %s:%d (%zd bytes) [Activos: %d]\n", thread_id, client_ip, client_port, n, atomic_load(&active_threads));
+    server_printf("[Thread %lu] Mensaje recibido desde %s (%zd bytes) [Activos: %d]\n", thread_id, peer_str, n, atomic_load(&active_threads));
 
     char log_msg[512];
-    snprintf(log_msg, sizeof(log_msg), "Mensaje recibido desde %s:%d (%zd bytes)", client_ip, client_port, n);
+    snprintf(log_msg, sizeof(log_msg), "Mensaje recibido desde %s (%zd bytes)", peer_str, n);
     logger_log(logger, log_msg);
 
     coap_message_t request, response;
-    if (parse_coap_message(buffer, n, &request) == 0)
+    tracer_span_begin("parse_coap_message");
+    int parse_result = parse_coap_message(buffer, n, &request);
+    tracer_span_end();
+    if (parse_result == 0)
     {
-        printf("[Thread %lu] Mensaje CoAP parseado correctamente:\n", thread_id);
-        printf("  Versión: %d\n", request.ver);
-        printf("  Tipo: %d\n", request.type);
-        printf("  Token Length: %d\n", request.tkl);
-        printf("  Código: %d\n", request.code);
-        printf("  Message ID: %d\n", request.mid);
+        tracer_request_label(request.uri_path);
+        server_printf("[Thread %lu] Mensaje CoAP parseado correctamente:\n", thread_id);
+        server_printf("  Versión: %d\n", request.ver);
+        server_printf("  Tipo: %d\n", request.type);
+        server_printf("  Token Length: %d\n", request.tkl);
+        server_printf("  Código: %d\n", request.code);
+        server_printf("  Message ID: %d\n", request.mid);
 
         char log_msg2[256];
         snprintf(log_msg2, sizeof(log_msg2), "Mensaje CoAP parseado - Ver:%d Tipo:%d Código:%d", request.ver, request.type, request.code);
@@ -98,10 +197,13 @@ void *process_message(void *arg)
 
         uint8_t resp_code = COAP_RESPONSE_VALID;
         char response_payload[512];
-        printf("[Thread %lu] URI recibido: '%s' - Método: %s\n", thread_id, request.uri_path, get_coap_method_message(request.code));
+        server_printf("[Thread %lu] URI recibido: '%s' - Método: %s\n", thread_id, request.uri_path, get_coap_method_message(request.code));
         
+        tracer_span_begin("coap_router_handle_request");
         int router_result = coap_router_handle_request(&request, &resp_code, response_payload, sizeof(response_payload));
-        
+        tracer_span_end();
+        if (resp_code == PAGE_NOT_FOUND) metrics_inc(METRIC_NOT_FOUND);
+
         if (router_result == 0)
         {
             if (resp_code != COAP_RESPONSE_NO_REPLY)
@@ -113,16 +215,21 @@ void *process_message(void *arg)
 
                     if (response_len > 0)
                     {
-                        ssize_t sent = sendto(sockfd, response_buffer, response_len, 0,(struct sockaddr *)client_addr, client_len);
+                        TransportDatagram reply = {response_buffer, response_len, msg_data->peer};
+                        tracer_span_begin("sendto");
+                        int sent = transport_send_batch(msg_data->transport, &reply, 1);
+                        tracer_span_end();
                         if (sent > 0)
                         {
-                            printf("[Thread %lu] Respuesta enviada: %s (%zd bytes)\n", thread_id, get_coap_response_message(resp_code), sent);
+                            metrics_inc(METRIC_TX_RESPONSES);
+                            server_printf("[Thread %lu] Respuesta enviada: %s (%zu bytes)\n", thread_id, get_coap_response_message(resp_code), response_len);
                             char log_msg3[256];
-                            snprintf(log_msg3, sizeof(log_msg3), "Respuesta CoAP enviada (%zd bytes) - Código: %d (%s)", sent, resp_code, get_coap_response_message(resp_code));
+                            snprintf(log_msg3, sizeof(log_msg3), "Respuesta CoAP enviada (%zu bytes) - Código: %d (%s)", response_len, resp_code, get_coap_response_message(resp_code));
                             logger_log(logger, log_msg3);
                         }
                         else
                         {
+                            metrics_inc(METRIC_SEND_ERRORS);
                             logger_log(logger, "Error al enviar respuesta");
                         }
                     }
@@ -131,7 +238,8 @@ void *process_message(void *arg)
             }
             else
             {
-                printf("[Thread %lu] Respuesta omitida (mensaje NON)\n", thread_id);
+                metrics_inc(METRIC_NO_REPLY);
+                server_printf("[Thread %lu] Respuesta omitida (mensaje NON)\n", thread_id);
                 char log_msg4[256];
                 snprintf(log_msg4, sizeof(log_msg4), "Respuesta omitida mensaje NON");
                 logger_log(logger, log_msg4);
@@ -140,7 +248,8 @@ void *process_message(void *arg)
         else
         {
             // Error interno del servidor
-            printf("[Thread %lu] Error interno del servidor\n", thread_id);
+            metrics_inc(METRIC_HANDLER_ERRORS);
+            server_printf("[Thread %lu] Error interno del servidor\n", thread_id);
             logger_log(logger, "Error interno del servidor");
         }
 
@@ -148,116 +257,257 @@ void *process_message(void *arg)
     }
     else
     {
-        printf("[Thread %lu] Datos raw recibidos (%zd bytes): ", thread_id, n);
-        for (ssize_t i = 0; i < n; i++)
+        metrics_inc(METRIC_PARSE_ERRORS);
+        if (server_verbose)
         {
-            printf("%02x ", buffer[i]);
+            printf("[Thread %lu] Datos raw recibidos (%zd bytes): ", thread_id, n);
+            for (ssize_t i = 0; i < n; i++)
+            {
+                printf("%02x ", buffer[i]);
+            }
+            printf("\n");
         }
-        printf("\n");
         logger_log(logger, "Datos raw recibidos (no CoAP válido)");
     }
 
     atomic_fetch_add(&total_messages_processed, 1);
     atomic_fetch_sub(&active_threads, 1);
+    metrics_gauge_add(METRIC_GAUGE_IN_FLIGHT, -1);
+    metrics_observe(METRIC_HIST_REQUEST_US, (metrics_now_ns() - msg_data->rx_ns) / 1000);
+    tracer_span_end();
+    tracer_request_end();
+    // Respuesta enviada: lo alocado durante el request ya no se usa
+    Arena *arena = arena_thread();
+    if (arena)
+    {
+        arena_reset(arena);
+    }
 
-    printf("[Thread %lu] Procesamiento completado [Total procesados: %d]\n",
-           thread_id, atomic_load(&total_messages_processed));
-
-    free(msg_data);
-    free(thread_data);
+    server_printf("[Thread %lu] Procesamiento completado [Total procesados: %d]\n",
+                  thread_id, atomic_load(&total_messages_processed));
+}
 
+void *process_message(void *arg)
+{
+    ThreadData *thread_data = (ThreadData *)arg;
+    server_handle_datagram(thread_data->msg_data, thread_data->logger);
+    atomic_fetch_sub(&pending_requests, 1);
+    slab_free(thread_data->msg_data);
+    slab_free(thread_data);
     return NULL;
 }
 
-void start_server(int port, Logger *logger)
+static void process_queued(struct MessageData *msg_data, void *ctx)
 {
-    int sockfd;
-    struct sockaddr_in server_addr, client_addr;
-    socklen_t client_len;
-    uint8_t buffer[BUFFER_SIZE];
+    metrics_gauge_add(METRIC_GAUGE_QUEUED, -1);
+    server_handle_datagram(msg_data, (Logger *)ctx);
+    atomic_fetch_sub(&pending_requests, 1);
+    slab_free(msg_data);
+}
 
-    sockfd = socket(AF_INET, SOCK_DGRAM, 0);
-    if (sockfd < 0)
+// Cada slot del lote recibe directo en su MessageData; los que se entregan a
+// un thread se reemplazan por uno nuevo antes del próximo recv.
+static int refill_slots(struct MessageData **slots, TransportDatagram *dgrams, int count)
+{
+    for (int i = 0; i < count; i++)
     {
-        logger_log(logger, "Error al crear socket");
-        perror("socket");
-        return;
+        if (!slots[i])
+        {
+            slots[i] = (struct MessageData *)slab_alloc(message_pool);
+            if (!slots[i])
+            {
+                return i;
+            }
+        }
+        dgrams[i].data = slots[i]->buffer;
     }
-    logger_log(logger, "Socket UDP inicializado correctamente");
-
-    memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_addr.s_addr = INADDR_ANY;
-    server_addr.sin_port = htons(port);
+    return count;
+}
 
-    if (bind(sockfd, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0)
+void server_run(Transport *transport, Logger *logger)
+{
+    struct MessageData *slots[TRANSPORT_BATCH] = {0};
+    TransportDatagram dgrams[TRANSPORT_BATCH];
+    // Las 5.03 de un lote salen juntas en un solo send_batch
+    uint8_t reject_buf[TRANSPORT_BATCH][ADMISSION_REJECT_MAX];
+    TransportDatagram rejects[TRANSPORT_BATCH];
+    struct MessageData *queued[TRANSPORT_BATCH];
+
+    pthread_once(&pools_once, create_pools);
+    if (!message_pool || !thread_data_pool)
     {
-        logger_log(logger, "Error en bind");
-        perror("bind");
-        close(sockfd);
+        fprintf(stderr, "Error al crear los pools de memoria\n");
         return;
     }
-    printf("Servidor CoAP Thread-per-Request escuchando en puerto %d...\n", port);
-    printf("Ruta: coap://<IP_PC>:%d/sensors/temp (espera POST)\n", port);
-    printf("Modo: Thread-per-Request (sin cola FIFO)\n");
 
-    char log_msg[256];
-    snprintf(log_msg, sizeof(log_msg), "Servidor CoAP Thread-per-Request escuchando en puerto %d", port);
-    logger_log(logger, log_msg);
+    WorkerPool *pool = NULL;
+    int workers = resolved_workers();
+    if (workers > 0)
+    {
+        pool = worker_pool_create(workers, server_lane_capacity, process_queued, logger);
+        if (!pool)
+        {
+            fprintf(stderr, "Error al crear el pool de workers, se usa un thread por datagrama\n");
+        }
+    }
 
     while (1)
     {
-        memset(buffer, 0, BUFFER_SIZE);
-        client_len = sizeof(client_addr);
-
-        ssize_t n = recvfrom(sockfd, buffer, BUFFER_SIZE, 0, (struct sockaddr *)&client_addr, &client_len);
+        int ready = refill_slots(slots, dgrams, TRANSPORT_BATCH);
+        if (ready == 0)
+        {
+            fprintf(stderr, "Error al asignar memoria para MessageData\n");
+            sleep(1);
+            continue;
+        }
 
+        int n = transport_recv_batch(transport, dgrams, ready);
         if (n < 0)
         {
+            if (errno == ESHUTDOWN || errno == EBADF)
+            {
+                break;
+            }
             logger_log(logger, "Error al recibir datagrama");
-            perror("recvfrom");
+            perror("recv");
             continue;
         }
+        uint64_t rx_ns = metrics_now_ns();
+        int n_rejects = 0;
+        int n_queued = 0;
 
-        struct MessageData *msg_data = (struct MessageData *)malloc(sizeof(struct MessageData));
-        if (!msg_data)
+        for (int i = 0; i < n; i++)
         {
-            fprintf(stderr, "Error al asignar memoria para MessageData\n");
-            continue;
-        }
+            metrics_inc(METRIC_RX_DATAGRAMS);
+            // Cada datagrama reserva su lugar antes del check, no al final del
+            // lote: así el siguiente del mismo recv ya lo ve en --max-pending
+            int pending = atomic_fetch_add(&pending_requests, 1);
+            if (admission)
+            {
+                int verdict = admission_check(admission, &dgrams[i].peer, rx_ns, pending);
+                if (verdict != ADMISSION_ACCEPT)
+                {
+                    atomic_fetch_sub(&pending_requests, 1);
+                    // El slot queda para el próximo recv
+                    metrics_inc(verdict == ADMISSION_RATE_LIMITED ? METRIC_SHED_RATE : METRIC_SHED_OVERLOAD);
+                    size_t len = admission_build_reject(admission, dgrams[i].data, dgrams[i].len,
+                                                        reject_buf[n_rejects], ADMISSION_REJECT_MAX);
+                    if (len > 0)
+                    {
+                        rejects[n_rejects].data = reject_buf[n_rejects];
+                        rejects[n_rejects].len = len;
+                        rejects[n_rejects].peer = dgrams[i].peer;
+                        n_rejects++;
+                    }
+                    continue;
+                }
+            }
 
-        memcpy(msg_data->buffer, buffer, n);
-        msg_data->len = n;
-        msg_data->client_addr = client_addr;
-        msg_data->client_len = client_len;
-        msg_data->sockfd = sockfd;
+            struct MessageData *msg_data = slots[i];
+            msg_data->len = (ssize_t)dgrams[i].len;
+            msg_data->peer = dgrams[i].peer;
+            msg_data->transport = transport;
+            msg_data->rx_ns = rx_ns;
 
-        ThreadData *thread_data = (ThreadData *)malloc(sizeof(ThreadData));
-        if (!thread_data)
-        {
-            fprintf(stderr, "Error al asignar memoria para thread_data\n");
-            free(msg_data);
-            continue;
-        }
+            if (pool)
+            {
+                queued[n_queued++] = msg_data;
+                slots[i] = NULL;
+                continue;
+            }
+
+            ThreadData *thread_data = (ThreadData *)slab_alloc(thread_data_pool);
+            if (!thread_data)
+            {
+                fprintf(stderr, "Error al asignar memoria para thread_data\n");
+                metrics_inc(METRIC_DROPPED);
+                atomic_fetch_sub(&pending_requests, 1);
+                continue;
+            }
 
-        thread_data->msg_data = msg_data;
-        thread_data->logger = logger;
+            thread_data->msg_data = msg_data;
+            thread_data->logger = logger;
 
-        pthread_t thread;
-        if (pthread_create(&thread, NULL, process_message, (void *)thread_data) != 0)
+            pthread_t thread;
+            if (pthread_create(&thread, NULL, process_message, (void *)thread_data) != 0)
+            {
+                fprintf(stderr, "Error al crear thread\n");
+                metrics_inc(METRIC_DROPPED);
+                atomic_fetch_sub(&pending_requests, 1);
+                slab_free(thread_data);
+                continue;
+            }
+            pthread_detach(thread);
+            slots[i] = NULL;
+
+            server_printf("Thread creado para mensaje [Threads activos: %d, Total procesados: %d]\n",
+                          atomic_load(&active_threads), atomic_load(&total_messages_processed));
+        }
+
+        if (n_queued > 0)
         {
-            fprintf(stderr, "Error al crear thread\n");
-            free(msg_data);
-            free(thread_data);
-            continue;
+            int accepted = worker_pool_submit_batch(pool, queued, n_queued);
+            metrics_gauge_add(METRIC_GAUGE_QUEUED, accepted);
+            for (int i = 0; accepted < n_queued && i < n_queued; i++)
+            {
+                // Carril lleno
+                if (queued[i])
+                {
+                    metrics_inc(METRIC_DROPPED);
+                    atomic_fetch_sub(&pending_requests, 1);
+                    slab_free(queued[i]);
+                }
+            }
         }
-        pthread_detach(thread);
 
-        printf("Thread creado para mensaje [Threads activos: %d, Total procesados: %d]\n",
-               atomic_load(&active_threads), atomic_load(&total_messages_processed));
+        if (n_rejects > 0)
+        {
+            int sent = transport_send_batch(transport, rejects, n_rejects);
+            if (sent > 0)
+            {
+                metrics_add(METRIC_TX_RESPONSES, (uint64_t)sent);
+            }
+            if (sent < n_rejects)
+            {
+                metrics_add(METRIC_SEND_ERRORS, (uint64_t)(n_rejects - (sent > 0 ? sent : 0)));
+            }
+        }
     }
 
-    close(sockfd);
+    worker_pool_destroy(pool);
+    for (int i = 0; i < TRANSPORT_BATCH; i++)
+    {
+        slab_free(slots[i]);
+    }
 }
 
+void start_server(int port, Logger *logger)
+{
+    Transport transport;
+    if (transport_udp_open(&transport, port) != 0)
+    {
+        logger_log(logger, "Error al abrir socket UDP");
+        return;
+    }
+    logger_log(logger, "Socket UDP inicializado correctamente");
+
+    printf("Servidor CoAP escuchando en puerto %d...\n", port);
+    printf("Ruta: coap://<IP_PC>:%d/sensors/temp (espera POST)\n", port);
+    int workers = resolved_workers();
+    if (workers > 0)
+    {
+        printf("Modo: pool de %d workers con carriles de prioridad\n", workers);
+    }
+    else
+    {
+        printf("Modo: Thread-per-Request (sin cola FIFO)\n");
+    }
+
+    char log_msg[256];
+    snprintf(log_msg, sizeof(log_msg), "Servidor CoAP escuchando en puerto %d", port);
+    logger_log(logger, log_msg);
 
+    server_run(&transport, logger);
+
+    transport_close(&transport);
+}
@@ -0,0 +1,355 @@
+#define _GNU_SOURCE
+#include "transport.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+// ---------------------------------------------------------------------------
+// Sockets (UDP y Unix): mismo camino con recvmmsg/sendmmsg
+// ---------------------------------------------------------------------------
+
+static int socket_recv_batch(Transport *t, TransportDatagram *dgrams, int max)
+{
+    struct mmsghdr msgs[TRANSPORT_BATCH];
+    struct iovec iov[TRANSPORT_BATCH];
+    if (max > TRANSPORT_BATCH) max = TRANSPORT_BATCH;
+
+    for (int i = 0; i < max; i++) {
+        iov[i].iov_base = dgrams[i].data;
+        iov[i].iov_len = TRANSPORT_MAX_DATAGRAM;
+        memset(&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_name = &dgrams[i].peer.addr;
+        msgs[i].msg_hdr.msg_namelen = sizeof(dgrams[i].peer.addr);
+    }
+    // MSG_WAITFORONE: bloquea por el primero y se lleva lo que ya esté en cola
+    int n = recvmmsg(t->fd, msgs, (unsigned)max, MSG_WAITFORONE, NULL);
+    if (n < 0) return errno == EINTR ? 0 : -1;
+    for (int i = 0; i < n; i++) {
+        dgrams[i].len = msgs[i].msg_len;
+        dgrams[i].peer.addr_len = msgs[i].msg_hdr.msg_namelen;
+    }
+    return n;
+}
+
+static int socket_send_batch(Transport *t, const TransportDatagram *dgrams, int count)
+{
+    struct mmsghdr msgs[TRANSPORT_BATCH];
+    struct iovec iov[TRANSPORT_BATCH];
+    int done = 0;
+    while (done < count) {
+        int chunk = count - done < TRANSPORT_BATCH ? count - done : TRANSPORT_BATCH;
+        for (int i = 0; i < chunk; i++) {
+            const TransportDatagram *d = &dgrams[done + i];
+            iov[i].iov_base = d->data;
+            iov[i].iov_len = d->len;
+            memset(&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_name = (void *)&d->peer.addr;
+            msgs[i].msg_hdr.msg_namelen = d->peer.addr_len;
+        }
+        int n = sendmmsg(t->fd, msgs, (unsigned)chunk, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        done += n;
+        if (n < chunk) break;
+    }
+    return done > 0 ? done : -1;
+}
+
+static void socket_close(Transport *t)
+{
+    if (t->fd >= 0) close(t->fd);
+    t->fd = -1;
+    if (t->impl) {
+        // impl guarda la ruta del socket Unix para borrarla al cerrar
+        unlink((const char *)t->impl);
+        free(t->impl);
+        t->impl = NULL;
+    }
+}
+
+static const TransportOps udp_ops = {"udp", socket_recv_batch, socket_send_batch, socket_close};
+static const TransportOps unix_ops = {"unix", socket_recv_batch, socket_send_batch, socket_close};
+
+int transport_udp_open(Transport *t, int port)
+{
+    memset(t, 0, sizeof(*t));
+    t->fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (t->fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(port);
+    if (bind(t->fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("bind");
+        close(t->fd);
+        t->fd = -1;
+        return -1;
+    }
+    t->ops = &udp_ops;
+    return 0;
+}
+
+int transport_unix_open(Transport *t, const char *path)
+{
+    memset(t, 0, sizeof(*t));
+    struct sockaddr_un addr;
+    if (!path || strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Ruta de socket Unix inválida\n");
+        return -1;
+    }
+    t->fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (t->fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path);
+    if (bind(t->fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("bind");
+        close(t->fd);
+        t->fd = -1;
+        return -1;
+    }
+    t->impl = strdup(path);
+    t->ops = &unix_ops;
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Loopback en memoria: colas MPMC acotadas (secuencia por celda, sin locks)
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    atomic_size_t seq;
+    uint32_t client_id;
+    uint32_t len;
+    uint8_t data[TRANSPORT_MAX_DATAGRAM];
+} LoopCell;
+
+typedef struct {
+    LoopCell *cells;
+    size_t mask;
+    _Alignas(64) atomic_size_t enqueue_pos;
+    _Alignas(64) atomic_size_t dequeue_pos;
+} LoopRing;
+
+typedef struct {
+    LoopRing to_server;
+    LoopRing to_client;
+    atomic_int closed;
+} Loopback;
+
+static int ring_init(LoopRing *r, size_t capacity)
+{
+    r->cells = calloc(capacity, sizeof(LoopCell));
+    if (!r->cells) return -1;
+    r->mask = capacity - 1;
+    for (size_t i = 0; i < capacity; i++) atomic_init(&r->cells[i].seq, i);
+    atomic_init(&r->enqueue_pos, 0);
+    atomic_init(&r->dequeue_pos, 0);
+    return 0;
+}
+
+static int ring_push(LoopRing *r, uint32_t client_id, const uint8_t *data, size_t len)
+{
+    size_t pos = atomic_load_explicit(&r->enqueue_pos, memory_order_relaxed);
+    for (;;) {
+        LoopCell *cell = &r->cells[pos & r->mask];
+        size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&r->enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                cell->client_id = client_id;
+                cell->len = (uint32_t)len;
+                memcpy(cell->data, data, len);
+                atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+                return 0;
+            }
+        } else if (diff < 0) {
+            return -1;  // llena
+        } else {
+            pos = atomic_load_explicit(&r->enqueue_pos, memory_order_relaxed);
+        }
+    }
+}
+
+static int ring_pop(LoopRing *r, uint32_t *client_id, uint8_t *buf, size_t size)
+{
+    size_t pos = atomic_load_explicit(&r->dequeue_pos, memory_order_relaxed);
+    for (;;) {
+        LoopCell *cell = &r->cells[pos & r->mask];
+        size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&r->dequeue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                size_t len = cell->len < size ? cell->len : size;
+                *client_id = cell->client_id;
+                memcpy(buf, cell->data, len);
+                atomic_store_explicit(&cell->seq, pos + r->mask + 1, memory_order_release);
+                return (int)len;
+            }
+        } else if (diff < 0) {
+            return -1;  // vacía
+        } else {
+            pos = atomic_load_explicit(&r->dequeue_pos, memory_order_relaxed);
+        }
+    }
+}
+
+// El id de cliente viaja en la dirección del peer con familia AF_UNSPEC
+static void loop_peer_set(TransportPeer *peer, uint32_t client_id)
+{
+    memset(&peer->addr, 0, sizeof(sa_family_t) + sizeof(client_id));
+    peer->addr.ss_family = AF_UNSPEC;
+    memcpy((uint8_t *)&peer->addr + sizeof(sa_family_t), &client_id, sizeof(client_id));
+    peer->addr_len = (socklen_t)(sizeof(sa_family_t) + sizeof(client_id));
+}
+
+static uint32_t loop_peer_get(const TransportPeer *peer)
+{
+    uint32_t client_id;
+    memcpy(&client_id, (const uint8_t *)&peer->addr + sizeof(sa_family_t), sizeof(client_id));
+    return client_id;
+}
+
+static int loop_recv_batch(Transport *t, TransportDatagram *dgrams, int max)
+{
+    Loopback *lb = (Loopback *)t->impl;
+    unsigned spins = 0;
+    for (;;) {
+        int n = 0;
+        while (n < max) {
+            uint32_t client_id;
+            int len = ring_pop(&lb->to_server, &client_id, dgrams[n].data, TRANSPORT_MAX_DATAGRAM);
+            if (len < 0) break;
+            dgrams[n].len = (size_t)len;
+            loop_peer_set(&dgrams[n].peer, client_id);
+            n++;
+        }
+        if (n > 0) return n;
+        if (atomic_load_explicit(&lb->closed, memory_order_acquire)) {
+            errno = ESHUTDOWN;
+            return -1;
+        }
+        // Espera activa corta y luego cede la CPU para no quemar un core ocioso
+        if (++spins < 64) continue;
+        if (spins < 1024) {
+            sched_yield();
+        } else {
+            struct timespec pause = {0, 50000};
+            nanosleep(&pause, NULL);
+        }
+    }
+}
+
+static int loop_send_batch(Transport *t, const TransportDatagram *dgrams, int count)
+{
+    Loopback *lb = (Loopback *)t->impl;
+    int sent = 0;
+    for (int i = 0; i < count; i++) {
+        if (ring_push(&lb->to_client, loop_peer_get(&dgrams[i].peer), dgrams[i].data, dgrams[i].len) != 0) break;
+        sent++;
+    }
+    return sent > 0 ? sent : -1;
+}
+
+static void loop_close(Transport *t)
+{
+    Loopback *lb = (Loopback *)t->impl;
+    if (!lb) return;
+    free(lb->to_server.cells);
+    free(lb->to_client.cells);
+    free(lb);
+    t->impl = NULL;
+}
+
+static const TransportOps loopback_ops = {"loopback", loop_recv_batch, loop_send_batch, loop_close};
+
+int transport_loopback_open(Transport *t, uint32_t capacity)
+{
+    memset(t, 0, sizeof(*t));
+    size_t cap = 16;
+    while (cap < capacity) cap <<= 1;
+    Loopback *lb = calloc(1, sizeof(Loopback));
+    if (!lb) return -1;
+    if (ring_init(&lb->to_server, cap) != 0 || ring_init(&lb->to_client, cap) != 0) {
+        free(lb->to_server.cells);
+        free(lb);
+        return -1;
+    }
+    atomic_init(&lb->closed, 0);
+    t->ops = &loopback_ops;
+    t->fd = -1;
+    t->impl = lb;
+    return 0;
+}
+
+int transport_loopback_send(Transport *t, uint32_t client_id, const uint8_t *data, size_t len)
+{
+    if (len > TRANSPORT_MAX_DATAGRAM) return -1;
+    return ring_push(&((Loopback *)t->impl)->to_server, client_id, data, len);
+}
+
+int transport_loopback_recv(Transport *t, uint32_t *client_id, uint8_t *buf, size_t size)
+{
+    int len = ring_pop(&((Loopback *)t->impl)->to_client, client_id, buf, size);
+    return len < 0 ? 0 : len;
+}
+
+void transport_loopback_shutdown(Transport *t)
+{
+    atomic_store_explicit(&((Loopback *)t->impl)->closed, 1, memory_order_release);
+}
+
+// ---------------------------------------------------------------------------
+
+int transport_peer_format(const TransportPeer *peer, char *out, size_t size)
+{
+    const struct sockaddr *sa = (const struct sockaddr *)&peer->addr;
+    char ip[INET6_ADDRSTRLEN];
+    switch (sa->sa_family) {
+        case AF_INET: {
+            const struct sockaddr_in *in = (const struct sockaddr_in *)sa;
+            inet_ntop(AF_INET, &in->sin_addr, ip, sizeof(ip));
+            return snprintf(out, size, "%s:%d", ip, ntohs(in->sin_port));
+        }
+        case AF_INET6: {
+            const struct sockaddr_in6 *in6 = (const struct sockaddr_in6 *)sa;
+            inet_ntop(AF_INET6, &in6->sin6_addr, ip, sizeof(ip));
+            return snprintf(out, size, "[%s]:%d", ip, ntohs(in6->sin6_port));
+        }
+        case AF_UNIX: {
+            const struct sockaddr_un *un = (const struct sockaddr_un *)sa;
+            // Un cliente sin bind no tiene ruta: no podrá recibir respuestas
+            if (peer->addr_len <= sizeof(sa_family_t) || !un->sun_path[0]) return snprintf(out, size, "unix:(anónimo)");
+            return snprintf(out, size, "unix:%s", un->sun_path);
+        }
+        case AF_UNSPEC:
+            return snprintf(out, size, "loop:%u", loop_peer_get(peer));
+        default:
+            return snprintf(out, size, "familia %d", sa->sa_family);
+    }
+}
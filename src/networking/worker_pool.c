@@ -0,0 +1,206 @@
+#include "worker_pool.h"
+#include "server.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+// Peso de cada carril en el Deficit Round Robin: datagramas por turno
+static const int lane_weight[LANE_COUNT] = {
+    [LANE_MGMT]      = 1,
+    [LANE_CON_READ]  = 8,
+    [LANE_CON_WRITE] = 4,
+    [LANE_NON_READ]  = 2,
+    [LANE_NON_WRITE] = 1,
+};
+
+static const char *lane_names[LANE_COUNT] = {
+    [LANE_MGMT]      = "mgmt",
+    [LANE_CON_READ]  = "con_read",
+    [LANE_CON_WRITE] = "con_write",
+    [LANE_NON_READ]  = "non_read",
+    [LANE_NON_WRITE] = "non_write",
+};
+
+typedef struct {
+    struct MessageData **ring;
+    uint32_t mask;
+    uint32_t head;
+    uint32_t tail;
+    int deficit;
+} Lane;
+
+struct WorkerPool {
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    Lane lanes[LANE_COUNT];
+    int current;            // carril con turno en el DRR
+    size_t queued;
+    int stopping;
+    worker_fn fn;
+    void *ctx;
+    pthread_t *threads;
+    int nthreads;
+};
+
+const char *worker_lane_name(WorkerLane lane)
+{
+    return lane < LANE_COUNT ? lane_names[lane] : "?";
+}
+
+static uint32_t lane_len(const Lane *l)
+{
+    return l->tail - l->head;
+}
+
+// Mira el primer segmento del Uri-Path sin parsear el mensaje completo
+static int is_management(const uint8_t *data, size_t len)
+{
+    size_t pos = 4 + (data[0] & 0x0F);
+    unsigned option = 0;
+    while (pos < len && data[pos] != 0xFF) {
+        unsigned delta = data[pos] >> 4;
+        unsigned olen = data[pos] & 0x0F;
+        pos++;
+        if (delta == 13) { if (pos >= len) return 0; delta = 13 + data[pos++]; }
+        else if (delta == 14) { if (pos + 1 >= len) return 0; delta = 269 + ((data[pos] << 8) | data[pos + 1]); pos += 2; }
+        else if (delta == 15) return 0;
+        if (olen == 13) { if (pos >= len) return 0; olen = 13 + data[pos++]; }
+        else if (olen == 14) { if (pos + 1 >= len) return 0; olen = 269 + ((data[pos] << 8) | data[pos + 1]); pos += 2; }
+        else if (olen == 15) return 0;
+        option += delta;
+        if (pos + olen > len) return 0;
+        if (option == 11) {
+            return olen == 11 && memcmp(data + pos, ".well-known", 11) == 0;
+        }
+        if (option > 11) return 0;
+        pos += olen;
+    }
+    return 0;
+}
+
+WorkerLane worker_pool_classify(const uint8_t *data, size_t len)
+{
+    if (len < 4 || len < 4u + (data[0] & 0x0F)) return LANE_NON_WRITE;
+    uint8_t type = (data[0] >> 4) & 0x03;
+    uint8_t code = data[1];
+    if (is_management(data, len)) return LANE_MGMT;
+    // ACK/RST/vacíos son baratos: van con los CON para no demorarlos
+    int confirmable = type != 1;
+    int read = code == 1 || code == 0;
+    if (confirmable) return read ? LANE_CON_READ : LANE_CON_WRITE;
+    return read ? LANE_NON_READ : LANE_NON_WRITE;
+}
+
+// Siguiente datagrama según el DRR; requiere queued > 0
+static struct MessageData *pick_next(WorkerPool *pool)
+{
+    Lane *l = &pool->lanes[pool->current];
+    while (lane_len(l) == 0 || l->deficit <= 0) {
+        pool->current = (pool->current + 1) % LANE_COUNT;
+        l = &pool->lanes[pool->current];
+        // Costo uniforme por datagrama: no hace falta acumular déficit
+        l->deficit = lane_len(l) ? lane_weight[pool->current] : 0;
+    }
+    l->deficit--;
+    pool->queued--;
+    return l->ring[l->head++ & l->mask];
+}
+
+static void *worker_main(void *arg)
+{
+    WorkerPool *pool = (WorkerPool *)arg;
+    pthread_mutex_lock(&pool->lock);
+    while (1) {
+        while (pool->queued == 0 && !pool->stopping) {
+            pthread_cond_wait(&pool->ready, &pool->lock);
+        }
+        if (pool->queued == 0) break;
+        struct MessageData *msg = pick_next(pool);
+        pthread_mutex_unlock(&pool->lock);
+        pool->fn(msg, pool->ctx);
+        pthread_mutex_lock(&pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+WorkerPool *worker_pool_create(int workers, uint32_t capacity, worker_fn fn, void *ctx)
+{
+    if (workers < 1 || !fn) return NULL;
+    WorkerPool *pool = calloc(1, sizeof(WorkerPool));
+    if (!pool) return NULL;
+    uint32_t n = 16;
+    while (n < capacity) n <<= 1;
+    for (int i = 0; i < LANE_COUNT; i++) {
+        pool->lanes[i].ring = malloc(sizeof(struct MessageData *) * n);
+        pool->lanes[i].mask = n - 1;
+        if (!pool->lanes[i].ring) {
+            for (int j = 0; j < i; j++) free(pool->lanes[j].ring);
+            free(pool);
+            return NULL;
+        }
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->ready, NULL);
+    pool->fn = fn;
+    pool->ctx = ctx;
+    pool->threads = calloc((size_t)workers, sizeof(pthread_t));
+    if (!pool->threads) {
+        worker_pool_destroy(pool);
+        return NULL;
+    }
+    for (int i = 0; i < workers; i++) {
+        if (pthread_create(&pool->threads[i], NULL, worker_main, pool) != 0) break;
+        pool->nthreads++;
+    }
+    if (pool->nthreads == 0) {
+        worker_pool_destroy(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+void worker_pool_destroy(WorkerPool *pool)
+{
+    if (!pool) return;
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = 1;
+    pthread_cond_broadcast(&pool->ready);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < pool->nthreads; i++) pthread_join(pool->threads[i], NULL);
+    for (int i = 0; i < LANE_COUNT; i++) free(pool->lanes[i].ring);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->ready);
+    free(pool->threads);
+    free(pool);
+}
+
+int worker_pool_submit_batch(WorkerPool *pool, struct MessageData **msgs, int count)
+{
+    // Clasificar fuera del lock
+    WorkerLane lanes[count > 0 ? count : 1];
+    for (int i = 0; i < count; i++) {
+        lanes[i] = msgs[i] ? worker_pool_classify(msgs[i]->buffer, (size_t)msgs[i]->len) : LANE_COUNT;
+    }
+
+    int queued = 0;
+    pthread_mutex_lock(&pool->lock);
+    for (int i = 0; i < count; i++) {
+        if (lanes[i] == LANE_COUNT) continue;
+        Lane *l = &pool->lanes[lanes[i]];
+        if (lane_len(l) > l->mask) continue;
+        l->ring[l->tail++ & l->mask] = msgs[i];
+        msgs[i] = NULL;
+        queued++;
+    }
+    pool->queued += (size_t)queued;
+    if (queued == 1) pthread_cond_signal(&pool->ready);
+    else if (queued > 1) pthread_cond_broadcast(&pool->ready);
+    pthread_mutex_unlock(&pool->lock);
+    return queued;
+}
+
+size_t worker_pool_queued(const WorkerPool *pool, WorkerLane lane)
+{
+    return lane < LANE_COUNT ? lane_len(&pool->lanes[lane]) : 0;
+}
@@ -0,0 +1,203 @@
+// Herramienta para el log binario del data store (store_log.h):
+//
+//   store_tool convert <texto> <binario>   log de texto de versiones
+//                                          anteriores -> formato binario
+//   store_tool dump <log>                  registros como texto, validando
+//                                          los CRC (sale con 1 si hay un
+//                                          registro cortado o corrupto)
+//
+// El servidor convierte solo un log de texto al arrancar; convert sirve
+// para hacerlo sin levantarlo (o para los snapshots guardados).
+#include "store_log.h"
+#include "json_dict.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LINE_MAX_TEXT (STORE_LOG_KEY_MAX + STORE_LOG_VALUE_MAX + 4)
+
+typedef struct {
+    FILE *out;
+    char key[STORE_LOG_KEY_MAX + 1];
+    char value[STORE_LOG_VALUE_MAX + 1];
+    StoreRecord rec;
+    int pending;                // valor esperando su línea "!"
+    unsigned long long records;
+} Converter;
+
+static int emit(Converter *c, const StoreRecord *rec)
+{
+    char buf[sizeof(StoreRecordHeader) + STORE_LOG_KEY_MAX + STORE_LOG_VALUE_MAX];
+    size_t n = store_log_encode(buf, sizeof(buf), rec);
+    if (n == 0 || fwrite(buf, 1, n, c->out) != n) return -1;
+    c->records++;
+    return 0;
+}
+
+static int flush_pending(Converter *c)
+{
+    if (!c->pending) return 0;
+    c->pending = 0;
+    return emit(c, &c->rec);
+}
+
+// Una línea "clave\tvalor" (o "@id", "!clave", "-clave") del log de texto.
+// timestamp_ms queda en 0: el texto no guardaba cuándo se escribió.
+static int convert_line(Converter *c, char *line)
+{
+    char *tab = strchr(line, '\t');
+    if (!tab) return 0;
+    *tab = '\0';
+    char *key = line, *val = tab + 1;
+    size_t len = strlen(val);
+    while (len > 0 && (val[len - 1] == '\n' || val[len - 1] == '\r')) val[--len] = '\0';
+
+    if (key[0] == '!') {
+        // Vencimiento del valor anterior
+        if (c->pending && strcmp(key + 1, c->key) == 0) {
+            unsigned long long ms = strtoull(val, NULL, 10);
+            c->rec.expires_ms = ms;
+            c->rec.flags = ms == 0 ? STORE_REC_PINNED : 0;
+        }
+        return flush_pending(c);
+    }
+    if (flush_pending(c) != 0) return -1;
+    StoreRecord rec;
+    memset(&rec, 0, sizeof(rec));
+    if (key[0] == JSON_DICT_MARK) {
+        rec.type = STORE_REC_TEMPLATE;
+        rec.version = (uint32_t)atoi(key + 1);
+        rec.value = val;
+        rec.value_len = len;
+        return emit(c, &rec);
+    }
+    if (key[0] == '-') {
+        rec.type = STORE_REC_TOMBSTONE;
+        rec.key = key + 1;
+        rec.key_len = strlen(key + 1);
+        return emit(c, &rec);
+    }
+    size_t klen = strlen(key);
+    if (klen > STORE_LOG_KEY_MAX || len > STORE_LOG_VALUE_MAX) return -1;
+    memcpy(c->key, key, klen + 1);
+    memcpy(c->value, val, len + 1);
+    memset(&c->rec, 0, sizeof(c->rec));
+    c->rec.type = STORE_REC_VALUE;
+    c->rec.key = c->key;
+    c->rec.key_len = klen;
+    c->rec.value = c->value;
+    c->rec.value_len = len;
+    c->pending = 1;
+    return 0;
+}
+
+static int convert(const char *src, const char *dst)
+{
+    FILE *in = fopen(src, "r");
+    if (!in) {
+        perror(src);
+        return 1;
+    }
+    StoreLogReader *rd = malloc(sizeof(StoreLogReader));
+    if (rd && store_log_open(rd, in)) {
+        fprintf(stderr, "%s ya está en formato binario\n", src);
+        free(rd);
+        fclose(in);
+        return 1;
+    }
+    free(rd);
+    Converter *c = calloc(1, sizeof(Converter));
+    char *line = malloc(LINE_MAX_TEXT);
+    if (!c || !line) {
+        free(c);
+        free(line);
+        fclose(in);
+        return 1;
+    }
+    c->out = fopen(dst, "wb");
+    if (!c->out) {
+        perror(dst);
+        fclose(in);
+        free(c);
+        free(line);
+        return 1;
+    }
+    fwrite(STORE_LOG_MAGIC, 1, STORE_LOG_MAGIC_LEN, c->out);
+    unsigned long long line_no = 0, skipped = 0;
+    while (fgets(line, LINE_MAX_TEXT, in)) {
+        line_no++;
+        if (convert_line(c, line) != 0) {
+            fprintf(stderr, "Línea %llu: no entra en un registro, se omite\n", line_no);
+            skipped++;
+        }
+    }
+    int ok = flush_pending(c) == 0;
+    ok = !ferror(c->out) && ok;
+    ok = fclose(c->out) == 0 && ok;
+    fclose(in);
+    printf("%s -> %s: %llu registros (%llu líneas omitidas)\n", src, dst, c->records, skipped);
+    free(line);
+    free(c);
+    return ok ? 0 : 1;
+}
+
+static int dump(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return 1;
+    }
+    StoreLogReader *rd = malloc(sizeof(StoreLogReader));
+    if (!rd || !store_log_open(rd, f)) {
+        fprintf(stderr, "%s no es un log binario del data store\n", path);
+        free(rd);
+        fclose(f);
+        return 1;
+    }
+    StoreRecord rec;
+    unsigned long long records = 0;
+    int r;
+    while ((r = store_log_read(rd, &rec)) == 1) {
+        records++;
+        if (rec.type == STORE_REC_TEMPLATE) {
+            json_dict_define(rec.version, rec.value, rec.value_len);
+            continue;
+        }
+        if (rec.type == STORE_REC_TOMBSTONE) putchar('-');
+        // Lectura que solo guardaba el índice por campo
+        if (rec.type == STORE_REC_INDEXED) putchar('?');
+        fwrite(rec.key, 1, rec.key_len, stdout);
+        if (rec.type == STORE_REC_TOMBSTONE) {
+            printf("\t%llu\n", (unsigned long long)rec.timestamp_ms);
+            continue;
+        }
+        char raw[STORE_LOG_VALUE_MAX + 1];
+        const char *value = rec.value;
+        if (rec.value[0] == JSON_DICT_MARK) {
+            value = json_dict_decode(rec.value, rec.value_len, raw, sizeof(raw)) >= 0 ? raw : "(comprimido ilegible)";
+        }
+        printf("\t%s\n", value);
+        if (rec.expires_ms > 0 || (rec.flags & STORE_REC_PINNED)) {
+            putchar('!');
+            fwrite(rec.key, 1, rec.key_len, stdout);
+            printf("\t%llu\n", (unsigned long long)rec.expires_ms);
+        }
+    }
+    fprintf(stderr, "%llu registros, %llu bytes válidos\n", records, (unsigned long long)rd->offset);
+    if (r < 0) fprintf(stderr, "Registro cortado o corrupto en el byte %llu\n", (unsigned long long)rd->offset);
+    free(rd);
+    fclose(f);
+    return r < 0 ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 4 && strcmp(argv[1], "convert") == 0) return convert(argv[2], argv[3]);
+    if (argc == 3 && strcmp(argv[1], "dump") == 0) return dump(argv[2]);
+    fprintf(stderr,
+            "Uso: %s convert <texto> <binario>\n"
+            "     %s dump <log>\n",
+            argv[0], argv[0]);
+    return 2;
+}
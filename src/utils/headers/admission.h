@@ -0,0 +1,55 @@
+#ifndef ADMISSION_H
+#define ADMISSION_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include "transport.h"
+
+// Control de admisión del loop de recepción: un token bucket por origen en
+// una tabla hash compacta y una marca de agua global de requests pendientes.
+// Lo que no entra se contesta con una 5.03 Service Unavailable pre-armada
+// (con Max-Age como sugerencia de espera) sin parsear el mensaje ni tocar el
+// data store.
+//
+// Solo la usa el thread que recibe: no tiene locks.
+
+#define ADMISSION_ACCEPT        0
+#define ADMISSION_RATE_LIMITED  1   // el origen agotó su bucket
+#define ADMISSION_OVERLOADED    2   // se superó la marca de agua global
+
+#define ADMISSION_COAP_503      163 // 5.03 Service Unavailable
+#define ADMISSION_OPTION_MAX_AGE 14
+#define ADMISSION_REJECT_MAX    32  // header + token + Max-Age
+
+typedef struct {
+    double rate;            // requests/s por origen (0 = sin límite por origen)
+    double burst;           // tamaño del bucket (0 = igual a rate)
+    int max_pending;        // requests en cola o en proceso (0 = sin límite)
+    int max_age_s;          // Max-Age de la 5.03
+    uint32_t table_size;    // orígenes que se recuerdan
+} AdmissionConfig;
+
+typedef struct AdmissionControl AdmissionControl;
+
+void admission_config_default(AdmissionConfig *cfg);
+AdmissionControl *admission_create(const AdmissionConfig *cfg);
+void admission_destroy(AdmissionControl *ac);
+
+// Decide si el datagrama de peer pasa. pending = requests ya despachados
+// que todavía no terminaron. Devuelve ADMISSION_*.
+int admission_check(AdmissionControl *ac, const TransportPeer *peer, uint64_t now_ns, int pending);
+
+// Arma la 5.03 para el request en out copiando MID y token del header.
+// Devuelve la longitud, o 0 si el datagrama no es un request (no se contesta).
+size_t admission_build_reject(AdmissionControl *ac, const uint8_t *request, size_t len,
+                              uint8_t *out, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Arena de bump por request: todo lo que se aloca mientras se procesa un
+// datagrama (payload parseado, payload de la respuesta) sale de un bloque
+// del thread y se descarta de una vez con arena_reset al enviar la respuesta.
+// Si un request no entra en el bloque se piden bloques extra a malloc, que se
+// liberan en el reset.
+
+#define ARENA_BLOCK_SIZE 8192
+
+typedef struct ArenaOverflow ArenaOverflow;
+
+typedef struct {
+    uint8_t *base;
+    size_t size;
+    size_t used;
+    ArenaOverflow *overflow;
+} Arena;
+
+// Arena del thread actual (el bloque sale de un slab pool y vuelve al
+// terminar el thread). NULL si no hay memoria.
+Arena *arena_thread(void);
+
+// Alineado a 16 bytes. NULL si no hay memoria.
+void *arena_alloc(Arena *arena, size_t size);
+void arena_reset(Arena *arena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
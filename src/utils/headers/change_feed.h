@@ -0,0 +1,110 @@
+#ifndef CHANGE_FEED_H
+#define CHANGE_FEED_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Stream ordenado de cambios del data store por un socket Unix de stream.
+//
+// Cada escritura o borrado recibe un número de secuencia global y se copia
+// a un buffer circular acotado (por bytes). Un thread propio atiende a los
+// suscriptores: cada uno lleva su cursor en el buffer y recibe frames con
+// tantos cambios como entren, a su ritmo. Si un suscriptor se atrasa más que
+// el buffer, recibe un frame FEED_FRAME_GAP con la secuencia más vieja que
+// queda y se lo desconecta: nunca se saltean cambios en silencio.
+//
+// La secuencia vuelve a 1 en cada arranque del servidor, así que cada feed
+// tiene una época (distinta en cada arranque) que va en todos los frames.
+// Para reanudar se pide la secuencia siguiente con la época en que se
+// recibió: si la época cambió o la secuencia es posterior al último cambio,
+// el servidor contesta FEED_FRAME_RESET y desconecta (hay que resincronizar
+// desde cero), en vez de mandar cambios renumerados como si fueran los que
+// seguían.
+//
+// Protocolo: el cliente envía "SUB <seq> <época>\n" (seq 0 = desde lo más
+// viejo que quede en el buffer; época 0 = no se conoce) y el servidor
+// contesta con frames. Enteros en el orden del host (es un socket local).
+//
+//   frame:  FeedFrameHeader + count registros
+//   registro: FeedRecord + key + value, con padding a 8 bytes (size)
+
+#define FEED_FRAME_MAGIC    0x46454544u     // "FEED"
+#define FEED_FRAME_CHANGES  1
+#define FEED_FRAME_GAP      2               // first_seq = más viejo disponible
+#define FEED_FRAME_RESET    3               // otra época: first_seq = más viejo disponible
+
+#define FEED_OP_SET         1
+#define FEED_OP_DELETE      2
+
+#define FEED_FRAME_MAX      (64 * 1024)
+
+typedef struct {
+    uint32_t magic;
+    uint32_t length;            // bytes del frame, header incluido
+    uint16_t type;              // FEED_FRAME_*
+    uint16_t count;             // registros
+    uint32_t reserved;
+    uint64_t first_seq;
+    uint64_t epoch;             // del servidor que mandó el frame
+} FeedFrameHeader;
+
+typedef struct {
+    uint32_t size;              // bytes del registro con key, value y padding
+    uint8_t op;                 // FEED_OP_*
+    uint8_t reserved;
+    uint16_t key_len;
+    uint16_t value_len;
+    uint16_t reserved2;
+    uint32_t version;           // escrituras de la clave (1 = recién creada)
+    uint64_t seq;
+    uint64_t ts_ns;             // CLOCK_REALTIME
+} FeedRecord;
+
+typedef struct ChangeFeed ChangeFeed;
+
+// Servidor: escucha en path con un buffer de ring_bytes. NULL si falla.
+ChangeFeed *change_feed_create(const char *path, size_t ring_bytes);
+// Agrega un cambio. Llamar con el orden de las escrituras (el data store lo
+// hace con store_mutex tomado). No bloquea por los suscriptores.
+void change_feed_publish(ChangeFeed *feed, uint8_t op, const char *key, size_t key_len,
+                         const char *value, size_t value_len, uint32_t version);
+// Secuencia del último cambio publicado
+uint64_t change_feed_last_seq(ChangeFeed *feed);
+// Época de este arranque
+uint64_t change_feed_epoch(ChangeFeed *feed);
+// Cierra a los suscriptores, detiene el thread y borra el socket
+void change_feed_destroy(ChangeFeed *feed);
+
+// Cliente: conecta y se suscribe desde from_seq de la época epoch (0 si no
+// se conoce). Devuelve el fd o -1.
+int change_feed_subscribe(const char *path, uint64_t from_seq, uint64_t epoch);
+
+typedef struct {
+    uint64_t epoch;
+    uint64_t seq;
+    uint64_t ts_ns;
+    uint32_t version;
+    uint8_t op;
+    const char *key;            // no terminados en '\0'; válidos durante el callback
+    size_t key_len;
+    const char *value;
+    size_t value_len;
+} FeedChange;
+
+typedef int (*change_feed_fn)(const FeedChange *change, void *ctx);
+
+// Lee frames de fd y llama a fn por cada cambio, en orden. Vuelve cuando fn
+// devuelve != 0 (0), cuando el servidor cierra (-1) o con un frame GAP o
+// RESET (FEED_FRAME_GAP o FEED_FRAME_RESET, con la secuencia más vieja
+// disponible en *oldest_seq).
+int change_feed_consume(int fd, change_feed_fn fn, void *ctx, uint64_t *oldest_seq);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
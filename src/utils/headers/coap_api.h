@@ -4,6 +4,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include "coap_parser.h" 
+#include "intern.h"
 
 
 #ifdef __cplusplus
@@ -18,17 +19,13 @@ extern "C" {
 
 #define RESPONSE_BUFFER_SIZE 512
 
-// Estructura para transacciones en vuelo
-typedef struct {
-    uint16_t message_id;
-    uint8_t token[8];
-    uint8_t token_len;
-    int active;
-} CoapTransaction;
-
-// Función para enviar request
+// Función para enviar request (bloquea hasta la respuesta o el timeout).
+// Para muchos requests en paralelo usar CoapClient (coap_client.h).
 int coap_send_request(const char *host, int port, const char *path, const char *method, const char *mode, const char *payload);
 
+// "get"/"post"/"put"/"delete" (o en mayúsculas) -> COAP_METHOD_*, -1 si no es válido
+int coap_parse_method(const char *method_str);
+
 // Tipo de handler
 // Funcion que recibe una request y un buffer en el que se debe guardar la respuesta
 // El handler debe retornar diferente de 0 si algo sale mal.
@@ -36,6 +33,8 @@ typedef int (*coap_handler_fn)(const coap_message_t *msg, char *responseBuffer);
 
 typedef struct {
     char uri[128];
+    const InternKey *key;   // rutas exactas: se comparan por puntero (NULL en "/*")
+    int pattern;            // atiende URIs con segmentos "*" (coap_register_pattern_handler)
     uint8_t method;
     coap_handler_fn handler;
 } Route;
@@ -45,10 +44,17 @@ coap_handler_fn find_handler(const char* uri, uint8_t method);
 
 // Registrar handler para una URI y método
 int coap_register_handler(const char* uri, uint8_t method, coap_handler_fn fn);
+// Handler para las URIs bajo prefix con algún segmento "*" (GET /sensors/*,
+// /sensors/*/temp). Esas URIs solo llegan a handlers de patrón: un POST a
+// "/sensors/temp/*" es 4.04, no una clave con asterisco.
+int coap_register_pattern_handler(const char* prefix, uint8_t method, coap_handler_fn fn);
 
 // Iniciar servidor
 int coap_server_start(int port, const char *logFileName);
 
+// Iniciar servidor sobre un socket Unix de datagramas
+int coap_server_start_unix(const char *socketPath, const char *logFileName);
+
 // Detener servidor
 // void coap_server_stop();
 
@@ -0,0 +1,67 @@
+#ifndef COAP_CLIENT_H
+#define COAP_CLIENT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <netinet/in.h>
+#include "message.h"
+#include "coap_reliability.h"
+
+// Cliente CoAP asíncrono: un socket UDP compartido por todos los requests,
+// exchanges en vuelo indexados por token (hash) y retransmisión de CON con
+// la capa de confiabilidad. Se pueden tener miles de requests pendientes y
+// recibir el resultado por callback.
+//
+// Un CoapClient pertenece a un único thread: coap_client_request y
+// coap_client_poll deben llamarse desde el mismo thread.
+
+#define COAP_CLIENT_OK          0   // llegó la respuesta
+#define COAP_CLIENT_TIMEOUT     1   // sin ACK tras las retransmisiones, o sin respuesta
+#define COAP_CLIENT_RESET       2   // el servidor respondió RST
+#define COAP_CLIENT_ERROR       3   // error de envío
+#define COAP_CLIENT_CANCELLED   4   // el cliente se destruyó con el request pendiente
+
+typedef struct {
+    int status;
+    const CoapMessage *response;    // solo con COAP_CLIENT_OK; válido durante el callback
+    uint64_t latency_us;            // desde coap_client_request
+    int retransmissions;
+} CoapClientResult;
+
+typedef void (*coap_client_cb)(const CoapClientResult *result, void *user);
+
+typedef struct CoapClient CoapClient;
+
+// params NULL = valores del RFC (NSTART = 1); para pipelining subir nstart
+CoapClient *coap_client_create(const CoapTxParams *params);
+void coap_client_destroy(CoapClient *client);
+
+// Tiempo máximo de espera de una respuesta NON o de una respuesta separada
+void coap_client_set_response_timeout(CoapClient *client, int timeout_ms);
+
+// Encola un request y vuelve enseguida; cb se llama exactamente una vez.
+// Devuelve -1 (sin llamar a cb) si no se pudo armar o enviar.
+// method: COAP_METHOD_*; payload solo se envía en POST/PUT.
+int coap_client_request(CoapClient *client, const struct sockaddr_in *server, uint8_t method,
+                        const char *path, int confirmable, const char *payload,
+                        coap_client_cb cb, void *user);
+
+// Procesa respuestas y timers, esperando hasta timeout_ms (-1 = sin límite,
+// acotado al próximo timer). Devuelve cuántos requests completó.
+int coap_client_poll(CoapClient *client, int timeout_ms);
+
+// Llama a poll hasta que no queden requests pendientes
+void coap_client_run(CoapClient *client);
+
+size_t coap_client_pending(const CoapClient *client);
+int coap_client_fd(const CoapClient *client);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -23,7 +23,10 @@ typedef struct {
     char uri_path[128];
     size_t uri_path_len;
     int content_format;
-    
+    long max_age;           // segundos; -1 = el request no trae Max-Age
+    char uri_query[128];    // opciones Uri-Query unidas con '&' ("id=esp32-7")
+    size_t uri_query_len;
+
 } coap_message_t;
 
 #define COAP_METHOD_GET     1
@@ -47,6 +50,8 @@ typedef struct {
 
 #define COAP_OPTION_URI_PATH      11
 #define COAP_OPTION_CONTENT_FORMAT 12
+#define COAP_OPTION_MAX_AGE       14
+#define COAP_OPTION_URI_QUERY     15
 
 int coap_default_success_code(uint8_t method);
 int parse_coap_message(const uint8_t *data, size_t len, coap_message_t *msg);
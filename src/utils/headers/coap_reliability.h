@@ -0,0 +1,107 @@
+#ifndef COAP_RELIABILITY_H
+#define COAP_RELIABILITY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <netinet/in.h>
+#include "timer_wheel.h"
+
+// Capa de confiabilidad del cliente CoAP (RFC 7252 §4.2 y §4.7):
+// retransmite los CON con ACK_TIMEOUT aleatorizado y backoff exponencial
+// hasta MAX_RETRANSMIT, y limita a NSTART los CON en vuelo por servidor
+// (el resto espera en una cola FIFO del servidor).
+//
+// Todo corre en el thread del llamador: una rueda de timers lleva miles de
+// exchanges sin un thread por request.
+
+#define COAP_ACK_TIMEOUT_MS      2000
+#define COAP_ACK_RANDOM_FACTOR   1.5
+#define COAP_MAX_RETRANSMIT      4
+#define COAP_NSTART              1
+#define COAP_MAX_PACKET          1024
+
+typedef struct {
+    int ack_timeout_ms;
+    double ack_random_factor;
+    int max_retransmit;
+    int nstart;             // CON simultáneos por servidor
+} CoapTxParams;
+
+// Resultado de un exchange
+#define COAP_EXCHANGE_ACKED       0   // llegó ACK (o respuesta piggybacked)
+#define COAP_EXCHANGE_RESET       1   // el servidor respondió RST
+#define COAP_EXCHANGE_TIMEOUT     2   // se agotaron las retransmisiones
+#define COAP_EXCHANGE_SEND_ERROR  3
+#define COAP_EXCHANGE_CANCELLED   4
+
+typedef struct CoapEndpoint CoapEndpoint;
+typedef struct CoapExchange CoapExchange;
+
+struct CoapExchange {
+    TimerEntry timer;           // primer campo: el callback de la rueda castea
+    CoapExchange *hash_next;
+    CoapExchange *queue_next;   // cola NSTART del servidor
+    CoapEndpoint *endpoint;
+    uint16_t mid;
+    uint8_t retransmits;
+    uint8_t in_flight;
+    uint32_t timeout_ms;        // timeout actual (se duplica en cada reintento)
+    uint64_t first_sent_ms;
+    void *user;
+    size_t len;
+    uint8_t packet[COAP_MAX_PACKET];
+};
+
+typedef void (*coap_exchange_fn)(CoapExchange *ex, int result, void *ctx);
+
+typedef struct {
+    int fd;
+    CoapTxParams params;
+    TimerWheel wheel;
+    CoapExchange **by_mid;      // hash (servidor, MID) de CON en vuelo
+    uint32_t mid_mask;
+    CoapEndpoint **endpoints;   // hash de servidores
+    uint32_t endpoint_mask;
+    uint64_t rng;
+    coap_exchange_fn on_done;
+    void *ctx;
+    size_t outstanding;         // CON en vuelo + en cola
+
+    uint64_t sent;
+    uint64_t retransmissions;
+    uint64_t timeouts;
+    uint64_t queued;            // veces que NSTART hizo esperar un CON
+} CoapReliability;
+
+void coap_tx_params_default(CoapTxParams *p);
+uint64_t coap_reliability_now_ms(void);
+
+// on_done se llama exactamente una vez por CON enviado con submit
+int coap_reliability_init(CoapReliability *r, int fd, const CoapTxParams *params,
+                          coap_exchange_fn on_done, void *ctx);
+void coap_reliability_free(CoapReliability *r);
+
+// Envía un mensaje ya serializado. Los NON salen directo y no se siguen.
+// El MID se lee del propio paquete. Devuelve 0 o -1.
+int coap_reliability_submit(CoapReliability *r, const struct sockaddr_in *peer,
+                            const uint8_t *packet, size_t len, void *user);
+
+// Procesar un ACK o RST recibido de peer. Devuelve 1 si cerró un exchange.
+int coap_reliability_handle(CoapReliability *r, const struct sockaddr_in *peer,
+                            uint16_t mid, uint8_t type);
+
+// Retransmite o da por perdidos los exchanges vencidos
+void coap_reliability_tick(CoapReliability *r, uint64_t now_ms);
+
+// Timeout para poll(): ms hasta el próximo vencimiento (-1 sin exchanges)
+int coap_reliability_next_timeout_ms(const CoapReliability *r, uint64_t now_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef COLD_STORE_H
+#define COLD_STORE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include "intern.h"
+
+// Almacenamiento en disco de las entradas que el data store saca de memoria
+// por presupuesto. Un archivo append-only de registros
+//
+//     ColdRecordHeader + key + value
+//
+// y un índice en memoria de clave internada -> offset (24 bytes por clave,
+// direccionamiento abierto). Traer una clave de vuelta a memoria deja su
+// registro como basura; cuando la basura supera a lo vivo se compacta el
+// archivo. No es durable: el log del store sigue siendo la fuente de verdad
+// y el archivo se trunca al crearlo.
+//
+// No es thread-safe: el data store lo usa con store_mutex tomado.
+
+typedef struct {
+    uint32_t key_len;
+    uint32_t value_len;
+    uint32_t flags;
+    uint32_t version;
+} ColdRecordHeader;
+
+// Lo que la entrada necesita para volver a memoria tal como estaba
+typedef struct {
+    uint32_t version;
+    uint16_t len;
+    uint16_t flags;
+} ColdMeta;
+
+typedef struct ColdStore ColdStore;
+
+ColdStore *cold_store_create(const char *path);
+// Cierra y borra el archivo
+void cold_store_destroy(ColdStore *cs);
+
+// Agrega un registro al lote en curso. -1 si no entra (escribir el lote con
+// cold_store_commit y volver a intentar).
+int cold_store_stage(ColdStore *cs, const InternKey *key, const char *value, size_t len, const ColdMeta *meta);
+// Escribe el lote con un solo pwrite y lo indexa. -1 = no se escribió nada
+// (el lote se descarta y las entradas deben quedar en memoria).
+int cold_store_commit(ColdStore *cs);
+
+int cold_store_contains(const ColdStore *cs, const InternKey *key);
+// Meta de la clave sin leer el disco. 1 si está, 0 si no.
+int cold_store_meta(const ColdStore *cs, const InternKey *key, ColdMeta *meta);
+// Lee el valor (terminado en '\0'). Devuelve el largo, -1 si no está o falla.
+int cold_store_read(ColdStore *cs, const InternKey *key, char *value, size_t cap, ColdMeta *meta);
+// Saca la clave del índice. 1 si estaba (con su meta en *meta), 0 si no.
+int cold_store_take(ColdStore *cs, const InternKey *key, ColdMeta *meta);
+
+typedef void (*cold_store_fn)(const InternKey *key, const char *value, size_t len, const ColdMeta *meta, void *ctx);
+// Recorre las claves leyendo cada valor del disco. Sin malloc ni stdio: se
+// puede usar en el hijo de un fork. Devuelve cuántos registros no se leyeron.
+size_t cold_store_scan(ColdStore *cs, cold_store_fn fn, void *ctx);
+
+size_t cold_store_count(const ColdStore *cs);
+uint64_t cold_store_file_bytes(const ColdStore *cs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
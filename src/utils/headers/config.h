@@ -7,6 +7,31 @@ typedef struct AppConfig
     const char *log_file;
     const char *store_file;
     const char *resource_path;
+    const char *metrics_file;       // Volcado Prometheus periódico (NULL = desactivado)
+    int metrics_interval_s;
+    const char *trace_file;         // Trazas Chrome/Perfetto (NULL = desactivado)
+    int trace_sample;               // Muestrear 1 de cada N requests (0 = no)
+    int trace_threshold_us;         // Muestrear requests más lentas que esto (0 = no)
+    const char *unix_socket;        // Escuchar en un socket Unix en vez de UDP (NULL = UDP)
+    int verbose;                    // printf por request (0 = solo server.log)
+    double rate_limit;              // requests/s por origen (0 = sin límite)
+    double rate_burst;              // ráfaga permitida por origen (0 = rate_limit)
+    int max_pending;                // requests pendientes antes de responder 5.03 (0 = sin límite)
+    int shed_max_age;               // Max-Age (s) sugerido en la 5.03
+    int workers;                    // Pool de workers con carriles (-1 = uno por core, 0 = thread por request)
+    int lane_capacity;              // Datagramas en cola por carril
+    int stale_ms;                   // Descartar CON más viejos que esto (0 = nunca)
+    int coalesce_ms;                // Ventana de coalescing del log (0 = un append por escritura)
+    int compress;                   // Valores JSON con diccionario de plantillas
+    int ttl_s;                      // TTL por defecto de las claves del recurso (0 = no expiran)
+    int memory_budget_kb;           // Memoria de las entradas del store antes de desalojar (0 = sin límite)
+    const char *index_fields;       // Campos del payload indexados, separados por coma (NULL = no)
+    const char *shm_table;          // Tabla de últimos valores en memoria compartida (NULL = no)
+    int shm_slots;                  // Claves que entran en la tabla compartida
+    const char *feed_socket;        // Socket Unix del change feed (NULL = desactivado)
+    int feed_buffer_kb;             // Cambios retenidos para reanudar y suscriptores lentos
+    const char *snapshot_file;      // Destino de los snapshots (NULL = <store>.snapshot)
+    int snapshot_interval_s;        // Snapshot agendado cada N segundos (0 = solo a pedido)
 } AppConfig;
 
 void set_default_config(AppConfig *cfg);
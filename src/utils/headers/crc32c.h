@@ -0,0 +1,32 @@
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CRC32C (Castagnoli), el de iSCSI/ext4. En x86-64 con SSE4.2 y en ARMv8
+// con la extensión CRC usa la instrucción del procesador (8 bytes por
+// instrucción); si no, una tabla de 256 entradas. Sin estado ni locks: se
+// puede usar en el hijo de un fork.
+
+// CRC de data continuando uno anterior (0 para empezar):
+// crc32c_extend(crc32c_extend(0, a, n), b, m) == CRC de a seguido de b
+uint32_t crc32c_extend(uint32_t crc, const void *data, size_t len);
+
+static inline uint32_t crc32c(const void *data, size_t len)
+{
+    return crc32c_extend(0, data, len);
+}
+
+// 1 si se usa la instrucción del procesador
+int crc32c_hardware(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
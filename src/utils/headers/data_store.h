@@ -2,6 +2,7 @@
 #define DATA_STORE_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -9,8 +10,90 @@ extern "C" {
 
 int data_store_init(const char *filepath);
 int data_store_set(const char *uri_path, const char *json_payload);
+// TTL en segundos desde esta escritura (cada escritura lo reinicia): al
+// vencer la clave se borra y se agrega un tombstone al log. 0 = no expira;
+// DATA_STORE_TTL_ROUTE = el de la ruta (data_store_set_route_ttl), que es lo
+// que usa data_store_set.
+#define DATA_STORE_TTL_ROUTE (-1)
+int data_store_set_with_ttl(const char *uri_path, const char *json_payload, int ttl_s);
+// TTL por defecto de las claves bajo prefix ("/sensors" incluye
+// "/sensors/x"; el prefijo más largo gana). Llamar antes de data_store_init
+// para que también se aplique a las claves cargadas sin vencimiento propio.
+int data_store_set_route_ttl(const char *prefix, int ttl_s);
 int data_store_get(const char *uri_path, char *out_payload, size_t out_size);
+// Índice secundario por campos del payload JSON (nombres separados por coma,
+// "id" indexa "id":"esp32-7"): cada valor apunta a su última lectura, aunque
+// varios dispositivos escriban la misma clave (ver field_index.h). Una
+// lectura se copia al índice solo cuando otro dispositivo pisa su clave.
+// NULL o "" = sin índice. Llamar antes de data_store_init para que se arme
+// con lo cargado.
+int data_store_set_index_fields(const char *fields);
+// Última lectura con field == value escrita en uri_path o debajo. Igual que
+// data_store_get: el largo completo, 0 si no hay; -1 si field no está indexado.
+int data_store_get_by_field(const char *uri_path, const char *field, const char *value,
+                            char *out_payload, size_t out_size);
+// GET con patrón: las claves que cumplen pattern ("/sensors/*/temp": cada
+// segmento "*" vale un segmento; el último, uno o más, así que "/sensors/*"
+// es todo lo que cuelga de "/sensors/"), en orden, a partir de la siguiente
+// a after (NULL = desde el principio). Escribe una página
+//   {"items":{"<clave>":<valor>,...},"next":"<clave>"}
+// armada con store_mutex tomado (una vista consistente de esas claves) y de
+// hasta out_size bytes o limit claves (0 = sin límite); "next" está si
+// pueden quedar más y es el after de la página siguiente. Un valor que no
+// entra en una página va como null. Las claves desalojadas se leen del cold
+// store sin volver a memoria. Devuelve el largo o -1 si pattern no tiene "*".
+int data_store_get_matching(const char *pattern, const char *after, int limit, char *out, size_t out_size);
 int data_store_delete(const char *uri_path);
+// Coalescing: el estado en memoria se actualiza en cada escritura, pero al
+// archivo va un solo registro por clave cada interval_ms (el último valor).
+// Se pierden a lo sumo interval_ms de escrituras si el proceso muere.
+// 0 = desactivado (un append por escritura). Llamar después de data_store_init.
+int data_store_set_coalescing(int interval_ms);
+// Guarda los valores JSON comprimidos con un diccionario de plantillas que
+// se aprende de los payloads y se persiste en el mismo log (ver json_dict.h).
+// Se descomprime al leer. Llamar antes de data_store_init.
+int data_store_set_compression(int enabled);
+// Presupuesto de memoria de las entradas (0 = sin límite). Al pasarlo se
+// desalojan con CLOCK las menos usadas a <store>.cold (ver cold_store.h) y
+// vuelven a memoria cuando se leen. Ese archivo no es durable: se trunca al
+// crearlo y el log sigue siendo la fuente de verdad. Llamar antes de
+// data_store_init.
+int data_store_set_memory_budget(size_t bytes);
+// Publica los últimos valores en una tabla de memoria compartida (/name,
+// ver shm_table.h) para lectores locales. Se publica lo ya cargado y después
+// cada escritura y borrado. NULL = desactivar (borra la tabla).
+int data_store_set_shared_table(const char *name, unsigned slots);
+// Stream ordenado de cambios (clave, valor, versión, timestamp) por un socket
+// Unix en path, con un buffer de ring_bytes para reanudar y absorber
+// suscriptores lentos (ver change_feed.h). NULL = desactivar.
+int data_store_set_change_feed(const char *path, size_t ring_bytes);
+
+// Snapshot en segundo plano: fork() con store_mutex tomado solo durante el
+// fork; el hijo escribe la vista copy-on-write del store (mismo formato que
+// el log, cargable con data_store_init) en un .tmp y lo renombra, mientras el
+// padre sigue atendiendo.
+typedef struct {
+    int running;
+    uint64_t started_ns;            // del último snapshot
+    uint64_t completed;
+    uint64_t failed;
+    int last_ok;
+    uint64_t last_entries;
+    uint64_t last_bytes;
+    uint64_t last_fork_us;          // lo que estuvo tomado store_mutex
+    uint64_t last_duration_ms;      // del fork a que el hijo terminó
+    uint64_t last_cow_pages;        // páginas copiadas por copy-on-write
+    uint64_t last_cow_kb;
+} DataStoreSnapshotInfo;
+
+// path NULL = <archivo del store>.snapshot; interval_s > 0 agenda uno cada
+// interval_s segundos. Llamar después de data_store_init.
+int data_store_set_snapshot(const char *path, int interval_s);
+// 0 = iniciado, 1 = ya hay uno en curso, -1 = error
+int data_store_snapshot_start(void);
+void data_store_snapshot_info(DataStoreSnapshotInfo *out);
+// Espera al snapshot en curso, detiene el flusher (escribiendo lo
+// pendiente) y libera todo
 void data_store_cleanup(void);
 
 #ifdef __cplusplus
@@ -0,0 +1,94 @@
+#ifndef FIELD_INDEX_H
+#define FIELD_INDEX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include "intern.h"
+
+// Índice secundario del data store: valor de un campo del payload JSON
+// ("id":"esp32-7") -> última lectura con ese valor. Varios dispositivos
+// escriben la misma clave (/sensors/temp), así que la clave solo tiene la
+// lectura del último; el índice no copia los payloads:
+//
+//   - mientras la lectura de un dispositivo es el valor actual de su clave,
+//     la entrada del índice solo apunta a la clave (reading == NULL);
+//   - cuando otro dispositivo pisa la clave, el data store le pasa al índice
+//     la lectura anterior (ya codificada, ver json_dict.h) antes de
+//     reemplazarla: cada lectura queda en un solo lugar.
+//
+// Hash encadenado por (campo, valor). No es thread-safe: el data store lo
+// usa con store_mutex tomado.
+
+#define FIELD_INDEX_FIELDS_MAX  4
+#define FIELD_INDEX_NAME_MAX    32
+#define FIELD_INDEX_VALUE_MAX   64
+
+typedef struct FieldIndexEntry {
+    struct FieldIndexEntry *next;   // cadena del bucket
+    uint64_t hash;
+    const InternKey *key;           // clave del store donde se escribió la lectura (con referencia)
+    char *reading;                  // NULL = es el valor actual de key
+    uint64_t expires_ms;            // de reading (CLOCK_REALTIME, 0 = no expira)
+    uint16_t reading_len;
+    uint8_t compressed;             // reading codificado con json_dict
+    uint8_t field;                  // posición en los campos configurados
+    uint16_t value_len;
+    char value[];                   // valor del campo, sin comillas
+} FieldIndexEntry;
+
+// Valor de un campo indexado dentro de un payload (apunta al payload)
+typedef struct {
+    int field;
+    const char *value;
+    size_t len;
+} FieldValue;
+
+typedef struct FieldIndex FieldIndex;
+
+// fields: nombres separados por coma ("id" o "id,mac"). NULL si la lista
+// es inválida o no hay memoria.
+FieldIndex *field_index_create(const char *fields);
+void field_index_destroy(FieldIndex *fi);
+// Vacía el índice y conserva los campos
+void field_index_clear(FieldIndex *fi);
+
+// Posición del campo name o -1 si no está indexado
+int field_index_field(const FieldIndex *fi, const char *name, size_t len);
+
+// Campos indexados del objeto de primer nivel de json: strings (tal cual,
+// sin desescapar), números y literales de hasta FIELD_INDEX_VALUE_MAX
+// bytes. Devuelve cuántos encontró (a lo sumo uno por campo).
+size_t field_index_extract(const FieldIndex *fi, const char *json, size_t len,
+                           FieldValue out[FIELD_INDEX_FIELDS_MAX]);
+
+FieldIndexEntry *field_index_find(const FieldIndex *fi, int field, const char *value, size_t len);
+// La busca o la crea (sin lectura). NULL si no hay memoria.
+FieldIndexEntry *field_index_put(FieldIndex *fi, int field, const char *value, size_t len);
+void field_index_remove(FieldIndex *fi, FieldIndexEntry *ie);
+// ie pasa a apuntar a k: toma una referencia de k y suelta la anterior
+void field_index_set_key(FieldIndexEntry *ie, const InternKey *k);
+
+// ie se queda con una copia de la lectura (la clave va a cambiar de valor)
+int field_index_keep(FieldIndex *fi, FieldIndexEntry *ie, const char *reading, size_t len,
+                     int compressed, uint64_t expires_ms);
+// Libera la copia: la lectura vuelve a ser el valor actual de ie->key
+void field_index_release(FieldIndex *fi, FieldIndexEntry *ie);
+
+typedef void (*field_index_fn)(FieldIndexEntry *ie, void *ctx);
+// Sin malloc ni stdio: se puede usar en el hijo de un fork. fn puede
+// remover la entrada que recibe.
+void field_index_scan(FieldIndex *fi, field_index_fn fn, void *ctx);
+
+size_t field_index_count(const FieldIndex *fi);
+// Bytes de lecturas copiadas (las que ya no son el valor de su clave)
+size_t field_index_kept_bytes(const FieldIndex *fi);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
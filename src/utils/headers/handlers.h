@@ -3,10 +3,16 @@
 
 #include "coap_api.h"
 
+int is_valid_json(const char *str);
+
 int HandlerFunctionTempPost(const coap_message_t *msg, char *responseBuffer);
 int HandlerFunctionTempGet(const coap_message_t *msg, char *responseBuffer);
+int HandlerFunctionBulkGet(const coap_message_t *msg, char *responseBuffer);
 int HandlerFunctionTempPut(const coap_message_t *msg, char *responseBuffer);
 int HandlerFunctionTempDelete(const coap_message_t *msg, char *responseBuffer);
+int HandlerFunctionMetricsGet(const coap_message_t *msg, char *responseBuffer);
+int HandlerFunctionSnapshotGet(const coap_message_t *msg, char *responseBuffer);
+int HandlerFunctionSnapshotPost(const coap_message_t *msg, char *responseBuffer);
 
 #endif
 
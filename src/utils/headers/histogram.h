@@ -0,0 +1,46 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+// Histograma log-lineal: 16 sub-buckets por potencia de 2 (~6% de error relativo).
+// Los contadores son atómicos: se puede registrar desde varios threads y leer
+// percentiles sin tomar ningún lock.
+#define HIST_SUB_BITS   4
+#define HIST_SUB_COUNT  (1 << HIST_SUB_BITS)
+#define HIST_MAGNITUDES 38
+#define HIST_BUCKETS    (HIST_MAGNITUDES * HIST_SUB_COUNT)
+#define HIST_MAX_VALUE  ((1ULL << (HIST_MAGNITUDES + HIST_SUB_BITS - 1)) - 1)
+
+typedef struct {
+    atomic_ullong counts[HIST_BUCKETS];
+    atomic_ullong total;
+    atomic_ullong sum;
+    atomic_ullong max;
+} Histogram;
+
+void hist_init(Histogram *h);
+void hist_record(Histogram *h, uint64_t value);
+// Registra un valor corrigiendo coordinated omission: si el valor supera el
+// intervalo esperado entre muestras, también registra las muestras que se
+// habrían tomado mientras el emisor estaba bloqueado.
+void hist_record_corrected(Histogram *h, uint64_t value, uint64_t expected_interval);
+void hist_merge(Histogram *dst, const Histogram *src);
+uint64_t hist_count(const Histogram *h);
+uint64_t hist_max(const Histogram *h);
+double hist_mean(const Histogram *h);
+uint64_t hist_percentile(const Histogram *h, double percentile);
+
+int hist_bucket_index(uint64_t value);
+uint64_t hist_bucket_upper(int index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Tabla de URIs internadas: cada ruta distinta se guarda una sola vez y
+// router y data store comparten el mismo puntero. Dos claves son iguales si
+// y solo si sus punteros lo son, y el hash ya viene calculado.
+//
+// Cada clave lleva un contador de referencias: intern_get devuelve una que
+// el llamador tiene que soltar con intern_release, y quien guarde el puntero
+// toma la suya con intern_acquire. Con la última se libera, así la tabla
+// sigue a las claves vivas y no a todas las que alguna vez se escribieron.
+//
+// Buscar no toma locks, pero un intern_release que libera desengancha la
+// clave de su cadena: quien busque sin tener una referencia tiene que estar
+// serializado con quien suelta (el data store lo hace con su mutex). Las
+// rutas del router se quedan su referencia para siempre.
+
+typedef struct InternKey {
+    struct InternKey *next;     // cadena del bucket
+    uint64_t hash;
+    uint32_t len;
+    uint32_t refs;              // atómico, ver intern_acquire/intern_release
+    char str[];
+} InternKey;
+
+uint64_t intern_hash(const char *s, size_t len);
+
+// NULL si la URI nunca se internó
+const InternKey *intern_lookup(const char *s, size_t len);
+// La interna si hace falta y devuelve una referencia nueva.
+// NULL solo si no hay memoria.
+const InternKey *intern_get(const char *s, size_t len);
+void intern_acquire(const InternKey *k);
+// Suelta una referencia; con la última la clave deja de existir
+void intern_release(const InternKey *k);
+
+size_t intern_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef JSON_DICT_H
+#define JSON_DICT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Compresión de payloads JSON con un diccionario de plantillas.
+//
+// La plantilla de un JSON es el mismo texto con el contenido de cada valor
+// escalar (strings, números, true/false/null) reemplazado por un hueco
+// (JSON_DICT_HOLE); las claves, la estructura y los espacios quedan. Los
+// payloads de un mismo tipo de dispositivo comparten plantilla, así que se
+// guarda una vez y cada valor queda como
+//
+//     @<id>\t<hueco 1>\t<hueco 2>...
+//
+// que se vuelve a armar byte a byte al leer. El diccionario se aprende con
+// los valores que llegan y se persiste en el log del store con un registro
+// de plantilla por id (store_log.h). La plantilla 0 es la identidad: "@0\t<texto>"
+// guarda tal cual un valor que empieza con '@'.
+//
+// No es thread-safe: el data store lo usa con store_mutex tomado.
+
+#define JSON_DICT_MARK      '@'
+#define JSON_DICT_HOLE      '\x01'  // JSON no permite controles sin escapar
+#define JSON_DICT_MAX       4096    // plantillas
+
+// Codifica json en out. Devuelve el largo, o -1 si no es un JSON que se
+// pueda separar en plantilla y huecos, si no queda más corto o si el
+// diccionario está lleno (el llamador lo guarda sin comprimir).
+int json_dict_encode(const char *json, size_t len, char *out, size_t cap);
+
+// Codificación de un valor que no se comprime pero empieza con '@'
+int json_dict_encode_literal(const char *value, size_t len, char *out, size_t cap);
+
+// Decodifica en out (terminado en '\0'). Devuelve el largo o -1.
+int json_dict_decode(const char *enc, size_t len, char *out, size_t cap);
+
+// Plantilla de un valor codificado (0 = literal, -1 = mal formado)
+int json_dict_id(const char *enc, size_t len);
+const char *json_dict_template(uint32_t id);
+
+// Carga una plantilla del log con su id original
+int json_dict_define(uint32_t id, const char *tmpl, size_t len);
+
+// Escritura al log: devuelve 1 la primera vez por plantilla (el llamador
+// escribe el registro de la plantilla antes del valor) y 0 después
+int json_dict_take_unpersisted(uint32_t id);
+// El log se reescribió desde cero: hay que volver a definir todo
+void json_dict_clear_persisted(void);
+
+uint32_t json_dict_count(void);
+void json_dict_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -3,7 +3,7 @@
 
 #define MAX_TOKEN_LEN 8
 #define MAX_OPTIONS 16
-#define MAX_PAYLOAD 256
+#define MAX_PAYLOAD 512
 
 typedef struct
 {
@@ -35,6 +35,9 @@ int coap_add_option(CoapMessage *msg, unsigned short number, const unsigned char
 int coap_set_payload(CoapMessage *msg, const unsigned char *data, int len);
 int coap_serialize(CoapMessage *msg, unsigned char *buffer, int buf_size);
 int coap_parse(CoapMessage *msg, const unsigned char *buffer, int len);
+// Como coap_parse pero sin malloc: los valores de las opciones apuntan a
+// buffer (no liberarlos, válidos mientras viva buffer) y valida los largos.
+int coap_parse_view(CoapMessage *msg, const unsigned char *buffer, int len);
 
 #endif
 
@@ -0,0 +1,94 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Contadores monotónicos del servidor
+typedef enum {
+    METRIC_RX_DATAGRAMS,
+    METRIC_TX_RESPONSES,
+    METRIC_NO_REPLY,
+    METRIC_PARSE_ERRORS,
+    METRIC_NOT_FOUND,
+    METRIC_HANDLER_ERRORS,
+    METRIC_SEND_ERRORS,
+    METRIC_DROPPED,
+    METRIC_STORE_WRITES,
+    METRIC_STORE_INPLACE,
+    METRIC_STORE_COALESCED,
+    METRIC_STORE_EXPIRED,
+    METRIC_STORE_HITS,
+    METRIC_STORE_MISSES,
+    METRIC_STORE_EVICTIONS,
+    METRIC_STORE_BULK_KEYS,
+    METRIC_SHED_RATE,
+    METRIC_SHED_OVERLOAD,
+    METRIC_STALE_DROPS,
+    METRIC_FEED_LAGGED,
+    METRIC_SNAPSHOTS,
+    METRIC_TRACE_DROPPED,
+    METRIC_COUNTER_COUNT
+} MetricCounter;
+
+// Valores instantáneos
+typedef enum {
+    METRIC_GAUGE_IN_FLIGHT,
+    METRIC_GAUGE_STORE_ENTRIES,
+    METRIC_GAUGE_STORE_BYTES,
+    METRIC_GAUGE_TTL_KEYS,
+    METRIC_GAUGE_RESIDENT_BYTES,
+    METRIC_GAUGE_COLD_KEYS,
+    METRIC_GAUGE_INDEX_KEYS,
+    METRIC_GAUGE_INDEX_KEPT_BYTES,
+    METRIC_GAUGE_QUEUED,
+    METRIC_GAUGE_FEED_SUBSCRIBERS,
+    METRIC_GAUGE_COUNT
+} MetricGauge;
+
+// Histogramas de latencia (microsegundos)
+typedef enum {
+    METRIC_HIST_REQUEST_US,
+    METRIC_HIST_STORE_SET_US,
+    METRIC_HIST_COUNT
+} MetricHistogram;
+
+void metrics_init(void);
+uint64_t metrics_now_ns(void);
+
+void metrics_inc(MetricCounter c);
+void metrics_add(MetricCounter c, uint64_t n);
+uint64_t metrics_get(MetricCounter c);
+
+void metrics_gauge_add(MetricGauge g, long delta);
+void metrics_gauge_set(MetricGauge g, long value);
+long metrics_gauge_get(MetricGauge g);
+
+void metrics_observe(MetricHistogram h, uint64_t value);
+
+// Bytes máximos de un campo del snapshot (el de un histograma)
+#define METRICS_JSON_FIELD_MAX 192
+
+// Snapshot JSON compacto (sin locks). Omite los contadores en cero. Va por
+// páginas de campos enteros: si no entran todos en out_size, la página
+// termina con "next":"<campo>", que se pasa como after para seguir (NULL =
+// desde el principio). Retorna la longitud escrita o -1 si el buffer no
+// alcanza para un campo o after no es un campo.
+int metrics_snapshot_json(char *out, size_t out_size, const char *after);
+
+// Volcado en formato de texto de Prometheus
+int metrics_write_prometheus(FILE *f);
+
+// Lanza un thread que reescribe 'path' cada 'interval_s' segundos
+int metrics_start_prometheus_dump(const char *path, int interval_s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,6 +1,9 @@
 #ifndef ROUTES_H
 #define ROUTES_H
 
+#define METRICS_RESOURCE_PATH "/.well-known/metrics"
+#define SNAPSHOT_RESOURCE_PATH "/.well-known/snapshot"
+
 int register_routes(const char *resource_path);
 
 #endif
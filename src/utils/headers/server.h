@@ -7,6 +7,8 @@ extern "C" {
 
 #include "logger.h"
 #include "coap_parser.h"
+#include "transport.h"
+#include "admission.h"
 #include <pthread.h>
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -14,14 +16,29 @@ extern "C" {
 #include <arpa/inet.h>
 
 struct MessageData {
-    uint8_t buffer[1024];
+    uint8_t buffer[TRANSPORT_MAX_DATAGRAM];
     ssize_t len;
-    struct sockaddr_in client_addr;
-    socklen_t client_len;
-    int sockfd;
+    TransportPeer peer;
+    Transport *transport;   // por donde sale la respuesta
+    uint64_t rx_ns;     // instante de recepción (CLOCK_MONOTONIC), base del deadline
 };
 
 void start_server(int port, Logger *logger);
+// Loop de recepción sobre cualquier transporte (el pool de workers, o un
+// thread por datagrama si se configuró así con server_set_workers)
+void server_run(Transport *transport, Logger *logger);
+// Procesa un datagrama completo en el thread actual: parseo, router y respuesta
+void server_handle_datagram(struct MessageData *msg_data, Logger *logger);
+// 0 = sin printf por request (solo server.log y métricas)
+void server_set_verbose(int verbose);
+// Activa el control de admisión en server_run (5.03 a lo que no entra)
+int server_set_admission(const AdmissionConfig *cfg);
+// Pool fijo con carriles CON/NON, lectura/escritura y gestión: workers < 0
+// (por defecto) = uno por core, 0 = sin pool, un thread por datagrama;
+// lane_capacity = datagramas en cola por carril (0 = por defecto)
+void server_set_workers(int workers, uint32_t lane_capacity);
+// Descarta los CON que esperaron más de deadline_ms desde el recv (0 = nunca)
+void server_set_stale_deadline(int deadline_ms);
 void* process_message(void* arg);
 unsigned long get_thread_id(void);
 
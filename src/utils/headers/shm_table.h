@@ -0,0 +1,73 @@
+#ifndef SHM_TABLE_H
+#define SHM_TABLE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Tabla de últimos valores en memoria compartida (shm_open + mmap) para que
+// procesos locales lean el data store sin hacer un GET por valor.
+//
+// Layout: un header, un índice de direccionamiento abierto (hash de la clave
+// -> slot + 1) y slots de tamaño fijo. Cada slot lleva un seqlock: el
+// escritor lo deja impar mientras escribe y par al terminar; el lector copia
+// el slot y reintenta si la secuencia cambió. Los lectores no toman locks ni
+// escriben en la tabla (la abren de solo lectura).
+//
+// Un solo escritor (el data store, con store_mutex tomado). Los slots no se
+// reciclan: una clave borrada queda con SHM_SLOT_DELETED y vuelve a usar su
+// slot si se escribe otra vez.
+
+#define SHM_TABLE_MAGIC     0x53484D54u     // "SHMT"
+#define SHM_TABLE_VERSION   1
+#define SHM_KEY_MAX         120
+#define SHM_VALUE_MAX       240
+
+#define SHM_SLOT_DELETED    1u
+#define SHM_SLOT_TOO_LARGE  2u              // el valor no entra: pedirlo por CoAP
+
+#define SHM_NOT_FOUND       -1
+#define SHM_TOO_LARGE       -2
+
+typedef struct {
+    char key[SHM_KEY_MAX + 1];
+    char value[SHM_VALUE_MAX + 1];
+    uint32_t flags;             // SHM_SLOT_*
+    uint64_t version;           // escrituras de la clave desde que se publicó
+    uint64_t updated_ns;        // CLOCK_REALTIME de la última escritura
+} ShmValue;
+
+typedef struct ShmTable ShmTable;
+
+// Escritor: crea (o recrea) /name con slots entradas. NULL si falla.
+ShmTable *shm_table_create(const char *name, uint32_t slots);
+// Publica el valor de key. -1 si la clave es muy larga o la tabla está llena;
+// un valor de más de SHM_VALUE_MAX se publica como SHM_SLOT_TOO_LARGE.
+int shm_table_publish(ShmTable *t, const char *key, size_t key_len,
+                      const char *value, size_t value_len);
+// Marca la clave como borrada (0 aunque no estuviera)
+int shm_table_remove(ShmTable *t, const char *key, size_t key_len);
+// Desmapea; unlink = 1 borra además el objeto de memoria compartida
+void shm_table_close(ShmTable *t, int unlink_name);
+
+// Lector: abre una tabla existente de solo lectura
+ShmTable *shm_table_open(const char *name);
+// Copia el valor de key en out (terminado en '\0'). Devuelve el largo, o
+// SHM_NOT_FOUND (no existe o está borrada) o SHM_TOO_LARGE. version puede ser NULL.
+int shm_table_get(const ShmTable *t, const char *key, char *out, size_t out_size,
+                  uint64_t *version);
+// Recorre todos los slots en uso con una copia consistente de cada uno
+// (borradas incluidas). fn devuelve != 0 para cortar. Devuelve cuántos visitó.
+typedef int (*shm_table_fn)(const ShmValue *v, void *ctx);
+size_t shm_table_scan(const ShmTable *t, shm_table_fn fn, void *ctx);
+// Slots en uso
+uint32_t shm_table_count(const ShmTable *t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef SKIPLIST_H
+#define SKIPLIST_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include "intern.h"
+
+// Claves internadas en orden de bytes (skip list con p = 1/4): insertar,
+// borrar y posicionarse cuestan O(log n) y después se avanza en orden por
+// el nivel 0. El data store la usa para recorrer un rango de claves
+// ("/sensors/" ... ) sin pasar por el índice hash.
+//
+// No es thread-safe: el data store la usa con store_mutex tomado.
+
+#define SKIPLIST_MAX_LEVEL 16
+
+typedef struct SkipNode {
+    const InternKey *key;
+    uint8_t level;
+    struct SkipNode *next[];        // level punteros
+} SkipNode;
+
+typedef struct SkipList SkipList;
+
+SkipList *skiplist_create(void);
+void skiplist_destroy(SkipList *sl);
+
+// 0 = insertada, 1 = ya estaba, -1 = sin memoria
+int skiplist_insert(SkipList *sl, const InternKey *key);
+// 1 si estaba
+int skiplist_remove(SkipList *sl, const InternKey *key);
+
+// Primer nodo con clave >= s (NULL si no hay)
+const SkipNode *skiplist_seek(const SkipList *sl, const char *s, size_t len);
+static inline const SkipNode *skiplist_next(const SkipNode *node)
+{
+    return node->next[0];
+}
+
+size_t skiplist_count(const SkipList *sl);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Pools de objetos de tamaño fijo para el camino de requests.
+//
+// Cada thread tiene su propio heap por pool: alloc y free locales son un
+// push/pop en una lista del thread, sin locks ni atómicos. Un objeto que se
+// libera desde otro thread (el receptor aloca MessageData y lo libera el
+// worker) va a la lista remota de su dueño con un CAS; el dueño la recupera
+// entera con un exchange cuando se le vacía la lista local.
+//
+// Cuando un thread termina su heap queda huérfano y lo adopta el próximo
+// thread que lo necesite, así el modo thread-per-request reutiliza los
+// objetos en vez de crecer. El mutex del pool solo se toma al crear slabs o
+// al adoptar/soltar un heap.
+
+#define SLAB_MAX_POOLS 16
+
+typedef struct SlabPool SlabPool;
+
+// obj_size se redondea a 16 bytes (máximo ~64 KiB); los objetos de 64 bytes
+// o múltiplos quedan alineados a línea de cache. NULL si no hay memoria o ya
+// hay SLAB_MAX_POOLS pools.
+SlabPool *slab_pool_create(const char *name, size_t obj_size);
+// Solo cuando ningún thread usa el pool
+void slab_pool_destroy(SlabPool *pool);
+
+void *slab_alloc(SlabPool *pool);
+// El objeto recuerda a su pool: no hace falta pasarlo
+void slab_free(void *obj);
+
+typedef struct {
+    uint64_t slabs;         // bloques pedidos a malloc
+    uint64_t objects;       // objetos creados en total
+} SlabStats;
+
+void slab_pool_stats(const SlabPool *pool, SlabStats *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef STORE_LOG_H
+#define STORE_LOG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Formato binario del log y de los snapshots del data store: un encabezado
+// de 8 bytes (STORE_LOG_MAGIC) y después registros
+//
+//     StoreRecordHeader + key + value
+//
+// con el largo adelante y un CRC32C (crc32c.h) de todo lo que sigue al
+// campo crc. La clave y el valor pueden tener cualquier byte (tabs, saltos
+// de línea). Al cargar se recorre el archivo en orden y el primer registro
+// incompleto o con CRC que no coincide marca el final de lo válido: una
+// escritura cortada por un crash se detecta en vez de cargarse a medias.
+// Enteros en el orden de bytes de la máquina, como cold_store.h.
+
+#define STORE_LOG_MAGIC         "CSTLOG1\n"
+#define STORE_LOG_MAGIC_LEN     8
+#define STORE_LOG_KEY_MAX       1024
+#define STORE_LOG_VALUE_MAX     4096    // valores y plantillas
+
+typedef enum {
+    STORE_REC_VALUE = 1,        // último valor de key (codificado, ver json_dict.h)
+    STORE_REC_TEMPLATE = 2,     // plantilla del diccionario: id en version, texto en value
+    STORE_REC_TOMBSTONE = 3,    // key expiró (timestamp_ms = cuándo)
+    STORE_REC_INDEXED = 4       // lectura que solo guarda el índice por campo
+                                // (field_index.h): key ya tiene otro valor
+} StoreRecordType;
+
+#define STORE_REC_PINNED 1u     // flags de STORE_REC_VALUE: Max-Age 0, no expira
+
+typedef struct {
+    uint32_t len;               // bytes que siguen a crc (resto del header, key y value)
+    uint32_t crc;               // CRC32C de esos len bytes
+    uint8_t type;               // StoreRecordType
+    uint8_t flags;
+    uint16_t key_len;
+    uint32_t value_len;
+    uint32_t version;           // de la clave (change feed)
+    uint32_t reserved;
+    uint64_t timestamp_ms;      // CLOCK_REALTIME al escribir el registro
+    uint64_t expires_ms;        // VALUE/INDEXED con TTL (0 = sin vencimiento)
+} StoreRecordHeader;
+
+typedef struct {
+    StoreRecordType type;
+    uint32_t flags;
+    uint32_t version;
+    uint64_t timestamp_ms;
+    uint64_t expires_ms;
+    const char *key;
+    size_t key_len;
+    const char *value;          // al leer, terminado en '\0'
+    size_t value_len;
+} StoreRecord;
+
+static inline size_t store_log_record_size(size_t key_len, size_t value_len)
+{
+    return sizeof(StoreRecordHeader) + key_len + value_len;
+}
+
+// Arma el registro en out. Devuelve los bytes escritos o 0 si no entra en
+// cap o excede los máximos. Sin malloc ni stdio: se usa en el hijo de un fork.
+size_t store_log_encode(char *out, size_t cap, const StoreRecord *rec);
+
+// Lectura secuencial sobre un FILE* ya posicionado después del magic
+typedef struct {
+    FILE *f;
+    uint64_t offset;            // fin del último registro válido
+    char buf[sizeof(StoreRecordHeader) + STORE_LOG_KEY_MAX + STORE_LOG_VALUE_MAX + 1];
+} StoreLogReader;
+
+// Lee el magic. 1 = archivo binario (el reader queda listo), 0 = otro
+// formato o vacío (el FILE* vuelve al principio).
+int store_log_open(StoreLogReader *rd, FILE *f);
+// 1 = registro en *rec (válido hasta la próxima llamada), 0 = fin del archivo
+// justo después de un registro, -1 = registro cortado o corrupto desde
+// rd->offset.
+int store_log_read(StoreLogReader *rd, StoreRecord *rec);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Rueda de timers con hash: cada slot es una lista intrusiva de los timers
+// cuyo tick de expiración cae en él (tick & mask). Agregar y cancelar son
+// O(1); avanzar recorre solo los slots de los ticks transcurridos, y un
+// timer más lejano que una vuelta completa queda en su slot hasta su tick.
+//
+// No es thread-safe: la usa un único thread (el loop del cliente).
+
+typedef struct TimerEntry {
+    struct TimerEntry *prev;
+    struct TimerEntry *next;
+    uint64_t expires_tick;
+    int armed;
+} TimerEntry;
+
+typedef void (*timer_fn)(TimerEntry *timer, void *ctx);
+
+typedef struct {
+    TimerEntry *slots;      // cabeceras centinela
+    uint32_t mask;
+    uint32_t tick_ms;
+    uint64_t current_tick;  // último tick procesado
+    size_t count;
+} TimerWheel;
+
+int timer_wheel_init(TimerWheel *w, uint32_t slots, uint32_t tick_ms, uint64_t now_ms);
+void timer_wheel_free(TimerWheel *w);
+
+// Arma (o re-arma) el timer para expirar en expires_ms
+void timer_wheel_add(TimerWheel *w, TimerEntry *timer, uint64_t expires_ms);
+void timer_wheel_cancel(TimerWheel *w, TimerEntry *timer);
+
+// Dispara los timers vencidos hasta now_ms; fn puede volver a armarlos.
+// Devuelve cuántos disparó.
+int timer_wheel_advance(TimerWheel *w, uint64_t now_ms, timer_fn fn, void *ctx);
+
+// Milisegundos hasta el próximo tick con timers (-1 si no hay ninguno)
+int timer_wheel_next_timeout_ms(const TimerWheel *w, uint64_t now_ms);
+
+// Rueda jerárquica para timers lejanos (TTLs de minutos a meses): niveles de
+// 64 slots donde cada slot del nivel n abarca 64^n ticks. Un timer entra en
+// el nivel más bajo que alcanza su vencimiento y baja un nivel (cascada)
+// cuando la vuelta del nivel de abajo llega a su slot, así que se mueve a lo
+// sumo TIMER_HWHEEL_LEVELS veces: avanzar es O(1) amortizado y nunca se
+// recorren timers que todavía no vencen. Mismo TimerEntry que la de arriba.
+#define TIMER_HWHEEL_BITS   6
+#define TIMER_HWHEEL_SLOTS  (1u << TIMER_HWHEEL_BITS)
+#define TIMER_HWHEEL_LEVELS 5       // 64^5 ticks (34 años con ticks de 1 s)
+
+typedef struct {
+    TimerEntry slots[TIMER_HWHEEL_LEVELS][TIMER_HWHEEL_SLOTS];
+    uint32_t tick_ms;
+    uint64_t current_tick;
+    size_t count;
+} HierTimerWheel;
+
+void timer_hwheel_init(HierTimerWheel *w, uint32_t tick_ms, uint64_t now_ms);
+void timer_hwheel_add(HierTimerWheel *w, TimerEntry *timer, uint64_t expires_ms);
+void timer_hwheel_cancel(HierTimerWheel *w, TimerEntry *timer);
+// Como timer_wheel_advance. fn puede liberar el timer que recibe.
+int timer_hwheel_advance(HierTimerWheel *w, uint64_t now_ms, timer_fn fn, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+// Tracer por muestreo en formato Chrome trace-event (JSON), legible en
+// chrome://tracing y en Perfetto. Cada thread acumula los spans de su request
+// en un buffer local; solo las requests muestreadas (1 de cada N, o las que
+// superan el umbral de latencia) se encolan sin locks y un thread de fondo
+// las escribe al archivo cada 100 ms. Con la cola llena la traza se descarta
+// (contador trace_dropped).
+
+// path NULL desactiva el tracer. sample_every = 0 desactiva el muestreo por
+// conteo; threshold_us = 0 desactiva el muestreo por latencia.
+int tracer_init(const char *path, int sample_every, uint64_t threshold_us);
+void tracer_shutdown(void);
+int tracer_enabled(void);
+
+// Delimitan una request completa; rx_ns es el instante de recvfrom
+void tracer_request_begin(uint64_t rx_ns, const char *label);
+void tracer_request_label(const char *label);
+void tracer_request_end(void);
+
+// Spans anidados dentro de la request actual del thread
+void tracer_span_begin(const char *name);
+void tracer_span_end(void);
+void tracer_span_add(const char *name, uint64_t start_ns, uint64_t end_ns);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+// Capa de transporte del servidor: recibe y envía datagramas en lotes sin que
+// el stack CoAP sepa si vienen de UDP, de un socket Unix o de memoria.
+//
+// Implementaciones:
+//   udp       recvmmsg/sendmmsg sobre un socket UDP
+//   unix      lo mismo sobre un socket Unix de datagramas
+//   loopback  dos colas MPMC lock-free en el mismo proceso (benchmarks)
+
+#define TRANSPORT_MAX_DATAGRAM 1024
+#define TRANSPORT_BATCH 32
+
+// Dirección del otro extremo; en loopback guarda el id de cliente
+typedef struct {
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+} TransportPeer;
+
+typedef struct {
+    uint8_t *data;          // en recv: buffer de TRANSPORT_MAX_DATAGRAM bytes
+    size_t len;
+    TransportPeer peer;
+} TransportDatagram;
+
+typedef struct Transport Transport;
+
+typedef struct {
+    const char *name;
+    // Bloquea hasta tener al menos un datagrama. Devuelve cuántos llenó,
+    // 0 si fue interrumpido, -1 si hubo error (errno = ESHUTDOWN al cerrarse).
+    int (*recv_batch)(Transport *t, TransportDatagram *dgrams, int max);
+    // Devuelve cuántos datagramas se enviaron (los primeros n), -1 si ninguno
+    int (*send_batch)(Transport *t, const TransportDatagram *dgrams, int count);
+    void (*close)(Transport *t);
+} TransportOps;
+
+struct Transport {
+    const TransportOps *ops;
+    int fd;                 // -1 en loopback
+    void *impl;
+};
+
+int transport_udp_open(Transport *t, int port);
+int transport_unix_open(Transport *t, const char *path);
+int transport_loopback_open(Transport *t, uint32_t capacity);
+
+static inline int transport_recv_batch(Transport *t, TransportDatagram *dgrams, int max)
+{
+    return t->ops->recv_batch(t, dgrams, max);
+}
+
+static inline int transport_send_batch(Transport *t, const TransportDatagram *dgrams, int count)
+{
+    return t->ops->send_batch(t, dgrams, count);
+}
+
+static inline void transport_close(Transport *t)
+{
+    if (t && t->ops) t->ops->close(t);
+}
+
+// "ip:puerto", "[ipv6]:puerto", "unix:<ruta>" o "loop:<id>"
+int transport_peer_format(const TransportPeer *peer, char *out, size_t size);
+
+// Lado cliente del loopback: inyectar requests y recoger respuestas.
+// send devuelve -1 si la cola está llena; recv devuelve 0 si no hay nada.
+int transport_loopback_send(Transport *t, uint32_t client_id, const uint8_t *data, size_t len);
+int transport_loopback_recv(Transport *t, uint32_t *client_id, uint8_t *buf, size_t size);
+// Despierta a quien esté en recv_batch y hace que devuelva -1
+void transport_loopback_shutdown(Transport *t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct MessageData;
+
+// Pool fijo de workers con carriles de prioridad. El loop de recepción
+// clasifica cada datagrama mirando solo el header (tipo, código y primer
+// segmento del Uri-Path) y lo encola en su carril; los workers atienden los
+// carriles con Deficit Round Robin, así una ráfaga de escrituras NON no
+// retrasa a los CON cuyo emisor está contando el timeout de retransmisión.
+
+typedef enum {
+    LANE_MGMT,          // /.well-known/*
+    LANE_CON_READ,
+    LANE_CON_WRITE,
+    LANE_NON_READ,
+    LANE_NON_WRITE,
+    LANE_COUNT
+} WorkerLane;
+
+typedef struct WorkerPool WorkerPool;
+
+// Lo llama un worker por cada datagrama; es dueño de msg y debe liberarlo
+typedef void (*worker_fn)(struct MessageData *msg, void *ctx);
+
+// capacity = datagramas en cola por carril
+WorkerPool *worker_pool_create(int workers, uint32_t capacity, worker_fn fn, void *ctx);
+// Procesa lo que quedaba en cola, detiene los workers y libera todo
+void worker_pool_destroy(WorkerPool *pool);
+
+WorkerLane worker_pool_classify(const uint8_t *data, size_t len);
+
+// Encola un lote con un solo lock. Los mensajes encolados pasan al pool y
+// su entrada queda en NULL; los que no entran (carril lleno) quedan en msgs.
+// Devuelve cuántos encoló.
+int worker_pool_submit_batch(WorkerPool *pool, struct MessageData **msgs, int count);
+
+// Datagramas en cola en un carril (sin lock, aproximado)
+size_t worker_pool_queued(const WorkerPool *pool, WorkerLane lane);
+
+const char *worker_lane_name(WorkerLane lane);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif